@@ -0,0 +1,161 @@
+#include "aliasing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool livesOverlap(const TransientResourceDesc& a, const TransientResourceDesc& b) {
+		return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+	}
+
+	bool memoryOverlaps(uint64_t offsetA, uint64_t sizeA, uint64_t offsetB, uint64_t sizeB) {
+		return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+	}
+}
+
+TransientHeapLayout
+packTransientResources(const std::vector<TransientResourceDesc>& resources) {
+	TransientHeapLayout layout;
+	layout.offsets.resize(resources.size(), 0);
+
+	// biggest first gives the tightest packing for this kind of greedy placement,
+	// ties are broken by lifetime start so the result is deterministic
+	std::vector<uint32_t> order(resources.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		if (resources[a].sizeInBytes != resources[b].sizeInBytes) {
+			return resources[a].sizeInBytes > resources[b].sizeInBytes;
+		}
+		return resources[a].firstPass < resources[b].firstPass;
+	});
+
+	std::vector<uint32_t> placed;
+	placed.reserve(resources.size());
+
+	for (uint32_t index : order) {
+		const TransientResourceDesc& resource = resources[index];
+		layout.committedSize += alignUp(resource.sizeInBytes, resource.alignment);
+
+		// memory ranges already taken by resources alive at the same time as this one
+		std::vector<std::pair<uint64_t, uint64_t>> taken;
+		for (uint32_t other : placed) {
+			if (livesOverlap(resource, resources[other])) {
+				taken.push_back({ layout.offsets[other], layout.offsets[other] + resources[other].sizeInBytes });
+			}
+		}
+		std::sort(taken.begin(), taken.end());
+
+		// first fit: walk the taken ranges from the bottom of the heap and stop at the first gap
+		uint64_t offset = 0;
+		for (const auto& range : taken) {
+			if (offset + resource.sizeInBytes <= range.first) {
+				break;
+			}
+			offset = std::max(offset, alignUp(range.second, resource.alignment));
+		}
+
+		layout.offsets[index] = offset;
+		layout.heapSize = std::max(layout.heapSize, offset + resource.sizeInBytes);
+		placed.push_back(index);
+	}
+
+	// aliasing barriers: whenever a resource starts living in memory that an earlier
+	// resource of the same frame used, the GPU needs to know before the first access
+	for (uint32_t after = 0; after < resources.size(); after++) {
+		uint32_t before = kNoTransientResource;
+		uint32_t numPredecessors = 0;
+
+		for (uint32_t other = 0; other < resources.size(); other++) {
+			if (resources[other].lastPass < resources[after].firstPass &&
+				memoryOverlaps(layout.offsets[other], resources[other].sizeInBytes,
+					layout.offsets[after], resources[after].sizeInBytes)) {
+				before = other;
+				numPredecessors++;
+			}
+		}
+
+		if (numPredecessors > 0) {
+			layout.barriers.push_back({ resources[after].firstPass,
+				numPredecessors == 1 ? before : kNoTransientResource, after });
+		}
+	}
+
+	std::stable_sort(layout.barriers.begin(), layout.barriers.end(),
+		[](const TransientAliasingBarrier& a, const TransientAliasingBarrier& b) { return a.pass < b.pass; });
+
+	return layout;
+}
+
+std::vector<TransientResourceDesc>
+buildSyntheticTransientFrame(uint32_t width, uint32_t height) {
+	std::vector<TransientResourceDesc> resources;
+
+	// bytesPerPixel, resolution divider and the inclusive pass interval
+	auto add = [&](const char* name, uint32_t bytesPerPixel, uint32_t divider, uint32_t firstPass, uint32_t lastPass) {
+		TransientResourceDesc desc;
+		desc.name = name;
+		desc.sizeInBytes = uint64_t(std::max(1u, width / divider)) * std::max(1u, height / divider) * bytesPerPixel;
+		desc.firstPass = firstPass;
+		desc.lastPass = lastPass;
+		resources.push_back(desc);
+	};
+
+	add("GBufferAlbedo", 4, 1, 0, 5);
+	add("GBufferNormal", 8, 1, 0, 5);
+	add("GBufferMaterial", 4, 1, 0, 5);
+	add("Depth", 4, 1, 0, 9);
+	add("Velocity", 4, 1, 0, 12);
+	add("SSAORaw", 1, 2, 1, 2);
+	add("SSAOBlurred", 1, 1, 2, 5);
+	add("ShadowMask", 1, 1, 3, 5);
+	add("Reflections", 8, 1, 4, 5);
+	add("HDRColor", 8, 1, 5, 10);
+	add("Transparency", 8, 1, 6, 10);
+	add("BloomBright", 8, 2, 7, 8);
+	add("BloomDown1", 8, 4, 8, 9);
+	add("BloomDown2", 8, 8, 9, 10);
+	add("BloomUp1", 8, 4, 10, 11);
+	add("BloomUp0", 8, 2, 11, 12);
+	add("Tonemapped", 4, 1, 12, 13);
+	add("TAAResolve", 4, 1, 13, 14);
+	add("Sharpen", 4, 1, 14, 15);
+	add("UIComposite", 4, 1, 15, 16);
+	add("RaytracingOutput", 4, 1, 16, 17);
+
+	return resources;
+}
+
+TransientAliasingReport
+reportTransientAliasing(const std::vector<TransientResourceDesc>& resources) {
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	TransientAliasingReport report;
+	report.numResources = static_cast<uint32_t>(resources.size());
+	for (const auto& resource : resources) {
+		report.numPasses = std::max(report.numPasses, resource.lastPass + 1);
+	}
+	report.committedSize = layout.committedSize;
+	report.aliasedSize = layout.heapSize;
+	report.numBarriers = static_cast<uint32_t>(layout.barriers.size());
+
+	return report;
+}
+
+std::string formatTransientAliasingReport(const TransientAliasingReport& report) {
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	double saved = report.committedSize > 0 ?
+		100.0 * (1.0 - double(report.aliasedSize) / double(report.committedSize)) : 0.0;
+
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer),
+		"Transient aliasing: %u resources over %u passes, committed %.1f MB, aliased %.1f MB (%.1f%% saved), %u aliasing barriers\n",
+		report.numResources, report.numPasses, report.committedSize * mb, report.aliasedSize * mb, saved, report.numBarriers);
+
+	return buffer;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// CPU side of transient resource aliasing. Nothing in here touches D3D12 so the
+// packing can be run and checked without a device, see transient.h for the GPU side.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t kNoTransientResource = ~0u;
+
+// A resource that only has to exist between two passes of a frame.
+// Passes are numbered in submission order and the interval is inclusive.
+struct TransientResourceDesc {
+	std::string name;
+	uint64_t sizeInBytes = 0;
+	uint64_t alignment = 64 * 1024; // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+	uint32_t firstPass = 0;
+	uint32_t lastPass = 0;
+};
+
+// Aliasing barrier that has to be issued before `pass` starts, because `after`
+// takes over memory that `before` used earlier in the frame.
+// before == kNoTransientResource means several resources were there (null barrier).
+struct TransientAliasingBarrier {
+	uint32_t pass;
+	uint32_t before;
+	uint32_t after;
+};
+
+struct TransientHeapLayout {
+	std::vector<uint64_t> offsets; // heap offset of each resource, same order as the input
+	std::vector<TransientAliasingBarrier> barriers; // sorted by pass
+	uint64_t heapSize = 0; // size of the shared heap
+	uint64_t committedSize = 0; // what it would cost with one committed resource each
+};
+
+// Packs the resources into a single heap. Resources whose pass intervals overlap
+// never share memory, everything else is free to alias. Greedy interval coloring:
+// largest resources are placed first, each at the lowest aligned offset that does not
+// collide with an already placed resource that is alive at the same time.
+TransientHeapLayout
+packTransientResources(const std::vector<TransientResourceDesc>& resources);
+
+struct TransientAliasingReport {
+	uint32_t numPasses = 0;
+	uint32_t numResources = 0;
+	uint64_t committedSize = 0;
+	uint64_t aliasedSize = 0;
+	uint32_t numBarriers = 0;
+};
+
+// Synthetic deferred-style frame (gbuffer, ssao, lighting, bloom chain, post) at the given
+// resolution, used to report how much peak memory aliasing saves.
+std::vector<TransientResourceDesc>
+buildSyntheticTransientFrame(uint32_t width, uint32_t height);
+
+TransientAliasingReport
+reportTransientAliasing(const std::vector<TransientResourceDesc>& resources);
+
+std::string formatTransientAliasingReport(const TransientAliasingReport& report);
@@ -0,0 +1,268 @@
+#include "bindings.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+	using nv_helpers_dx12::RootParameterKind;
+
+	bool sameRegister(const ShaderBinding& a, const ShaderBinding& b) {
+		return a.type == b.type && a.space == b.space && a.bindPoint == b.bindPoint;
+	}
+
+	bool registerOrder(const ShaderBinding& a, const ShaderBinding& b) {
+		return std::make_tuple(a.type, a.space, a.bindPoint) < std::make_tuple(b.type, b.space, b.bindPoint);
+	}
+
+	bool isRootDescriptor(ShaderBindingType type) {
+		return type == ShaderBindingType::Buffer || type == ShaderBindingType::RWBuffer ||
+			type == ShaderBindingType::AccelerationStructure;
+	}
+
+	static_assert(sizeof(ShaderBinding) == 20, "bindings are serialized as is");
+
+	void appendUint32(std::vector<uint8_t>& bytes, uint32_t value) {
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(value));
+	}
+
+	// reads front to back, every read checks it stays inside the bytes
+	class ByteReader {
+	public:
+		ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		bool read(void* destination, size_t size) {
+			if (size > m_size - m_offset) {
+				return false;
+			}
+			if (size == 0) {
+				return true; // destination may be the data of an empty vector
+			}
+			memcpy(destination, m_data + m_offset, size);
+			m_offset += size;
+			return true;
+		}
+
+		bool done() const { return m_offset == m_size; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+	};
+
+	char registerPrefix(ShaderBindingType type) {
+		switch (type) {
+		case ShaderBindingType::ConstantBuffer:
+			return 'b';
+		case ShaderBindingType::RWTexture:
+		case ShaderBindingType::RWBuffer:
+			return 'u';
+		case ShaderBindingType::Sampler:
+			return 's';
+		default:
+			return 't';
+		}
+	}
+}
+
+const std::vector<ShaderBinding>& findExportBindings(const std::vector<ExportBindings>& exports,
+	const std::wstring& exportName) {
+	std::string name(exportName.begin(), exportName.end());
+
+	for (const ExportBindings& exported : exports) {
+		if (exported.name == name) {
+			return exported.bindings;
+		}
+	}
+
+	throw std::runtime_error("no export " + name + " in the library");
+}
+
+// per export: name length, name, number of bindings, bindings
+std::vector<uint8_t> serializeLibraryBindings(const std::vector<ExportBindings>& exports) {
+	std::vector<uint8_t> bytes;
+	appendUint32(bytes, static_cast<uint32_t>(exports.size()));
+
+	for (const ExportBindings& exported : exports) {
+		appendUint32(bytes, static_cast<uint32_t>(exported.name.size()));
+		bytes.insert(bytes.end(), exported.name.begin(), exported.name.end());
+
+		appendUint32(bytes, static_cast<uint32_t>(exported.bindings.size()));
+		const uint8_t* bindings = reinterpret_cast<const uint8_t*>(exported.bindings.data());
+		bytes.insert(bytes.end(), bindings, bindings + exported.bindings.size() * sizeof(ShaderBinding));
+	}
+
+	return bytes;
+}
+
+bool parseLibraryBindings(const uint8_t* data, size_t size, std::vector<ExportBindings>& exports) {
+	exports.clear();
+
+	ByteReader reader(data, size);
+	uint32_t numExports;
+
+	if (!reader.read(&numExports, sizeof(numExports))) {
+		return false;
+	}
+
+	std::vector<ExportBindings> parsed;
+
+	for (uint32_t i = 0; i < numExports; i++) {
+		ExportBindings exported;
+		uint32_t nameLength, numBindings;
+
+		// sizes are checked against what's left before anything gets allocated
+		if (!reader.read(&nameLength, sizeof(nameLength)) || nameLength > size) {
+			return false;
+		}
+		exported.name.resize(nameLength);
+
+		if (!reader.read(exported.name.data(), nameLength) || !reader.read(&numBindings, sizeof(numBindings)) ||
+			numBindings > size / sizeof(ShaderBinding)) {
+			return false;
+		}
+		exported.bindings.resize(numBindings);
+
+		if (!reader.read(exported.bindings.data(), numBindings * sizeof(ShaderBinding))) {
+			return false;
+		}
+
+		parsed.push_back(std::move(exported));
+	}
+
+	if (!reader.done()) {
+		return false;
+	}
+
+	exports = std::move(parsed);
+
+	return true;
+}
+
+std::vector<ShaderBinding> mergeShaderBindings(const std::vector<ShaderBinding>& a, const std::vector<ShaderBinding>& b) {
+	std::vector<ShaderBinding> merged = a;
+
+	for (const ShaderBinding& binding : b) {
+		auto found = std::find_if(merged.begin(), merged.end(),
+			[&](const ShaderBinding& other) { return sameRegister(binding, other); });
+
+		if (found == merged.end()) {
+			merged.push_back(binding);
+		}
+		else {
+			found->bindCount = std::max(found->bindCount, binding.bindCount);
+			found->size = std::max(found->size, binding.size);
+		}
+	}
+
+	return merged;
+}
+
+LocalRootLayout planLocalRootLayout(const std::vector<ShaderBinding>& bindings, uint32_t constantPromotionLimit) {
+	std::vector<ShaderBinding> sorted = bindings;
+	std::sort(sorted.begin(), sorted.end(), registerOrder);
+
+	LocalRootLayout layout;
+	std::vector<LocalRootParameter> constants;
+	LocalRootParameter table = {};
+	table.kind = RootParameterKind::DescriptorTable;
+	LocalRootParameter samplers = table;
+
+	// the root arguments of everything but the promoted constants, which are decided last
+	uint32_t argumentsSize = 0;
+
+	for (const ShaderBinding& binding : sorted) {
+		if (binding.type == ShaderBindingType::ConstantBuffer && binding.bindCount == 1) {
+			LocalRootParameter parameter = {};
+			parameter.kind = RootParameterKind::Constants;
+			parameter.binding = binding;
+			parameter.num32BitValues = (binding.size + 3) / 4;
+			constants.push_back(parameter);
+		}
+		else if (isRootDescriptor(binding.type) && binding.bindCount == 1) {
+			LocalRootParameter parameter = {};
+			parameter.kind = RootParameterKind::Descriptor;
+			parameter.binding = binding;
+			layout.parameters.push_back(parameter);
+			argumentsSize += 8;
+		}
+		else if (binding.type == ShaderBindingType::Sampler) {
+			samplers.ranges.push_back(binding);
+		}
+		else {
+			table.ranges.push_back(binding);
+		}
+	}
+
+	for (LocalRootParameter* parameter : { &table, &samplers }) {
+		if (!parameter->ranges.empty()) {
+			parameter->binding = parameter->ranges.front();
+			layout.parameters.push_back(*parameter);
+			argumentsSize += 8;
+		}
+	}
+
+	// constant buffers too big to promote stay behind a root CBV, in order with the descriptors. A
+	// local signature has no DWORD budget, only the record stride limits it.
+	for (LocalRootParameter& parameter : constants) {
+		if (!nv_helpers_dx12::PromoteToLocalRootConstants(parameter.binding.size, constantPromotionLimit, argumentsSize)) {
+			parameter.kind = RootParameterKind::Descriptor;
+			parameter.num32BitValues = 0;
+			argumentsSize += 8;
+		}
+		else {
+			argumentsSize += 4 * parameter.num32BitValues;
+		}
+	}
+
+	std::stable_partition(constants.begin(), constants.end(),
+		[](const LocalRootParameter& parameter) { return parameter.kind == RootParameterKind::Descriptor; });
+	layout.parameters.insert(layout.parameters.end(), constants.begin(), constants.end());
+
+	// 8 byte arguments first, so the offsets need no padding
+	uint32_t offset = 0;
+
+	for (LocalRootParameter& parameter : layout.parameters) {
+		parameter.offset = offset;
+		offset += parameter.kind == RootParameterKind::Constants ? 4 * parameter.num32BitValues : 8;
+	}
+
+	layout.argumentsSize = offset;
+
+	return layout;
+}
+
+nv_helpers_dx12::RootSignatureCost localRootLayoutCost(const LocalRootLayout& layout) {
+	std::vector<nv_helpers_dx12::RootParameterCost> parameters;
+
+	for (const LocalRootParameter& parameter : layout.parameters) {
+		parameters.push_back({ parameter.kind, parameter.num32BitValues });
+	}
+
+	return nv_helpers_dx12::ComputeRootSignatureCost(parameters);
+}
+
+std::string undecorateExportName(const std::string& name) {
+	size_t begin = name.find('?');
+
+	if (begin == std::string::npos) {
+		return name;
+	}
+
+	size_t end = name.find('@', begin);
+
+	return name.substr(begin + 1, end == std::string::npos ? std::string::npos : end - begin - 1);
+}
+
+std::string formatShaderBinding(const ShaderBinding& binding) {
+	std::string text = registerPrefix(binding.type) + std::to_string(binding.bindPoint);
+
+	if (binding.space != 0) {
+		text += ", space" + std::to_string(binding.space);
+	}
+
+	return text;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// Local root signatures planned from what a shader actually binds, no D3D12 or DXC in here.
+// The bindings come from reflecting the compiled library (reflectLibrary in shaders.h), done by
+// shaderpack for the libraries in the shader archive, so a variant that compiles a resource out
+// also drops it from its signature and its records.
+//
+// Every binding that can be a root argument becomes one, a descriptor table is only used for
+// what can't: textures, typed buffers and samplers.
+//  - structured and byte address buffers, acceleration structures: root SRV/UAV, 8 bytes
+//  - constant buffers: root constants up to the promotion limit as long as the record stays within
+//    the largest stride, root CBV otherwise
+//  - the rest: one descriptor table, its ranges sorted by type, space and register, and a second
+//    one for samplers, which can't share a table with the others
+// Descriptors and the table come first and constants last, so no argument needs padding.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dxr/RootSignatureCost.h"
+
+enum class ShaderBindingType : uint32_t {
+	ConstantBuffer,
+	Texture, // textures and typed buffers
+	Buffer, // structured and byte address buffers
+	RWTexture, // typed UAVs
+	RWBuffer, // structured and byte address UAVs
+	AccelerationStructure,
+	Sampler
+};
+
+struct ShaderBinding {
+	ShaderBindingType type;
+	uint32_t bindPoint;
+	uint32_t bindCount;
+	uint32_t space;
+	uint32_t size; // constant buffers only, in bytes
+};
+
+inline bool operator==(const ShaderBinding& a, const ShaderBinding& b) {
+	return a.type == b.type && a.bindPoint == b.bindPoint && a.bindCount == b.bindCount &&
+		a.space == b.space && a.size == b.size;
+}
+
+// What one export of a library binds, by its undecorated name
+struct ExportBindings {
+	std::string name;
+	std::vector<ShaderBinding> bindings;
+};
+
+// The bindings of the export, throws std::runtime_error if the library has none by that name
+const std::vector<ShaderBinding>& findExportBindings(const std::vector<ExportBindings>& exports,
+	const std::wstring& exportName);
+
+// What a library's exports bind, as stored next to it in the shader archive. Parsing checks
+// every size against the bytes, false if they don't add up.
+std::vector<uint8_t> serializeLibraryBindings(const std::vector<ExportBindings>& exports);
+bool parseLibraryBindings(const uint8_t* data, size_t size, std::vector<ExportBindings>& exports);
+
+// The bindings of several exports sharing a record, e.g. the closest hit and any hit shaders of
+// a hit group. A register bound by both is kept once, with the larger count and size.
+std::vector<ShaderBinding> mergeShaderBindings(const std::vector<ShaderBinding>& a, const std::vector<ShaderBinding>& b);
+
+struct LocalRootParameter {
+	nv_helpers_dx12::RootParameterKind kind;
+	// Descriptor and Constants: the binding, Table: the first range
+	ShaderBinding binding;
+	uint32_t num32BitValues; // Constants only
+	std::vector<ShaderBinding> ranges; // Table only, laid out back to back in the heap
+	uint32_t offset; // of the root argument, from the end of the shader identifier
+};
+
+struct LocalRootLayout {
+	std::vector<LocalRootParameter> parameters;
+	uint32_t argumentsSize = 0; // bytes after the shader identifier
+};
+
+LocalRootLayout planLocalRootLayout(const std::vector<ShaderBinding>& bindings,
+	uint32_t constantPromotionLimit = nv_helpers_dx12::kDefaultConstantPromotionLimit);
+
+nv_helpers_dx12::RootSignatureCost localRootLayoutCost(const LocalRootLayout& layout);
+
+// Writes the root arguments of one record, argumentsSize bytes. write(parameter, destination)
+// puts the value of each parameter at destination: 8 bytes for tables and descriptors,
+// 4 * num32BitValues for constants.
+template <typename Write>
+void writeLocalRootArguments(const LocalRootLayout& layout, uint8_t* arguments, Write&& write) {
+	for (const LocalRootParameter& parameter : layout.parameters) {
+		write(parameter, arguments + parameter.offset);
+	}
+}
+
+// "\x01?ClosestHit@@YAXUHitInfo@@UAttributes@@@Z" to "ClosestHit", undecorated names as they are
+std::string undecorateExportName(const std::string& name);
+
+// e.g. "t1" or "u0, space1", for errors about a binding
+std::string formatShaderBinding(const ShaderBinding& binding);
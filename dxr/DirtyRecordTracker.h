@@ -0,0 +1,132 @@
+/*
+The DirtyRecordTracker keeps track of which records of a table changed, for several copies of
+that table. Each copy is typically the buffer of one frame in flight: a record changed while the
+GPU reads one copy is rewritten in each copy the next time that copy is safe to write, and the
+records which did not change are left alone.
+
+Example:
+
+DirtyRecordTracker tracker;
+tracker.Resize(numRecords);  // all records of all copies are dirty
+tracker.MarkDirty(hitGroupRecord);
+
+// when the copy of this frame can be written
+for (const DirtyRecordTracker::Range& range : tracker.TakeRanges(frameSlot))
+{
+  // rewrite records range.first to range.first + range.count - 1
+}
+
+It has no dependency on D3D12.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+class DirtyRecordTracker
+{
+public:
+  /// Consecutive dirty records
+  struct Range
+  {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  /// Set the number of records, which makes all of them dirty in every copy, as after a change of
+  /// layout nothing written before is valid
+  void Resize(uint32_t numRecords)
+  {
+    m_numRecords = numRecords;
+    for (Copy& copy : m_copies)
+    {
+      MarkAll(copy);
+    }
+  }
+
+  /// Record changed, every copy has to be rewritten
+  void MarkDirty(uint32_t record)
+  {
+    if (record >= m_numRecords)
+    {
+      return;
+    }
+    for (Copy& copy : m_copies)
+    {
+      if (!copy.m_dirty[record])
+      {
+        copy.m_dirty[record] = 1;
+        copy.m_dirtyRecords.push_back(record);
+      }
+    }
+  }
+
+  /// The dirty records of a copy as sorted, coalesced ranges, and mark them clean in that copy.
+  /// A copy seen for the first time has all its records dirty.
+  const std::vector<Range>& TakeRanges(uint32_t copyIndex)
+  {
+    while (m_copies.size() <= copyIndex)
+    {
+      m_copies.emplace_back();
+      MarkAll(m_copies.back());
+    }
+
+    Copy& copy = m_copies[copyIndex];
+    std::sort(copy.m_dirtyRecords.begin(), copy.m_dirtyRecords.end());
+
+    m_ranges.clear();
+    for (uint32_t record : copy.m_dirtyRecords)
+    {
+      if (!m_ranges.empty() && m_ranges.back().first + m_ranges.back().count == record)
+      {
+        m_ranges.back().count++;
+      }
+      else
+      {
+        m_ranges.push_back({record, 1});
+      }
+      copy.m_dirty[record] = 0;
+    }
+    copy.m_dirtyRecords.clear();
+
+    return m_ranges;
+  }
+
+  /// Whether the copy has anything to rewrite
+  bool IsDirty(uint32_t copyIndex) const
+  {
+    return copyIndex >= m_copies.size() || !m_copies[copyIndex].m_dirtyRecords.empty();
+  }
+
+  uint32_t NumRecords() const { return m_numRecords; }
+
+private:
+  /// Dirty flags by record, plus the list of the dirty ones so taking them does not scan all
+  /// records
+  struct Copy
+  {
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint32_t> m_dirtyRecords;
+  };
+
+  void MarkAll(Copy& copy)
+  {
+    copy.m_dirty.assign(m_numRecords, 1);
+    copy.m_dirtyRecords.resize(m_numRecords);
+    for (uint32_t record = 0; record < m_numRecords; record++)
+    {
+      copy.m_dirtyRecords[record] = record;
+    }
+  }
+
+  uint32_t m_numRecords = 0;
+  std::vector<Copy> m_copies;
+  std::vector<Range> m_ranges;
+};
+
+} // namespace nv_helpers_dx12
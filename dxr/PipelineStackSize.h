@@ -0,0 +1,115 @@
+/*
+The smallest stack a raytracing pipeline needs, computed from the stack size of each of its shaders
+and from which of them trace rays.
+
+Without SetPipelineStackSize the runtime assumes every closest hit and miss shader may trace rays
+down to the maximum recursion depth, and that any shader may call callable shaders two deep. A
+pipeline whose hit and miss shaders don't trace rays only ever has one of them on top of the ray
+generation shader, whatever the recursion depth, and a smaller stack leaves room for more rays in
+flight.
+
+For each level of recursion the stack holds either the traversal (intersection and any hit
+shaders) or one closest hit or miss shader, plus the level below if that shader traces rays. The
+ray generation shader is at the bottom, callable shaders are counted on top of the deepest level.
+Intersection and any hit shaders are not paired by hit group, the largest of each is used.
+
+Example:
+
+uint64_t stackSize = ComputePipelineStackSize({{ShaderStage::RayGeneration, 256, true},
+                                               {ShaderStage::ClosestHit, 64, false},
+                                               {ShaderStage::Miss, 16, false}},
+                                              1);
+// stackSize == 320
+
+It has no dependency on D3D12.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+enum class ShaderStage
+{
+  RayGeneration,
+  Miss,
+  ClosestHit,
+  AnyHit,
+  Intersection,
+  Callable
+};
+
+struct ShaderStackUsage
+{
+  ShaderStage stage;
+  /// Bytes, as returned by ID3D12StateObjectProperties::GetShaderStackSize
+  uint64_t stackSize;
+  /// Whether the shader calls TraceRay, only meaningful for ray generation, closest hit and miss
+  bool tracesRays;
+};
+
+/// Stack size in bytes for a pipeline made of shaders, tracing rays at most maxRecursionDepth deep
+/// and calling callable shaders at most maxCallableDepth deep
+inline uint64_t ComputePipelineStackSize(const std::vector<ShaderStackUsage>& shaders,
+                                         uint32_t maxRecursionDepth, uint32_t maxCallableDepth = 0)
+{
+  uint64_t intersection = 0;
+  uint64_t anyHit = 0;
+  uint64_t callable = 0;
+
+  for (const ShaderStackUsage& shader : shaders)
+  {
+    uint64_t* largest = shader.stage == ShaderStage::Intersection ? &intersection
+                        : shader.stage == ShaderStage::AnyHit     ? &anyHit
+                        : shader.stage == ShaderStage::Callable   ? &callable
+                                                                  : nullptr;
+    if (largest && shader.stackSize > *largest)
+    {
+      *largest = shader.stackSize;
+    }
+  }
+
+  // From the deepest level up, the stack a TraceRay at the level above needs. Shaders at the
+  // deepest level can't trace rays, so nothing is below them.
+  uint64_t below = 0;
+
+  for (uint32_t level = maxRecursionDepth; level > 0; level--)
+  {
+    uint64_t frame = intersection + anyHit;
+
+    for (const ShaderStackUsage& shader : shaders)
+    {
+      if (shader.stage == ShaderStage::ClosestHit || shader.stage == ShaderStage::Miss)
+      {
+        uint64_t stack = shader.stackSize + (shader.tracesRays ? below : 0);
+        if (stack > frame)
+        {
+          frame = stack;
+        }
+      }
+    }
+
+    below = frame;
+  }
+
+  uint64_t rayGeneration = 0;
+
+  for (const ShaderStackUsage& shader : shaders)
+  {
+    if (shader.stage == ShaderStage::RayGeneration)
+    {
+      uint64_t stack = shader.stackSize + (shader.tracesRays ? below : 0);
+      if (stack > rayGeneration)
+      {
+        rayGeneration = stack;
+      }
+    }
+  }
+
+  return rayGeneration + maxCallableDepth * callable;
+}
+
+} // namespace nv_helpers_dx12
@@ -42,7 +42,6 @@ compiling in debug mode.
 #include "RaytracingPipelineGenerator.h"
 
 #include "dxcapi.h"
-#include <unordered_set>
 
 namespace nv_helpers_dx12
 {
@@ -51,7 +50,16 @@ namespace nv_helpers_dx12
 // The pipeline helper requires access to the device, as well as the
 // raytracing device prior to Windows 10 RS5.
 RayTracingPipelineGenerator::RayTracingPipelineGenerator(ID3D12Device5* device)
-    : m_device(device)
+    : RayTracingPipelineGenerator(device, m_ownSymbols)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Same, with names interned in a symbol table shared with other helpers
+RayTracingPipelineGenerator::RayTracingPipelineGenerator(ID3D12Device5* device,
+                                                         ShaderSymbolTable& symbols)
+    : m_device(device), m_symbols(&symbols)
 {
   // The pipeline creation requires having at least one empty global and local root signatures, so
   // we systematically create both, as this does not incur any overhead
@@ -66,7 +74,13 @@ RayTracingPipelineGenerator::RayTracingPipelineGenerator(ID3D12Device5* device)
 void RayTracingPipelineGenerator::AddLibrary(IDxcBlob* dxilLibrary,
                                              const std::vector<std::wstring>& symbolExports)
 {
-  m_libraries.emplace_back(Library(dxilLibrary, symbolExports));
+  AddLibrary(dxilLibrary, Intern(symbolExports));
+}
+
+void RayTracingPipelineGenerator::AddLibrary(IDxcBlob* dxilLibrary,
+                                             const std::vector<ShaderSymbol>& symbolExports)
+{
+  m_libraries.emplace_back(Library(dxilLibrary, symbolExports, *m_symbols));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -83,9 +97,18 @@ void RayTracingPipelineGenerator::AddHitGroup(const std::wstring& hitGroupName,
                                               const std::wstring& closestHitSymbol,
                                               const std::wstring& anyHitSymbol /*= L""*/,
                                               const std::wstring& intersectionSymbol /*= L""*/)
+{
+  AddHitGroup(m_symbols->Intern(hitGroupName), m_symbols->Intern(closestHitSymbol),
+              m_symbols->Intern(anyHitSymbol), m_symbols->Intern(intersectionSymbol));
+}
+
+void RayTracingPipelineGenerator::AddHitGroup(ShaderSymbol hitGroupName,
+                                              ShaderSymbol closestHitSymbol,
+                                              ShaderSymbol anyHitSymbol /*= kNoShaderSymbol*/,
+                                              ShaderSymbol intersectionSymbol /*= kNoShaderSymbol*/)
 {
   m_hitGroups.emplace_back(
-      HitGroup(hitGroupName, closestHitSymbol, anyHitSymbol, intersectionSymbol));
+      HitGroup(hitGroupName, closestHitSymbol, anyHitSymbol, intersectionSymbol, *m_symbols));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -96,7 +119,14 @@ void RayTracingPipelineGenerator::AddHitGroup(const std::wstring& hitGroupName,
 void RayTracingPipelineGenerator::AddRootSignatureAssociation(
     ID3D12RootSignature* rootSignature, const std::vector<std::wstring>& symbols)
 {
-  m_rootSignatureAssociations.emplace_back(RootSignatureAssociation(rootSignature, symbols));
+  AddRootSignatureAssociation(rootSignature, Intern(symbols));
+}
+
+void RayTracingPipelineGenerator::AddRootSignatureAssociation(
+    ID3D12RootSignature* rootSignature, const std::vector<ShaderSymbol>& symbols)
+{
+  m_rootSignatureAssociations.emplace_back(
+      RootSignatureAssociation(rootSignature, symbols, *m_symbols));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -131,21 +161,171 @@ void RayTracingPipelineGenerator::SetMaxRecursionDepth(UINT maxDepth)
   m_maxRecursionDepth = maxDepth;
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// Deepest chain of callable shader calls, only used for the pipeline stack size
+void RayTracingPipelineGenerator::SetMaxCallableDepth(UINT maxDepth)
+{
+  m_maxCallableDepth = maxDepth;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Declare the stage of an exported shader and whether it traces rays, for the pipeline stack size.
+// A later declaration of the same symbol replaces the earlier one.
+void RayTracingPipelineGenerator::SetShaderStage(const std::wstring& symbol, ShaderStage stage,
+                                                 bool tracesRays /*= false*/)
+{
+  SetShaderStage(m_symbols->Intern(symbol), stage, tracesRays);
+}
+
+void RayTracingPipelineGenerator::SetShaderStage(ShaderSymbol symbol, ShaderStage stage,
+                                                 bool tracesRays /*= false*/)
+{
+  for (ShaderStageDeclaration& declaration : m_shaderStages)
+  {
+    if (declaration.m_symbol == symbol)
+    {
+      declaration.m_stage = stage;
+      declaration.m_tracesRays = tracesRays;
+      return;
+    }
+  }
+  m_shaderStages.push_back({symbol, stage, tracesRays});
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Allow GenerateAdditions to grow the state object created by the next Generate
+void RayTracingPipelineGenerator::SetAllowStateObjectAdditions(bool allow)
+{
+  m_allowStateObjectAdditions = allow;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// State object additions came with raytracing tier 1.1 and ID3D12Device7
+bool RayTracingPipelineGenerator::SupportsStateObjectAdditions() const
+{
+  D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
+  if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5, &options5,
+                                           sizeof(options5))))
+  {
+    return false;
+  }
+  return options5.RaytracingTier >= D3D12_RAYTRACING_TIER_1_1;
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // Compiles the raytracing state object
 ID3D12StateObject* RayTracingPipelineGenerator::Generate()
+{
+  ID3D12StateObject* rtStateObject =
+      CreateStateObject(D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE, 0, 0, 0);
+
+  // Everything added so far is in the pipeline now
+  m_generatedLibraries = m_libraries.size();
+  m_generatedHitGroups = m_hitGroups.size();
+  m_generatedAssociations = m_rootSignatureAssociations.size();
+  m_growable = m_allowStateObjectAdditions;
+
+  return rtStateObject;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Whether libraries, hit groups or associations were added since the pipeline was generated
+bool RayTracingPipelineGenerator::HasAdditions() const
+{
+  return m_libraries.size() > m_generatedLibraries || m_hitGroups.size() > m_generatedHitGroups ||
+         m_rootSignatureAssociations.size() > m_generatedAssociations;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Compile what was added since the last Generate or GenerateAdditions into a collection, and add
+// that collection to the pipeline. Only the new shaders are compiled, the existing ones are neither
+// recompiled nor relinked, and keep their shader identifiers.
+ID3D12StateObject* RayTracingPipelineGenerator::GenerateAdditions(ID3D12StateObject* pipeline)
+{
+  if (!m_growable)
+  {
+    throw std::logic_error("The pipeline was not generated with state object additions allowed");
+  }
+
+  if (!HasAdditions())
+  {
+    pipeline->AddRef();
+    return pipeline;
+  }
+
+  Microsoft::WRL::ComPtr<ID3D12Device7> device7;
+  if (FAILED(m_device->QueryInterface(IID_PPV_ARGS(&device7))))
+  {
+    throw std::logic_error("State object additions need ID3D12Device7");
+  }
+
+  // The collection is where the driver compiles the new shaders
+  Microsoft::WRL::ComPtr<ID3D12StateObject> collection;
+  collection.Attach(CreateStateObject(D3D12_STATE_OBJECT_TYPE_COLLECTION, m_generatedLibraries,
+                                      m_generatedHitGroups, m_generatedAssociations));
+
+  // The addition itself only links it in, with every export of the collection
+  D3D12_EXISTING_COLLECTION_DESC collectionDesc = {};
+  collectionDesc.pExistingCollection = collection.Get();
+
+  D3D12_STATE_OBJECT_CONFIG stateObjectConfig = {};
+  stateObjectConfig.Flags = D3D12_STATE_OBJECT_FLAG_ALLOW_STATE_OBJECT_ADDITIONS;
+
+  D3D12_RAYTRACING_PIPELINE_CONFIG pipelineConfig = {};
+  pipelineConfig.MaxTraceRecursionDepth = m_maxRecursionDepth;
+
+  D3D12_STATE_SUBOBJECT subobjects[] = {
+      {D3D12_STATE_SUBOBJECT_TYPE_EXISTING_COLLECTION, &collectionDesc},
+      {D3D12_STATE_SUBOBJECT_TYPE_STATE_OBJECT_CONFIG, &stateObjectConfig},
+      {D3D12_STATE_SUBOBJECT_TYPE_RAYTRACING_PIPELINE_CONFIG, &pipelineConfig}};
+
+  D3D12_STATE_OBJECT_DESC additionDesc = {};
+  additionDesc.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
+  additionDesc.NumSubobjects = static_cast<UINT>(sizeof(subobjects) / sizeof(subobjects[0]));
+  additionDesc.pSubobjects = subobjects;
+
+  ID3D12StateObject* grownStateObject = nullptr;
+  HRESULT hr = device7->AddToStateObject(&additionDesc, pipeline, IID_PPV_ARGS(&grownStateObject));
+  if (FAILED(hr))
+  {
+    throw std::logic_error("Could not add to the raytracing state object");
+  }
+
+  m_generatedLibraries = m_libraries.size();
+  m_generatedHitGroups = m_hitGroups.size();
+  m_generatedAssociations = m_rootSignatureAssociations.size();
+
+  return grownStateObject;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Create a state object of type from the libraries, hit groups and root signature associations
+// starting at the given indices, plus the configuration objects
+ID3D12StateObject* RayTracingPipelineGenerator::CreateStateObject(D3D12_STATE_OBJECT_TYPE type,
+                                                                  size_t firstLibrary,
+                                                                  size_t firstHitGroup,
+                                                                  size_t firstAssociation)
 {
   // The pipeline is made of a set of sub-objects, representing the DXIL libraries, hit group
   // declarations, root signature associations, plus some configuration objects
+  size_t numAssociations = m_rootSignatureAssociations.size() - firstAssociation;
   UINT64 subobjectCount =
-      m_libraries.size() +                     // DXIL libraries
-      m_hitGroups.size() +                     // Hit group declarations
-      1 +                                      // Shader configuration
-      1 +                                      // Shader payload
-      2 * m_rootSignatureAssociations.size() + // Root signature declaration + association
-      2 +                                      // Empty global and local root signatures
-      1;                                       // Final pipeline subobject
+      (m_libraries.size() - firstLibrary) +  // DXIL libraries
+      (m_hitGroups.size() - firstHitGroup) + // Hit group declarations
+      1 +                                    // Shader configuration
+      1 +                                    // Shader payload
+      2 * numAssociations +                  // Root signature declaration + association
+      2 +                                    // Empty global and local root signatures
+      1 +                                    // Final pipeline subobject
+      1;                                     // State object configuration
 
   // Initialize a vector with the target object count. It is necessary to make the allocation before
   // adding subobjects as some subobjects reference other subobjects by pointer. Using push_back may
@@ -155,8 +335,9 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
   UINT currentIndex = 0;
 
   // Add all the DXIL libraries
-  for (const Library& lib : m_libraries)
+  for (size_t i = firstLibrary; i < m_libraries.size(); i++)
   {
+    const Library& lib = m_libraries[i];
     D3D12_STATE_SUBOBJECT libSubobject = {};
     libSubobject.Type = D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY;
     libSubobject.pDesc = &lib.m_libDesc;
@@ -165,8 +346,9 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
   }
 
   // Add all the hit group declarations
-  for (const HitGroup& group : m_hitGroups)
+  for (size_t i = firstHitGroup; i < m_hitGroups.size(); i++)
   {
+    const HitGroup& group = m_hitGroups[i];
     D3D12_STATE_SUBOBJECT hitGroup = {};
     hitGroup.Type = D3D12_STATE_SUBOBJECT_TYPE_HIT_GROUP;
     hitGroup.pDesc = &group.m_desc;
@@ -185,17 +367,25 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
 
   subobjects[currentIndex++] = shaderConfigObject;
 
+  ShaderExports exports = Exports();
+
+#ifdef _DEBUG
+  // Sanity checks in debug mode. Additions are linked against the pipeline, so their hit groups
+  // may use the shaders it already holds as well as those of the new libraries.
+  CheckShaderExports(exports, m_symbols->Size(), firstLibrary, firstHitGroup, firstAssociation);
+#endif
+
   // Build a list of all the symbols for ray generation, miss and hit groups
   // Those shaders have to be associated with the payload definition
-  std::vector<std::wstring> exportedSymbols = {};
+  std::vector<ShaderSymbol> exportedSymbols =
+      ListShaderExports(exports, m_symbols->Size(), firstLibrary, firstHitGroup);
   std::vector<LPCWSTR> exportedSymbolPointers = {};
-  BuildShaderExportList(exportedSymbols);
 
-  // Build an array of the string pointers
+  // Build an array of the string pointers, owned by the symbol table
   exportedSymbolPointers.reserve(exportedSymbols.size());
-  for (const auto& name : exportedSymbols)
+  for (ShaderSymbol symbol : exportedSymbols)
   {
-    exportedSymbolPointers.push_back(name.c_str());
+    exportedSymbolPointers.push_back(m_symbols->Name(symbol));
   }
   const WCHAR** shaderExports = exportedSymbolPointers.data();
 
@@ -215,8 +405,9 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
 
   // The root signature association requires two objects for each: one to declare the root
   // signature, and another to associate that root signature to a set of symbols
-  for (RootSignatureAssociation& assoc : m_rootSignatureAssociations)
+  for (size_t i = firstAssociation; i < m_rootSignatureAssociations.size(); i++)
   {
+    RootSignatureAssociation& assoc = m_rootSignatureAssociations[i];
 
     // Add a subobject to declare the root signature
     D3D12_STATE_SUBOBJECT rootSigObject = {};
@@ -263,9 +454,28 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
 
   subobjects[currentIndex++] = pipelineConfigObject;
 
+  // A pipeline which can be grown later has to say so when it is created. A collection of
+  // additions is linked against that pipeline: its hit groups may use shaders already in there,
+  // and the collections added after it may use its shaders in turn.
+  D3D12_STATE_OBJECT_CONFIG stateObjectConfig = {};
+  stateObjectConfig.Flags =
+      type == D3D12_STATE_OBJECT_TYPE_COLLECTION
+          ? D3D12_STATE_OBJECT_FLAG_ALLOW_LOCAL_DEPENDENCIES_ON_EXTERNAL_DEFINITIONS |
+                D3D12_STATE_OBJECT_FLAG_ALLOW_EXTERNAL_DEPENDENCIES_ON_LOCAL_DEFINITIONS
+          : D3D12_STATE_OBJECT_FLAG_ALLOW_STATE_OBJECT_ADDITIONS;
+
+  if (m_allowStateObjectAdditions || type == D3D12_STATE_OBJECT_TYPE_COLLECTION)
+  {
+    D3D12_STATE_SUBOBJECT stateObjectConfigObject = {};
+    stateObjectConfigObject.Type = D3D12_STATE_SUBOBJECT_TYPE_STATE_OBJECT_CONFIG;
+    stateObjectConfigObject.pDesc = &stateObjectConfig;
+
+    subobjects[currentIndex++] = stateObjectConfigObject;
+  }
+
   // Describe the ray tracing pipeline state object
   D3D12_STATE_OBJECT_DESC pipelineDesc = {};
-  pipelineDesc.Type = D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE;
+  pipelineDesc.Type = type;
   pipelineDesc.NumSubobjects = currentIndex; // static_cast<UINT>(subobjects.size());
   pipelineDesc.pSubobjects = subobjects.data();
 
@@ -280,6 +490,97 @@ ID3D12StateObject* RayTracingPipelineGenerator::Generate()
   return rtStateObject;
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// Smallest stack for the generated state object. The shaders of a hit group are queried through
+// the hit group, as "HitGroup::closesthit" etc., the others by their export name.
+UINT64 RayTracingPipelineGenerator::ComputeStackSize(
+    ID3D12StateObjectProperties* raytracingPipeline) const
+{
+  std::vector<ShaderStackUsage> shaders;
+  std::vector<uint8_t> inHitGroup(m_symbols->Size(), 0);
+
+  for (const HitGroup& group : m_hitGroups)
+  {
+    std::wstring name = m_symbols->Name(group.m_hitGroupName);
+
+    if (group.m_closestHitSymbol != kNoShaderSymbol)
+    {
+      const ShaderStageDeclaration* declaration = FindShaderStage(group.m_closestHitSymbol);
+      shaders.push_back(
+          {ShaderStage::ClosestHit,
+           raytracingPipeline->GetShaderStackSize((name + L"::closesthit").c_str()),
+           declaration && declaration->m_tracesRays});
+      inHitGroup[group.m_closestHitSymbol] = 1;
+    }
+    if (group.m_anyHitSymbol != kNoShaderSymbol)
+    {
+      shaders.push_back({ShaderStage::AnyHit,
+                         raytracingPipeline->GetShaderStackSize((name + L"::anyhit").c_str()),
+                         false});
+      inHitGroup[group.m_anyHitSymbol] = 1;
+    }
+    if (group.m_intersectionSymbol != kNoShaderSymbol)
+    {
+      shaders.push_back(
+          {ShaderStage::Intersection,
+           raytracingPipeline->GetShaderStackSize((name + L"::intersection").c_str()), false});
+      inHitGroup[group.m_intersectionSymbol] = 1;
+    }
+  }
+
+  // An export of unknown stage could be anywhere in the call graph, no size would be safe
+  for (const Library& lib : m_libraries)
+  {
+    for (ShaderSymbol symbol : lib.m_exportedSymbols)
+    {
+      if (inHitGroup[symbol])
+      {
+        continue;
+      }
+
+      const ShaderStageDeclaration* declaration = FindShaderStage(symbol);
+      if (!declaration)
+      {
+        throw std::logic_error("No stage declared for a shader export, the pipeline stack size "
+                               "can't be computed");
+      }
+      shaders.push_back({declaration->m_stage,
+                         raytracingPipeline->GetShaderStackSize(m_symbols->Name(symbol)),
+                         declaration->m_tracesRays});
+    }
+  }
+
+  return ComputePipelineStackSize(shaders, m_maxRecursionDepth, m_maxCallableDepth);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Set the pipeline stack size to the smallest one for the declared call graph
+UINT64 RayTracingPipelineGenerator::SetPipelineStackSize(
+    ID3D12StateObjectProperties* raytracingPipeline) const
+{
+  UINT64 stackSize = ComputeStackSize(raytracingPipeline);
+  raytracingPipeline->SetPipelineStackSize(stackSize);
+  return stackSize;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Declaration of the stage of a symbol, nullptr if there is none
+const RayTracingPipelineGenerator::ShaderStageDeclaration*
+RayTracingPipelineGenerator::FindShaderStage(ShaderSymbol symbol) const
+{
+  for (const ShaderStageDeclaration& declaration : m_shaderStages)
+  {
+    if (declaration.m_symbol == symbol)
+    {
+      return &declaration;
+    }
+  }
+  return nullptr;
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // The pipeline creation requires having at least one empty global and local root signatures, so
@@ -336,97 +637,40 @@ void RayTracingPipelineGenerator::CreateDummyRootSignatures()
 
 //--------------------------------------------------------------------------------------------------
 //
-// Build a list containing the export symbols for the ray generation shaders, miss shaders, and
-// hit group names
-void RayTracingPipelineGenerator::BuildShaderExportList(std::vector<std::wstring>& exportedSymbols)
+// The exports of the libraries, hit groups and associations added so far, by symbol
+ShaderExports RayTracingPipelineGenerator::Exports() const
 {
-  // Get all names from libraries
-  // Get names associated to hit groups
-  // Return list of libraries+hit group names - shaders in hit groups
-
-  std::unordered_set<std::wstring> exports;
+  ShaderExports exports;
 
-  // Add all the symbols exported by the libraries
-  for (const Library& lib : m_libraries)
+  for (const Library& library : m_libraries)
   {
-    for (const auto& exportName : lib.m_exportedSymbols)
-    {
-#ifdef _DEBUG
-      // Sanity check in debug mode: check that no name is exported more than once
-      if (exports.find(exportName) != exports.end())
-      {
-        throw std::logic_error("Multiple definition of a symbol in the imported DXIL libraries");
-      }
-#endif
-      exports.insert(exportName);
-    }
+    exports.libraries.push_back(library.m_exportedSymbols);
   }
-
-#ifdef _DEBUG
-  // Sanity check in debug mode: verify that the hit groups do not reference an unknown shader name
-  std::unordered_set<std::wstring> all_exports = exports;
-
-  for (const auto& hitGroup : m_hitGroups)
+  for (const HitGroup& hitGroup : m_hitGroups)
   {
-    if (!hitGroup.m_anyHitSymbol.empty() && exports.find(hitGroup.m_anyHitSymbol) == exports.end())
-    {
-      throw std::logic_error("Any hit symbol not found in the imported DXIL libraries");
-    }
-
-    if (!hitGroup.m_closestHitSymbol.empty() &&
-        exports.find(hitGroup.m_closestHitSymbol) == exports.end())
-    {
-      throw std::logic_error("Closest hit symbol not found in the imported DXIL libraries");
-    }
-
-    if (!hitGroup.m_intersectionSymbol.empty() &&
-        exports.find(hitGroup.m_intersectionSymbol) == exports.end())
-    {
-      throw std::logic_error("Intersection symbol not found in the imported DXIL libraries");
-    }
-
-    all_exports.insert(hitGroup.m_hitGroupName);
+    exports.hitGroups.push_back({hitGroup.m_hitGroupName, hitGroup.m_closestHitSymbol,
+                                 hitGroup.m_anyHitSymbol, hitGroup.m_intersectionSymbol});
   }
-
-  // Sanity check in debug mode: verify that the root signature associations do not reference an
-  // unknown shader or hit group name
-  for (const auto& assoc : m_rootSignatureAssociations)
+  for (const RootSignatureAssociation& association : m_rootSignatureAssociations)
   {
-    for (const auto& symb : assoc.m_symbols)
-    {
-      if (!symb.empty() && all_exports.find(symb) == all_exports.end())
-      {
-        throw std::logic_error("Root association symbol not found in the "
-                               "imported DXIL libraries and hit group names");
-      }
-    }
+    exports.associations.push_back(association.m_symbols);
   }
-#endif
 
-  // Go through all hit groups and remove the symbols corresponding to intersection, any hit and
-  // closest hit shaders from the symbol set
-  for (const auto& hitGroup : m_hitGroups)
-  {
-    if (!hitGroup.m_anyHitSymbol.empty())
-    {
-      exports.erase(hitGroup.m_anyHitSymbol);
-    }
-    if (!hitGroup.m_closestHitSymbol.empty())
-    {
-      exports.erase(hitGroup.m_closestHitSymbol);
-    }
-    if (!hitGroup.m_intersectionSymbol.empty())
-    {
-      exports.erase(hitGroup.m_intersectionSymbol);
-    }
-    exports.insert(hitGroup.m_hitGroupName);
-  }
+  return exports;
+}
 
-  // Finally build a vector containing ray generation and miss shaders, plus the hit group names
-  for (const auto& name : exports)
+//--------------------------------------------------------------------------------------------------
+//
+// Intern the names passed to the string overloads
+std::vector<ShaderSymbol> RayTracingPipelineGenerator::Intern(const std::vector<std::wstring>& names)
+{
+  std::vector<ShaderSymbol> symbols;
+  symbols.reserve(names.size());
+  for (const auto& name : names)
   {
-    exportedSymbols.push_back(name);
+    symbols.push_back(m_symbols->Intern(name));
   }
+  return symbols;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -434,14 +678,15 @@ void RayTracingPipelineGenerator::BuildShaderExportList(std::vector<std::wstring
 // Store data related to a DXIL library: the library itself, the exported symbols, and the
 // associated descriptors
 RayTracingPipelineGenerator::Library::Library(IDxcBlob* dxil,
-                                              const std::vector<std::wstring>& exportedSymbols)
+                                              const std::vector<ShaderSymbol>& exportedSymbols,
+                                              const ShaderSymbolTable& symbols)
     : m_dxil(dxil), m_exportedSymbols(exportedSymbols), m_exports(exportedSymbols.size())
 {
-  // Create one export descriptor per symbol
+  // Create one export descriptor per symbol, the names are owned by the symbol table
   for (size_t i = 0; i < m_exportedSymbols.size(); i++)
   {
     m_exports[i] = {};
-    m_exports[i].Name = m_exportedSymbols[i].c_str();
+    m_exports[i].Name = symbols.Name(m_exportedSymbols[i]);
     m_exports[i].ExportToRename = nullptr;
     m_exports[i].Flags = D3D12_EXPORT_FLAG_NONE;
   }
@@ -455,42 +700,36 @@ RayTracingPipelineGenerator::Library::Library(IDxcBlob* dxil,
 
 //--------------------------------------------------------------------------------------------------
 //
-// This copy constructor has to be defined so that the export descriptors are set correctly. Using
-// the default constructor would copy the string pointers of the symbols into the descriptors, which
-// would cause issues when the original Library object gets out of scope
+// This copy constructor has to be defined so that the library descriptor points to the export
+// descriptors of the copy. Using the default constructor would point it to those of the original
+// Library object, which would cause issues when it gets out of scope
 RayTracingPipelineGenerator::Library::Library(const Library& source)
-    : Library(source.m_dxil, source.m_exportedSymbols)
+    : m_dxil(source.m_dxil), m_exportedSymbols(source.m_exportedSymbols),
+      m_exports(source.m_exports), m_libDesc(source.m_libDesc)
 {
+  m_libDesc.pExports = m_exports.data();
 }
 
 //--------------------------------------------------------------------------------------------------
 //
 // Create a hit group descriptor from the input hit group name and shader symbols
-RayTracingPipelineGenerator::HitGroup::HitGroup(std::wstring hitGroupName,
-                                                std::wstring closestHitSymbol,
-                                                std::wstring anyHitSymbol /*= L""*/,
-                                                std::wstring intersectionSymbol /*= L""*/)
-    : m_hitGroupName(std::move(hitGroupName)), m_closestHitSymbol(std::move(closestHitSymbol)),
-      m_anyHitSymbol(std::move(anyHitSymbol)), m_intersectionSymbol(std::move(intersectionSymbol))
+RayTracingPipelineGenerator::HitGroup::HitGroup(ShaderSymbol hitGroupName,
+                                                ShaderSymbol closestHitSymbol,
+                                                ShaderSymbol anyHitSymbol,
+                                                ShaderSymbol intersectionSymbol,
+                                                const ShaderSymbolTable& symbols)
+    : m_hitGroupName(hitGroupName), m_closestHitSymbol(closestHitSymbol),
+      m_anyHitSymbol(anyHitSymbol), m_intersectionSymbol(intersectionSymbol)
 {
   // Indicate which shader program is used for closest hit, leave the other
   // ones undefined (default behavior), export the name of the group
-  m_desc.HitGroupExport = m_hitGroupName.c_str();
-  m_desc.ClosestHitShaderImport = m_closestHitSymbol.empty() ? nullptr : m_closestHitSymbol.c_str();
-  m_desc.AnyHitShaderImport = m_anyHitSymbol.empty() ? nullptr : m_anyHitSymbol.c_str();
+  m_desc.HitGroupExport = symbols.Name(m_hitGroupName);
+  m_desc.ClosestHitShaderImport =
+      m_closestHitSymbol == kNoShaderSymbol ? nullptr : symbols.Name(m_closestHitSymbol);
+  m_desc.AnyHitShaderImport =
+      m_anyHitSymbol == kNoShaderSymbol ? nullptr : symbols.Name(m_anyHitSymbol);
   m_desc.IntersectionShaderImport =
-      m_intersectionSymbol.empty() ? nullptr : m_intersectionSymbol.c_str();
-}
-
-//--------------------------------------------------------------------------------------------------
-//
-// This copy constructor has to be defined so that the export descriptors are set correctly. Using
-// the default constructor would copy the string pointers of the symbols into the descriptors, which
-// would cause issues when the original HitGroup object gets out of scope
-RayTracingPipelineGenerator::HitGroup::HitGroup(const HitGroup& source)
-    : HitGroup(source.m_hitGroupName, source.m_closestHitSymbol, source.m_anyHitSymbol,
-               source.m_intersectionSymbol)
-{
+      m_intersectionSymbol == kNoShaderSymbol ? nullptr : symbols.Name(m_intersectionSymbol);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -499,24 +738,14 @@ RayTracingPipelineGenerator::HitGroup::HitGroup(const HitGroup& source)
 // will be built when compiling the pipeline. We store the symbol pointers directly so that they can
 // be used without processing during compilation.
 RayTracingPipelineGenerator::RootSignatureAssociation::RootSignatureAssociation(
-    ID3D12RootSignature* rootSignature, const std::vector<std::wstring>& symbols)
+    ID3D12RootSignature* rootSignature, const std::vector<ShaderSymbol>& symbols,
+    const ShaderSymbolTable& symbolTable)
     : m_rootSignature(rootSignature), m_symbols(symbols), m_symbolPointers(symbols.size())
 {
   for (size_t i = 0; i < m_symbols.size(); i++)
   {
-    m_symbolPointers[i] = m_symbols[i].c_str();
+    m_symbolPointers[i] = symbolTable.Name(m_symbols[i]);
   }
   m_rootSignaturePointer = m_rootSignature;
 }
-
-//--------------------------------------------------------------------------------------------------
-//
-// This copy constructor has to be defined so that the export descriptors are set correctly. Using
-// the default constructor would copy the string pointers of the symbols into the descriptors, which
-// would cause issues when the original RootSignatureAssociation object gets out of scope
-RayTracingPipelineGenerator::RootSignatureAssociation::RootSignatureAssociation(
-    const RootSignatureAssociation& source)
-    : RootSignatureAssociation(source.m_rootSignature, source.m_symbols)
-{
-}
 } // namespace nv_helpers_dx12
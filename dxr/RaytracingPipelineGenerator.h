@@ -55,8 +55,26 @@ pipeline.SetMaxAttributeSize(2 * sizeof(float)); // barycentric coordinates
 
 pipeline.SetMaxRecursionDepth(1);
 
+pipeline.SetShaderStage(L"RayGen", ShaderStage::RayGeneration, true);
+pipeline.SetShaderStage(L"Miss", ShaderStage::Miss);
+
 rtStateObject = pipeline.Generate();
 
+// once the state object exists, the stack sizes of its shaders can be queried
+pipeline.SetPipelineStackSize(rtStateObjectProps.Get());
+
+A pipeline generated with SetAllowStateObjectAdditions(true) can be grown afterwards: libraries,
+hit groups and associations added to the generator after Generate are compiled on their own and
+added to the existing state object, e.g. for the materials of streamed in content. Allowing
+additions costs the driver some freedom in how it compiles the pipeline, only ask for it when
+something will grow the pipeline.
+
+pipeline.AddLibrary(m_newMaterialLibrary.Get(), {L"NewClosestHit"});
+pipeline.AddHitGroup(L"NewHitGroup", L"NewClosestHit");
+pipeline.AddRootSignatureAssociation(m_hitSignature.Get(), {L"NewHitGroup"});
+
+rtStateObject = pipeline.GenerateAdditions(rtStateObject.Get());
+
 */
 
 #pragma once
@@ -69,6 +87,10 @@ rtStateObject = pipeline.Generate();
 #include <vector>
 #include <stdexcept>
 
+#include "PipelineStackSize.h"
+#include "ShaderExports.h"
+#include "ShaderSymbolTable.h"
+
 namespace nv_helpers_dx12
 {
 
@@ -80,10 +102,18 @@ public:
   /// raytracing device prior to Windows 10 RS5.
   RayTracingPipelineGenerator(ID3D12Device5* device);
 
+  /// Same, interning names in symbols, which has to outlive the generator. Share it with the SBT
+  /// generator so the same handles can be used for both.
+  RayTracingPipelineGenerator(ID3D12Device5* device, ShaderSymbolTable& symbols);
+
+  RayTracingPipelineGenerator(const RayTracingPipelineGenerator&) = delete;
+  RayTracingPipelineGenerator& operator=(const RayTracingPipelineGenerator&) = delete;
+
   /// Add a DXIL library to the pipeline. Note that this library has to be
   /// compiled with dxc, using a lib_6_3 target. The exported symbols must correspond exactly to the
   /// names of the shaders declared in the library, although unused ones can be omitted.
   void AddLibrary(IDxcBlob* dxilLibrary, const std::vector<std::wstring>& symbolExports);
+  void AddLibrary(IDxcBlob* dxilLibrary, const std::vector<ShaderSymbol>& symbolExports);
 
   /// In DXR the hit-related shaders are grouped into hit groups. Such shaders are:
   /// - The intersection shader, which can be used to intersect custom geometry, and is called upon
@@ -96,12 +126,17 @@ public:
   void AddHitGroup(const std::wstring& hitGroupName, const std::wstring& closestHitSymbol,
                    const std::wstring& anyHitSymbol = L"",
                    const std::wstring& intersectionSymbol = L"");
+  void AddHitGroup(ShaderSymbol hitGroupName, ShaderSymbol closestHitSymbol,
+                   ShaderSymbol anyHitSymbol = kNoShaderSymbol,
+                   ShaderSymbol intersectionSymbol = kNoShaderSymbol);
 
   /// The shaders and hit groups may have various root signatures. This call associates a root
   /// signature to one or more symbols. All imported symbols must be associated to one root
   /// signature.
   void AddRootSignatureAssociation(ID3D12RootSignature* rootSignature,
                                    const std::vector<std::wstring>& symbols);
+  void AddRootSignatureAssociation(ID3D12RootSignature* rootSignature,
+                                   const std::vector<ShaderSymbol>& symbols);
 
   /// The payload is the way hit or miss shaders can exchange data with the shader that called
   /// TraceRay. When several ray types are used (e.g. primary and shadow rays), this value must be
@@ -120,37 +155,79 @@ public:
   /// algorithms must be flattened to a loop in the ray generation program for best performance.
   void SetMaxRecursionDepth(UINT maxDepth);
 
+  /// Callable shaders can call further callable shaders, this is the deepest chain of them. Only
+  /// used for the pipeline stack size, the runtime default assumes 2.
+  void SetMaxCallableDepth(UINT maxDepth);
+
+  /// Declare the stage of an exported shader, and whether it calls TraceRay, for the pipeline stack
+  /// size. Every ray generation, miss and callable shader needs one, the shaders of hit groups are
+  /// known from AddHitGroup and only need one to mark a closest hit shader tracing rays.
+  void SetShaderStage(const std::wstring& symbol, ShaderStage stage, bool tracesRays = false);
+  void SetShaderStage(ShaderSymbol symbol, ShaderStage stage, bool tracesRays = false);
+
+  /// Create the state object of the next Generate so that GenerateAdditions can grow it. Needs
+  /// raytracing tier 1.1, see SupportsStateObjectAdditions.
+  void SetAllowStateObjectAdditions(bool allow);
+
+  /// Whether the device can grow state objects
+  bool SupportsStateObjectAdditions() const;
+
   /// Compiles the raytracing state object
   ID3D12StateObject* Generate();
 
+  /// Whether anything was added since the last Generate or GenerateAdditions
+  bool HasAdditions() const;
+
+  /// Grow pipeline, the state object returned by the last Generate or GenerateAdditions, with the
+  /// libraries, hit groups and root signature associations added since. Those are compiled into a
+  /// collection on their own and added with ID3D12Device7::AddToStateObject, the shaders already in
+  /// the pipeline are not compiled or linked again and keep their identifiers. The new hit groups
+  /// may use the shaders already in the pipeline, e.g. a material hit group reusing its closest
+  /// hit shader, the associations only refer to new exports. Returns the grown state object, which
+  /// the existing one stays valid next to, or pipeline itself with a new reference if nothing was
+  /// added.
+  ID3D12StateObject* GenerateAdditions(ID3D12StateObject* pipeline);
+
+  /// Smallest stack for the state object created by Generate, from the stack size of each of its
+  /// shaders and the call graph declared with SetShaderStage, see PipelineStackSize.h. Throws
+  /// std::logic_error for an export without a declared stage.
+  UINT64 ComputeStackSize(ID3D12StateObjectProperties* raytracingPipeline) const;
+
+  /// Set the pipeline stack size to ComputeStackSize instead of the runtime default, which assumes
+  /// every hit and miss shader recurses. Returns the size set.
+  UINT64 SetPipelineStackSize(ID3D12StateObjectProperties* raytracingPipeline) const;
+
+  /// The table names are interned in
+  ShaderSymbolTable& Symbols() { return *m_symbols; }
+
 private:
   /// Storage for DXIL libraries and their exported symbols
   struct Library
   {
-    Library(IDxcBlob* dxil, const std::vector<std::wstring>& exportedSymbols);
+    Library(IDxcBlob* dxil, const std::vector<ShaderSymbol>& exportedSymbols,
+            const ShaderSymbolTable& symbols);
 
     Library(const Library& source);
 
     IDxcBlob* m_dxil;
-    const std::vector<std::wstring> m_exportedSymbols;
+    const std::vector<ShaderSymbol> m_exportedSymbols;
 
     std::vector<D3D12_EXPORT_DESC> m_exports;
     D3D12_DXIL_LIBRARY_DESC m_libDesc;
   };
 
   /// Storage for the hit groups, binding the hit group name with the underlying intersection, any
-  /// hit and closest hit symbols
+  /// hit and closest hit symbols. The descriptor points at names owned by the symbol table, so
+  /// copies stay valid.
   struct HitGroup
   {
-    HitGroup(std::wstring hitGroupName, std::wstring closestHitSymbol,
-             std::wstring anyHitSymbol = L"", std::wstring intersectionSymbol = L"");
-
-    HitGroup(const HitGroup& source);
+    HitGroup(ShaderSymbol hitGroupName, ShaderSymbol closestHitSymbol, ShaderSymbol anyHitSymbol,
+             ShaderSymbol intersectionSymbol, const ShaderSymbolTable& symbols);
 
-    std::wstring m_hitGroupName;
-    std::wstring m_closestHitSymbol;
-    std::wstring m_anyHitSymbol;
-    std::wstring m_intersectionSymbol;
+    ShaderSymbol m_hitGroupName;
+    ShaderSymbol m_closestHitSymbol;
+    ShaderSymbol m_anyHitSymbol;
+    ShaderSymbol m_intersectionSymbol;
     D3D12_HIT_GROUP_DESC m_desc = {};
   };
 
@@ -158,28 +235,44 @@ private:
   struct RootSignatureAssociation
   {
     RootSignatureAssociation(ID3D12RootSignature* rootSignature,
-                             const std::vector<std::wstring>& symbols);
-
-    RootSignatureAssociation(const RootSignatureAssociation& source);
+                             const std::vector<ShaderSymbol>& symbols,
+                             const ShaderSymbolTable& symbolTable);
 
     ID3D12RootSignature* m_rootSignature;
     ID3D12RootSignature* m_rootSignaturePointer;
-    std::vector<std::wstring> m_symbols;
+    std::vector<ShaderSymbol> m_symbols;
     std::vector<LPCWSTR> m_symbolPointers;
     D3D12_SUBOBJECT_TO_EXPORTS_ASSOCIATION m_association = {};
   };
 
+  /// Stage of a shader outside of hit groups, or of a closest hit shader tracing rays
+  struct ShaderStageDeclaration
+  {
+    ShaderSymbol m_symbol;
+    ShaderStage m_stage;
+    bool m_tracesRays;
+  };
+
   /// The pipeline creation requires having at least one empty global and local root signatures, so
   /// we systematically create both
   void CreateDummyRootSignatures();
 
-  /// Build a list containing the export symbols for the ray generation shaders, miss shaders, and
-  /// hit group names
-  void BuildShaderExportList(std::vector<std::wstring>& exportedSymbols);
+  const ShaderStageDeclaration* FindShaderStage(ShaderSymbol symbol) const;
+
+  /// Create a state object of type from the libraries, hit groups and associations starting at
+  /// the given indices, everything for a whole pipeline and the new ones for a collection
+  ID3D12StateObject* CreateStateObject(D3D12_STATE_OBJECT_TYPE type, size_t firstLibrary,
+                                       size_t firstHitGroup, size_t firstAssociation);
+
+  /// The exports of the libraries, hit groups and associations added so far, by symbol
+  ShaderExports Exports() const;
+
+  std::vector<ShaderSymbol> Intern(const std::vector<std::wstring>& names);
 
   std::vector<Library> m_libraries = {};
   std::vector<HitGroup> m_hitGroups = {};
   std::vector<RootSignatureAssociation> m_rootSignatureAssociations = {};
+  std::vector<ShaderStageDeclaration> m_shaderStages = {};
 
   UINT m_maxPayLoadSizeInBytes = 0;
   /// Attribute size, initialized to 2 for the barycentric coordinates used by the built-in triangle
@@ -187,12 +280,24 @@ private:
   UINT m_maxAttributeSizeInBytes = 2 * sizeof(float);
   /// Maximum recursion depth, initialized to 1 to at least allow tracing primary rays
   UINT m_maxRecursionDepth = 1;
+  /// Maximum depth of callable shader calls, none by default
+  UINT m_maxCallableDepth = 0;
+
+  bool m_allowStateObjectAdditions = false;
+  /// Whether the last generated pipeline allows additions
+  bool m_growable = false;
+  /// What is already in the pipeline: the first libraries, hit groups and associations, up to
+  /// these counts. GenerateAdditions submits the rest.
+  size_t m_generatedLibraries = 0;
+  size_t m_generatedHitGroups = 0;
+  size_t m_generatedAssociations = 0;
 
   ID3D12Device5* m_device;
   ID3D12RootSignature* m_dummyLocalRootSignature;
   ID3D12RootSignature* m_dummyGlobalRootSignature;
 
-  
+  ShaderSymbolTable m_ownSymbols;
+  ShaderSymbolTable* m_symbols;
 };
 
 } // namespace nv_helpers_dx12
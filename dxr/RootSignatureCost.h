@@ -0,0 +1,141 @@
+/*
+What a root signature costs, computed from its parameters without creating it.
+
+A global root signature has a budget of 64 DWORDs: a descriptor table takes 1, a root descriptor
+2 and root constants 1 per 32-bit value. The parameters of a local root signature are the root
+arguments of its shader records instead, laid out as in ShaderRecordLayout.h: 8 bytes for tables
+and root descriptors, 4 bytes per root constant. They are limited by the largest record stride,
+and every byte of them is read from the SBT for every hit. Both are computed for any signature.
+
+Tables and root descriptors are read through a pointer before the shader gets to the data, a
+table through a descriptor heap entry on top of that. Root constants are read directly from the
+root arguments. Small constant data is therefore cheaper as root constants, see
+PromoteToRootConstants.
+
+Example:
+
+RootSignatureCost cost = ComputeRootSignatureCost({{RootParameterKind::DescriptorTable, 0},
+                                                   {RootParameterKind::Constants, 4}});
+// cost.dwords == 5, cost.localArgumentsSize == 24, cost.recordStride == 64
+
+It has no dependency on D3D12.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ShaderRecordLayout.h"
+
+namespace nv_helpers_dx12
+{
+
+/// Size limit of a root signature in DWORDs
+constexpr uint32_t kMaxRootSignatureDwords = 64;
+/// D3D12_RAYTRACING_MAX_SHADER_RECORD_STRIDE
+constexpr uint32_t kMaxShaderRecordStride = 4096;
+/// Constant buffers up to this size are bound as root constants by default
+constexpr uint32_t kDefaultConstantPromotionLimit = 16;
+
+enum class RootParameterKind
+{
+  DescriptorTable,
+  Descriptor, /// root CBV, SRV or UAV
+  Constants
+};
+
+struct RootParameterCost
+{
+  RootParameterKind kind;
+  uint32_t num32BitValues; /// root constants only
+};
+
+struct RootSignatureCost
+{
+  /// Size of the root signature, against kMaxRootSignatureDwords
+  uint32_t dwords;
+  /// Root arguments of a shader record after the identifier, when used as a local root signature
+  uint32_t localArgumentsSize;
+  /// Smallest stride of a section of such records
+  uint32_t recordStride;
+
+  uint32_t numTables;
+  uint32_t numDescriptors;
+  uint32_t numConstants; /// 32-bit values
+
+  bool WithinBudget(bool isLocal) const
+  {
+    return isLocal ? recordStride <= kMaxShaderRecordStride : dwords <= kMaxRootSignatureDwords;
+  }
+};
+
+inline uint32_t RootParameterDwords(const RootParameterCost& parameter)
+{
+  switch (parameter.kind)
+  {
+  case RootParameterKind::DescriptorTable:
+    return 1;
+  case RootParameterKind::Descriptor:
+    return 2;
+  default:
+    return parameter.num32BitValues;
+  }
+}
+
+inline RootSignatureCost ComputeRootSignatureCost(const std::vector<RootParameterCost>& parameters)
+{
+  RootSignatureCost cost = {};
+  uint32_t offset = kShaderIdentifierSize;
+
+  for (const RootParameterCost& parameter : parameters)
+  {
+    cost.dwords += RootParameterDwords(parameter);
+
+    if (parameter.kind == RootParameterKind::Constants)
+    {
+      offset += 4 * parameter.num32BitValues;
+      cost.numConstants += parameter.num32BitValues;
+    }
+    else
+    {
+      // GPU descriptor handles and virtual addresses
+      offset = AlignUp(offset, 8) + 8;
+      if (parameter.kind == RootParameterKind::DescriptorTable)
+      {
+        cost.numTables++;
+      }
+      else
+      {
+        cost.numDescriptors++;
+      }
+    }
+  }
+
+  cost.localArgumentsSize = offset - kShaderIdentifierSize;
+  cost.recordStride = AlignUp(offset, kShaderRecordAlignment);
+
+  return cost;
+}
+
+/// Whether a constant buffer of sizeInBytes, added to a signature already using dwordsUsed, is
+/// better bound as root constants than as a root CBV: it must be at most promotionLimit bytes and
+/// leave the signature within the 64 DWORDs
+inline bool PromoteToRootConstants(uint32_t sizeInBytes, uint32_t promotionLimit,
+                                   uint32_t dwordsUsed)
+{
+  uint32_t dwords = (sizeInBytes + 3) / 4;
+  return sizeInBytes <= promotionLimit && dwordsUsed + dwords <= kMaxRootSignatureDwords;
+}
+
+/// Same for a local root signature whose root arguments already take argumentsSizeUsed bytes. It
+/// has no DWORD budget, the record has to stay within kMaxShaderRecordStride instead.
+inline bool PromoteToLocalRootConstants(uint32_t sizeInBytes, uint32_t promotionLimit,
+                                        uint32_t argumentsSizeUsed)
+{
+  uint32_t recordSize = kShaderIdentifierSize + argumentsSizeUsed + AlignUp(sizeInBytes, 4);
+  return sizeInBytes <= promotionLimit &&
+         AlignUp(recordSize, kShaderRecordAlignment) <= kMaxShaderRecordStride;
+}
+
+} // namespace nv_helpers_dx12
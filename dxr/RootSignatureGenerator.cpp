@@ -38,6 +38,7 @@ pointers will be bound.
 #include "RootSignatureGenerator.h"
 
 #include <stdexcept>
+#include <string>
 
 namespace nv_helpers_dx12
 {
@@ -152,11 +153,86 @@ void RootSignatureGenerator::AddRootParameter(D3D12_ROOT_PARAMETER_TYPE type,
   m_rangeLocations.push_back(~0u);
 }
 
+//--------------------------------------------------------------------------------------------------
+//
+// Add a constant buffer, bound as root constants if it is small enough and fits the budget, as a
+// root CBV otherwise
+D3D12_ROOT_PARAMETER_TYPE RootSignatureGenerator::AddConstantBufferParameter(UINT shaderRegister,
+                                                                             UINT registerSpace,
+                                                                             UINT sizeInBytes)
+{
+  if (PromoteToRootConstants(sizeInBytes, m_constantPromotionLimit, ComputeCost().dwords))
+  {
+    AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, shaderRegister, registerSpace,
+                     (sizeInBytes + 3) / 4);
+    return D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+  }
+
+  AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, shaderRegister, registerSpace);
+  return D3D12_ROOT_PARAMETER_TYPE_CBV;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// DWORD cost of the parameters added so far and the size of their local root arguments
+RootSignatureCost RootSignatureGenerator::ComputeCost() const
+{
+  std::vector<RootParameterCost> parameters;
+  parameters.reserve(m_parameters.size());
+
+  for (const D3D12_ROOT_PARAMETER& param : m_parameters)
+  {
+    switch (param.ParameterType)
+    {
+    case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+      parameters.push_back({RootParameterKind::DescriptorTable, 0});
+      break;
+    case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+      parameters.push_back({RootParameterKind::Constants, param.Constants.Num32BitValues});
+      break;
+    default:
+      parameters.push_back({RootParameterKind::Descriptor, 0});
+      break;
+    }
+  }
+
+  return ComputeRootSignatureCost(parameters);
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // Create the root signature from the set of parameters, in the order of the addition calls
 ID3D12RootSignature* RootSignatureGenerator::Generate(ID3D12Device* device, bool isLocal)
 {
+  Microsoft::WRL::ComPtr<ID3DBlob> sigBlob = Serialize(isLocal);
+
+  ID3D12RootSignature* pRootSig;
+  HRESULT hr = device->CreateRootSignature(0, sigBlob->GetBufferPointer(), sigBlob->GetBufferSize(),
+                                           IID_PPV_ARGS(&pRootSig));
+  if (FAILED(hr))
+  {
+    throw std::logic_error("Cannot create root signature");
+  }
+  return pRootSig;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Serialize the root signature without creating it
+Microsoft::WRL::ComPtr<ID3DBlob> RootSignatureGenerator::Serialize(bool isLocal)
+{
+  // Report an oversized signature with its size rather than as a failed serialization
+  RootSignatureCost cost = ComputeCost();
+  if (!cost.WithinBudget(isLocal))
+  {
+    throw std::logic_error(
+        isLocal ? "Local root arguments make a shader record of " +
+                      std::to_string(cost.recordStride) + " bytes, more than " +
+                      std::to_string(kMaxShaderRecordStride)
+                : "Root signature takes " + std::to_string(cost.dwords) + " DWORDs, more than " +
+                      std::to_string(kMaxRootSignatureDwords));
+  }
+
   // Go through all the parameters, and set the actual addresses of the heap range descriptors based
   // on their indices in the range set array
   for (size_t i = 0; i < m_parameters.size(); i++)
@@ -175,23 +251,81 @@ ID3D12RootSignature* RootSignatureGenerator::Generate(ID3D12Device* device, bool
   rootDesc.Flags =
       isLocal ? D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE : D3D12_ROOT_SIGNATURE_FLAG_NONE;
 
-  // Create the root signature from its descriptor
-  ID3DBlob* pSigBlob;
-  ID3DBlob* pErrorBlob;
-  HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &pSigBlob,
-                                           &pErrorBlob);
+  // Serialize the descriptor, the blobs are released with the ComPtrs
+  Microsoft::WRL::ComPtr<ID3DBlob> sigBlob;
+  Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+  HRESULT hr = D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &sigBlob,
+                                           &errorBlob);
   if (FAILED(hr))
   {
-    throw std::logic_error("Cannot serialize root signature");
+    std::string message = "Cannot serialize root signature";
+    if (errorBlob)
+    {
+      message += ": " + std::string(static_cast<const char*>(errorBlob->GetBufferPointer()),
+                                    errorBlob->GetBufferSize());
+    }
+    throw std::logic_error(message);
   }
-  ID3D12RootSignature* pRootSig;
-  hr = device->CreateRootSignature(0, pSigBlob->GetBufferPointer(), pSigBlob->GetBufferSize(),
-                                   IID_PPV_ARGS(&pRootSig));
-  if (FAILED(hr))
+  return sigBlob;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The description as bytes which only depend on what the root signature is. Every value is written
+// as a 32-bit word, a format word first so a change here does not match older keys.
+std::vector<uint8_t> RootSignatureGenerator::CanonicalDesc(bool isLocal) const
+{
+  std::vector<uint8_t> bytes;
+  auto write = [&bytes](uint32_t value) {
+    bytes.insert(bytes.end(), reinterpret_cast<const uint8_t*>(&value),
+                 reinterpret_cast<const uint8_t*>(&value) + sizeof(value));
+  };
+
+  write(1); // format
+  write(isLocal ? D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE : D3D12_ROOT_SIGNATURE_FLAG_NONE);
+  write(static_cast<uint32_t>(m_parameters.size()));
+
+  for (size_t i = 0; i < m_parameters.size(); i++)
   {
-    throw std::logic_error("Cannot create root signature");
+    const D3D12_ROOT_PARAMETER& param = m_parameters[i];
+    write(param.ParameterType);
+    write(param.ShaderVisibility);
+
+    if (param.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+    {
+      const std::vector<D3D12_DESCRIPTOR_RANGE>& ranges = m_ranges[m_rangeLocations[i]];
+      write(static_cast<uint32_t>(ranges.size()));
+
+      // An appended range starts where the previous one of the table ends
+      uint32_t nextOffset = 0;
+      for (const D3D12_DESCRIPTOR_RANGE& range : ranges)
+      {
+        uint32_t offset = range.OffsetInDescriptorsFromTableStart ==
+                                  D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
+                              ? nextOffset
+                              : range.OffsetInDescriptorsFromTableStart;
+        write(range.RangeType);
+        write(range.BaseShaderRegister);
+        write(range.NumDescriptors);
+        write(range.RegisterSpace);
+        write(offset);
+        nextOffset = offset + range.NumDescriptors;
+      }
+    }
+    else if (param.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+    {
+      write(param.Constants.ShaderRegister);
+      write(param.Constants.RegisterSpace);
+      write(param.Constants.Num32BitValues);
+    }
+    else
+    {
+      write(param.Descriptor.ShaderRegister);
+      write(param.Descriptor.RegisterSpace);
+    }
   }
-  return pRootSig;
+
+  return bytes;
 }
 
 } // namespace nv_helpers_dx12
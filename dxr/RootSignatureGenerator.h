@@ -54,9 +54,14 @@ return rsc.Generate(m_device.Get(), true);
 
 #include "d3d12.h"
 
+#include <cstdint>
 #include <tuple>
 #include <vector>
 
+#include <wrl/client.h>
+
+#include "RootSignatureCost.h"
+
 namespace nv_helpers_dx12
 {
 
@@ -102,9 +107,35 @@ public:
   void AddRootParameter(D3D12_ROOT_PARAMETER_TYPE type, UINT shaderRegister = 0,
                         UINT registerSpace = 0, UINT numRootConstants = 1);
 
-  /// Create the root signature from the set of parameters, in the order of the addition calls
+  /// Add a constant buffer of sizeInBytes, accessible via register(b<shaderRegister>,
+  /// space<registerSpace>). HLSL reads a cbuffer the same way whether it is bound as root
+  /// constants or through a root CBV, so the generator picks: buffers up to the promotion limit
+  /// become root constants as long as the signature stays within its DWORD budget, which saves
+  /// the shader a pointer dereference, larger ones a root CBV. Returns the parameter type used, the
+  /// caller puts either the values or the buffer address in the root arguments.
+  D3D12_ROOT_PARAMETER_TYPE AddConstantBufferParameter(UINT shaderRegister, UINT registerSpace,
+                                                       UINT sizeInBytes);
+
+  /// Largest constant buffer AddConstantBufferParameter turns into root constants, 0 never does
+  void SetConstantPromotionLimit(UINT sizeInBytes) { m_constantPromotionLimit = sizeInBytes; }
+
+  /// DWORD cost of the parameters added so far, and the size of their root arguments in a shader
+  /// record when used as a local root signature
+  RootSignatureCost ComputeCost() const;
+
+  /// Create the root signature from the set of parameters, in the order of the addition calls. The
+  /// caller owns the returned reference.
   ID3D12RootSignature* Generate(ID3D12Device* device, bool isLocal);
 
+  /// Serialize the root signature without creating it, the blob can be stored and passed to
+  /// CreateRootSignature later
+  Microsoft::WRL::ComPtr<ID3DBlob> Serialize(bool isLocal);
+
+  /// The description as bytes which only depend on what the root signature is, e.g. to key a cache:
+  /// no pointers or union padding, ranges inlined into their table and appended range offsets
+  /// resolved, so the same signature built in different ways gives the same bytes
+  std::vector<uint8_t> CanonicalDesc(bool isLocal) const;
+
 private:
   /// Heap range descriptors
   std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>> m_ranges;
@@ -115,6 +146,8 @@ private:
   /// the parameter is not a heap range descriptor
   std::vector<UINT> m_rangeLocations;
 
+  UINT m_constantPromotionLimit = kDefaultConstantPromotionLimit;
+
   enum
   {
     RSC_BASE_SHADER_REGISTER = 0,
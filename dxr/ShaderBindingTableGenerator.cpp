@@ -36,42 +36,165 @@ dispatch rays description.
 
 #include "ShaderBindingTableGenerator.h"
 
-// Helper to compute aligned buffer sizes
-#ifndef ROUND_UP
-#define ROUND_UP(v, powerOf2Alignment) (((v) + (powerOf2Alignment)-1) & ~((powerOf2Alignment)-1))
-#endif
+#include <algorithm>
 
 namespace nv_helpers_dx12
 {
 
+// The layout is computed without D3D12, make sure it agrees with it
+static_assert(kShaderIdentifierSize == D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, "");
+static_assert(kShaderRecordAlignment == D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, "");
+static_assert(kShaderTableAlignment == D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, "");
+
+//--------------------------------------------------------------------------------------------------
+//
+// Entries added by name are interned in a table owned by the generator
+ShaderBindingTableGenerator::ShaderBindingTableGenerator() : m_symbols(&m_ownSymbols)
+{
+  Reset();
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Entries added by name are interned in the given table, shared with the pipeline generator
+ShaderBindingTableGenerator::ShaderBindingTableGenerator(ShaderSymbolTable& symbols)
+    : m_symbols(&symbols)
+{
+  Reset();
+}
+
 //--------------------------------------------------------------------------------------------------
 //
 // Add a ray generation program by name, with its list of data pointers or values according to
 // the layout of its root signature
-void ShaderBindingTableGenerator::AddRayGenerationProgram(const std::wstring& entryPoint,
-                                                          const std::vector<void*>& inputData)
+uint32_t ShaderBindingTableGenerator::AddRayGenerationProgram(const std::wstring& entryPoint,
+                                                              const std::vector<void*>& inputData)
+{
+  return AddRayGenerationProgram(m_symbols->Intern(entryPoint), inputData);
+}
+
+uint32_t ShaderBindingTableGenerator::AddRayGenerationProgram(ShaderSymbol entryPoint,
+                                                              const std::vector<void*>& inputData)
 {
-  m_rayGen.emplace_back(SBTEntry(entryPoint, inputData));
+  return AddEntry(m_rayGen, entryPoint, reinterpret_cast<const uint8_t*>(inputData.data()),
+                  static_cast<uint32_t>(inputData.size() * 8));
 }
 
 //--------------------------------------------------------------------------------------------------
 //
 // Add a miss program by name, with its list of data pointers or values according to
 // the layout of its root signature
-void ShaderBindingTableGenerator::AddMissProgram(const std::wstring& entryPoint,
-                                                 const std::vector<void*>& inputData)
+uint32_t ShaderBindingTableGenerator::AddMissProgram(const std::wstring& entryPoint,
+                                                     const std::vector<void*>& inputData)
+{
+  return AddMissProgram(m_symbols->Intern(entryPoint), inputData);
+}
+
+uint32_t ShaderBindingTableGenerator::AddMissProgram(ShaderSymbol entryPoint,
+                                                     const std::vector<void*>& inputData)
 {
-  m_miss.emplace_back(SBTEntry(entryPoint, inputData));
+  return AddEntry(m_miss, entryPoint, reinterpret_cast<const uint8_t*>(inputData.data()),
+                  static_cast<uint32_t>(inputData.size() * 8));
 }
 
 //--------------------------------------------------------------------------------------------------
 //
 // Add a hit group by name, with its list of data pointers or values according to
 // the layout of its root signature
-void ShaderBindingTableGenerator::AddHitGroup(const std::wstring& entryPoint,
+uint32_t ShaderBindingTableGenerator::AddHitGroup(const std::wstring& entryPoint,
+                                                  const std::vector<void*>& inputData)
+{
+  return AddHitGroup(m_symbols->Intern(entryPoint), inputData);
+}
+
+uint32_t ShaderBindingTableGenerator::AddHitGroup(ShaderSymbol entryPoint,
+                                                  const std::vector<void*>& inputData)
+{
+  return AddEntry(m_hitGroup, entryPoint, reinterpret_cast<const uint8_t*>(inputData.data()),
+                  static_cast<uint32_t>(inputData.size() * 8));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add entries with root arguments laid out by the caller, size bytes of them
+uint32_t ShaderBindingTableGenerator::AddRayGenerationProgram(ShaderSymbol entryPoint,
+                                                              const uint8_t* arguments,
+                                                              uint32_t size)
+{
+  return AddEntry(m_rayGen, entryPoint, arguments, size);
+}
+
+uint32_t ShaderBindingTableGenerator::AddMissProgram(ShaderSymbol entryPoint,
+                                                     const uint8_t* arguments, uint32_t size)
+{
+  return AddEntry(m_miss, entryPoint, arguments, size);
+}
+
+uint32_t ShaderBindingTableGenerator::AddHitGroup(ShaderSymbol entryPoint,
+                                                  const uint8_t* arguments, uint32_t size)
+{
+  return AddEntry(m_hitGroup, entryPoint, arguments, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Change the program or the values of an entry added before, without changing the layout
+void ShaderBindingTableGenerator::SetRayGenerationProgram(uint32_t index, ShaderSymbol entryPoint,
+                                                          const std::vector<void*>& inputData)
+{
+  SetEntry(Section::RayGen, index, entryPoint, reinterpret_cast<const uint8_t*>(inputData.data()),
+           static_cast<uint32_t>(inputData.size() * 8));
+}
+
+void ShaderBindingTableGenerator::SetMissProgram(uint32_t index, ShaderSymbol entryPoint,
+                                                 const std::vector<void*>& inputData)
+{
+  SetEntry(Section::Miss, index, entryPoint, reinterpret_cast<const uint8_t*>(inputData.data()),
+           static_cast<uint32_t>(inputData.size() * 8));
+}
+
+void ShaderBindingTableGenerator::SetHitGroup(uint32_t index, ShaderSymbol entryPoint,
                                               const std::vector<void*>& inputData)
 {
-  m_hitGroup.emplace_back(SBTEntry(entryPoint, inputData));
+  SetEntry(Section::HitGroup, index, entryPoint,
+           reinterpret_cast<const uint8_t*>(inputData.data()),
+           static_cast<uint32_t>(inputData.size() * 8));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Append count hit groups with room for argumentsSize bytes each, filled later with FillHitGroup.
+// The entries have no program until then, generating the SBT with one left unfilled throws.
+uint32_t ShaderBindingTableGenerator::ReserveHitGroups(uint32_t count, uint32_t argumentsSize)
+{
+  uint32_t first = static_cast<uint32_t>(m_hitGroup.size());
+  uint32_t firstByte = static_cast<uint32_t>(m_argumentData.size());
+
+  m_hitGroup.reserve(m_hitGroup.size() + count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    m_hitGroup.push_back({kNoShaderSymbol, firstByte + i * argumentsSize, argumentsSize});
+  }
+  m_argumentData.resize(m_argumentData.size() + size_t(count) * argumentsSize);
+
+  return first;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Write a reserved hit group with root arguments laid out by the caller, at most as many bytes as
+// were reserved
+void ShaderBindingTableGenerator::FillHitGroup(uint32_t index, ShaderSymbol entryPoint,
+                                               const uint8_t* arguments, uint32_t size)
+{
+  SBTEntry& entry = m_hitGroup[index];
+  if (size > entry.m_numBytes)
+  {
+    throw std::logic_error("Hit group record larger than the reserved entry");
+  }
+  entry.m_entryPoint = entryPoint;
+  entry.m_numBytes = size;
+  std::copy(arguments, arguments + size, m_argumentData.begin() + entry.m_firstByte);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -79,21 +202,17 @@ void ShaderBindingTableGenerator::AddHitGroup(const std::wstring& entryPoint,
 // Compute the size of the SBT based on the set of programs and hit groups it contains
 uint32_t ShaderBindingTableGenerator::ComputeSBTSize()
 {
-  // Size of a program identifier
-  m_progIdSize = D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT;
-  // Compute the entry size of each program type depending on the maximum number of parameters in
-  // each category
-  m_rayGenEntrySize = GetEntrySize(m_rayGen);
-  m_missEntrySize = GetEntrySize(m_miss);
-  m_hitGroupEntrySize = GetEntrySize(m_hitGroup);
+  // Compute the entry size of each program type depending on the largest entry in each category,
+  // each section then starts on a D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT boundary
+  m_layout = ComputeShaderTableLayout(GetEntrySize(m_rayGen), static_cast<uint32_t>(m_rayGen.size()),
+                                      GetEntrySize(m_miss), static_cast<uint32_t>(m_miss.size()),
+                                      GetEntrySize(m_hitGroup),
+                                      static_cast<uint32_t>(m_hitGroup.size()));
+
+  // A new layout, every copy of the SBT has to be written entirely
+  m_dirtyRecords.Resize(static_cast<uint32_t>(m_rayGen.size() + m_miss.size() + m_hitGroup.size()));
 
-  // The total SBT size is the sum of the entries for ray generation, miss and hit groups, aligned
-  // on 256 bytes
-  uint32_t sbtSize = ROUND_UP(m_rayGenEntrySize * static_cast<UINT>(m_rayGen.size()) +
-                                  m_missEntrySize * static_cast<UINT>(m_miss.size()) +
-                                  m_hitGroupEntrySize * static_cast<UINT>(m_hitGroup.size()),
-                              256);
-  return sbtSize;
+  return m_layout.size;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -103,6 +222,26 @@ uint32_t ShaderBindingTableGenerator::ComputeSBTSize()
 // names
 void ShaderBindingTableGenerator::Generate(ID3D12Resource* sbtBuffer,
                                            ID3D12StateObjectProperties* raytracingPipeline)
+{
+  // Fetch the program identifiers only for a new pipeline or newly interned symbols
+  if (m_identifiers.Pipeline() != raytracingPipeline)
+  {
+    m_identifiers.Fill(raytracingPipeline, *m_symbols);
+  }
+  else
+  {
+    m_identifiers.Update(*m_symbols);
+  }
+
+  Generate(sbtBuffer, m_identifiers);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Build the SBT and store it into sbtBuffer, which has to be pre-allocated on the upload heap,
+// with identifiers already fetched from the pipeline
+void ShaderBindingTableGenerator::Generate(ID3D12Resource* sbtBuffer,
+                                           const ShaderIdentifierCache& identifiers)
 {
   // Map the SBT
   uint8_t* pData;
@@ -111,20 +250,77 @@ void ShaderBindingTableGenerator::Generate(ID3D12Resource* sbtBuffer,
   {
     throw std::logic_error("Could not map the shader binding table");
   }
+
+  Generate(pData, identifiers);
+
+  // Unmap the SBT
+  sbtBuffer->Unmap(0, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Build the SBT into memory mapped by the caller
+void ShaderBindingTableGenerator::Generate(uint8_t* pData, const ShaderIdentifierCache& identifiers)
+{
   // Copy the shader identifiers followed by their resource pointers or root constants: first the
-  // ray generation, then the miss shaders, and finally the set of hit groups
-  uint32_t offset = 0;
+  // ray generation, then the miss shaders, and finally the set of hit groups, each section at its
+  // aligned offset
+  CopyShaderData(identifiers, pData + m_layout.rayGen.offset, m_rayGen, m_layout.rayGen.stride);
+  CopyShaderData(identifiers, pData + m_layout.miss.offset, m_miss, m_layout.miss.stride);
+  CopyShaderData(identifiers, pData + m_layout.hitGroup.offset, m_hitGroup,
+                 m_layout.hitGroup.stride);
+}
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_rayGen, m_rayGenEntrySize);
-  pData += offset;
+//--------------------------------------------------------------------------------------------------
+//
+// Rewrite only the entries of one copy of the SBT which changed since that copy was last updated
+uint32_t ShaderBindingTableGenerator::Update(uint8_t* sbtData,
+                                             const ShaderIdentifierCache& identifiers,
+                                             uint32_t copy)
+{
+  // Records written with the identifiers of another pipeline are all out of date
+  if (identifiers.Generation() != m_updateGeneration)
+  {
+    m_dirtyRecords.Resize(m_dirtyRecords.NumRecords());
+    m_updateGeneration = identifiers.Generation();
+  }
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_miss, m_missEntrySize);
-  pData += offset;
+  uint32_t rayGenEnd = static_cast<uint32_t>(m_rayGen.size());
+  uint32_t missEnd = rayGenEnd + static_cast<uint32_t>(m_miss.size());
+  uint32_t bytesWritten = 0;
 
-  offset = CopyShaderData(raytracingPipeline, pData, m_hitGroup, m_hitGroupEntrySize);
+  for (const DirtyRecordTracker::Range& range : m_dirtyRecords.TakeRanges(copy))
+  {
+    for (uint32_t record = range.first; record < range.first + range.count; record++)
+    {
+      const ShaderTableSection* section = &m_layout.rayGen;
+      const SBTEntry* entry = nullptr;
+      uint32_t index = record;
+
+      if (record < rayGenEnd)
+      {
+        entry = &m_rayGen[index];
+      }
+      else if (record < missEnd)
+      {
+        section = &m_layout.miss;
+        index = record - rayGenEnd;
+        entry = &m_miss[index];
+      }
+      else
+      {
+        section = &m_layout.hitGroup;
+        index = record - missEnd;
+        entry = &m_hitGroup[index];
+      }
+
+      WriteEntry(identifiers, sbtData + section->offset + index * section->stride, *entry,
+                 section->stride);
+      bytesWritten += section->stride;
+    }
+  }
 
-  // Unmap the SBT
-  sbtBuffer->Unmap(0, nullptr);
+  return bytesWritten;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -135,11 +331,10 @@ void ShaderBindingTableGenerator::Reset()
   m_rayGen.clear();
   m_miss.clear();
   m_hitGroup.clear();
+  m_argumentData.clear();
+  m_dirtyRecords.Resize(0);
 
-  m_rayGenEntrySize = 0;
-  m_missEntrySize = 0;
-  m_hitGroupEntrySize = 0;
-  m_progIdSize = 0;
+  m_layout = {};
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -151,7 +346,7 @@ void ShaderBindingTableGenerator::Reset()
 // Get the size in bytes of the SBT section dedicated to ray generation programs
 UINT ShaderBindingTableGenerator::GetRayGenSectionSize() const
 {
-  return m_rayGenEntrySize * static_cast<UINT>(m_rayGen.size());
+  return m_layout.rayGen.Size();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -159,7 +354,15 @@ UINT ShaderBindingTableGenerator::GetRayGenSectionSize() const
 // Get the size in bytes of one ray generation program entry in the SBT
 UINT ShaderBindingTableGenerator::GetRayGenEntrySize() const
 {
-  return m_rayGenEntrySize;
+  return m_layout.rayGen.stride;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Get the offset in bytes of the SBT section dedicated to miss programs
+UINT ShaderBindingTableGenerator::GetMissSectionOffset() const
+{
+  return m_layout.miss.offset;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -167,15 +370,23 @@ UINT ShaderBindingTableGenerator::GetRayGenEntrySize() const
 // Get the size in bytes of the SBT section dedicated to miss programs
 UINT ShaderBindingTableGenerator::GetMissSectionSize() const
 {
-  return m_missEntrySize * static_cast<UINT>(m_miss.size());
+  return m_layout.miss.Size();
 }
 
 //--------------------------------------------------------------------------------------------------
 //
 // Get the size in bytes of one miss program entry in the SBT
-UINT ShaderBindingTableGenerator::GetMissEntrySize()
+UINT ShaderBindingTableGenerator::GetMissEntrySize() const
 {
-  return m_missEntrySize;
+  return m_layout.miss.stride;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Get the offset in bytes of the SBT section dedicated to hit groups
+UINT ShaderBindingTableGenerator::GetHitGroupSectionOffset() const
+{
+  return m_layout.hitGroup.offset;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -183,15 +394,15 @@ UINT ShaderBindingTableGenerator::GetMissEntrySize()
 // Get the size in bytes of the SBT section dedicated to hit groups
 UINT ShaderBindingTableGenerator::GetHitGroupSectionSize() const
 {
-  return m_hitGroupEntrySize * static_cast<UINT>(m_hitGroup.size());
+  return m_layout.hitGroup.Size();
 }
 
 //--------------------------------------------------------------------------------------------------
 //
-// Get the size in bytes of one hit group entry in the SBT
+// Get the size in bytes of hit group entry in the SBT
 UINT ShaderBindingTableGenerator::GetHitGroupEntrySize() const
 {
-  return m_hitGroupEntrySize;
+  return m_layout.hitGroup.stride;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -200,25 +411,13 @@ UINT ShaderBindingTableGenerator::GetHitGroupEntrySize() const
 // constants in outputData, with a stride in bytes of entrySize, and returns the size in bytes
 // actually written to outputData.
 uint32_t ShaderBindingTableGenerator::CopyShaderData(
-    ID3D12StateObjectProperties* raytracingPipeline, uint8_t* outputData,
+    const ShaderIdentifierCache& identifiers, uint8_t* outputData,
     const std::vector<SBTEntry>& shaders, uint32_t entrySize)
 {
   uint8_t* pData = outputData;
   for (const auto& shader : shaders)
   {
-    // Get the shader identifier, and check whether that identifier is known
-    void* id = raytracingPipeline->GetShaderIdentifier(shader.m_entryPoint.c_str());
-    if (!id)
-    {
-      std::wstring errMsg(std::wstring(L"Unknown shader identifier used in the SBT: ") +
-                          shader.m_entryPoint);
-      throw std::logic_error(std::string(errMsg.begin(), errMsg.end()));
-    }
-    // Copy the shader identifier
-    memcpy(pData, id, m_progIdSize);
-    // Copy all its resources pointers or values in bulk
-    memcpy(pData + m_progIdSize, shader.m_inputData.data(), shader.m_inputData.size() * 8);
-
+    WriteEntry(identifiers, pData, shader, entrySize);
     pData += entrySize;
   }
   // Return the number of bytes actually written to the output buffer
@@ -227,32 +426,100 @@ uint32_t ShaderBindingTableGenerator::CopyShaderData(
 
 //--------------------------------------------------------------------------------------------------
 //
-// Compute the size of the SBT entries for a set of entries, which is determined by the maximum
-// number of parameters of their root signature
-uint32_t ShaderBindingTableGenerator::GetEntrySize(const std::vector<SBTEntry>& entries)
+// Copy the shader identifier of one entry followed by its resource pointers and/or root constants
+void ShaderBindingTableGenerator::WriteEntry(const ShaderIdentifierCache& identifiers,
+                                             uint8_t* outputData, const SBTEntry& shader,
+                                             uint32_t entrySize)
 {
-  // Find the maximum number of parameters used by a single entry
-  size_t maxArgs = 0;
-  for (const auto& shader : entries)
+  // Get the shader identifier, and check whether that identifier is known
+  const void* id = identifiers.Get(shader.m_entryPoint);
+  if (!id)
   {
-    maxArgs = max(maxArgs, shader.m_inputData.size());
+    // the name is only converted when reporting the error
+    std::wstring errMsg(std::wstring(L"Unknown shader identifier used in the SBT: ") +
+                        m_symbols->Name(shader.m_entryPoint));
+    throw std::logic_error(std::string(errMsg.begin(), errMsg.end()));
   }
-  // A SBT entry is made of a program ID and a set of parameters, taking 8 bytes each. Those
-  // parameters can either be 8-bytes pointers, or 4-bytes constants
-  uint32_t entrySize = m_progIdSize + 8 * static_cast<uint32_t>(maxArgs);
+  // Copy the shader identifier
+  memcpy(outputData, id, kShaderIdentifierSize);
+  // Copy all its resources pointers or values in bulk
+  memcpy(outputData + kShaderIdentifierSize, m_argumentData.data() + shader.m_firstByte,
+         shader.m_numBytes);
+  // Clear what an entry with more values may have left in the record
+  memset(outputData + kShaderIdentifierSize + shader.m_numBytes, 0,
+         entrySize - kShaderIdentifierSize - shader.m_numBytes);
+}
 
-  // The entries of the shader binding table must be 16-bytes-aligned
-  entrySize = ROUND_UP(entrySize, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
+//--------------------------------------------------------------------------------------------------
+//
+// Append an entry and its root arguments, laid out as in the record
+uint32_t ShaderBindingTableGenerator::AddEntry(std::vector<SBTEntry>& entries,
+                                               ShaderSymbol entryPoint, const uint8_t* arguments,
+                                               uint32_t size)
+{
+  SBTEntry entry = {entryPoint, static_cast<uint32_t>(m_argumentData.size()), size};
+  m_argumentData.insert(m_argumentData.end(), arguments, arguments + size);
+  entries.push_back(entry);
 
-  return entrySize;
+  return static_cast<uint32_t>(entries.size()) - 1;
 }
 
 //--------------------------------------------------------------------------------------------------
 //
+// Replace an entry in place and mark its record dirty. Arguments which do not fit the storage of
+// the entry get new storage at the end, the old one is reclaimed by Reset.
+void ShaderBindingTableGenerator::SetEntry(Section section, uint32_t index,
+                                           ShaderSymbol entryPoint, const uint8_t* arguments,
+                                           uint32_t size)
+{
+  std::vector<SBTEntry>& entries = section == Section::RayGen ? m_rayGen
+                                   : section == Section::Miss ? m_miss
+                                                              : m_hitGroup;
+  const ShaderTableSection& layout = section == Section::RayGen ? m_layout.rayGen
+                                     : section == Section::Miss ? m_layout.miss
+                                                                : m_layout.hitGroup;
+  uint32_t firstRecord = section == Section::RayGen ? 0
+                         : section == Section::Miss
+                             ? static_cast<uint32_t>(m_rayGen.size())
+                             : static_cast<uint32_t>(m_rayGen.size() + m_miss.size());
+
+  if (index >= entries.size())
+  {
+    throw std::logic_error("Unknown entry index in the shader binding table");
+  }
+  if (layout.stride != 0 && kShaderIdentifierSize + size > layout.stride)
+  {
+    throw std::logic_error("Shader binding table entry does not fit the current layout");
+  }
+
+  SBTEntry& entry = entries[index];
+  entry.m_entryPoint = entryPoint;
+  if (size > entry.m_numBytes)
+  {
+    entry.m_firstByte = static_cast<uint32_t>(m_argumentData.size());
+    m_argumentData.resize(m_argumentData.size() + size);
+  }
+  entry.m_numBytes = size;
+  std::copy(arguments, arguments + size, m_argumentData.begin() + entry.m_firstByte);
+
+  m_dirtyRecords.MarkDirty(firstRecord + index);
+}
+
+//--------------------------------------------------------------------------------------------------
 //
-ShaderBindingTableGenerator::SBTEntry::SBTEntry(std::wstring entryPoint,
-                                                std::vector<void*> inputData)
-    : m_entryPoint(std::move(entryPoint)), m_inputData(std::move(inputData))
+// Compute the size of the SBT entries for a set of entries, which is determined by the largest
+// set of root arguments. The layout aligns it to the record alignment.
+uint32_t ShaderBindingTableGenerator::GetEntrySize(const std::vector<SBTEntry>& entries)
 {
+  uint32_t maxBytes = 0;
+  for (const auto& shader : entries)
+  {
+    if (shader.m_numBytes > maxBytes)
+    {
+      maxBytes = shader.m_numBytes;
+    }
+  }
+
+  return kShaderIdentifierSize + maxBytes;
 }
 } // namespace nv_helpers_dx12
@@ -109,6 +109,10 @@ desc.HitGroupTable.StrideInBytes = m_sbtHelper.GetHitGroupEntrySize();
 
 #include "d3d12.h"
 
+#include "DirtyRecordTracker.h"
+#include "ShaderRecordLayout.h"
+#include "ShaderSymbolTable.h"
+
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -119,30 +123,96 @@ namespace nv_helpers_dx12
 class ShaderBindingTableGenerator
 {
 public:
+  /// Entries added by name are interned in a table owned by the generator
+  ShaderBindingTableGenerator();
+
+  /// Entries added by name are interned in symbols, which has to outlive the generator. Share it
+  /// with the pipeline generator so the same handles can be used for both.
+  explicit ShaderBindingTableGenerator(ShaderSymbolTable& symbols);
+
+  ShaderBindingTableGenerator(const ShaderBindingTableGenerator&) = delete;
+  ShaderBindingTableGenerator& operator=(const ShaderBindingTableGenerator&) = delete;
+
   /// Add a ray generation program by name, with its list of data pointers or values according to
-  /// the layout of its root signature
-  void AddRayGenerationProgram(const std::wstring& entryPoint, const std::vector<void*>& inputData);
+  /// the layout of its root signature. Returns the index of the entry in its section, which stays
+  /// the same until Reset.
+  uint32_t AddRayGenerationProgram(const std::wstring& entryPoint,
+                                   const std::vector<void*>& inputData);
 
   /// Add a miss program by name, with its list of data pointers or values according to
   /// the layout of its root signature
-  void AddMissProgram(const std::wstring& entryPoint, const std::vector<void*>& inputData);
+  uint32_t AddMissProgram(const std::wstring& entryPoint, const std::vector<void*>& inputData);
 
   /// Add a hit group by name, with its list of data pointers or values according to
   /// the layout of its root signature
-  void AddHitGroup(const std::wstring& entryPoint, const std::vector<void*>& inputData);
-
-  /// Compute the size of the SBT based on the set of programs and hit groups it contains
+  uint32_t AddHitGroup(const std::wstring& entryPoint, const std::vector<void*>& inputData);
+
+  /// Same as above with interned symbols, no string is hashed or copied
+  uint32_t AddRayGenerationProgram(ShaderSymbol entryPoint, const std::vector<void*>& inputData);
+  uint32_t AddMissProgram(ShaderSymbol entryPoint, const std::vector<void*>& inputData);
+  uint32_t AddHitGroup(ShaderSymbol entryPoint, const std::vector<void*>& inputData);
+
+  /// Same with records laid out at run time, e.g. from shader reflection: size bytes of root
+  /// arguments as they follow the identifier in the record, see ShaderRecordLayout.h
+  uint32_t AddRayGenerationProgram(ShaderSymbol entryPoint, const uint8_t* arguments,
+                                   uint32_t size);
+  uint32_t AddMissProgram(ShaderSymbol entryPoint, const uint8_t* arguments, uint32_t size);
+  uint32_t AddHitGroup(ShaderSymbol entryPoint, const uint8_t* arguments, uint32_t size);
+
+  /// Change the program or the values of an entry added before, without changing the layout. The
+  /// entry is marked dirty and rewritten by the next Update of each copy of the SBT. After
+  /// ComputeSBTSize the values have to fit the entry size of the section, a larger entry needs a
+  /// Reset and a new layout.
+  void SetRayGenerationProgram(uint32_t index, ShaderSymbol entryPoint,
+                               const std::vector<void*>& inputData);
+  void SetMissProgram(uint32_t index, ShaderSymbol entryPoint, const std::vector<void*>& inputData);
+  void SetHitGroup(uint32_t index, ShaderSymbol entryPoint, const std::vector<void*>& inputData);
+
+  /// Append count hit groups at once, each with room for argumentsSize bytes of root arguments,
+  /// and return the index of the first one. Large tables, e.g. a record per geometry of the
+  /// scene, are sized this way once and then written with FillHitGroup.
+  uint32_t ReserveHitGroups(uint32_t count, uint32_t argumentsSize);
+
+  /// Write the program and size bytes of root arguments of a hit group reserved with
+  /// ReserveHitGroups. Nothing is allocated or shared between entries, so several threads can
+  /// fill the table at once as long as each index is written by one of them. Only valid before ComputeSBTSize, which marks every record dirty, use
+  /// SetHitGroup to change an entry afterwards.
+  void FillHitGroup(uint32_t index, ShaderSymbol entryPoint, const uint8_t* arguments,
+                    uint32_t size);
+
+  /// Compute the size of the SBT based on the set of programs and hit groups it contains. The size
+  /// is a multiple of D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT.
   uint32_t ComputeSBTSize();
 
+  /// The layout computed by ComputeSBTSize
+  const ShaderTableLayout& GetLayout() const { return m_layout; }
+
   /// Build the SBT and store it into sbtBuffer, which has to be pre-allocated on the upload heap.
   /// Access to the raytracing pipeline object is required to fetch program identifiers using their
   /// names
   void Generate(ID3D12Resource* sbtBuffer,
                 ID3D12StateObjectProperties* raytracingPipeline);
 
-  /// Reset the sets of programs and hit groups
+  /// Build the SBT using identifiers already fetched from the pipeline, which makes generating
+  /// it a copy per entry without any name lookup
+  void Generate(ID3D12Resource* sbtBuffer, const ShaderIdentifierCache& identifiers);
+
+  /// Same, writing into sbtData mapped by the caller, at least ComputeSBTSize() bytes
+  void Generate(uint8_t* sbtData, const ShaderIdentifierCache& identifiers);
+
+  /// Rewrite only the entries of one copy of the SBT which changed since that copy was last
+  /// updated. Every copy, e.g. one per frame in flight, has its own dirty entries, and must not be
+  /// in use by the GPU. A copy seen for the first time, a new layout or new identifiers rewrite
+  /// everything. Returns the number of bytes written.
+  uint32_t Update(uint8_t* sbtData, const ShaderIdentifierCache& identifiers, uint32_t copy);
+
+  /// Reset the sets of programs and hit groups. Their storage is kept, so adding the same number
+  /// of entries again does not allocate.
   void Reset();
 
+  /// The table names are interned in
+  ShaderSymbolTable& Symbols() { return *m_symbols; }
+
   /// The following getters are used to simplify the call to DispatchRays where the offsets of the
   /// shader programs must be exactly following the SBT layout
 
@@ -151,51 +221,84 @@ public:
   /// Get the size in bytes of one ray generation program entry in the SBT
   UINT GetRayGenEntrySize() const;
 
+  /// Get the offset in bytes of the SBT section dedicated to miss programs, aligned to
+  /// D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+  UINT GetMissSectionOffset() const;
   /// Get the size in bytes of the SBT section dedicated to miss programs
   UINT GetMissSectionSize() const;
   /// Get the size in bytes of one miss program entry in the SBT
-  UINT GetMissEntrySize();
+  UINT GetMissEntrySize() const;
 
+  /// Get the offset in bytes of the SBT section dedicated to hit groups, aligned to
+  /// D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+  UINT GetHitGroupSectionOffset() const;
   /// Get the size in bytes of the SBT section dedicated to hit groups
   UINT GetHitGroupSectionSize() const;
   /// Get the size in bytes of hit group entry in the SBT
   UINT GetHitGroupEntrySize() const;
 
 private:
-  /// Wrapper for SBT entries, each consisting of the name of the program and a list of values,
-  /// which can be either pointers or raw 32-bit constants
+  /// Wrapper for SBT entries, each consisting of the symbol of the program and its root
+  /// arguments, laid out as they are in the record after the identifier. The arguments of all
+  /// entries are stored back to back in m_argumentData.
   struct SBTEntry
   {
-    SBTEntry(std::wstring entryPoint, std::vector<void*> inputData);
+    ShaderSymbol m_entryPoint;
+    uint32_t m_firstByte;
+    uint32_t m_numBytes;
+  };
 
-    const std::wstring m_entryPoint;
-    const std::vector<void*> m_inputData;
+  enum class Section
+  {
+    RayGen,
+    Miss,
+    HitGroup
   };
 
+  uint32_t AddEntry(std::vector<SBTEntry>& entries, ShaderSymbol entryPoint,
+                    const uint8_t* arguments, uint32_t size);
+
+  /// Replace an entry and mark its record dirty
+  void SetEntry(Section section, uint32_t index, ShaderSymbol entryPoint,
+                const uint8_t* arguments, uint32_t size);
+
+  /// Copy the shader identifier of one entry followed by its values, zeroing the rest of the record
+  void WriteEntry(const ShaderIdentifierCache& identifiers, uint8_t* outputData,
+                  const SBTEntry& shader, uint32_t entrySize);
+
   /// For each entry, copy the shader identifier followed by its resource pointers and/or root
   /// constants in outputData, with a stride in bytes of entrySize, and returns the size in bytes
   /// actually written to outputData.
-  uint32_t CopyShaderData(ID3D12StateObjectProperties* raytracingPipeline,
+  uint32_t CopyShaderData(const ShaderIdentifierCache& identifiers,
                           uint8_t* outputData, const std::vector<SBTEntry>& shaders,
                           uint32_t entrySize);
 
-  /// Compute the size of the SBT entries for a set of entries, which is determined by the maximum
-  /// number of parameters of their root signature
+  /// Compute the size of the SBT entries for a set of entries, which is determined by the largest
+  /// set of root arguments, before alignment
   uint32_t GetEntrySize(const std::vector<SBTEntry>& entries);
 
   std::vector<SBTEntry> m_rayGen;
   std::vector<SBTEntry> m_miss;
   std::vector<SBTEntry> m_hitGroup;
 
-  /// For each category, the size of an entry in the SBT depends on the maximum number of resources
-  /// used by the shaders in that category.The helper computes those values automatically in
-  /// GetEntrySize()
-  uint32_t m_rayGenEntrySize;
-  uint32_t m_missEntrySize;
-  uint32_t m_hitGroupEntrySize;
+  std::vector<uint8_t> m_argumentData;
+
+  ShaderSymbolTable m_ownSymbols;
+  ShaderSymbolTable* m_symbols;
+
+  /// Identifiers of the last pipeline passed to Generate by pointer, fetched again only when the
+  /// pipeline changes or new symbols got interned
+  ShaderIdentifierCache m_identifiers;
+
+  /// Entries changed since each copy of the SBT was last updated, records are numbered through
+  /// the ray generation, miss and hit group sections
+  DirtyRecordTracker m_dirtyRecords;
+  /// Generation of the identifiers the copies were last updated with
+  uint64_t m_updateGeneration = 0;
 
-  /// The program names are translated into program identifiers.The size in bytes of an identifier
-  /// is provided by the device and is the same for all categories.
-  UINT m_progIdSize;
+  /// Offset, stride and number of records of each section. The stride of a section depends on
+  /// the largest set of root arguments used by the shaders in that category, the helper computes
+  /// it automatically in ComputeSBTSize()
+  ShaderTableLayout m_layout = {};
 };
 } // namespace nv_helpers_dx12
@@ -0,0 +1,165 @@
+/*
+The exports of a raytracing pipeline, by symbol: what its DXIL libraries export, its hit groups
+and its root signature associations. From those come the list of exports the shader payload is
+associated with, and the checks that every name refers to something the pipeline defines.
+
+A pipeline grown with state object additions keeps everything it had, the libraries, hit groups
+and associations added since are given from their first index. The new hit groups may use the
+shaders already in the pipeline, the new associations only the new exports: those already in the
+pipeline have their root signature.
+
+Example:
+
+ShaderExports exports;
+exports.libraries = {{rayGen}, {miss}, {closestHit}};
+exports.hitGroups = {{hitGroup, closestHit, kNoShaderSymbol, kNoShaderSymbol}};
+exports.associations = {{rayGen}, {miss}, {hitGroup}};
+
+CheckShaderExports(exports, symbols.Size(), 0, 0, 0);
+std::vector<ShaderSymbol> payloadExports = ListShaderExports(exports, symbols.Size(), 0, 0);
+// payloadExports == {rayGen, miss, hitGroup}, in symbol order
+
+It has no dependency on D3D12.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace nv_helpers_dx12
+{
+
+/// Handle of an interned name, an index into the ShaderSymbolTable that interned it
+typedef uint32_t ShaderSymbol;
+
+/// No symbol, e.g. a hit group without any hit shader. The empty name interns to it.
+const ShaderSymbol kNoShaderSymbol = ~0u;
+
+struct HitGroupExports
+{
+  ShaderSymbol name;
+  ShaderSymbol closestHit;
+  ShaderSymbol anyHit;
+  ShaderSymbol intersection;
+};
+
+struct ShaderExports
+{
+  /// Symbols exported by each DXIL library
+  std::vector<std::vector<ShaderSymbol>> libraries;
+  std::vector<HitGroupExports> hitGroups;
+  /// Symbols each root signature is associated with
+  std::vector<std::vector<ShaderSymbol>> associations;
+};
+
+/// Exports of the libraries and hit groups starting at the given indices the shader payload is
+/// associated with: the ray generation, miss and callable shaders, and the hit group names instead
+/// of the shaders in them. Symbols are below numSymbols, the list is in symbol order.
+inline std::vector<ShaderSymbol> ListShaderExports(const ShaderExports& exports,
+                                                   uint32_t numSymbols, size_t firstLibrary,
+                                                   size_t firstHitGroup)
+{
+  // Symbols are small indices, so the set is flags indexed by symbol
+  std::vector<uint8_t> listed(numSymbols, 0);
+
+  for (size_t i = firstLibrary; i < exports.libraries.size(); i++)
+  {
+    for (ShaderSymbol symbol : exports.libraries[i])
+    {
+      listed[symbol] = 1;
+    }
+  }
+
+  // The shaders of a hit group are only referred to by the hit group name
+  for (size_t i = firstHitGroup; i < exports.hitGroups.size(); i++)
+  {
+    const HitGroupExports& hitGroup = exports.hitGroups[i];
+    for (ShaderSymbol shader : {hitGroup.closestHit, hitGroup.anyHit, hitGroup.intersection})
+    {
+      if (shader != kNoShaderSymbol)
+      {
+        listed[shader] = 0;
+      }
+    }
+    listed[hitGroup.name] = 1;
+  }
+
+  std::vector<ShaderSymbol> list;
+  for (ShaderSymbol symbol = 0; symbol < numSymbols; symbol++)
+  {
+    if (listed[symbol])
+    {
+      list.push_back(symbol);
+    }
+  }
+  return list;
+}
+
+/// Throws std::logic_error if a name is exported by more than one library, if a hit group starting
+/// at firstHitGroup uses a shader no library exports, or if an association starting at
+/// firstAssociation names something else than an export of the libraries and hit groups starting
+/// at firstLibrary and firstHitGroup
+inline void CheckShaderExports(const ShaderExports& exports, uint32_t numSymbols,
+                               size_t firstLibrary, size_t firstHitGroup, size_t firstAssociation)
+{
+  // Every library, those already in the pipeline too
+  std::vector<uint8_t> allExports(numSymbols, 0);
+  for (const std::vector<ShaderSymbol>& library : exports.libraries)
+  {
+    for (ShaderSymbol symbol : library)
+    {
+      if (allExports[symbol])
+      {
+        throw std::logic_error("Multiple definition of a symbol in the imported DXIL libraries");
+      }
+      allExports[symbol] = 1;
+    }
+  }
+
+  for (size_t i = firstHitGroup; i < exports.hitGroups.size(); i++)
+  {
+    const HitGroupExports& hitGroup = exports.hitGroups[i];
+    if (hitGroup.anyHit != kNoShaderSymbol && !allExports[hitGroup.anyHit])
+    {
+      throw std::logic_error("Any hit symbol not found in the imported DXIL libraries");
+    }
+    if (hitGroup.closestHit != kNoShaderSymbol && !allExports[hitGroup.closestHit])
+    {
+      throw std::logic_error("Closest hit symbol not found in the imported DXIL libraries");
+    }
+    if (hitGroup.intersection != kNoShaderSymbol && !allExports[hitGroup.intersection])
+    {
+      throw std::logic_error("Intersection symbol not found in the imported DXIL libraries");
+    }
+  }
+
+  // Only the new libraries and hit groups
+  std::vector<uint8_t> newExports(numSymbols, 0);
+  for (size_t i = firstLibrary; i < exports.libraries.size(); i++)
+  {
+    for (ShaderSymbol symbol : exports.libraries[i])
+    {
+      newExports[symbol] = 1;
+    }
+  }
+  for (size_t i = firstHitGroup; i < exports.hitGroups.size(); i++)
+  {
+    newExports[exports.hitGroups[i].name] = 1;
+  }
+
+  for (size_t i = firstAssociation; i < exports.associations.size(); i++)
+  {
+    for (ShaderSymbol symbol : exports.associations[i])
+    {
+      if (symbol != kNoShaderSymbol && !newExports[symbol])
+      {
+        throw std::logic_error("Root association symbol not found in the "
+                               "imported DXIL libraries and hit group names");
+      }
+    }
+  }
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,76 @@
+/*
+Layout of the sections of a shader binding table.
+
+A shader record is a shader identifier followed by the root arguments of the local root
+signature of the shader, each aligned to its size: 8 bytes for root descriptors and descriptor
+tables, 4 bytes for root constants. The sections of the table start on
+D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT boundaries and each has its own stride, the
+smallest valid one for its largest record:
+
+ShaderTableLayout layout = ComputeShaderTableLayout(rayGenSize, 1, missSize, 2, hitSize, 4);
+// layout.hitGroup.offset + index * layout.hitGroup.stride is the record of hit group index
+
+Both can be evaluated at compile time.
+
+It has no dependency on D3D12, the constants are checked against the D3D12 ones by the
+ShaderBindingTableGenerator.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace nv_helpers_dx12
+{
+
+/// D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+constexpr uint32_t kShaderIdentifierSize = 32;
+/// D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, alignment of every record
+constexpr uint32_t kShaderRecordAlignment = 32;
+/// D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, alignment of the start of every section
+constexpr uint32_t kShaderTableAlignment = 64;
+
+constexpr uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/// A section of the table: where it starts, the stride between its records and how many
+struct ShaderTableSection
+{
+  uint32_t offset;
+  uint32_t stride;
+  uint32_t count;
+
+  constexpr uint32_t Size() const { return stride * count; }
+};
+
+struct ShaderTableLayout
+{
+  ShaderTableSection rayGen;
+  ShaderTableSection miss;
+  ShaderTableSection hitGroup;
+  /// Multiple of kShaderTableAlignment, so copies of the table can be put back to back
+  uint32_t size;
+};
+
+/// Ray generation, miss and hit group sections one after the other, each starting on a
+/// kShaderTableAlignment boundary. Ray generation records are each used as the start of a table
+/// by DispatchRays, so their stride is aligned to kShaderTableAlignment as well.
+constexpr ShaderTableLayout ComputeShaderTableLayout(uint32_t rayGenSize, uint32_t numRayGen,
+                                                     uint32_t missSize, uint32_t numMiss,
+                                                     uint32_t hitGroupSize, uint32_t numHitGroups)
+{
+  ShaderTableLayout layout = {};
+
+  layout.rayGen = {0, AlignUp(rayGenSize, kShaderTableAlignment), numRayGen};
+  layout.miss = {AlignUp(layout.rayGen.offset + layout.rayGen.Size(), kShaderTableAlignment),
+                 AlignUp(missSize, kShaderRecordAlignment), numMiss};
+  layout.hitGroup = {AlignUp(layout.miss.offset + layout.miss.Size(), kShaderTableAlignment),
+                     AlignUp(hitGroupSize, kShaderRecordAlignment), numHitGroups};
+  layout.size = AlignUp(layout.hitGroup.offset + layout.hitGroup.Size(), kShaderTableAlignment);
+
+  return layout;
+}
+
+} // namespace nv_helpers_dx12
@@ -0,0 +1,111 @@
+/*
+The ShaderSymbolTable interns the names of the exports of a raytracing pipeline, and the
+ShaderIdentifierCache holds the shader identifiers of one pipeline indexed by those symbols.
+*/
+
+#include "ShaderSymbolTable.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace nv_helpers_dx12
+{
+
+namespace
+{
+std::atomic<uint64_t> s_identifierGeneration = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Handle of the name, interning it on first use
+ShaderSymbol ShaderSymbolTable::Intern(const std::wstring& name)
+{
+  if (name.empty())
+  {
+    return kNoShaderSymbol;
+  }
+
+  auto found = m_symbols.find(name);
+  if (found != m_symbols.end())
+  {
+    return found->second;
+  }
+
+  ShaderSymbol symbol = Size();
+  m_names.push_back(name);
+  m_symbols.emplace(m_names.back(), symbol);
+
+  return symbol;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Handle of an already interned name, kNoShaderSymbol if it never was
+ShaderSymbol ShaderSymbolTable::Find(const std::wstring& name) const
+{
+  auto found = m_symbols.find(name);
+
+  return found != m_symbols.end() ? found->second : kNoShaderSymbol;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// The interned name, the pointer stays valid for the lifetime of the table
+const wchar_t* ShaderSymbolTable::Name(ShaderSymbol symbol) const
+{
+  return symbol < Size() ? m_names[symbol].c_str() : L"";
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Fetch the identifiers of the pipeline for all the symbols of the table, replacing those of any
+// previous pipeline
+void ShaderIdentifierCache::Fill(ID3D12StateObjectProperties* raytracingPipeline,
+                                 const ShaderSymbolTable& symbols)
+{
+  Reset();
+  m_pipeline = raytracingPipeline;
+  Update(symbols);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Fetch the identifiers of symbols interned since the last Fill or Update. This is the only place
+// the names are looked up in the pipeline.
+void ShaderIdentifierCache::Update(const ShaderSymbolTable& symbols)
+{
+  uint32_t first = static_cast<uint32_t>(m_valid.size());
+
+  if (!m_pipeline || first >= symbols.Size())
+  {
+    return;
+  }
+
+  m_identifiers.resize(size_t(symbols.Size()) * D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+  m_valid.resize(symbols.Size(), 0);
+
+  for (ShaderSymbol symbol = first; symbol < symbols.Size(); symbol++)
+  {
+    void* id = m_pipeline->GetShaderIdentifier(symbols.Name(symbol));
+    if (id)
+    {
+      memcpy(m_identifiers.data() + size_t(symbol) * D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, id,
+             D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+      m_valid[symbol] = 1;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+//
+void ShaderIdentifierCache::Reset()
+{
+  m_pipeline = nullptr;
+  m_identifiers.clear();
+  m_valid.clear();
+  m_generation = ++s_identifierGeneration;
+}
+
+} // namespace nv_helpers_dx12
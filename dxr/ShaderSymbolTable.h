@@ -0,0 +1,100 @@
+/*
+The ShaderSymbolTable interns the names of shaders, hit groups and other exports of a
+raytracing pipeline, and hands out small integer handles for them. The pipeline and SBT
+helpers refer to exports through those handles, so the names are hashed once when interned
+and never compared again afterwards.
+
+The ShaderIdentifierCache holds the shader identifiers of one raytracing pipeline, indexed by
+symbol. They are fetched from the pipeline once, after which filling shader records is a plain
+copy per record.
+
+Example:
+
+ShaderSymbolTable symbols;
+ShaderSymbol rayGen = symbols.Intern(L"RayGen");
+ShaderSymbol hitGroup = symbols.Intern(L"HitGroup");
+
+// build the pipeline and the SBT with those handles, then
+ShaderIdentifierCache identifiers;
+identifiers.Fill(rtStateObjectProps, symbols);
+m_sbtHelper.Generate(m_sbtStorage.Get(), identifiers);
+*/
+
+#pragma once
+
+#include "d3d12.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <wrl/client.h>
+
+// ShaderSymbol and kNoShaderSymbol
+#include "ShaderExports.h"
+
+namespace nv_helpers_dx12
+{
+
+class ShaderSymbolTable
+{
+public:
+  /// Handle of the name, interning it on first use
+  ShaderSymbol Intern(const std::wstring& name);
+
+  /// Handle of an already interned name, kNoShaderSymbol if it never was
+  ShaderSymbol Find(const std::wstring& name) const;
+
+  /// The interned name, the pointer stays valid for the lifetime of the table
+  const wchar_t* Name(ShaderSymbol symbol) const;
+
+  /// Number of interned symbols, handles are 0 to Size() - 1
+  uint32_t Size() const { return static_cast<uint32_t>(m_names.size()); }
+
+private:
+  /// A deque never moves its elements, so the views used as keys stay valid
+  std::deque<std::wstring> m_names;
+  std::unordered_map<std::wstring_view, ShaderSymbol> m_symbols;
+};
+
+class ShaderIdentifierCache
+{
+public:
+  /// Fetch the identifiers of the pipeline for all the symbols of the table, replacing those of
+  /// any previous pipeline. Symbols which are not shader or hit group exports of the pipeline
+  /// (e.g. a closest hit shader only reachable through its hit group) get no identifier.
+  void Fill(ID3D12StateObjectProperties* raytracingPipeline, const ShaderSymbolTable& symbols);
+
+  /// Fetch the identifiers of symbols interned since the last Fill or Update, for the same pipeline
+  void Update(const ShaderSymbolTable& symbols);
+
+  /// The D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES bytes identifier of the symbol, nullptr if the
+  /// pipeline has none for it
+  const void* Get(ShaderSymbol symbol) const
+  {
+    return symbol < m_valid.size() && m_valid[symbol]
+               ? m_identifiers.data() + size_t(symbol) * D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+               : nullptr;
+  }
+
+  /// The pipeline the identifiers belong to. It is kept alive by the cache, so a pipeline
+  /// created later can not reuse its address while identifiers of the old one are around.
+  ID3D12StateObjectProperties* Pipeline() const { return m_pipeline.Get(); }
+
+  /// Changes with every Fill or Reset of any cache, so data written from the identifiers can tell
+  /// whether it is out of date even if a new pipeline got the address of an old one
+  uint64_t Generation() const { return m_generation; }
+
+  void Reset();
+
+private:
+  Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> m_pipeline;
+  std::vector<uint8_t> m_identifiers;
+  std::vector<uint8_t> m_valid;
+  uint64_t m_generation = 0;
+};
+
+} // namespace nv_helpers_dx12
@@ -138,8 +138,9 @@ private:
     Instance(ID3D12Resource* blAS, const DirectX::XMMATRIX& tr, UINT iID, UINT hgId);
     /// Bottom-level AS
     ID3D12Resource* bottomLevelAS;
-    /// Transform matrix
-    const DirectX::XMMATRIX& transform;
+    /// Transform matrix, stored by value so the TLAS can be regenerated after the caller's
+    /// instance list is gone
+    DirectX::XMMATRIX transform;
     /// Instance ID visible in the shader
     UINT instanceID;
     /// Hit group index used to fetch the shaders from the SBT
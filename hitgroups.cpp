@@ -0,0 +1,35 @@
+#include "hitgroups.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+HitGroupTableLayout layoutHitGroupTable(const std::vector<uint32_t>& geometriesPerInstance, uint32_t numRayTypes) {
+	HitGroupTableLayout layout;
+	layout.numRayTypes = numRayTypes;
+	layout.instanceContributions.reserve(geometriesPerInstance.size());
+
+	uint64_t numRecords = 0;
+
+	for (uint32_t geometries : geometriesPerInstance) {
+		layout.instanceContributions.push_back(static_cast<uint32_t>(numRecords));
+		numRecords += uint64_t(geometries) * numRayTypes;
+
+		if (numRecords > kMaxHitGroupRecords) {
+			throw std::length_error("hit group table has more records than an instance can address");
+		}
+	}
+
+	layout.numRecords = static_cast<uint32_t>(numRecords);
+
+	return layout;
+}
+
+HitGroupRecord locateHitGroupRecord(const HitGroupTableLayout& layout, uint32_t record) {
+	// the last instance starting at or before the record, instances without geometry start
+	// where the next one does and get skipped
+	auto next = std::upper_bound(layout.instanceContributions.begin(), layout.instanceContributions.end(), record);
+	uint32_t instance = static_cast<uint32_t>(next - layout.instanceContributions.begin()) - 1;
+	uint32_t local = record - layout.instanceContributions[instance];
+
+	return { instance, local / layout.numRayTypes, local % layout.numRayTypes };
+}
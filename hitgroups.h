@@ -0,0 +1,44 @@
+#pragma once
+
+// Layout of the hit group table, no D3D12 in here. Every geometry of every instance gets its
+// own hit records, one per ray type, so each mesh binds its own vertex and index data. The
+// record a hit uses is picked on the GPU as
+//
+//   InstanceContributionToHitGroupIndex
+//     + GeometryIndex * MultiplierForGeometryContributionToHitGroupIndex
+//     + RayContributionToHitGroupIndex
+//
+// with the instance contributions from here, the multiplier being the number of ray types
+// and the ray contribution the ray type passed to TraceRay.
+
+#include <cstdint>
+#include <vector>
+
+// InstanceContributionToHitGroupIndex is a 24 bit field of the instance desc
+const uint32_t kMaxHitGroupRecords = 1u << 24;
+
+struct HitGroupTableLayout {
+	uint32_t numRayTypes = 1;
+	// first record of each instance, prefix sums of geometries * ray types
+	std::vector<uint32_t> instanceContributions;
+	uint32_t numRecords = 0;
+};
+
+// Which instance, geometry and ray type a record is for
+struct HitGroupRecord {
+	uint32_t instance;
+	uint32_t geometry;
+	uint32_t rayType;
+};
+
+// Throws std::length_error past kMaxHitGroupRecords records
+HitGroupTableLayout layoutHitGroupTable(const std::vector<uint32_t>& geometriesPerInstance, uint32_t numRayTypes);
+
+inline uint32_t hitGroupRecordIndex(const HitGroupTableLayout& layout, uint32_t instance, uint32_t geometry,
+	uint32_t rayType) {
+	return layout.instanceContributions[instance] + geometry * layout.numRayTypes + rayType;
+}
+
+// Inverse of hitGroupRecordIndex, a binary search over the instances. Lets the table be
+// filled by record ranges, which splits evenly however the geometries are spread.
+HitGroupRecord locateHitGroupRecord(const HitGroupTableLayout& layout, uint32_t record);
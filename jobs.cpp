@@ -0,0 +1,476 @@
+#include "jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+	// the pool the current thread is a worker of, and its index there
+	thread_local JobSystem* tJobSystem = nullptr;
+	thread_local uint32_t tWorkerIndex = 0;
+}
+
+bool Task::finished() const {
+	return !m_state || m_state->finished;
+}
+
+JobSystem::JobSystem(uint32_t numWorkers) {
+	for (uint32_t i = 0; i < numWorkers + 1; i++) {
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+
+	for (uint32_t i = 0; i < numWorkers; i++) {
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+uint32_t JobSystem::defaultWorkerCount() {
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+Task JobSystem::run(std::function<void()> job, const std::vector<Task>& dependencies) {
+	auto state = std::make_shared<Task::State>();
+	state->job = std::move(job);
+
+	// held while the dependencies are registered so the task can't be queued halfway through
+	state->pendingDependencies = 1;
+
+	for (const Task& dependency : dependencies) {
+		if (!dependency.valid()) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(dependency.m_state->mutex);
+
+		if (dependency.m_state->finished) {
+			if (dependency.m_state->error && !state->error) {
+				state->error = dependency.m_state->error;
+			}
+			continue;
+		}
+
+		state->pendingDependencies++;
+		dependency.m_state->dependents.push_back(state);
+	}
+
+	if (--state->pendingDependencies == 0) {
+		push(state);
+	}
+
+	return Task(state);
+}
+
+void JobSystem::wait(const Task& task) {
+	bool helping = helpsOut();
+
+	while (!task.finished()) {
+		if (helping) {
+			if (runOne()) {
+				continue;
+			}
+		}
+		else if (TaskState own = claim(task.m_state)) {
+			execute(std::move(own));
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepers++;
+		if (!helping) {
+			m_outsideSleepers++;
+		}
+
+		m_wake.wait(lock, [&] { return task.finished() || (helping ? m_queued > 0 : task.m_state->queued.load()); });
+
+		m_sleepers--;
+		if (!helping) {
+			m_outsideSleepers--;
+		}
+	}
+
+	if (task.m_state) {
+		std::lock_guard<std::mutex> lock(task.m_state->mutex);
+
+		if (task.m_state->error) {
+			std::rethrow_exception(task.m_state->error);
+		}
+	}
+}
+
+void JobSystem::wait(const std::vector<Task>& tasks) {
+	// wait for all of them even if one threw, callers rely on nothing running afterwards
+	std::exception_ptr error;
+
+	for (const Task& task : tasks) {
+		try {
+			wait(task);
+		}
+		catch (...) {
+			if (!error) {
+				error = std::current_exception();
+			}
+		}
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize,
+	const std::function<void(size_t begin, size_t end)>& body, uint32_t maxThreads) {
+	if (count == 0) {
+		return;
+	}
+
+	if (grainSize == 0) {
+		// a few chunks per thread so uneven chunks even out
+		grainSize = std::max<size_t>(1, count / ((numWorkers() + 1) * 4));
+	}
+
+	size_t numChunks = (count + grainSize - 1) / grainSize;
+	std::atomic<size_t> nextChunk = 0;
+
+	// every participant grabs chunks until none are left, so helpers that start late just return.
+	// A thread outside the pool waiting below runs its own helpers if no worker took them yet.
+	auto loop = [&]() {
+		for (size_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+			body(chunk * grainSize, std::min(count, (chunk + 1) * grainSize));
+		}
+	};
+
+	std::vector<Task> helpers;
+	size_t numHelpers = std::min<size_t>(numChunks - 1, numWorkers());
+
+	if (maxThreads > 0) {
+		numHelpers = std::min<size_t>(numHelpers, maxThreads - 1);
+	}
+
+	for (size_t i = 0; i < numHelpers; i++) {
+		helpers.push_back(run(loop));
+	}
+
+	std::exception_ptr error;
+
+	try {
+		loop();
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+
+	// the helpers reference this stack frame, they all have to be done before returning
+	try {
+		wait(helpers);
+	}
+	catch (...) {
+		if (!error) {
+			error = std::current_exception();
+		}
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex) {
+	tJobSystem = this;
+	tWorkerIndex = workerIndex;
+
+	while (true) {
+		if (runOne()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+		m_sleepers++;
+		m_wake.wait(lock, [this] { return m_quit || m_queued > 0; });
+		m_sleepers--;
+
+		if (m_quit && m_queued == 0) {
+			return;
+		}
+	}
+}
+
+void JobSystem::push(TaskState task) {
+	// a worker keeps what it spawns local, anyone else hands it to the shared queue
+	Queue& queue = tJobSystem == this ? *m_queues[tWorkerIndex] : *m_queues.back();
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		task->queued = true;
+		queue.tasks.push_back(std::move(task));
+	}
+
+	m_queued++;
+
+	// a thread outside the pool only wakes for its own task, one wakeup could miss it
+	if (m_sleepers > 0) {
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+
+		if (m_outsideSleepers > 0) {
+			m_wake.notify_all();
+		}
+		else {
+			m_wake.notify_one();
+		}
+	}
+}
+
+JobSystem::TaskState JobSystem::pop() {
+	if (m_queued == 0) {
+		return nullptr;
+	}
+
+	bool isWorker = tJobSystem == this;
+	uint32_t numQueues = static_cast<uint32_t>(m_queues.size());
+
+	auto take = [&](Queue& queue, bool fromBack) -> TaskState {
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty()) {
+			return nullptr;
+		}
+
+		TaskState task;
+		if (fromBack) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+
+		task->queued = false;
+		m_queued--;
+
+		return task;
+	};
+
+	// own tasks newest first, they are the most likely to still be in cache
+	if (isWorker) {
+		if (TaskState task = take(*m_queues[tWorkerIndex], true)) {
+			return task;
+		}
+	}
+
+	if (TaskState task = take(*m_queues.back(), false)) {
+		return task;
+	}
+
+	// steal the oldest task of another worker, starting next to us so thieves spread out
+	uint32_t start = isWorker ? tWorkerIndex + 1 : 0;
+
+	for (uint32_t i = 0; i < numQueues - 1; i++) {
+		uint32_t victim = (start + i) % (numQueues - 1);
+
+		if (isWorker && victim == tWorkerIndex) {
+			continue;
+		}
+
+		if (TaskState task = take(*m_queues[victim], false)) {
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+// takes exactly this task out of whichever queue it's in, null if it's not queued (anymore)
+JobSystem::TaskState JobSystem::claim(const TaskState& task) {
+	if (!task->queued) {
+		return nullptr;
+	}
+
+	for (auto& queue : m_queues) {
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		auto found = std::find(queue->tasks.begin(), queue->tasks.end(), task);
+
+		if (found != queue->tasks.end()) {
+			queue->tasks.erase(found);
+			task->queued = false;
+			m_queued--;
+
+			return task;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::helpsOut() const {
+	return tJobSystem == this || m_workers.empty();
+}
+
+bool JobSystem::runOne() {
+	TaskState task = pop();
+
+	if (!task) {
+		return false;
+	}
+
+	execute(std::move(task));
+
+	return true;
+}
+
+void JobSystem::execute(TaskState task) {
+	bool skip;
+	{
+		std::lock_guard<std::mutex> lock(task->mutex);
+		skip = task->error != nullptr;
+	}
+
+	if (!skip) {
+		try {
+			task->job();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(task->mutex);
+			task->error = std::current_exception();
+		}
+	}
+
+	// drop whatever the job captured now rather than when the last handle goes away
+	task->job = nullptr;
+
+	finish(task);
+}
+
+void JobSystem::finish(const TaskState& task) {
+	std::vector<TaskState> dependents;
+	std::exception_ptr error;
+
+	{
+		std::lock_guard<std::mutex> lock(task->mutex);
+		task->finished = true;
+		dependents.swap(task->dependents);
+		error = task->error;
+	}
+
+	for (TaskState& dependent : dependents) {
+		if (error) {
+			std::lock_guard<std::mutex> lock(dependent->mutex);
+			if (!dependent->error) {
+				dependent->error = error;
+			}
+		}
+
+		if (--dependent->pendingDependencies == 0) {
+			push(std::move(dependent));
+		}
+	}
+
+	// someone may be waiting for exactly this task
+	if (m_sleepers > 0) {
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wake.notify_all();
+	}
+}
+
+namespace {
+	// fixed amount of integer work that the optimizer can't drop
+	uint64_t busyWork(uint64_t seed, uint32_t iterations) {
+		uint64_t x = seed * 0x9E3779B97F4A7C15ull + 1;
+
+		for (uint32_t i = 0; i < iterations; i++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+		}
+
+		return x;
+	}
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+std::vector<JobBenchmarkResult> benchmarkJobSystem(uint32_t maxThreads) {
+	const size_t kItems = 1 << 14;
+	const uint32_t kItemWork = 20000;
+	const uint32_t kChains = 64;
+	const uint32_t kChainLength = 16;
+	const uint32_t kTaskWork = 200000;
+
+	std::vector<JobBenchmarkResult> results;
+	std::vector<uint64_t> output(kItems);
+
+	for (uint32_t threads = 1; threads <= std::max(1u, maxThreads); threads++) {
+		JobSystem jobs(threads - 1);
+		JobBenchmarkResult result = {};
+		result.threads = threads;
+
+		auto start = std::chrono::steady_clock::now();
+		jobs.parallelFor(kItems, 0, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				output[i] = busyWork(i, kItemWork);
+			}
+		});
+		result.parallelForSeconds = secondsSince(start);
+
+		// one root fanning out into independent chains, joined by a final task
+		std::vector<uint64_t> chainResults(kChains);
+		start = std::chrono::steady_clock::now();
+
+		Task root = jobs.run([] {});
+		std::vector<Task> chainEnds;
+
+		for (uint32_t chain = 0; chain < kChains; chain++) {
+			Task previous = root;
+
+			for (uint32_t link = 0; link < kChainLength; link++) {
+				previous = jobs.run([&chainResults, chain, kTaskWork] {
+					chainResults[chain] = busyWork(chainResults[chain] + chain, kTaskWork);
+				}, { previous });
+			}
+
+			chainEnds.push_back(previous);
+		}
+
+		uint64_t joined = 0;
+		jobs.wait(jobs.run([&] {
+			for (uint64_t value : chainResults) {
+				joined ^= value;
+			}
+		}, chainEnds));
+		result.taskGraphSeconds = secondsSince(start);
+
+		result.speedup = results.empty() ? 1.0 : results[0].parallelForSeconds / result.parallelForSeconds;
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+std::string formatJobBenchmark(const std::vector<JobBenchmarkResult>& results) {
+	std::string text = "job system scaling\n threads  parallel-for  task graph  speedup\n";
+	char line[128];
+
+	for (const JobBenchmarkResult& result : results) {
+		snprintf(line, sizeof(line), " %7u  %10.1fms  %8.1fms  %6.2fx\n", result.threads,
+			result.parallelForSeconds * 1000.0, result.taskGraphSeconds * 1000.0, result.speedup);
+		text += line;
+	}
+
+	return text;
+}
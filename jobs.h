@@ -0,0 +1,122 @@
+#pragma once
+
+// Work-stealing job system shared by everything CPU heavy (command recording, shader
+// compiles, SBT fills, ...). No D3D12 in here.
+//
+// A fixed pool of workers each owns a deque of tasks: a worker pushes and pops its own
+// tasks at the back and steals from the front of the others' when it runs dry. Tasks
+// started from outside the pool go to a shared queue every worker looks at. Workers
+// waiting for a task run other tasks in the meantime, so waiting inside a task is fine.
+// Threads outside the pool (the render thread) only run the task they wait for, or their
+// own parallelFor chunks, and otherwise block: picking up someone else's long task would
+// stall them for as long as it takes. A pool without workers is the exception, its callers
+// run whatever is queued as nothing else would.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Handle to a scheduled task, cheap to copy. A default constructed one counts as finished.
+class Task {
+public:
+	Task() = default;
+
+	bool valid() const { return m_state != nullptr; }
+	bool finished() const;
+
+private:
+	friend class JobSystem;
+
+	struct State {
+		std::function<void()> job;
+		std::atomic<uint32_t> pendingDependencies = 0;
+		std::atomic<bool> finished = false;
+		std::atomic<bool> queued = false; // sitting in one of the queues
+		std::mutex mutex; // guards dependents and error
+		std::vector<std::shared_ptr<State>> dependents;
+		std::exception_ptr error;
+	};
+
+	explicit Task(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+	std::shared_ptr<State> m_state;
+};
+
+class JobSystem {
+public:
+	// numWorkers threads besides the ones calling in, 0 gives a pool that runs everything on the caller
+	explicit JobSystem(uint32_t numWorkers = defaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// one less than the number of hardware threads, the thread waiting on the pool helps out
+	static uint32_t defaultWorkerCount();
+
+	uint32_t numWorkers() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	// Runs job once all dependencies have finished. If one of them threw, job is skipped and
+	// the task finishes with that exception.
+	Task run(std::function<void()> job, const std::vector<Task>& dependencies = {});
+
+	// Blocks until the task finished and rethrows what it threw. Workers run other tasks
+	// meanwhile, threads outside the pool only the task itself.
+	void wait(const Task& task);
+	void wait(const std::vector<Task>& tasks);
+
+	// Calls body(begin, end) over [0, count) in chunks of grainSize (0 picks one) on the workers
+	// and the calling thread, returns when all are done. maxThreads caps how many chunks run at
+	// once, 0 allows one per thread.
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body,
+		uint32_t maxThreads = 0);
+
+private:
+	typedef std::shared_ptr<Task::State> TaskState;
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<TaskState> tasks;
+	};
+
+	void workerLoop(uint32_t workerIndex);
+	void push(TaskState task);
+	TaskState pop();
+	TaskState claim(const TaskState& task);
+	bool runOne();
+	bool helpsOut() const;
+	void execute(TaskState task);
+	void finish(const TaskState& task);
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<Queue>> m_queues; // one per worker, then the shared one for outside threads
+
+	std::atomic<uint64_t> m_queued = 0; // tasks sitting in any queue
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake; // new task queued, a task finished or quitting
+	std::atomic<uint32_t> m_sleepers = 0;
+	std::atomic<uint32_t> m_outsideSleepers = 0; // waiting for one particular task to be queued
+	bool m_quit = false;
+};
+
+struct JobBenchmarkResult {
+	uint32_t threads; // workers + the calling thread
+	double parallelForSeconds;
+	double taskGraphSeconds;
+	double speedup; // of the parallel-for over one thread
+};
+
+// Runs a fixed CPU-bound parallel-for and a task graph (fan-out, fan-in, chains) with 1 to
+// maxThreads threads
+std::vector<JobBenchmarkResult> benchmarkJobSystem(uint32_t maxThreads);
+std::string formatJobBenchmark(const std::vector<JobBenchmarkResult>& results);
@@ -23,14 +23,30 @@
 
 // STL
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <iostream>
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
 
 // helpers
 #include "helpers.h"
 #include "raytracing.h"
+#include "residencymanager.h"
+#include "jobs.h"
+#include "recorder.h"
+#include "scheduler.h"
+#include "queues.h"
+#include "timeline.h"
+#include "resize.h"
+#include "shaders.h"
+#include "shaderwatch.h"
+#include "startup.h"
+#include "pipelines.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -40,6 +56,8 @@ uint32_t gClientWidth = 1280;
 uint32_t gClientHeight = 720;
 
 bool gIsInitialized = false; // set to true once DX12 objects initialized
+const auto gStartTime = std::chrono::steady_clock::now(); // time to first frame and to ray tracing are measured from here
+bool gFirstFramePresented = false; // render thread only
 
 // Windows globals
 
@@ -49,12 +67,17 @@ RECT gWindowRect;
 // DirectX 12 objects
 ComPtr<ID3D12Device5> gDevice;
 ComPtr<ID3D12CommandQueue> gCommandQueue;
+ComPtr<ID3D12CommandQueue> gComputeQueue; // acceleration structure builds, overlap with ray tracing on gCommandQueue
 ComPtr<IDXGISwapChain4> gSwapChain;
 ComPtr<ID3D12Resource> gBackBuffers[gNumFrames];
-ComPtr<ID3D12GraphicsCommandList4> gCommandList;
+ComPtr<ID3D12GraphicsCommandList4> gCommandList; // only used for initialization, frames are recorded by gCommandRecorder
 ComPtr<ID3D12CommandAllocator> gCommandAllocators[gNumFrames];
+CommandRecorder gCommandRecorder;
+std::unique_ptr<JobSystem> gJobs; // worker pool shared by everything that runs in parallel
 ComPtr<ID3D12DescriptorHeap> gRTVDescriptorHeap; // render target view
 ComPtr<ID3D12RootSignature> gRootSignature;
+ComPtr<ID3DBlob> gRootSignatureBlob; // serialized gRootSignature, part of the pipeline cache keys
+PipelineStateCache gPipelineStates; // graphics PSOs, kept in pipelines.bin next to the shader cache
 ComPtr<ID3D12PipelineState> gPipelineState;
 CD3DX12_VIEWPORT gViewport;
 CD3DX12_RECT gScissorRect;
@@ -64,19 +87,47 @@ UINT gCurrentBackBufferIndex;
 // DirectX 12 resources
 ComPtr<ID3D12Resource> gVertexBuffer;
 D3D12_VERTEX_BUFFER_VIEW gVertexBufferView;
+ComPtr<ID3D12Resource> gIndexBuffer; // only read by the hit shaders, the raster path draws unindexed
 
 // DXR specific stuff 
 
 ComPtr<ID3D12Resource> gBLAS;
 
-nv_helpers_dx12::TopLevelASGenerator gTopLevelASGenerator;
-AccelerationStructureBuffers gTopLevelASBuffers;
-AccelerationStructureBuffers gBottomLevelASBuffers;
+// one TLAS per frame in flight, rebuilt on the compute queue every ray traced frame
+nv_helpers_dx12::TopLevelASGenerator gTopLevelASGenerators[gNumFrames];
+AccelerationStructureBuffers gTopLevelASBuffers[gNumFrames];
+
+// meshes with a BLAS each and the instances of them in the TLAS, every geometry of every
+// instance has its own hit records laid out by gHitGroups
+std::vector<RaytracingMesh> gMeshes;
+std::vector<RaytracingInstance> gInstances;
+HitGroupTableLayout gHitGroups;
+
+ShaderCompiler gShaderCompiler;
+ShaderArchive gShaderArchive;
+std::vector<ShaderCompileJob> gBaseShaders; // applicationShaders(), by ShaderIndex
+std::vector<ShaderCompileJob> gShaders; // the variants in use, by ShaderIndex
+
+// shader permutations, the render thread switches to the requested features once their
+// variants are ready
+VariantCache<ShaderCompileJob> gShaderVariants;
+uint32_t gShaderFeatures = kDefaultShaderFeatures;
+std::atomic<uint32_t> gRequestedShaderFeatures = kDefaultShaderFeatures; // toggle vertex color with c, alpha test with a
+Task gShaderVariantTask;
+std::shared_ptr<std::vector<ShaderCompileJob>> gPendingShaderVariants;
+uint32_t gPendingShaderFeatures = 0;
+uint32_t gEditedShaders = 0; // bit per ShaderIndex, hot reloaded since the archive was built
+
+// hot reload, only touched by the render thread once it runs
+DirectoryWatcher gShaderWatcher;
+ChangeDebouncer gShaderChanges;
+ShaderDependencyGraph gShaderDependencies;
 
 ComPtr<IDxcBlob> gRayGenLibrary;
 ComPtr<IDxcBlob> gHitLibrary;
 ComPtr<IDxcBlob> gMissLibrary;
 
+RootSignatureCache gRootSignatures; // local root signatures, shared by description and stored next to the shader cache
 ComPtr<ID3D12RootSignature> gRayGenSignature;
 ComPtr<ID3D12RootSignature> gHitSignature;
 ComPtr<ID3D12RootSignature> gMissSignature;
@@ -84,29 +135,101 @@ ComPtr<ID3D12RootSignature> gMissSignature;
 ComPtr<ID3D12StateObject> gRaytracingPipelineState;
 ComPtr<ID3D12StateObjectProperties> gRaytracingStateObjectProperties;
 
+TransientResourcePool gTransientResources; // per-frame targets, placed into one aliased heap
+uint32_t gRaytracingOutputIndex; // index of the RT output buffer in gTransientResources
 ComPtr<ID3D12Resource> gRaytracingOutputBuffer; // The UAV buffer that the RT writes to (gets copied to RTV)
-ComPtr<ID3D12DescriptorHeap> gSrvUavHeap; // holds descriptor to the RT output buffer 
-
-nv_helpers_dx12::ShaderBindingTableGenerator gSBTGenerator;
-ComPtr<ID3D12Resource> gSBTStorage;
+ComPtr<ID3D12DescriptorHeap> gSrvUavHeap; // holds descriptors to the RT output buffer and the TLAS of every slot
+ResizePolicy gRaytracingOutputPolicy; // size of the RT output, grows in steps and shrinks late
+RecyclingPool<TransientResourcePool::Allocation> gRecycledTransientResources; // replaced by resizes, for reuse
+uint64_t gRaytracingOutputVersion = 0; // bumped every time gRaytracingOutputBuffer is replaced
+uint64_t gSlotOutputVersions[gNumFrames] = {}; // which output buffer the UAV in each slot's descriptor table points at
+
+// Ray tracing is set up by gRaytracingInitTask while the raster path already renders, frames with
+// ray tracing enabled render raster until it's Ready. Until then the task owns the ray tracing
+// globals, the render thread doesn't touch them.
+enum class RaytracingStatus {
+	Starting,
+	Ready,
+	Failed // the libraries didn't compile or the state object couldn't be created, raster only
+};
+
+std::atomic<RaytracingStatus> gRaytracingStatus = RaytracingStatus::Starting;
+Task gRaytracingInitTask;
+std::vector<ShaderCompileJob> gRaytracingInitShaders; // the libraries the init task built the state object from
+const UINT kRaytracingStatusMessage = WM_APP; // posted when gRaytracingStatus changes, updates the window title
+
+nv_helpers_dx12::ShaderSymbolTable gShaderSymbols; // names of the ray tracing exports, interned
+RaytracingSymbols gRaytracingSymbols = internRaytracingSymbols(gShaderSymbols);
+RaytracingLayouts gRaytracingLayouts; // planned from the bindings of the current pipeline's libraries
+nv_helpers_dx12::ShaderIdentifierCache gShaderIdentifiers; // of gRaytracingPipelineState
+nv_helpers_dx12::ShaderBindingTableGenerator gSBTGenerator(gShaderSymbols);
+ComPtr<ID3D12Resource> gSBTStorage; // one copy of the SBT per slot
+uint8_t* gSBTData = nullptr; // gSBTStorage, persistently mapped
+uint32_t gSBTCopySize = 0;
+
+// residency
+ResidencyManager gResidencyManager;
+std::vector<ResidencyHandle> gRasterResidencySet; // everything a raster frame references
+std::vector<ResidencyHandle> gRaytracingResidencySet; // everything a ray traced frame references
 
 // syncronization stuff
 
-ComPtr<ID3D12Fence> gFence;
-uint64_t gFenceValue = 0;
-uint64_t gFrameFenceValues[gNumFrames] = {};
-HANDLE gFenceEvent;
+QueueTimeline gTimeline; // fences of the direct and compute queues, deferred releases
+
+ComPtr<ID3D12GraphicsCommandList4> gComputeCommandList;
+CommandAllocatorPool gComputeAllocators;
+ComPtr<ID3D12CommandAllocator> gInitialBuildAllocator; // the initial AS builds are recorded with it, back to gComputeAllocators once submitted
+AsyncBuildScheduler gAsyncBuilds(gNumFrames); // cross-queue waits between TLAS builds and ray tracing
+
+// threading
+
+// Everything the render thread needs from a simulation tick, handed over through gSnapshots
+struct FrameSnapshot {
+	uint64_t simulationTick = 0;
+	double simulationTime = 0.0; // seconds since the simulation started
+	bool rayTracingEnabled = false;
+};
+
+const uint32_t kSimulationRate = 120; // simulation ticks per second
+
+SnapshotHandoff<FrameSnapshot> gSnapshots; // simulation thread -> render thread
+FrameScheduler gFrameScheduler; // how many frames the render thread may queue ahead of the GPU
+std::thread gSimulationThread;
+std::thread gRenderThread;
+std::atomic<bool> gQuit = false;
+std::atomic<uint64_t> gPendingSize = 0; // (width << 32) | height from WM_SIZE, applied by the render thread
+const auto kSwapChainResizeDelay = std::chrono::milliseconds(100); // how long the window size has to settle
 
 // settings
 
-bool gVSync = true; // toggle with v key
+std::atomic<bool> gVSync = true; // toggle with v key
 bool gTearingSupported = false;
 bool gFullscreen = false; // toggle with Alt + Enter or F11
-bool gRayTracingEnabled = false;
+std::atomic<bool> gRayTracingEnabled = false; // toggle with space, picked up by the next simulation tick
+uint32_t gFramesInFlight = gNumFrames; // CPU/GPU frame latency, --frames-in-flight <1-3>
+bool gTransientReport = false; // log how much a synthetic frame saves with aliasing, --transient-report
+bool gAsyncBuildReport = false; // log a simulated timeline of TLAS builds on the compute queue, --async-build-report
+bool gRootSignatureReport = false; // log the DWORD and SBT cost of the ray tracing root signatures, --root-signature-report
+uint32_t gWorkerThreads = JobSystem::defaultWorkerCount(); // job system workers besides the render thread, --worker-threads <N>
+bool gJobBenchmark = false; // log how the job system scales from 1 to all cores, --job-benchmark
+bool gStartupReport = false; // log when each startup step ran and what it waited for, --startup-report
+uint32_t gShaderThreads = 0; // shaders compiled at once, 0 for every job system thread, --shader-threads <N>
+uint64_t gVideoMemoryBudget = 0; // in bytes, 0 uses the budget reported by the adapter, --vram-budget <MB>
+std::filesystem::path gShaderCacheDirectory = "shadercache"; // compiled DXIL, root signatures and pipeline states by content hash, --shader-cache <dir>, off with --no-shader-cache
+std::filesystem::path gShaderArchivePath = "shaders.pak"; // shaders compiled at build time, --shader-archive <path>, off with --no-shader-archive
+#if defined(_DEBUG)
+bool gHotReload = true; // recompile shaders edited while running, --hot-reload / --no-hot-reload
+#else
+bool gHotReload = false;
+#endif
 
 // Window callback function forward decl
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 
+void updateShaderFeatures();
+void reloadShaders();
+void updateRaytracingInit();
+
 void parseCommandLineArguments() {
 	int argc;
 
@@ -121,6 +244,56 @@ void parseCommandLineArguments() {
 		if (::wcscmp(arg, L"-h") == 0 || ::wcscmp(arg, L"--height") == 0) {
 			gClientHeight = ::wcstol(argv[i + 1], nullptr, 10);
 		}
+		if (::wcscmp(arg, L"--frames-in-flight") == 0) {
+			gFramesInFlight = ::wcstoul(argv[i + 1], nullptr, 10);
+		}
+		if (::wcscmp(arg, L"--worker-threads") == 0 || ::wcscmp(arg, L"--record-threads") == 0) {
+			gWorkerThreads = ::wcstoul(argv[i + 1], nullptr, 10);
+		}
+		if (::wcscmp(arg, L"--root-signature-report") == 0) {
+			gRootSignatureReport = true;
+		}
+		if (::wcscmp(arg, L"--job-benchmark") == 0) {
+			gJobBenchmark = true;
+		}
+		if (::wcscmp(arg, L"--startup-report") == 0) {
+			gStartupReport = true;
+		}
+		if (::wcscmp(arg, L"--vram-budget") == 0) {
+			gVideoMemoryBudget = ::wcstoull(argv[i + 1], nullptr, 10) * 1024 * 1024;
+		}
+		if (::wcscmp(arg, L"--shader-cache") == 0) {
+			gShaderCacheDirectory = argv[i + 1];
+		}
+		if (::wcscmp(arg, L"--no-shader-cache") == 0) {
+			gShaderCacheDirectory.clear();
+		}
+		if (::wcscmp(arg, L"--shader-archive") == 0) {
+			gShaderArchivePath = argv[i + 1];
+		}
+		if (::wcscmp(arg, L"--no-shader-archive") == 0) {
+			gShaderArchivePath.clear();
+		}
+		if (::wcscmp(arg, L"--shader-features") == 0) {
+			// comma separated defines, e.g. VERTEX_COLOR,ALPHA_TEST or none
+			gShaderFeatures = parseShaderFeatures(shaderFeatureNames(), std::filesystem::path(argv[i + 1]).string());
+			gRequestedShaderFeatures = gShaderFeatures;
+		}
+		if (::wcscmp(arg, L"--hot-reload") == 0) {
+			gHotReload = true;
+		}
+		if (::wcscmp(arg, L"--no-hot-reload") == 0) {
+			gHotReload = false;
+		}
+		if (::wcscmp(arg, L"--shader-threads") == 0) {
+			gShaderThreads = ::wcstoul(argv[i + 1], nullptr, 10);
+		}
+		if (::wcscmp(arg, L"--transient-report") == 0) {
+			gTransientReport = true;
+		}
+		if (::wcscmp(arg, L"--async-build-report") == 0) {
+			gAsyncBuildReport = true;
+		}
 	}
 
 	::LocalFree(argv);
@@ -140,50 +313,69 @@ ComPtr<ID3D12CommandQueue> createCommandQueue(ComPtr<ID3D12Device5> device, D3D1
 	return d3d12CommandQueue;
 }
 
-ComPtr<ID3D12Fence> createFence(ComPtr<ID3D12Device5> device) {
-	ComPtr<ID3D12Fence> fence;
+// Rebuilds the frame's TLAS slot on the compute queue. The build only waits for the last
+// trace that read the slot, frames in flight earlier than that can still be ray tracing.
+void submitTopLevelASBuild(uint64_t frameIndex) {
+	uint32_t slot = gAsyncBuilds.slot(frameIndex);
 
-	throwIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+	ComPtr<ID3D12CommandAllocator> allocator = gComputeAllocators.acquire(gTimeline.completedValue(QueueType::Compute));
+	throwIfFailed(gComputeCommandList->Reset(allocator.Get(), nullptr));
 
-	return fence;
-}
-
-HANDLE createEventHandle() {
-	HANDLE fenceEvent;
+	buildTopLevelAS(gComputeCommandList, gTopLevelASGenerators[slot], gTopLevelASBuffers[slot]);
 
-	fenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(fenceEvent && "Failed to create fence event.");
+	throwIfFailed(gComputeCommandList->Close());
 
-	return fenceEvent;
-}
+	QueueSubmission build = gAsyncBuilds.planBuild(frameIndex, gTimeline.nextValue(QueueType::Compute));
+	gTimeline.gpuWait(QueueType::Compute, build.waits);
 
-uint64_t signal(ComPtr<ID3D12CommandQueue> commandQueue,
-	ComPtr<ID3D12Fence> fence,
-	uint64_t& fenceValue) {
-	fenceValue++;
-	uint64_t fenceValueForSignal = fenceValue;
+	ID3D12CommandList* const commandLists[] = { gComputeCommandList.Get() };
+	gComputeQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
 
-	throwIfFailed(commandQueue->Signal(fence.Get(), fenceValueForSignal));
+	uint64_t fenceValue = gTimeline.signal(QueueType::Compute);
+	gComputeAllocators.release(allocator, fenceValue);
+}
 
-	return fenceValueForSignal;
+void reportAsyncBuilds() {
+	// a frame whose build takes a third of its trace time, with one slot every build has to
+	// wait for the previous trace, with a slot per frame in flight builds run ahead
+	AsyncBuildSimulation serialized = simulateAsyncBuilds(100, 1, 1.0, 3.0);
+	AsyncBuildSimulation overlapped = simulateAsyncBuilds(100, gNumFrames, 1.0, 3.0);
+
+	char buffer[500];
+	sprintf_s(buffer, 500, "TLAS builds over 100 frames (build 1, trace 3): direct queue only %.0f, "
+		"compute queue with 1 slot %.0f, with %u slots %.0f, %.0f of it overlapped\n",
+		overlapped.serialTime, serialized.asyncTime, static_cast<uint32_t>(gNumFrames), overlapped.asyncTime, overlapped.overlapTime);
+	OutputDebugString(buffer);
 }
 
-void waitForFenceValue(ComPtr<ID3D12Fence> fence, uint64_t fenceValue,
-	HANDLE fenceEvent, std::chrono::milliseconds duration = std::chrono::milliseconds::max()) {
-	if (fence->GetCompletedValue() < fenceValue) {
-		throwIfFailed(fence->SetEventOnCompletion(fenceValue, fenceEvent));
-		::WaitForSingleObject(fenceEvent, static_cast<DWORD>(duration.count()));
+// The direct queue's fence as the frame scheduler sees it
+class FenceGpuTimeline : public GpuTimeline {
+public:
+	uint64_t completedValue() override {
+		return gTimeline.completedValue(QueueType::Direct);
+	}
+
+	void waitForValue(uint64_t value) override {
+		gTimeline.wait(QueueWait{ QueueType::Direct, value });
 	}
+};
+
+// simulation tick, runs on the simulation thread and publishes a snapshot for the render thread
+void update(uint64_t tick, double simulationTime) {
+	FrameSnapshot& snapshot = gSnapshots.back();
+
+	snapshot.simulationTick = tick;
+	snapshot.simulationTime = simulationTime;
+	snapshot.rayTracingEnabled = gRayTracingEnabled;
+
+	gSnapshots.publish();
 }
 
-void flush(ComPtr<ID3D12CommandQueue> commandQueue,
-	ComPtr<ID3D12Fence> fence,
-	uint64_t& fenceValue, HANDLE fenceEvent) {
-	uint64_t fenceValueForSignal = signal(commandQueue, fence, fenceValue);
-	waitForFenceValue(fence, fenceValueForSignal, fenceEvent);
+double secondsSinceStartup() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - gStartTime).count();
 }
 
-void update() {
+void reportFrameRate() {
 	static uint64_t frameCounter = 0;
 	static double elapsedSeconds = 0.0;
 	static std::chrono::high_resolution_clock clock;
@@ -207,129 +399,188 @@ void update() {
 	}
 }
 
-void render() {
-	auto commandAllocator = gCommandAllocators[gCurrentBackBufferIndex];
+void render(const FrameSnapshot& snapshot, uint64_t frameIndex) {
 	auto backBuffer = gBackBuffers[gCurrentBackBufferIndex];
+	UINT backBufferIndex = gCurrentBackBufferIndex;
+	uint32_t width = gClientWidth;
+	uint32_t height = gClientHeight;
 
-	throwIfFailed(commandAllocator->Reset());
-	throwIfFailed(gCommandList->Reset(commandAllocator.Get(), gPipelineState.Get()));
+	// Every job records into a command list of its own on one of the recorder threads,
+	// the lists get submitted in the order the jobs are added here
+	std::vector<RecordJob> jobs;
 
-	// Set state
-	{
-		gCommandList->SetGraphicsRootSignature(gRootSignature.Get());
-		gCommandList->RSSetViewports(1, &gViewport);
-		gCommandList->RSSetScissorRects(1, &gScissorRect);
-	}
+	// queued behind initialization, the toggle takes effect once ray tracing is ready
+	bool rayTracing = snapshot.rayTracingEnabled && gRaytracingStatus == RaytracingStatus::Ready;
 
 	// Raster
-	if (!gRayTracingEnabled) {
-		// transition backbuffer state from present to render target 
-		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-		gCommandList->ResourceBarrier(1, &barrier);
+	if (!rayTracing) {
+		jobs.push_back([=](ID3D12GraphicsCommandList4* commandList) {
+			// transition backbuffer state from present to render target 
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			commandList->ResourceBarrier(1, &barrier);
+
+			CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(gRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+				backBufferIndex, gRTVDescriptorSize);
+
+			FLOAT clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+			commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+		});
+
+		jobs.push_back([=](ID3D12GraphicsCommandList4* commandList) {
+			// Set state, command lists don't inherit any so each draw job sets its own
+			commandList->SetPipelineState(gPipelineState.Get());
+			commandList->SetGraphicsRootSignature(gRootSignature.Get());
+			commandList->RSSetViewports(1, &gViewport);
+			commandList->RSSetScissorRects(1, &gScissorRect);
+
+			CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(gRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+				backBufferIndex, gRTVDescriptorSize);
+
+			commandList->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+
+			// Draw triangle 
+			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			commandList->IASetVertexBuffers(0, 1, &gVertexBufferView);
+			commandList->DrawInstanced(3, 1, 0, 0);
+		});
+	}
+	else {
+	// RT
+		uint32_t slot = gAsyncBuilds.slot(frameIndex);
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(gRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-			gCurrentBackBufferIndex, gRTVDescriptorSize);
+		// the output buffer was replaced by a resize since this slot's table was written, the
+		// frame that used the slot last is done so the descriptor can be overwritten now
+		if (gSlotOutputVersions[slot] != gRaytracingOutputVersion) {
+			writeRaytracingOutputDescriptor(gDevice, gSrvUavHeap, slot, gRaytracingOutputBuffer);
+			gSlotOutputVersions[slot] = gRaytracingOutputVersion;
+		}
 
-		gCommandList->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+		// same for the slot's copy of the SBT, only records changed since it was last used get
+		// rewritten, usually none
+		gSBTGenerator.Update(gSBTData + slot * gSBTCopySize, gShaderIdentifiers, slot);
 
-		FLOAT clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-		gCommandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+		D3D12_GPU_VIRTUAL_ADDRESS sbtAddress = gSBTStorage->GetGPUVirtualAddress() + slot * gSBTCopySize;
 
-		// Draw triangle 
-		gCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		gCommandList->IASetVertexBuffers(0, 1, &gVertexBufferView);
-		gCommandList->DrawInstanced(3, 1, 0, 0);
-	}
-	else {
-	// RT
-		// Bind the descriptor heap giving access to RT output buffer as well as TLAS 
-		std::vector<ID3D12DescriptorHeap*> heaps = { gSrvUavHeap.Get() };
+		jobs.push_back([=](ID3D12GraphicsCommandList4* commandList) {
+			// Bind the descriptor heap giving access to RT output buffer as well as TLAS 
+			std::vector<ID3D12DescriptorHeap*> heaps = { gSrvUavHeap.Get() };
+
+			commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data());
 
-		gCommandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data());
+			gTransientResources.aliasingBarriers(commandList, kRaytracingPassDispatch);
 
-		// Prepare RT output buffer
-		CD3DX12_RESOURCE_BARRIER transition = CD3DX12_RESOURCE_BARRIER::Transition(gRaytracingOutputBuffer.Get(), 
-			D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			// Prepare RT output buffer
+			CD3DX12_RESOURCE_BARRIER transition = CD3DX12_RESOURCE_BARRIER::Transition(gRaytracingOutputBuffer.Get(), 
+				D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		gCommandList->ResourceBarrier(1, &transition);
+			commandList->ResourceBarrier(1, &transition);
 
-		// Set up raytracing task 
-		D3D12_DISPATCH_RAYS_DESC desc = {};
+			// Set up raytracing task 
+			D3D12_DISPATCH_RAYS_DESC desc = {};
 
-		// Layout of the SBT is as follows 
-		// ray generation shader
-		// miss shaders
-		// hit groups
-		
-		// All SBT entries of the  same type have the same size to allow fixed stride 
+			// Layout of the SBT is as follows 
+			// ray generation shader
+			// miss shaders
+			// hit groups
+			
+			// All SBT entries of the  same type have the same size to allow fixed stride, every
+			// section starts on a D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT boundary
 
-		uint32_t rayGenerationSectionSizeInBytes = gSBTGenerator.GetRayGenSectionSize();
-		desc.RayGenerationShaderRecord.StartAddress = gSBTStorage->GetGPUVirtualAddress();
-		desc.RayGenerationShaderRecord.SizeInBytes = rayGenerationSectionSizeInBytes;
+			// one ray generation record per TLAS slot, only the one of this frame's slot is used
+			desc.RayGenerationShaderRecord.StartAddress = sbtAddress + slot * gSBTGenerator.GetRayGenEntrySize();
+			desc.RayGenerationShaderRecord.SizeInBytes = gSBTGenerator.GetRayGenEntrySize();
 
-		uint32_t missSectionSizeInBytes = gSBTGenerator.GetMissSectionSize();
-		desc.MissShaderTable.StartAddress = gSBTStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes;
-		desc.MissShaderTable.SizeInBytes = missSectionSizeInBytes;
-		desc.MissShaderTable.StrideInBytes = gSBTGenerator.GetMissEntrySize();
+			desc.MissShaderTable.StartAddress = sbtAddress + gSBTGenerator.GetMissSectionOffset();
+			desc.MissShaderTable.SizeInBytes = gSBTGenerator.GetMissSectionSize();
+			desc.MissShaderTable.StrideInBytes = gSBTGenerator.GetMissEntrySize();
 
-		uint32_t hitGroupsSectionSize = gSBTGenerator.GetHitGroupSectionSize();
-		desc.HitGroupTable.StartAddress = gSBTStorage->GetGPUVirtualAddress() + rayGenerationSectionSizeInBytes + missSectionSizeInBytes;
-		desc.HitGroupTable.SizeInBytes = hitGroupsSectionSize;
-		desc.HitGroupTable.StrideInBytes = gSBTGenerator.GetHitGroupEntrySize();
+			desc.HitGroupTable.StartAddress = sbtAddress + gSBTGenerator.GetHitGroupSectionOffset();
+			desc.HitGroupTable.SizeInBytes = gSBTGenerator.GetHitGroupSectionSize();
+			desc.HitGroupTable.StrideInBytes = gSBTGenerator.GetHitGroupEntrySize();
 
-		desc.Width = gClientWidth;
-		desc.Height = gClientHeight;
-		desc.Depth = 1;
+			desc.Width = width;
+			desc.Height = height;
+			desc.Depth = 1;
 
-		// bind RT pipeline
-		gCommandList->SetPipelineState1(gRaytracingPipelineState.Get());
+			// bind RT pipeline
+			commandList->SetPipelineState1(gRaytracingPipelineState.Get());
 
-		// Dispatch the rays, which writes to RT output buffer
-		gCommandList->DispatchRays(&desc);
+			// Dispatch the rays, which writes to RT output buffer
+			commandList->DispatchRays(&desc);
+		});
 
-		// Now copy RT output buffer to the render target 
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(gRaytracingOutputBuffer.Get(),
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE); 
+		jobs.push_back([=](ID3D12GraphicsCommandList4* commandList) {
+			// Now copy RT output buffer to the render target 
+			gTransientResources.aliasingBarriers(commandList, kRaytracingPassCopy);
 
-		gCommandList->ResourceBarrier(1, &transition);
+			CD3DX12_RESOURCE_BARRIER transition = CD3DX12_RESOURCE_BARRIER::Transition(gRaytracingOutputBuffer.Get(),
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE); 
 
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST);
+			commandList->ResourceBarrier(1, &transition);
 
-		gCommandList->ResourceBarrier(1, &transition);
+			transition = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST);
 
-		gCommandList->CopyResource(backBuffer.Get(), gRaytracingOutputBuffer.Get());
+			commandList->ResourceBarrier(1, &transition);
 
-		transition = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			// the output buffer can be bigger than the back buffer, only the rendered part is copied
+			CD3DX12_TEXTURE_COPY_LOCATION destination(backBuffer.Get(), 0);
+			CD3DX12_TEXTURE_COPY_LOCATION source(gRaytracingOutputBuffer.Get(), 0);
+			D3D12_BOX region = { 0, 0, 0, width, height, 1 };
 
-		gCommandList->ResourceBarrier(1, &transition);
+			commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, &region);
+
+			transition = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+			commandList->ResourceBarrier(1, &transition);
+		});
 	}
 
 	// Present
 	{
-		// transition backbuffer state from render target to present 
-		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-			backBuffer.Get(),
-			D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+		jobs.push_back([=](ID3D12GraphicsCommandList4* commandList) {
+			// transition backbuffer state from render target to present 
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+				backBuffer.Get(),
+				D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
-		gCommandList->ResourceBarrier(1, &barrier);
+			commandList->ResourceBarrier(1, &barrier);
+		});
 
-		throwIfFailed(gCommandList->Close());
+		std::vector<ID3D12CommandList*> commandLists = gCommandRecorder.record(jobs, gTimeline.completedValue(QueueType::Direct));
 
-		ID3D12CommandList* const commandLists[] = {
-			gCommandList.Get() 
-		};
+		// page back in anything this frame needs that got evicted, the next direct fence value
+		// is what signal() below will use for this frame
+		uint64_t frameFenceValue = gTimeline.nextValue(QueueType::Direct);
+
+		gResidencyManager.makeResident(rayTracing ? gRaytracingResidencySet : gRasterResidencySet,
+			frameFenceValue, gTimeline.completedValue(QueueType::Direct));
+
+		// the TLAS build goes to the compute queue first, the direct queue waits for it on the GPU
+		if (rayTracing) {
+			submitTopLevelASBuild(frameIndex);
+			gTimeline.gpuWait(QueueType::Direct, gAsyncBuilds.planTrace(frameIndex, frameFenceValue).waits);
+		}
 
-		gCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+		gCommandQueue->ExecuteCommandLists(static_cast<UINT>(commandLists.size()), commandLists.data());
 
 		UINT syncInterval = gVSync ? 1 : 0;
 		UINT presentFlags = gTearingSupported && !gVSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
 		throwIfFailed(gSwapChain->Present(syncInterval, presentFlags));
 
-		gFrameFenceValues[gCurrentBackBufferIndex] = signal(gCommandQueue, gFence, gFenceValue);
+		gTimeline.signal(QueueType::Direct);
+
+		// the allocators this frame recorded with can be reused once its fence is reached
+		gCommandRecorder.submitted(frameFenceValue);
+
+		// no waiting here, the next frame's beginFrame() blocks only if the CPU got too far ahead
+		gFrameScheduler.endFrame(frameFenceValue);
 
 		gCurrentBackBufferIndex = gSwapChain->GetCurrentBackBufferIndex();
 
-		waitForFenceValue(gFence, gFrameFenceValues[gCurrentBackBufferIndex], gFenceEvent);
+		gResidencyManager.trim(gTimeline.completedValue(QueueType::Direct));
+
+		// releases and callbacks whose fences passed
+		gTimeline.poll();
 	}
 }
 
@@ -360,16 +611,15 @@ void resize(uint32_t width, uint32_t height)
 		gClientWidth = std::max(1u, width);
 		gClientHeight = std::max(1u, height);
 
-		// Flush the GPU queue to make sure the swap chain's back buffers
-		// are not being referenced by an in-flight command list.
-		flush(gCommandQueue, gFence, gFenceValue, gFenceEvent);
+		// Wait for the frames in flight on the direct queue, the only ones that reference the
+		// back buffers. Nothing new is signalled and the compute queue keeps going.
+		gTimeline.wait(QueueWait{ QueueType::Direct, gTimeline.lastSignaled(QueueType::Direct) });
 
 		for (int i = 0; i < gNumFrames; ++i)
 		{
 			// Any references to the back buffers must be released
 			// before the swap chain can be resized.
 			gBackBuffers[i].Reset();
-			gFrameFenceValues[i] = gFrameFenceValues[gCurrentBackBufferIndex];
 		}
 
 		DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
@@ -380,6 +630,106 @@ void resize(uint32_t width, uint32_t height)
 		gCurrentBackBufferIndex = gSwapChain->GetCurrentBackBufferIndex();
 
 		updateRenderTargetViews(gDevice, gSwapChain, gRTVDescriptorHeap);
+
+		gViewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(gClientWidth), static_cast<float>(gClientHeight));
+		gScissorRect = CD3DX12_RECT(0, 0, static_cast<LONG>(gClientWidth), static_cast<LONG>(gClientHeight));
+	}
+}
+
+// Keeps the RT output buffer at least as big as the back buffers. The allocation it replaces
+// is recycled without waiting, frames in flight still using it run on the same queue as all
+// later frames, so reusing it later is ordered behind them as well.
+void updateRaytracingOutput() {
+	Extent2D previousCapacity = gRaytracingOutputPolicy.capacity();
+
+	if (!gRaytracingOutputPolicy.update({ gClientWidth, gClientHeight })) {
+		return;
+	}
+
+	Extent2D capacity = gRaytracingOutputPolicy.capacity();
+
+	std::optional<TransientResourcePool::Allocation> evicted =
+		gRecycledTransientResources.recycle(previousCapacity, gTransientResources.detach());
+
+	if (evicted) {
+		gTimeline.deferRelease(std::move(*evicted));
+	}
+
+	std::optional<TransientResourcePool::Allocation> reused = gRecycledTransientResources.reuse(capacity);
+
+	if (reused) {
+		gTransientResources.attach(std::move(*reused));
+	}
+	else {
+		gTransientResources.setResourceDesc(gRaytracingOutputIndex, raytracingOutputBufferDesc(capacity.width, capacity.height));
+		gTransientResources.build(gDevice);
+	}
+
+	gRaytracingOutputBuffer = gTransientResources.get(gRaytracingOutputIndex);
+	gRaytracingOutputVersion++;
+}
+
+void simulationLoop() {
+	const auto tickDuration = std::chrono::microseconds(1000000 / kSimulationRate);
+	const auto start = std::chrono::steady_clock::now();
+	auto nextTick = start;
+
+	for (uint64_t tick = 0; !gQuit; tick++) {
+		update(tick, std::chrono::duration<double>(nextTick - start).count());
+
+		nextTick += tickDuration;
+		std::this_thread::sleep_until(nextTick);
+	}
+}
+
+void renderLoop() {
+	FenceGpuTimeline gpu;
+	uint64_t pendingSize = 0;
+	auto pendingSince = std::chrono::steady_clock::now();
+
+	while (!gQuit) {
+		// only the render thread touches the swap chain, so WM_SIZE just leaves the new size here.
+		// It is applied once the size stopped changing, while dragging DXGI stretches the old
+		// back buffers to the window instead of every pixel of change waiting for the GPU.
+		uint64_t latestSize = gPendingSize.exchange(0);
+		if (latestSize != 0) {
+			pendingSize = latestSize;
+			pendingSince = std::chrono::steady_clock::now();
+		}
+
+		if (pendingSize != 0 && std::chrono::steady_clock::now() - pendingSince >= kSwapChainResizeDelay) {
+			resize(static_cast<uint32_t>(pendingSize >> 32), static_cast<uint32_t>(pendingSize & 0xffffffff));
+			pendingSize = 0;
+		}
+
+		updateRaytracingInit();
+
+		if (gRaytracingStatus == RaytracingStatus::Ready) {
+			updateRaytracingOutput();
+		}
+
+		updateShaderFeatures();
+
+		if (gHotReload) {
+			reloadShaders();
+		}
+
+		uint64_t frameIndex = gFrameScheduler.beginFrame(gpu);
+
+		// if the simulation hasn't ticked since the last frame we render the previous snapshot again
+		gSnapshots.acquire();
+
+		render(gSnapshots.front(), frameIndex);
+
+		if (!gFirstFramePresented) {
+			gFirstFramePresented = true;
+
+			char buffer[500];
+			sprintf_s(buffer, 500, "first frame: %.1fms after startup\n", secondsSinceStartup() * 1000.0);
+			OutputDebugString(buffer);
+		}
+
+		reportFrameRate();
 	}
 }
 
@@ -433,6 +783,29 @@ void setFullscreen(bool fullscreen) {
 	}
 }
 
+// "RTX: starting" while ray tracing is enabled but not initialized yet, frames are raster until then
+void updateWindowTitle() {
+	const char* state = "off";
+
+	if (gRayTracingEnabled) {
+		switch (gRaytracingStatus) {
+		case RaytracingStatus::Ready:
+			state = "on";
+			break;
+		case RaytracingStatus::Failed:
+			state = "unavailable";
+			break;
+		default:
+			state = "starting";
+			break;
+		}
+	}
+
+	char title[100];
+	sprintf_s(title, 100, "Unreal Engine 6 (RTX: %s)", state);
+	::SetWindowText(ghWnd, title);
+}
+
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	if (gIsInitialized)
@@ -440,8 +813,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		switch (message)
 		{
 		case WM_PAINT:
-			update();
-			render();
+			// frames are produced by the render thread, just tell Windows the window is painted
+			::ValidateRect(hwnd, nullptr);
 			break;
 		case WM_SYSKEYDOWN:
 		case WM_KEYDOWN:
@@ -453,16 +826,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			case 'V':
 				gVSync = !gVSync;
 				break;
+			case 'C':
+				gRequestedShaderFeatures ^= kFeatureVertexColor;
+				break;
+			case 'A':
+				gRequestedShaderFeatures ^= kFeatureAlphaTest;
+				break;
 			case VK_SPACE:
 				gRayTracingEnabled = !gRayTracingEnabled;
-
-				if (gRayTracingEnabled) {
-					::SetWindowText(ghWnd, "Unreal Engine 6 (RTX: on)");
-				}
-				else {
-					::SetWindowText(ghWnd, "Unreal Engine 6 (RTX: off)");
-				}
-
+				updateWindowTitle();
 				break;
 			case VK_ESCAPE:
 				::PostQuitMessage(0);
@@ -482,15 +854,18 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		// not handled.
 		case WM_SYSCHAR:
 			break;
+		case kRaytracingStatusMessage:
+			updateWindowTitle();
+			break;
 		case WM_SIZE:
 		{
 			RECT clientRect = {};
 			::GetClientRect(ghWnd, &clientRect);
 
-			int width = clientRect.right - clientRect.left;
-			int height = clientRect.bottom - clientRect.top;
+			uint64_t width = std::max<LONG>(1, clientRect.right - clientRect.left);
+			uint64_t height = std::max<LONG>(1, clientRect.bottom - clientRect.top);
 
-			resize(width, height);
+			gPendingSize = (width << 32) | height;
 		}
 		break;
 		case WM_DESTROY:
@@ -752,12 +1127,11 @@ bool checkRayTracingSupport(ComPtr<ID3D12Device5> device) {
 }
 
 ComPtr<ID3D12RootSignature> 
-createRootSignature(ComPtr<ID3D12Device5> device) {
+createRootSignature(ComPtr<ID3D12Device5> device, ComPtr<ID3DBlob>& signatureBlob) {
 	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
 
 	rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
-	ComPtr<ID3DBlob> signatureBlob;
 	ComPtr<ID3DBlob> errorBlob;
 
 	throwIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob));
@@ -770,23 +1144,8 @@ createRootSignature(ComPtr<ID3D12Device5> device) {
 }
 
 ComPtr<ID3D12PipelineState>
-createPipelineState(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> rootSignature) {
-	ComPtr<ID3DBlob> vertexShader;
-	ComPtr<ID3DBlob> pixelShader;
-
-	#if defined(_DEBUG)
-		// Enable better shader debugging with the graphics debugging tools.
-		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-	#else
-		UINT compileFlags = 0;
-	#endif
-		
-	std::filesystem::path vertexShaderPath = std::filesystem::current_path() / "shaders" / "Vertex.hlsl";
-	std::filesystem::path pixelShaderPath = std::filesystem::current_path() / "shaders" / "Pixel.hlsl";
-
-	throwIfFailed(D3DCompileFromFile(vertexShaderPath.c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-	throwIfFailed(D3DCompileFromFile(pixelShaderPath.c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
-
+createPipelineState(PipelineStateCache& pipelines, ComPtr<ID3D12RootSignature> rootSignature,
+	ComPtr<ID3DBlob> rootSignatureBlob, ComPtr<ID3DBlob> vertexShader, ComPtr<ID3DBlob> pixelShader) {
 	// Define the vertex input layout 
 	D3D12_INPUT_ELEMENT_DESC inputElementDescs[] = {
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -810,15 +1169,228 @@ createPipelineState(ComPtr<ID3D12Device5> device, ComPtr<ID3D12RootSignature> ro
 	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 	psoDesc.SampleDesc.Count = 1;
 
-	ComPtr<ID3D12PipelineState> pipelineState;
-	
-	throwIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+	// loaded from the pipeline cache when this description was created before
+	return pipelines.get(psoDesc, rootSignatureBlob.Get());
+}
+
+void updateShaderDependencies(uint32_t shader) {
+	std::vector<std::filesystem::path> files;
+
+	for (const ShaderSourceFile& source : gatherShaderSources(gBaseShaders[shader].fileName)) {
+		files.push_back(source.path);
+	}
+
+	gShaderDependencies.setFiles(shader, files);
+}
+
+// The shader specialized for the features: from the variant cache, else from the archive,
+// else compiled. Safe to call from jobs.
+ShaderCompileJob loadShaderVariant(uint32_t shader, uint32_t features, bool fromArchive) {
+	const ShaderCompileJob& base = gBaseShaders[shader];
+
+	return gShaderVariants.get(shader, variantKey(base, features), [&]() {
+		ShaderCompileJob variant = shaderVariant(base, features);
+
+		if (!fromArchive || !gShaderArchive.isOpen() || !loadShaderFromArchive(gShaderArchive, variant)) {
+			gShaderCompiler.compile(variant);
+		}
+
+		return variant;
+	});
+}
+
+const uint32_t kRasterShaders = (1u << kShaderVertex) | (1u << kShaderPixel);
+const uint32_t kRaytracingShaders = (1u << kShaderRayGen) | (1u << kShaderHit) | (1u << kShaderMiss);
+const uint32_t kAllShaders = kRasterShaders | kRaytracingShaders;
+
+// every shader's variant at once, shaders in editedShaders skip the archive, it's out of date for
+// them. Shaders not in loadedShaders are left empty.
+std::vector<ShaderCompileJob> loadShaderVariants(uint32_t features, uint32_t editedShaders, uint32_t loadedShaders = kAllShaders) {
+	std::vector<ShaderCompileJob> shaders(kNumShaders);
+
+	gJobs->parallelFor(kNumShaders, 1, [&](size_t begin, size_t end) {
+		for (size_t shader = begin; shader < end; shader++) {
+			if (loadedShaders & (1u << shader)) {
+				shaders[shader] = loadShaderVariant(static_cast<uint32_t>(shader), features,
+					!(editedShaders & (1u << shader)));
+			}
+		}
+	}, gShaderThreads);
 
-	return pipelineState;
+	return shaders;
+}
+
+// Recreates the ray tracing state object and SBT from the libraries in gShaders. Frames in flight
+// keep using the old objects, they are released once those are done.
+void rebuildRaytracingPipeline() {
+	gTimeline.deferRelease(std::make_tuple(gRaytracingPipelineState, gRaytracingStateObjectProperties,
+		gRayGenSignature, gHitSignature, gMissSignature, gSBTStorage));
+
+	gRayGenLibrary = gShaders[kShaderRayGen].library;
+	gHitLibrary = gShaders[kShaderHit].library;
+	gMissLibrary = gShaders[kShaderMiss].library;
+
+	gRaytracingLayouts = planRaytracingLayouts(gShaderSymbols, gRaytracingSymbols, gShaders[kShaderRayGen].bindings,
+		gShaders[kShaderHit].bindings, gShaders[kShaderMiss].bindings, (gShaderFeatures & kFeatureAlphaTest) != 0);
+
+	gRaytracingPipelineState = createRaytracingPipelineState(gDevice, gRootSignatures, gShaderSymbols, gRaytracingSymbols,
+		gShaderIdentifiers, gRayGenLibrary, gHitLibrary,
+		gMissLibrary, gRayGenSignature, gHitSignature, gMissSignature,
+		gRaytracingStateObjectProperties, gRaytracingLayouts, (gShaderFeatures & kFeatureAlphaTest) != 0);
+
+	// the shader identifiers in the records belong to the old state object, and the variant
+	// may bind less or more than the old one
+	gSBTStorage = createShaderBindingTable(gDevice, *gJobs, gSBTGenerator, gSrvUavHeap, gNumFrames, gTopLevelASBuffers,
+		gMeshes, gInstances, gHitGroups, gRaytracingLayouts, gRaytracingSymbols, gShaderIdentifiers, gSBTData, gSBTCopySize);
+}
+
+// Switches to new shaders and rebuilds only what uses the ones that changed: the raster PSO
+// for Vertex/Pixel, the ray tracing state object and SBT for the libraries. Frames in flight
+// keep using the old objects, they are released once those are done. Before ray tracing is
+// ready the libraries are only recorded, updateRaytracingInit builds from them.
+void applyShaders(const std::vector<ShaderCompileJob>& shaders, uint32_t features) {
+	bool rasterChanged = false;
+	bool raytracingChanged = false;
+
+	for (uint32_t shader = 0; shader < kNumShaders; shader++) {
+		if (shaders[shader].library != gShaders[shader].library) {
+			raytracingChanged = true;
+		}
+		if (shaders[shader].bytecode != gShaders[shader].bytecode) {
+			rasterChanged = true;
+		}
+	}
+
+	if (gRaytracingStatus != RaytracingStatus::Ready) {
+		raytracingChanged = false;
+	}
+
+	gShaders = shaders;
+	gShaderFeatures = features;
+
+	if (rasterChanged) {
+		ComPtr<ID3D12PipelineState> pipelineState = createPipelineState(gPipelineStates, gRootSignature, gRootSignatureBlob,
+			gShaders[kShaderVertex].bytecode, gShaders[kShaderPixel].bytecode);
+
+		gTimeline.deferRelease(std::move(gPipelineState));
+		gPipelineState = pipelineState;
+	}
+
+	if (raytracingChanged) {
+		rebuildRaytracingPipeline();
+	}
+
+	char buffer[500];
+	sprintf_s(buffer, 500, "shaders: features %s, rebuilt%s%s, %zu variants cached\n",
+		formatShaderFeatures(shaderFeatureNames(), gShaderFeatures).c_str(),
+		rasterChanged ? " raster PSO" : "", raytracingChanged ? " ray tracing state object and SBT" : "",
+		gShaderVariants.size());
+	OutputDebugString(buffer);
+}
+
+// Picks up feature toggles. The variants are loaded or compiled in the background while the
+// current ones keep rendering, a variant seen before comes straight from the variant cache.
+void updateShaderFeatures() {
+	if (gShaderVariantTask.valid()) {
+		if (!gShaderVariantTask.finished()) {
+			return;
+		}
+
+		Task task = gShaderVariantTask;
+		gShaderVariantTask = Task();
+
+		try {
+			gJobs->wait(task);
+		}
+		catch (const std::exception& error) {
+			OutputDebugString("shader variant failed to compile, keeping the current features\n");
+			OutputDebugString(error.what());
+			OutputDebugString("\n");
+
+			gRequestedShaderFeatures = gShaderFeatures;
+			return;
+		}
+
+		applyShaders(*gPendingShaderVariants, gPendingShaderFeatures);
+		return;
+	}
+
+	uint32_t requested = gRequestedShaderFeatures;
+
+	if (requested == gShaderFeatures) {
+		return;
+	}
+
+	auto variants = std::make_shared<std::vector<ShaderCompileJob>>();
+	uint32_t editedShaders = gEditedShaders;
+
+	gPendingShaderVariants = variants;
+	gPendingShaderFeatures = requested;
+	gShaderVariantTask = gJobs->run([variants, requested, editedShaders]() {
+		*variants = loadShaderVariants(requested, editedShaders);
+	});
+}
+
+// Recompiles the shaders reading an edited file, in their current variant. The variant cache
+// forgets their other variants and the archive is out of date for them from now on. A shader
+// that doesn't compile leaves everything as it was.
+void reloadShaders() {
+	auto now = std::chrono::steady_clock::now();
+
+	gShaderChanges.add(gShaderWatcher.poll(), now);
+
+	// changes stay queued until a feature switch in progress is done
+	if (gShaderVariantTask.valid()) {
+		return;
+	}
+
+	std::vector<uint32_t> affected = gShaderDependencies.affectedRoots(gShaderChanges.take(now));
+
+	if (affected.empty()) {
+		return;
+	}
+
+	for (uint32_t shader : affected) {
+		gShaderVariants.invalidate(shader);
+		gEditedShaders |= 1u << shader;
+	}
+
+	std::vector<ShaderCompileJob> shaders = gShaders;
+	auto start = std::chrono::steady_clock::now();
+
+	try {
+		gJobs->parallelFor(affected.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				shaders[affected[i]] = loadShaderVariant(affected[i], gShaderFeatures, false);
+			}
+		}, gShaderThreads);
+	}
+	catch (const std::exception& error) {
+		// the include set may have changed even though it didn't compile
+		for (uint32_t shader : affected) {
+			updateShaderDependencies(shader);
+		}
+
+		OutputDebugString("shader hot reload failed, keeping the old shaders\n");
+		OutputDebugString(error.what());
+		OutputDebugString("\n");
+		return;
+	}
+
+	for (uint32_t shader : affected) {
+		updateShaderDependencies(shader);
+	}
+
+	char buffer[500];
+	sprintf_s(buffer, 500, "shader hot reload: %zu shaders in %.1fms\n", affected.size(),
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000.0);
+	OutputDebugString(buffer);
+
+	applyShaders(shaders, gShaderFeatures);
 }
 
 ComPtr<ID3D12Resource> 
-createVertexBuffer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12CommandQueue> commandQueue, 
+createVertexBuffer(ResidencyManager& residencyManager, ComPtr<ID3D12CommandQueue> commandQueue, 
 	D3D12_VERTEX_BUFFER_VIEW &vertexBufferView) {
 	Vertex triangleVertices[] =
 	{
@@ -829,20 +1401,17 @@ createVertexBuffer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12CommandQueue> comm
 
 	const UINT vertexBufferSize = sizeof(triangleVertices);
 
-	ComPtr<ID3D12Resource> vertexBuffer;
-
 	D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 	D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
 
 	// Note: upload heaps not recommended for transfering vert buffers normally 
-	throwIfFailed(device->CreateCommittedResource(
-		&heapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
+	// goes through the residency manager so it evicts instead of failing when memory is tight
+	ComPtr<ID3D12Resource> vertexBuffer = residencyManager.createCommittedResource(
+		heapProperties,
+		resourceDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&vertexBuffer)
-	));
+		0
+	);
 
 	// copy triangle data to the VB 
 	UINT8* pVertexDataBegin;
@@ -858,24 +1427,186 @@ createVertexBuffer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12CommandQueue> comm
 	return vertexBuffer;
 }
 
-int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow) {
+// 32-bit indices of the triangle, for the hit shaders
+ComPtr<ID3D12Resource>
+createIndexBuffer(ResidencyManager& residencyManager) {
+	uint32_t triangleIndices[] = { 0, 1, 2 };
 
-	// client area of window can have 100% scaling while non-client window content
-	// can still be drawn in DPI sensitive fashion
-	// without this our client area would get scaled based on DPI scaling 
-	// we don't want that here 
-	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+	D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(triangleIndices));
 
-	parseCommandLineArguments();
+	ComPtr<ID3D12Resource> indexBuffer = residencyManager.createCommittedResource(
+		heapProperties,
+		resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		0
+	);
 
-	gViewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(gClientWidth), static_cast<float>(gClientHeight));
-	gScissorRect = CD3DX12_RECT(0, 0, static_cast<LONG>(gClientWidth), static_cast<LONG>(gClientHeight));
+	UINT8* pIndexDataBegin;
+	CD3DX12_RANGE readRange(0, 0); // We are not reading from it 
+	throwIfFailed(indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
+	memcpy(pIndexDataBegin, triangleIndices, sizeof(triangleIndices));
+	indexBuffer->Unmap(0, nullptr);
 
-	enableDebugLayer();
+	return indexBuffer;
+}
 
-	gTearingSupported = checkTearingSupport();
+// Starts the part of ray tracing setup that owns no state the frames share: the libraries and
+// the state object, and the initial acceleration structure builds recorded on gComputeCommandList,
+// both in parallel. The raster path renders meanwhile, updateRaytracingInit finishes the rest.
+void startRaytracingInit() {
+	uint32_t features = gShaderFeatures;
+
+	Task pipeline = gJobs->run([features]() {
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<ShaderCompileJob> shaders = loadShaderVariants(features, 0, kRaytracingShaders);
+		std::vector<ShaderCompileJob> libraries = { shaders[kShaderRayGen], shaders[kShaderHit], shaders[kShaderMiss] };
+
+		OutputDebugString(formatShaderCompileReport(libraries,
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()).c_str());
+
+		gRayGenLibrary = shaders[kShaderRayGen].library;
+		gHitLibrary = shaders[kShaderHit].library;
+		gMissLibrary = shaders[kShaderMiss].library;
+
+		gRaytracingLayouts = planRaytracingLayouts(gShaderSymbols, gRaytracingSymbols, shaders[kShaderRayGen].bindings,
+			shaders[kShaderHit].bindings, shaders[kShaderMiss].bindings, (features & kFeatureAlphaTest) != 0);
+
+		gRaytracingPipelineState = createRaytracingPipelineState(gDevice, gRootSignatures, gShaderSymbols, gRaytracingSymbols,
+			gShaderIdentifiers, gRayGenLibrary, gHitLibrary,
+			gMissLibrary, gRayGenSignature, gHitSignature, gMissSignature,
+			gRaytracingStateObjectProperties, gRaytracingLayouts, (features & kFeatureAlphaTest) != 0);
+
+		gRaytracingInitShaders = std::move(shaders);
+	});
+
+	Task structures = gJobs->run([]() {
+		createAccelerationStructures(gDevice, gComputeCommandList, gMeshes, gInstances, gHitGroups,
+			gNumFrames, gTopLevelASGenerators, gTopLevelASBuffers);
+
+		throwIfFailed(gComputeCommandList->Close());
+	});
+
+	gRaytracingInitTask = gJobs->run([]() {}, { pipeline, structures });
+}
+
+// Once the init task is done, submits the initial builds and creates what the frames share: the
+// output buffer, residency, the descriptor heap and the SBT. Render thread only.
+void updateRaytracingInit() {
+	if (!gRaytracingInitTask.valid()) {
+		return;
+	}
+
+	// a pool without workers runs the task only when it's waited for, after the first frame then
+	if (!gRaytracingInitTask.finished() && (gJobs->numWorkers() > 0 || !gFirstFramePresented)) {
+		return;
+	}
+
+	Task task = gRaytracingInitTask;
+	gRaytracingInitTask = Task();
+
+	try {
+		gJobs->wait(task);
+	}
+	catch (const std::exception& error) {
+		OutputDebugString("ray tracing failed to initialize, rendering raster only\n");
+		OutputDebugString(error.what());
+		OutputDebugString("\n");
+
+		gRaytracingStatus = RaytracingStatus::Failed;
+		::PostMessage(ghWnd, kRaytracingStatusMessage, 0, 0);
+		return;
+	}
+
+	// the direct queue waits for the builds before the next frame, ray traced or not
+	ID3D12CommandList* const computeCommandLists[] = { gComputeCommandList.Get() };
+	gComputeQueue->ExecuteCommandLists(_countof(computeCommandLists), computeCommandLists);
+
+	uint64_t initialBuildFenceValue = gTimeline.signal(QueueType::Compute);
+	gComputeAllocators.release(std::move(gInitialBuildAllocator), initialBuildFenceValue);
+	gTimeline.gpuWait(QueueType::Direct, { { QueueType::Compute, initialBuildFenceValue } });
+
+	// the BLASes are never rebuilt, their scratch memory can go as soon as the build is done
+	for (RaytracingMesh& mesh : gMeshes) {
+		gTimeline.deferRelease(std::move(mesh.bottomLevelBuffers.pScratch), { { QueueType::Compute, initialBuildFenceValue } });
+	}
+
+	{
+		RootSignatureCacheStats stats = gRootSignatures.stats();
+
+		char buffer[500];
+		sprintf_s(buffer, 500, "root signatures: %zu created, %u loaded, %u serialized, %u shared\n",
+			gRootSignatures.size(), stats.loaded, stats.serialized, stats.shared);
+		OutputDebugString(buffer);
+	}
+
+	if (gRootSignatureReport) {
+		OutputDebugString(formatRaytracingSignatureCosts(gRaytracingLayouts).c_str());
+	}
+
+	{
+		char buffer[500];
+		sprintf_s(buffer, 500, "ray tracing pipeline stack: %llu bytes\n",
+			gRaytracingStateObjectProperties->GetPipelineStackSize());
+		OutputDebugString(buffer);
+	}
+
+	gRaytracingOutputPolicy.update({ gClientWidth, gClientHeight });
+	gRaytracingOutputIndex = addRaytracingOutputBuffer(gTransientResources,
+		gRaytracingOutputPolicy.capacity().width, gRaytracingOutputPolicy.capacity().height);
+	gTransientResources.build(gDevice);
+	gRaytracingOutputBuffer = gTransientResources.get(gRaytracingOutputIndex);
+
+	// the raster set plus the index buffer and the acceleration structures, only read by ray tracing
+	gRaytracingResidencySet = gRasterResidencySet;
+	gRaytracingResidencySet.push_back(gResidencyManager.track(gIndexBuffer, ResidencyKind::Buffer));
+
+	for (const RaytracingMesh& mesh : gMeshes) {
+		gRaytracingResidencySet.push_back(gResidencyManager.track(mesh.bottomLevelBuffers.pResult, ResidencyKind::BottomLevelAS));
+	}
+
+	for (uint32_t slot = 0; slot < gNumFrames; slot++) {
+		gRaytracingResidencySet.push_back(gResidencyManager.track(gTopLevelASBuffers[slot].pResult, ResidencyKind::TopLevelAS));
+	}
+
+	gSrvUavHeap = createShaderResourceHeap(gDevice, gRaytracingOutputBuffer, gNumFrames, gTopLevelASBuffers);
+
+	gSBTStorage = createShaderBindingTable(gDevice, *gJobs, gSBTGenerator, gSrvUavHeap, gNumFrames, gTopLevelASBuffers,
+		gMeshes, gInstances, gHitGroups, gRaytracingLayouts, gRaytracingSymbols, gShaderIdentifiers, gSBTData, gSBTCopySize);
+
+	// a feature switch or hot reload while the task ran only recorded its libraries in gShaders
+	bool librariesChanged = false;
+
+	for (uint32_t shader : { kShaderRayGen, kShaderHit, kShaderMiss }) {
+		if (!gShaders[shader].library) {
+			gShaders[shader] = gRaytracingInitShaders[shader];
+		}
+		if (gShaders[shader].library != gRaytracingInitShaders[shader].library) {
+			librariesChanged = true;
+		}
+	}
+
+	gRaytracingInitShaders.clear();
+
+	if (librariesChanged) {
+		rebuildRaytracingPipeline();
+	}
+
+	gRaytracingStatus = RaytracingStatus::Ready;
+	::PostMessage(ghWnd, kRaytracingStatusMessage, 0, 0);
+
+	char buffer[500];
+	sprintf_s(buffer, 500, "ray tracing: ready %.1fms after startup\n", secondsSinceStartup() * 1000.0);
+	OutputDebugString(buffer);
+}
+
+// Startup steps, run by a StartupGraph in wWinMain. Each one fills in its globals and only reads
+// those of the steps it awaited, the ones touching the window run on the main thread.
+
+StartupStep openWindow(StartupGraph& startup, HINSTANCE hInstance) {
+	co_await startup.mainThread();
 
-	// Window stuff
 	const wchar_t* windowClassName = L"DX12WindowClass";
 	registerWindowClass(hInstance, windowClassName);
 	ghWnd = createWindow(windowClassName, hInstance, 
@@ -883,15 +1614,104 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
 
 	// Init global window rect variable
 	::GetWindowRect(ghWnd, &gWindowRect);
+}
+
+StartupStep openDevice() {
+	enableDebugLayer();
 
-	// DirectX 12 stuff
 	ComPtr<IDXGIAdapter4> dxgiAdapter4 = getAdapter();
 
 	gDevice = createDevice(dxgiAdapter4);
 
 	checkRayTracingSupport(gDevice);
 
+	gResidencyManager.init(gDevice, dxgiAdapter4);
+	gResidencyManager.setBudgetOverride(gVideoMemoryBudget);
+
+	co_return;
+}
+
+// Shaders come from the archive built with the exe when it has them, then nothing gets
+// compiled and dxcompiler.dll (delay loaded) is never touched. Anything missing from it, or
+// built from sources edited since, is compiled, all shaders at once so the slowest one decides how long this takes. Only the
+// raster shaders are loaded here, the ray tracing libraries are loaded by startRaytracingInit.
+StartupStep loadStartupShaders() {
+	gBaseShaders = applicationShaders();
+	gShaderCompiler.init(gShaderCacheDirectory);
+
+	if (!gShaderArchivePath.empty() && !gShaderArchive.open(gShaderArchivePath)) {
+		OutputDebugString("shaders: no usable archive, compiling\n");
+	}
+
+	auto shaderCompileStart = std::chrono::steady_clock::now();
+
+	try {
+		gShaders = loadShaderVariants(gShaderFeatures, 0, kRasterShaders);
+	}
+	catch (const std::runtime_error& error) {
+		::MessageBoxA(nullptr, error.what(), "Error!", MB_OK);
+		throw;
+	}
+
+	double shaderCompileSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - shaderCompileStart).count();
+
+	OutputDebugString(formatShaderCompileReport({ gShaders[kShaderVertex], gShaders[kShaderPixel] }, shaderCompileSeconds).c_str());
+
+	// nothing to say when everything came from the archive
+	const ShaderCache* shaderCache = gShaderCompiler.cache();
+
+	if (shaderCache && shaderCache->stats().hits + shaderCache->stats().misses > 0) {
+		ShaderCacheStats stats = shaderCache->stats();
+
+		char buffer[500];
+		sprintf_s(buffer, 500, "shader cache: %u hits, %u misses, %u stored, %u rejected\n",
+			stats.hits, stats.misses, stats.stores, stats.rejected);
+		OutputDebugString(buffer);
+	}
+
+	if (gHotReload) {
+		for (uint32_t shader = 0; shader < kNumShaders; shader++) {
+			updateShaderDependencies(shader);
+		}
+
+		if (!gShaderWatcher.open("shaders")) {
+			OutputDebugString("shader hot reload: can't watch the shaders directory\n");
+		}
+	}
+
+	co_return;
+}
+
+StartupStep createQueues(StartupStep device) {
+	co_await device;
+
 	gCommandQueue = createCommandQueue(gDevice, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	gComputeQueue = createCommandQueue(gDevice, D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+	for (int i = 0; i < gNumFrames; i++) {
+		gCommandAllocators[i] = createCommandAllocator(gDevice, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	}
+
+	gCommandRecorder.init(gDevice, D3D12_COMMAND_LIST_TYPE_DIRECT, *gJobs);
+
+	gFrameScheduler.setFramesInFlight(gFramesInFlight);
+
+	gTimeline.init(gDevice);
+	gTimeline.addQueue(QueueType::Direct, gCommandQueue);
+	gTimeline.addQueue(QueueType::Compute, gComputeQueue);
+
+	gComputeAllocators.init(gDevice, D3D12_COMMAND_LIST_TYPE_COMPUTE);
+	gInitialBuildAllocator = gComputeAllocators.acquire(0);
+	gComputeCommandList = createCommandList(gDevice, gInitialBuildAllocator, D3D12_COMMAND_LIST_TYPE_COMPUTE);
+}
+
+// DXGI talks to the window while creating the swap chain, so this runs on the thread owning it
+StartupStep createSwapChainStep(StartupGraph& startup, StartupStep window, StartupStep queues) {
+	co_await window;
+	co_await queues;
+	co_await startup.mainThread();
+
+	gTearingSupported = checkTearingSupport();
 
 	gSwapChain = createSwapChain(ghWnd, gCommandQueue, gClientWidth, gClientHeight, gNumFrames);
 
@@ -902,60 +1722,160 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
 
 	updateRenderTargetViews(gDevice, gSwapChain, gRTVDescriptorHeap);
 
-	for (int i = 0; i < gNumFrames; i++) {
-		gCommandAllocators[i] = createCommandAllocator(gDevice, D3D12_COMMAND_LIST_TYPE_DIRECT);
-	}
-
 	gCommandList = createCommandList(gDevice, gCommandAllocators[gCurrentBackBufferIndex], D3D12_COMMAND_LIST_TYPE_DIRECT);
+}
 
-	gFence = createFence(gDevice);
-	gFenceEvent = createEventHandle();
+StartupStep createRootSignatures(StartupStep device) {
+	co_await device;
 
-	gRootSignature = createRootSignature(gDevice);
+	gRootSignatures.init(gDevice, gShaderCacheDirectory);
+	gPipelineStates.init(gDevice, gShaderCacheDirectory.empty() ? std::filesystem::path() : gShaderCacheDirectory / "pipelines.bin");
+	gRootSignature = createRootSignature(gDevice, gRootSignatureBlob);
+}
 
-	gPipelineState = createPipelineState(gDevice, gRootSignature);
+StartupStep createRasterPipeline(StartupStep shaders, StartupStep rootSignatures) {
+	co_await shaders;
+	co_await rootSignatures;
 
-	gVertexBuffer = createVertexBuffer(gDevice, gCommandQueue, gVertexBufferView);
+	auto start = std::chrono::steady_clock::now();
 
-	createAccelerationStructures(gDevice, gCommandList, gVertexBuffer, 
-		gTopLevelASGenerator, gBottomLevelASBuffers, gTopLevelASBuffers);
+	gPipelineState = createPipelineState(gPipelineStates, gRootSignature, gRootSignatureBlob,
+		gShaders[kShaderVertex].bytecode, gShaders[kShaderPixel].bytecode);
 
-	gRaytracingPipelineState = createRaytracingPipelineState(gDevice, gRayGenLibrary, gHitLibrary, 
-		gMissLibrary, gRayGenSignature, gHitSignature, gMissSignature,
-		gRaytracingStateObjectProperties);
+	PipelineCacheStats stats = gPipelineStates.stats();
+
+	char buffer[500];
+	sprintf_s(buffer, 500, "pipelines: raster PSO %s in %.0fus, %s\n", stats.loaded > 0 ? "loaded" : "created",
+		std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count(),
+		gPipelineStates.hasLibrary() ? "pipeline library" : "cached blobs");
+	OutputDebugString(buffer);
+}
+
+StartupStep createGeometry(StartupStep queues) {
+	co_await queues;
+
+	gVertexBuffer = createVertexBuffer(gResidencyManager, gCommandQueue, gVertexBufferView);
+	gIndexBuffer = createIndexBuffer(gResidencyManager);
+
+	// one mesh with one geometry, instanced once
+	gMeshes = { { { { gVertexBuffer, 3, gIndexBuffer, 3 } } } };
+	gInstances = { { 0, DirectX::XMMatrixIdentity() } };
+	gHitGroups = layoutSceneHitGroups(gMeshes, gInstances);
+
+	// the vertex buffer is read by both paths, updateRaytracingInit adds what only ray tracing reads
+	gRasterResidencySet = { gResidencyManager.track(gVertexBuffer, ResidencyKind::Buffer) };
+}
+
+// only starts the background init, the window shows without waiting for ray tracing
+StartupStep startRaytracing(StartupStep shaders, StartupStep rootSignatures, StartupStep queues, StartupStep geometry) {
+	co_await shaders;
+	co_await rootSignatures;
+	co_await queues;
+	co_await geometry;
+
+	startRaytracingInit();
+}
 
-	gRaytracingOutputBuffer = createRaytracingOutputBuffer(gDevice, gClientWidth, gClientHeight);
+int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow) {
 
-	gSrvUavHeap = createShaderResourceHeap(gDevice, gRaytracingOutputBuffer, gTopLevelASBuffers);
+	// client area of window can have 100% scaling while non-client window content
+	// can still be drawn in DPI sensitive fashion
+	// without this our client area would get scaled based on DPI scaling 
+	// we don't want that here 
+	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+
+	parseCommandLineArguments();
 
-	gSBTStorage = createShaderBindingTable(gDevice, gSBTGenerator, gSrvUavHeap, gVertexBuffer, gRaytracingStateObjectProperties);
+	gViewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(gClientWidth), static_cast<float>(gClientHeight));
+	gScissorRect = CD3DX12_RECT(0, 0, static_cast<LONG>(gClientWidth), static_cast<LONG>(gClientHeight));
+
+	gJobs = std::make_unique<JobSystem>(gWorkerThreads);
+
+	if (gJobBenchmark) {
+		OutputDebugString(formatJobBenchmark(benchmarkJobSystem(std::thread::hardware_concurrency())).c_str());
+	}
+
+	// the steps run as soon as what they await is there, see the startup steps above
+	{
+		StartupGraph startup(*gJobs);
+
+		StartupStep window = startup.add("window", openWindow(startup, hInstance));
+		StartupStep device = startup.add("device", openDevice());
+		StartupStep shaders = startup.add("shaders", loadStartupShaders());
+		StartupStep queues = startup.add("queues", createQueues(device));
+		startup.add("swap chain", createSwapChainStep(startup, window, queues));
+		StartupStep rootSignatures = startup.add("root signatures", createRootSignatures(device));
+		startup.add("raster pso", createRasterPipeline(shaders, rootSignatures));
+		StartupStep geometry = startup.add("geometry", createGeometry(queues));
+		startup.add("ray tracing", startRaytracing(shaders, rootSignatures, queues, geometry));
+
+		startup.wait();
+
+		if (gStartupReport) {
+			OutputDebugString(formatStartupTimeline(startup.timings()).c_str());
+		}
+	}
+
+	if (gTransientReport) {
+		TransientAliasingReport report = reportTransientAliasing(buildSyntheticTransientFrame(gClientWidth, gClientHeight));
+		OutputDebugString(formatTransientAliasingReport(report).c_str());
+	}
+
+	if (gAsyncBuildReport) {
+		reportAsyncBuilds();
+	}
 
 	// Flush command list to make sure everything above finished 
 	throwIfFailed(gCommandList->Close());
 	ID3D12CommandList* const commandLists[] = { gCommandList.Get() };
 	gCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
 
-	flush(gCommandQueue, gFence, gFenceValue, gFenceEvent);
+	gTimeline.flush(QueueType::Direct);
+	gTimeline.poll();
 	gCurrentBackBufferIndex = gSwapChain->GetCurrentBackBufferIndex();
 
-	// now start the message loop
+	// now start the simulation and render threads, this thread only pumps messages from here on
 	gIsInitialized = true;
 
+	update(0, 0.0);
+
+	gSimulationThread = std::thread(simulationLoop);
+	gRenderThread = std::thread(renderLoop);
+
 	::ShowWindow(ghWnd, SW_SHOW);
 
 	MSG msg = {};
-	while (msg.message != WM_QUIT)
+	while (::GetMessage(&msg, NULL, 0, 0) > 0)
 	{
-		if (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-		{
-			::TranslateMessage(&msg);
-			::DispatchMessage(&msg);
+		::TranslateMessage(&msg);
+		::DispatchMessage(&msg);
+	}
+
+	gQuit = true;
+
+	gSimulationThread.join();
+	gRenderThread.join();
+
+	// quit before ray tracing was ready, its objects are released with the globals
+	if (gRaytracingInitTask.valid()) {
+		try {
+			gJobs->wait(gRaytracingInitTask);
+		}
+		catch (const std::exception&) {
 		}
 	}
 
-	flush(gCommandQueue, gFence, gFenceValue, gFenceEvent);
+	// PSOs created this run are there without compiling next time
+	if (!gPipelineStates.save()) {
+		OutputDebugString("pipelines: couldn't write the pipeline cache\n");
+	}
+
+	// wait for every queue, then run whatever is still waiting to be released
+	gTimeline.flushAll();
+	gTimeline.poll();
 
-	::CloseHandle(gFenceEvent);
+	gCommandRecorder.shutdown();
+	gJobs.reset();
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "permutations.h"
+
+#include <sstream>
+
+std::vector<std::string> permutationDefines(const std::vector<std::string>& featureNames,
+	uint32_t declared, uint32_t enabled) {
+	std::vector<std::string> defines;
+
+	for (uint32_t feature = 0; feature < kMaxShaderFeatures; feature++) {
+		uint32_t bit = 1u << feature;
+
+		if (!(declared & bit)) {
+			continue;
+		}
+
+		if (feature >= featureNames.size()) {
+			throw std::logic_error("shader declares a feature that has no name");
+		}
+
+		defines.push_back(featureNames[feature] + ((enabled & bit) ? "=1" : "=0"));
+	}
+
+	return defines;
+}
+
+uint32_t parseShaderFeatures(const std::vector<std::string>& featureNames, const std::string& text) {
+	uint32_t features = 0;
+	std::istringstream names(text);
+	std::string name;
+
+	while (std::getline(names, name, ',')) {
+		if (name.empty() || name == "none") {
+			continue;
+		}
+
+		bool known = false;
+
+		for (size_t feature = 0; feature < featureNames.size(); feature++) {
+			if (featureNames[feature] == name) {
+				features |= 1u << feature;
+				known = true;
+			}
+		}
+
+		if (!known) {
+			throw std::logic_error("unknown shader feature " + name);
+		}
+	}
+
+	return features;
+}
+
+std::string formatShaderFeatures(const std::vector<std::string>& featureNames, uint32_t features) {
+	std::string text;
+
+	for (size_t feature = 0; feature < featureNames.size(); feature++) {
+		if (features & (1u << feature)) {
+			text += (text.empty() ? "" : ",") + featureNames[feature];
+		}
+	}
+
+	return text.empty() ? "none" : text;
+}
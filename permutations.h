@@ -0,0 +1,107 @@
+#pragma once
+
+// Shader permutations, no D3D12 or DXC in here. Features are flags for the whole pipeline
+// (vertex color, alpha test, ...), each backed by a define. A shader declares which of them
+// it is specialized on and gets compiled with NAME=1 or NAME=0 for each of those, so a
+// disabled feature is compiled out instead of being a branch. Shaders not declaring a
+// feature share one variant for both settings.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+const uint32_t kMaxShaderFeatures = 16;
+
+// NAME=0/1 for every feature set in declared, in feature order. Throws std::logic_error for
+// bits without a name.
+std::vector<std::string> permutationDefines(const std::vector<std::string>& featureNames,
+	uint32_t declared, uint32_t enabled);
+
+// "VERTEX_COLOR,ALPHA_TEST" to a mask, "none" or "" is 0. Throws std::logic_error for unknown names.
+uint32_t parseShaderFeatures(const std::vector<std::string>& featureNames, const std::string& text);
+std::string formatShaderFeatures(const std::vector<std::string>& featureNames, uint32_t features);
+
+// Compiled variants by shader and enabled feature mask, filled on demand. The first get() of a
+// variant compiles it, concurrent get()s of the same variant wait for that compile rather
+// than starting their own. A compile that throws isn't cached, the next get() retries.
+template <typename Variant>
+class VariantCache {
+public:
+	typedef std::pair<uint32_t, uint32_t> Key; // shader, variant
+
+	Variant get(uint32_t shader, uint32_t variant, const std::function<Variant()>& compile) {
+		Key key(shader, variant);
+		std::shared_future<Variant> future;
+		std::promise<Variant> promise;
+		bool compiling = false;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto found = m_variants.find(key);
+
+			if (found != m_variants.end()) {
+				m_hits++;
+				future = found->second;
+			}
+			else {
+				m_misses++;
+				future = promise.get_future().share();
+				m_variants.emplace(key, future);
+				compiling = true;
+			}
+		}
+
+		if (compiling) {
+			try {
+				promise.set_value(compile());
+			}
+			catch (...) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_variants.erase(key);
+				}
+				promise.set_exception(std::current_exception());
+			}
+		}
+
+		return future.get();
+	}
+
+	bool contains(uint32_t shader, uint32_t variant) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_variants.find(Key(shader, variant));
+
+		return found != m_variants.end() &&
+			found->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	// drops every variant of the shader, its source changed
+	void invalidate(uint32_t shader) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto it = m_variants.begin(); it != m_variants.end();) {
+			it = it->first.first == shader ? m_variants.erase(it) : std::next(it);
+		}
+	}
+
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_variants.size();
+	}
+
+	uint32_t hits() const { return m_hits; }
+	uint32_t misses() const { return m_misses; }
+
+private:
+	mutable std::mutex m_mutex;
+	std::map<Key, std::shared_future<Variant>> m_variants;
+	uint32_t m_hits = 0; // guarded by m_mutex
+	uint32_t m_misses = 0;
+};
@@ -0,0 +1,238 @@
+#include "pipelinecache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+	const char kPipelineCacheMagic[4] = { 'P', 'S', 'O', 'C' };
+	const uint32_t kPipelineCacheFormat = 1;
+
+	struct PipelineCacheHeader {
+		char magic[4];
+		uint32_t format;
+		uint32_t vendorId;
+		uint32_t deviceId;
+		uint64_t driverVersion;
+		uint64_t librarySize;
+		uint32_t numEntries;
+		uint32_t reserved;
+		uint64_t payloadHash; // of everything after the header
+	};
+
+	static_assert(sizeof(PipelineCacheHeader) == 48, "the header is written as is");
+
+	struct PipelineCacheEntryHeader {
+		uint64_t key;
+		uint32_t descSize;
+		uint32_t blobSize;
+	};
+
+	template <typename T>
+	void append(std::vector<uint8_t>& bytes, const T& value) {
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(T));
+	}
+
+	// reads front to back, every read checks it stays inside the bytes
+	class ByteReader {
+	public:
+		ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		template <typename T>
+		bool read(T& value) {
+			if (sizeof(T) > m_size - m_offset) {
+				return false;
+			}
+
+			memcpy(&value, m_data + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+
+			return true;
+		}
+
+		bool read(std::vector<uint8_t>& bytes, uint64_t size) {
+			if (size > m_size - m_offset) {
+				return false;
+			}
+
+			bytes.assign(m_data + m_offset, m_data + m_offset + size);
+			m_offset += static_cast<size_t>(size);
+
+			return true;
+		}
+
+		bool atEnd() const { return m_offset == m_size; }
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+	};
+}
+
+void PipelineDescWriter::value(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	this->value(bits);
+}
+
+void PipelineDescWriter::string(const char* text) {
+	if (!text) {
+		value(UINT32_MAX);
+		return;
+	}
+
+	uint32_t length = static_cast<uint32_t>(strlen(text));
+
+	value(length);
+	bytes(text, length);
+}
+
+void PipelineDescWriter::blob(const void* data, size_t size) {
+	uint64_t size64 = size;
+	uint64_t hash = size > 0 ? hashBytes(data, size) : 0;
+
+	bytes(&size64, sizeof(size64));
+	bytes(&hash, sizeof(hash));
+}
+
+void PipelineDescWriter::bytes(const void* data, size_t size) {
+	const uint8_t* begin = static_cast<const uint8_t*>(data);
+	m_bytes.insert(m_bytes.end(), begin, begin + size);
+}
+
+uint64_t pipelineCacheKey(const std::vector<uint8_t>& desc) {
+	return hashBytes(desc.data(), desc.size(), hashBytes(kPipelineCacheMagic, sizeof(kPipelineCacheMagic)));
+}
+
+const PipelineCacheEntry* findPipelineCacheEntry(const PipelineCacheContents& contents, uint64_t key,
+	const std::vector<uint8_t>& desc) {
+	for (const PipelineCacheEntry& entry : contents.entries) {
+		if (entry.key == key && entry.desc == desc) {
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+std::wstring pipelineLibraryName(uint64_t key) {
+	std::string name = formatShaderCacheKey(key);
+
+	return std::wstring(name.begin(), name.end());
+}
+
+std::vector<uint8_t> serializePipelineCache(const PipelineCacheContents& contents) {
+	std::vector<uint8_t> payload = contents.library;
+
+	for (const PipelineCacheEntry& entry : contents.entries) {
+		append(payload, PipelineCacheEntryHeader{ entry.key,
+			static_cast<uint32_t>(entry.desc.size()), static_cast<uint32_t>(entry.blob.size()) });
+		payload.insert(payload.end(), entry.desc.begin(), entry.desc.end());
+		payload.insert(payload.end(), entry.blob.begin(), entry.blob.end());
+	}
+
+	PipelineCacheHeader header = {};
+	memcpy(header.magic, kPipelineCacheMagic, sizeof(kPipelineCacheMagic));
+	header.format = kPipelineCacheFormat;
+	header.vendorId = contents.identity.vendorId;
+	header.deviceId = contents.identity.deviceId;
+	header.driverVersion = contents.identity.driverVersion;
+	header.librarySize = contents.library.size();
+	header.numEntries = static_cast<uint32_t>(contents.entries.size());
+	header.payloadHash = hashBytes(payload.data(), payload.size());
+
+	std::vector<uint8_t> bytes;
+	bytes.reserve(sizeof(header) + payload.size());
+	append(bytes, header);
+	bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+	return bytes;
+}
+
+bool parsePipelineCache(const uint8_t* data, size_t size, PipelineCacheContents& contents) {
+	contents = PipelineCacheContents();
+
+	ByteReader reader(data, size);
+	PipelineCacheHeader header;
+
+	if (!reader.read(header) || memcmp(header.magic, kPipelineCacheMagic, sizeof(kPipelineCacheMagic)) != 0 ||
+		header.format != kPipelineCacheFormat || header.reserved != 0 ||
+		header.payloadHash != hashBytes(data + sizeof(header), size - sizeof(header))) {
+		return false;
+	}
+
+	PipelineCacheContents parsed;
+	parsed.identity = { header.vendorId, header.deviceId, header.driverVersion };
+
+	if (!reader.read(parsed.library, header.librarySize)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.numEntries; i++) {
+		PipelineCacheEntryHeader entryHeader;
+		PipelineCacheEntry entry;
+
+		if (!reader.read(entryHeader) || !reader.read(entry.desc, entryHeader.descSize) ||
+			!reader.read(entry.blob, entryHeader.blobSize)) {
+			return false;
+		}
+
+		entry.key = entryHeader.key;
+		parsed.entries.push_back(std::move(entry));
+	}
+
+	if (!reader.atEnd()) {
+		return false;
+	}
+
+	contents = std::move(parsed);
+
+	return true;
+}
+
+bool writePipelineCache(const std::filesystem::path& path, const PipelineCacheContents& contents) {
+	std::vector<uint8_t> bytes = serializePipelineCache(contents);
+
+	std::error_code error;
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path(), error);
+	}
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+		if (!file.good()) {
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, path, error);
+
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool readPipelineCache(const std::filesystem::path& path, PipelineCacheContents& contents) {
+	contents = PipelineCacheContents();
+
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file) {
+		return false;
+	}
+
+	std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	return parsePipelineCache(bytes.data(), bytes.size(), contents);
+}
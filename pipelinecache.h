@@ -0,0 +1,180 @@
+#pragma once
+
+// Keys and file format of the pipeline state cache (PipelineStateCache in pipelines.h). No D3D12
+// in here, the description is a template parameter, so both can be checked on any platform with
+// a stand-in that has the fields of D3D12_GRAPHICS_PIPELINE_STATE_DESC.
+//
+// A key hashes the canonical bytes of a description: every field that goes into the PSO in a
+// fixed order, pointers replaced by what they point at, shader bytecode and the root signature by
+// their size and hash. The bytes are stored with each entry and compared on load, so a key
+// collision is a miss rather than the wrong pipeline.
+//
+// The cache is one file: header, then the pipeline library blob when the driver has one, then the
+// entries, each a key, its description and the pipeline's own cached blob when there's no
+// library. Compiled PSOs only work on the GPU and driver that made them, the header names both
+// and a file of another one is ignored as a whole.
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "shadercache.h"
+
+// Canonical description bytes, written field by field
+class PipelineDescWriter {
+public:
+	void value(uint32_t value) { bytes(&value, sizeof(value)); }
+	void value(float value); // by its bits
+
+	// semantic names, null and "" differ
+	void string(const char* text);
+
+	// size and hash of shader bytecode or a serialized root signature
+	void blob(const void* data, size_t size);
+
+	const std::vector<uint8_t>& bytes() const { return m_bytes; }
+
+private:
+	void bytes(const void* data, size_t size);
+
+	std::vector<uint8_t> m_bytes;
+};
+
+// The canonical bytes of a D3D12_GRAPHICS_PIPELINE_STATE_DESC or anything with its fields. The
+// root signature is given serialized, its object differs between launches. CachedPSO is left out.
+template <typename GraphicsPipelineDesc>
+std::vector<uint8_t> graphicsPipelineDesc(const GraphicsPipelineDesc& desc, const void* rootSignature, size_t rootSignatureSize) {
+	PipelineDescWriter writer;
+
+	writer.value(1u); // format
+	writer.blob(rootSignature, rootSignatureSize);
+
+	for (const auto* shader : { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS }) {
+		writer.blob(shader->pShaderBytecode, shader->BytecodeLength);
+	}
+
+	writer.value(static_cast<uint32_t>(desc.StreamOutput.NumEntries));
+	for (uint32_t i = 0; i < desc.StreamOutput.NumEntries; i++) {
+		const auto& entry = desc.StreamOutput.pSODeclaration[i];
+		writer.value(static_cast<uint32_t>(entry.Stream));
+		writer.string(entry.SemanticName);
+		writer.value(static_cast<uint32_t>(entry.SemanticIndex));
+		writer.value(static_cast<uint32_t>(entry.StartComponent));
+		writer.value(static_cast<uint32_t>(entry.ComponentCount));
+		writer.value(static_cast<uint32_t>(entry.OutputSlot));
+	}
+	writer.value(static_cast<uint32_t>(desc.StreamOutput.NumStrides));
+	for (uint32_t i = 0; i < desc.StreamOutput.NumStrides; i++) {
+		writer.value(static_cast<uint32_t>(desc.StreamOutput.pBufferStrides[i]));
+	}
+	writer.value(static_cast<uint32_t>(desc.StreamOutput.RasterizedStream));
+
+	writer.value(static_cast<uint32_t>(desc.BlendState.AlphaToCoverageEnable));
+	writer.value(static_cast<uint32_t>(desc.BlendState.IndependentBlendEnable));
+	for (const auto& target : desc.BlendState.RenderTarget) {
+		writer.value(static_cast<uint32_t>(target.BlendEnable));
+		writer.value(static_cast<uint32_t>(target.LogicOpEnable));
+		writer.value(static_cast<uint32_t>(target.SrcBlend));
+		writer.value(static_cast<uint32_t>(target.DestBlend));
+		writer.value(static_cast<uint32_t>(target.BlendOp));
+		writer.value(static_cast<uint32_t>(target.SrcBlendAlpha));
+		writer.value(static_cast<uint32_t>(target.DestBlendAlpha));
+		writer.value(static_cast<uint32_t>(target.BlendOpAlpha));
+		writer.value(static_cast<uint32_t>(target.LogicOp));
+		writer.value(static_cast<uint32_t>(target.RenderTargetWriteMask));
+	}
+	writer.value(static_cast<uint32_t>(desc.SampleMask));
+
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.FillMode));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.CullMode));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.FrontCounterClockwise));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.DepthBias));
+	writer.value(static_cast<float>(desc.RasterizerState.DepthBiasClamp));
+	writer.value(static_cast<float>(desc.RasterizerState.SlopeScaledDepthBias));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.DepthClipEnable));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.MultisampleEnable));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.AntialiasedLineEnable));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.ForcedSampleCount));
+	writer.value(static_cast<uint32_t>(desc.RasterizerState.ConservativeRaster));
+
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.DepthEnable));
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.DepthWriteMask));
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.DepthFunc));
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.StencilEnable));
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.StencilReadMask));
+	writer.value(static_cast<uint32_t>(desc.DepthStencilState.StencilWriteMask));
+	for (const auto* face : { &desc.DepthStencilState.FrontFace, &desc.DepthStencilState.BackFace }) {
+		writer.value(static_cast<uint32_t>(face->StencilFailOp));
+		writer.value(static_cast<uint32_t>(face->StencilDepthFailOp));
+		writer.value(static_cast<uint32_t>(face->StencilPassOp));
+		writer.value(static_cast<uint32_t>(face->StencilFunc));
+	}
+
+	writer.value(static_cast<uint32_t>(desc.InputLayout.NumElements));
+	for (uint32_t i = 0; i < desc.InputLayout.NumElements; i++) {
+		const auto& element = desc.InputLayout.pInputElementDescs[i];
+		writer.string(element.SemanticName);
+		writer.value(static_cast<uint32_t>(element.SemanticIndex));
+		writer.value(static_cast<uint32_t>(element.Format));
+		writer.value(static_cast<uint32_t>(element.InputSlot));
+		writer.value(static_cast<uint32_t>(element.AlignedByteOffset));
+		writer.value(static_cast<uint32_t>(element.InputSlotClass));
+		writer.value(static_cast<uint32_t>(element.InstanceDataStepRate));
+	}
+
+	writer.value(static_cast<uint32_t>(desc.IBStripCutValue));
+	writer.value(static_cast<uint32_t>(desc.PrimitiveTopologyType));
+	writer.value(static_cast<uint32_t>(desc.NumRenderTargets));
+	for (auto format : desc.RTVFormats) {
+		writer.value(static_cast<uint32_t>(format));
+	}
+	writer.value(static_cast<uint32_t>(desc.DSVFormat));
+	writer.value(static_cast<uint32_t>(desc.SampleDesc.Count));
+	writer.value(static_cast<uint32_t>(desc.SampleDesc.Quality));
+	writer.value(static_cast<uint32_t>(desc.NodeMask));
+	writer.value(static_cast<uint32_t>(desc.Flags));
+
+	return writer.bytes();
+}
+
+uint64_t pipelineCacheKey(const std::vector<uint8_t>& desc);
+
+// The GPU and driver a cache file was written with
+struct PipelineCacheIdentity {
+	uint32_t vendorId;
+	uint32_t deviceId;
+	uint64_t driverVersion; // user mode driver version, as from IDXGIAdapter::CheckInterfaceSupport
+};
+
+inline bool operator==(const PipelineCacheIdentity& a, const PipelineCacheIdentity& b) {
+	return a.vendorId == b.vendorId && a.deviceId == b.deviceId && a.driverVersion == b.driverVersion;
+}
+
+struct PipelineCacheEntry {
+	uint64_t key;
+	std::vector<uint8_t> desc; // canonical bytes
+	std::vector<uint8_t> blob; // ID3D12PipelineState::GetCachedBlob, empty when the library has the pipeline
+};
+
+struct PipelineCacheContents {
+	PipelineCacheIdentity identity = {};
+	std::vector<uint8_t> library; // ID3D12PipelineLibrary::Serialize, empty without a library
+	std::vector<PipelineCacheEntry> entries;
+};
+
+// the entry stored for the key with exactly this description, or null
+const PipelineCacheEntry* findPipelineCacheEntry(const PipelineCacheContents& contents, uint64_t key,
+	const std::vector<uint8_t>& desc);
+
+// the name a pipeline is stored under in the library
+std::wstring pipelineLibraryName(uint64_t key);
+
+std::vector<uint8_t> serializePipelineCache(const PipelineCacheContents& contents);
+
+// false, leaving contents empty, if the bytes are truncated, corrupt or of another format
+bool parsePipelineCache(const uint8_t* data, size_t size, PipelineCacheContents& contents);
+
+// written to a temporary name and renamed, false if that failed
+bool writePipelineCache(const std::filesystem::path& path, const PipelineCacheContents& contents);
+bool readPipelineCache(const std::filesystem::path& path, PipelineCacheContents& contents);
@@ -0,0 +1,196 @@
+#include "pipelines.h"
+
+#include <dxgi1_6.h>
+
+#include <algorithm>
+
+#include "helpers.h"
+
+namespace {
+	// the GPU and user mode driver the device runs on, all zero if DXGI can't tell
+	PipelineCacheIdentity adapterIdentity(ID3D12Device* device) {
+		ComPtr<IDXGIFactory4> factory;
+		ComPtr<IDXGIAdapter1> adapter;
+		DXGI_ADAPTER_DESC1 desc;
+		LARGE_INTEGER driverVersion;
+
+		if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) ||
+			FAILED(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(&adapter))) ||
+			FAILED(adapter->GetDesc1(&desc)) ||
+			FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion))) {
+			return {};
+		}
+
+		return { desc.VendorId, desc.DeviceId, static_cast<uint64_t>(driverVersion.QuadPart) };
+	}
+
+	bool supportsPipelineLibrary(ID3D12Device* device) {
+		D3D12_FEATURE_DATA_SHADER_CACHE shaderCache = {};
+
+		return SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_SHADER_CACHE, &shaderCache, sizeof(shaderCache))) &&
+			(shaderCache.SupportFlags & D3D12_SHADER_CACHE_SUPPORT_LIBRARY) != 0;
+	}
+}
+
+void PipelineStateCache::init(ComPtr<ID3D12Device5> device, const std::filesystem::path& file) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_device = device;
+	m_file = file;
+
+	PipelineCacheIdentity identity = adapterIdentity(device.Get());
+
+	// without knowing the driver a file could be from another one, nothing is kept
+	if (identity == PipelineCacheIdentity{}) {
+		m_file.clear();
+	}
+
+	if (m_file.empty() || !readPipelineCache(m_file, m_contents) || !(m_contents.identity == identity)) {
+		m_contents = PipelineCacheContents();
+		m_contents.identity = identity;
+	}
+
+	if (supportsPipelineLibrary(device.Get())) {
+		// a library the driver doesn't take anymore starts over empty, its entries with it
+		if (m_contents.library.empty() || FAILED(device->CreatePipelineLibrary(m_contents.library.data(),
+			m_contents.library.size(), IID_PPV_ARGS(&m_library)))) {
+			m_contents.library.clear();
+			m_contents.entries.clear();
+			m_library = nullptr;
+
+			if (FAILED(device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library)))) {
+				m_library = nullptr;
+			}
+		}
+	}
+
+	if (!m_library) {
+		m_contents.library.clear();
+	}
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3DBlob* rootSignature) {
+	std::vector<uint8_t> canonical = graphicsPipelineDesc(desc, rootSignature->GetBufferPointer(), rootSignature->GetBufferSize());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_pipelines.find(canonical);
+
+	if (found != m_pipelines.end()) {
+		m_stats.shared++;
+		return found->second;
+	}
+
+	uint64_t key = pipelineCacheKey(canonical);
+	std::wstring name = pipelineLibraryName(key);
+	const PipelineCacheEntry* entry = findPipelineCacheEntry(m_contents, key, canonical);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC createDesc = desc;
+	createDesc.CachedPSO = {};
+
+	ComPtr<ID3D12PipelineState> pipelineState;
+
+	if (entry && (m_library || !entry->blob.empty())) {
+		HRESULT result;
+
+		if (m_library) {
+			result = m_library->LoadGraphicsPipeline(name.c_str(), &createDesc, IID_PPV_ARGS(&pipelineState));
+		}
+		else {
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC cachedDesc = createDesc;
+			cachedDesc.CachedPSO = { entry->blob.data(), entry->blob.size() };
+
+			result = m_device->CreateGraphicsPipelineState(&cachedDesc, IID_PPV_ARGS(&pipelineState));
+		}
+
+		// e.g. D3D12_ERROR_DRIVER_VERSION_MISMATCH, it's compiled again below
+		if (SUCCEEDED(result)) {
+			m_stats.loaded++;
+		}
+		else {
+			pipelineState = nullptr;
+			m_stats.rejected++;
+		}
+	}
+
+	if (!pipelineState) {
+		throwIfFailed(m_device->CreateGraphicsPipelineState(&createDesc, IID_PPV_ARGS(&pipelineState)));
+		m_stats.created++;
+
+		if (m_library) {
+			// fails for a name the library has already, a rejected pipeline just stays uncached
+			if (SUCCEEDED(m_library->StorePipeline(name.c_str(), pipelineState.Get()))) {
+				storeEntry({ key, canonical, {} });
+			}
+		}
+		else {
+			ComPtr<ID3DBlob> blob;
+
+			if (SUCCEEDED(pipelineState->GetCachedBlob(&blob))) {
+				const uint8_t* data = static_cast<const uint8_t*>(blob->GetBufferPointer());
+				storeEntry({ key, canonical, std::vector<uint8_t>(data, data + blob->GetBufferSize()) });
+			}
+		}
+	}
+
+	m_pipelines.emplace(std::move(canonical), pipelineState);
+
+	return pipelineState;
+}
+
+bool PipelineStateCache::save() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_dirty || m_file.empty()) {
+		return true;
+	}
+
+	// the library keeps reading the blob it was created from, the new one goes to a copy
+	PipelineCacheContents contents;
+	contents.identity = m_contents.identity;
+	contents.entries = m_contents.entries;
+
+	if (m_library) {
+		contents.library.resize(m_library->GetSerializedSize());
+
+		if (FAILED(m_library->Serialize(contents.library.data(), contents.library.size()))) {
+			return false;
+		}
+	}
+
+	if (!writePipelineCache(m_file, contents)) {
+		return false;
+	}
+
+	m_dirty = false;
+
+	return true;
+}
+
+PipelineCacheStats PipelineStateCache::stats() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+size_t PipelineStateCache::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pipelines.size();
+}
+
+bool PipelineStateCache::hasLibrary() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_library != nullptr;
+}
+
+void PipelineStateCache::storeEntry(PipelineCacheEntry entry) {
+	auto existing = std::find_if(m_contents.entries.begin(), m_contents.entries.end(),
+		[&](const PipelineCacheEntry& stored) { return stored.key == entry.key; });
+
+	if (existing != m_contents.entries.end()) {
+		*existing = std::move(entry);
+	}
+	else {
+		m_contents.entries.push_back(std::move(entry));
+	}
+
+	m_dirty = true;
+}
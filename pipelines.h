@@ -0,0 +1,63 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "pipelinecache.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct PipelineCacheStats {
+	uint32_t loaded; // from the pipeline library or a cached blob, no driver compile
+	uint32_t created; // compiled by the driver
+	uint32_t shared; // asked for a description which already had a pipeline
+	uint32_t rejected; // stored pipelines the driver didn't take, created again
+};
+
+// Graphics pipeline states by description, kept across launches in one file (see
+// pipelinecache.h for the keys and the format). Where the driver has pipeline libraries the
+// pipelines live in an ID3D12PipelineLibrary stored in the file, elsewhere each one's cached blob
+// is stored and handed back as CachedPSO. Either way a warm launch doesn't compile anything.
+//
+// Safe to use from several threads at once.
+class PipelineStateCache {
+public:
+	// reads file if it was written on this GPU and driver, empty keeps nothing on disk
+	void init(ComPtr<ID3D12Device5> device, const std::filesystem::path& file);
+
+	// rootSignature is the serialized desc.pRootSignature, CachedPSO is ignored
+	ComPtr<ID3D12PipelineState> get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3DBlob* rootSignature);
+
+	// writes the file if pipelines were added since it was read, false if that failed
+	bool save();
+
+	PipelineCacheStats stats() const;
+
+	// distinct pipelines created so far
+	size_t size() const;
+
+	bool hasLibrary() const;
+
+private:
+	void storeEntry(PipelineCacheEntry entry);
+
+	ComPtr<ID3D12Device5> m_device;
+	std::filesystem::path m_file;
+
+	mutable std::mutex m_mutex; // guards everything below, the library isn't free threaded for Serialize
+	PipelineCacheContents m_contents; // the library blob backs m_library and stays as read
+	ComPtr<ID3D12PipelineLibrary> m_library;
+	std::map<std::vector<uint8_t>, ComPtr<ID3D12PipelineState>> m_pipelines;
+	PipelineCacheStats m_stats = {};
+	bool m_dirty = false;
+};
@@ -0,0 +1,168 @@
+#include "queues.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+AsyncBuildScheduler::AsyncBuildScheduler(uint32_t numSlots) :
+	m_slotTraceValues(std::max(1u, numSlots), 0),
+	m_slotBuildValues(std::max(1u, numSlots), 0) {
+}
+
+QueueSubmission AsyncBuildScheduler::planBuild(uint64_t frameIndex, uint64_t computeSignalValue) {
+	uint32_t buildSlot = slot(frameIndex);
+
+	QueueSubmission submission;
+	submission.queue = QueueType::Compute;
+	submission.signalValue = computeSignalValue;
+
+	// the build overwrites the slot, the last trace reading it has to be done first
+	if (m_slotTraceValues[buildSlot] != 0) {
+		submission.waits.push_back({ QueueType::Direct, m_slotTraceValues[buildSlot] });
+	}
+
+	m_slotBuildValues[buildSlot] = computeSignalValue;
+
+	return submission;
+}
+
+QueueSubmission AsyncBuildScheduler::planTrace(uint64_t frameIndex, uint64_t directSignalValue) {
+	uint32_t traceSlot = slot(frameIndex);
+
+	QueueSubmission submission;
+	submission.queue = QueueType::Direct;
+	submission.signalValue = directSignalValue;
+
+	if (m_slotBuildValues[traceSlot] != 0) {
+		submission.waits.push_back({ QueueType::Compute, m_slotBuildValues[traceSlot] });
+	}
+
+	m_slotTraceValues[traceSlot] = directSignalValue;
+
+	return submission;
+}
+
+void CompletionQueue::enqueue(std::vector<QueueWait> waits, std::function<void()> callback) {
+	m_entries.push_back({ std::move(waits), std::move(callback) });
+}
+
+std::vector<std::function<void()>> CompletionQueue::takeReady(const uint64_t (&completedValues)[kNumQueueTypes]) {
+	auto isPending = [&](const Entry& entry) {
+		for (const QueueWait& wait : entry.waits) {
+			if (completedValues[static_cast<uint32_t>(wait.queue)] < wait.value) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	auto firstReady = std::stable_partition(m_entries.begin(), m_entries.end(), isPending);
+
+	std::vector<std::function<void()>> ready;
+	for (auto entry = firstReady; entry != m_entries.end(); entry++) {
+		ready.push_back(std::move(entry->callback));
+	}
+	m_entries.erase(firstReady, m_entries.end());
+
+	return ready;
+}
+
+size_t CompletionQueue::run(const uint64_t (&completedValues)[kNumQueueTypes]) {
+	// take the ready entries out first, so callbacks are free to enqueue
+	std::vector<std::function<void()>> ready = takeReady(completedValues);
+
+	for (auto& callback : ready) {
+		callback();
+	}
+
+	return ready.size();
+}
+
+std::vector<QueueInterval>
+simulateQueueTimeline(const std::vector<QueueSubmission>& submissions, const std::vector<double>& durations) {
+	if (durations.size() != submissions.size()) {
+		throw std::logic_error("simulateQueueTimeline: one duration per submission expected");
+	}
+
+	std::vector<QueueInterval> intervals(submissions.size());
+	double queueFree[kNumQueueTypes] = {};
+
+	for (size_t i = 0; i < submissions.size(); i++) {
+		const QueueSubmission& submission = submissions[i];
+		double start = queueFree[static_cast<uint32_t>(submission.queue)];
+
+		for (const QueueWait& wait : submission.waits) {
+			// the first earlier submission on that queue signalling a value at least as high
+			bool found = false;
+
+			for (size_t j = 0; j < i && !found; j++) {
+				if (submissions[j].queue == wait.queue && submissions[j].signalValue >= wait.value) {
+					start = std::max(start, intervals[j].end);
+					found = true;
+				}
+			}
+
+			// waiting on work submitted later is legal on a GPU but would deadlock the replay
+			if (!found) {
+				throw std::logic_error("simulateQueueTimeline: wait on a value that was not submitted before");
+			}
+		}
+
+		intervals[i] = { start, start + durations[i] };
+		queueFree[static_cast<uint32_t>(submission.queue)] = intervals[i].end;
+	}
+
+	return intervals;
+}
+
+double queueOverlap(const std::vector<QueueSubmission>& submissions, const std::vector<QueueInterval>& intervals,
+	QueueType a, QueueType b) {
+	double overlap = 0.0;
+
+	// intervals on the same queue never overlap each other, so pairwise intersections add up
+	for (size_t i = 0; i < submissions.size(); i++) {
+		if (submissions[i].queue != a) {
+			continue;
+		}
+
+		for (size_t j = 0; j < submissions.size(); j++) {
+			if (submissions[j].queue != b) {
+				continue;
+			}
+
+			double start = std::max(intervals[i].start, intervals[j].start);
+			double end = std::min(intervals[i].end, intervals[j].end);
+			overlap += std::max(0.0, end - start);
+		}
+	}
+
+	return overlap;
+}
+
+AsyncBuildSimulation simulateAsyncBuilds(uint32_t numFrames, uint32_t numSlots, double buildTime, double traceTime) {
+	AsyncBuildScheduler scheduler(numSlots);
+	std::vector<QueueSubmission> submissions;
+	std::vector<double> durations;
+	uint64_t computeValue = 0;
+	uint64_t directValue = 0;
+
+	// same submission order as the renderer: the frame's build, then its trace
+	for (uint64_t frame = 0; frame < numFrames; frame++) {
+		submissions.push_back(scheduler.planBuild(frame, ++computeValue));
+		durations.push_back(buildTime);
+
+		submissions.push_back(scheduler.planTrace(frame, ++directValue));
+		durations.push_back(traceTime);
+	}
+
+	std::vector<QueueInterval> intervals = simulateQueueTimeline(submissions, durations);
+
+	AsyncBuildSimulation simulation;
+	simulation.serialTime = numFrames * (buildTime + traceTime);
+	simulation.asyncTime = 0.0;
+	for (const QueueInterval& interval : intervals) {
+		simulation.asyncTime = std::max(simulation.asyncTime, interval.end);
+	}
+	simulation.overlapTime = queueOverlap(submissions, intervals, QueueType::Compute, QueueType::Direct);
+
+	return simulation;
+}
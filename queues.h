@@ -0,0 +1,104 @@
+#pragma once
+
+// Backend-agnostic description of work spread over several GPU queues, plus a small
+// timeline simulator to check how submissions overlap. The D3D12 side only turns a
+// QueueSubmission into Wait / ExecuteCommandLists / Signal calls.
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum class QueueType : uint8_t {
+	Direct = 0,
+	Compute = 1
+};
+
+const uint32_t kNumQueueTypes = 2;
+
+// GPU-side wait for another queue's fence to reach a value
+struct QueueWait {
+	QueueType queue;
+	uint64_t value;
+};
+
+// One batch of work on a queue. It starts after all waits are satisfied and signals
+// signalValue on its own queue's fence when done.
+struct QueueSubmission {
+	QueueType queue = QueueType::Direct;
+	std::vector<QueueWait> waits;
+	uint64_t signalValue = 0;
+};
+
+// Plans acceleration structure builds on the compute queue next to the ray tracing on
+// the direct queue. Every frame builds its TLAS into one of numSlots slots:
+//  - the build of frame n waits until the direct queue is done reading that slot,
+//    which was last traced by frame n - numSlots
+//  - the ray tracing of frame n waits for the build of frame n
+// so the build of frame n + 1 only depends on the trace of frame n + 1 - numSlots and
+// can run while frame n is being ray traced.
+class AsyncBuildScheduler {
+public:
+	explicit AsyncBuildScheduler(uint32_t numSlots);
+
+	uint32_t numSlots() const { return static_cast<uint32_t>(m_slotTraceValues.size()); }
+	uint32_t slot(uint64_t frameIndex) const { return static_cast<uint32_t>(frameIndex % numSlots()); }
+
+	// computeSignalValue is the compute fence value the build will signal
+	QueueSubmission planBuild(uint64_t frameIndex, uint64_t computeSignalValue);
+
+	// directSignalValue is the direct fence value signalled once the frame is traced
+	QueueSubmission planTrace(uint64_t frameIndex, uint64_t directSignalValue);
+
+private:
+	std::vector<uint64_t> m_slotTraceValues; // direct fence value of the last trace reading each slot
+	std::vector<uint64_t> m_slotBuildValues; // compute fence value of the last build into each slot
+};
+
+// CPU work waiting for fence values on one or more queues, e.g. completion callbacks, or
+// deferred releases which are callbacks holding the last reference to an object.
+class CompletionQueue {
+public:
+	// callback runs once every wait is satisfied, an empty list means at the next run()
+	void enqueue(std::vector<QueueWait> waits, std::function<void()> callback);
+
+	// Removes and returns, in enqueue order, every callback whose waits are satisfied by the
+	// completed values (indexed by QueueType), so they can be run outside of any lock
+	std::vector<std::function<void()>> takeReady(const uint64_t (&completedValues)[kNumQueueTypes]);
+
+	// takeReady() and runs them, returns how many ran. Callbacks may enqueue more work,
+	// which is left for the next run().
+	size_t run(const uint64_t (&completedValues)[kNumQueueTypes]);
+
+	size_t pending() const { return m_entries.size(); }
+
+private:
+	struct Entry {
+		std::vector<QueueWait> waits;
+		std::function<void()> callback;
+	};
+
+	std::vector<Entry> m_entries;
+};
+
+struct QueueInterval {
+	double start;
+	double end;
+};
+
+// Replays submissions, given in CPU submission order, assuming the CPU is never the
+// bottleneck: each queue runs its submissions in order and a submission starts once its
+// queue is idle and everything it waits for has completed.
+std::vector<QueueInterval>
+simulateQueueTimeline(const std::vector<QueueSubmission>& submissions, const std::vector<double>& durations);
+
+// Time during which both queues are busy at once
+double queueOverlap(const std::vector<QueueSubmission>& submissions, const std::vector<QueueInterval>& intervals,
+	QueueType a, QueueType b);
+
+struct AsyncBuildSimulation {
+	double serialTime; // builds and traces back to back on one queue
+	double asyncTime; // builds on the compute queue, traces on the direct queue
+	double overlapTime; // how long both queues were busy together
+};
+
+AsyncBuildSimulation simulateAsyncBuilds(uint32_t numFrames, uint32_t numSlots, double buildTime, double traceTime);
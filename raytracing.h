@@ -15,6 +15,11 @@
 #include <vector>
 
 #include "vertex.h"
+#include "transient.h"
+#include "hitgroups.h"
+#include "jobs.h"
+#include "rootsignatures.h"
+#include "shaders.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -24,15 +29,52 @@ struct AccelerationStructureBuffers {
 	ComPtr<ID3D12Resource> pInstanceDesc;
 };
 
+// Vertices and 32-bit indices of one geometry of a BLAS, its hit records point the hit shaders
+// at both
+struct RaytracingGeometry {
+	ComPtr<ID3D12Resource> vertexBuffer;
+	uint32_t vertexCount;
+	ComPtr<ID3D12Resource> indexBuffer;
+	uint32_t indexCount;
+};
+
+// Geometries built into one BLAS, GeometryIndex() in the hit shaders is the position in geometries
+struct RaytracingMesh {
+	std::vector<RaytracingGeometry> geometries;
+	AccelerationStructureBuffers bottomLevelBuffers;
+};
+
+struct RaytracingInstance {
+	uint32_t mesh;
+	DirectX::XMMATRIX transform;
+};
+
+// Rays traced per hit, the geometry multiplier of TraceRay in RayGen.hlsl
+const uint32_t kNumRayTypes = 1;
+
+// Records per instance per geometry, see hitgroups.h
+HitGroupTableLayout
+layoutSceneHitGroups(const std::vector<RaytracingMesh>& meshes, const std::vector<RaytracingInstance>& instances) {
+	std::vector<uint32_t> geometriesPerInstance;
+	geometriesPerInstance.reserve(instances.size());
+
+	for (const RaytracingInstance& instance : instances) {
+		geometriesPerInstance.push_back(static_cast<uint32_t>(meshes[instance.mesh].geometries.size()));
+	}
+
+	return layoutHitGroupTable(geometriesPerInstance, kNumRayTypes);
+}
+
 AccelerationStructureBuffers
 createBottomLevelAS(ComPtr<ID3D12Device5> &device, ComPtr<ID3D12GraphicsCommandList4> &commandList,
-	std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> &vertexBuffers) {
+	const std::vector<RaytracingGeometry> &geometries) {
 
 	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
 
-	// add all the vertex buffers
-	for (const auto& buffer : vertexBuffers) {
-		bottomLevelAS.AddVertexBuffer(buffer.first.Get(), 0, buffer.second, sizeof(Vertex), 0, 0);
+	// add all the geometries, in GeometryIndex() order
+	for (const RaytracingGeometry& geometry : geometries) {
+		bottomLevelAS.AddVertexBuffer(geometry.vertexBuffer.Get(), 0, geometry.vertexCount, sizeof(Vertex),
+			geometry.indexBuffer.Get(), 0, geometry.indexCount, nullptr, 0);
 	}
 
 	// AS build requires some scratch temp memory for the build 
@@ -58,13 +100,17 @@ createBottomLevelAS(ComPtr<ID3D12Device5> &device, ComPtr<ID3D12GraphicsCommandL
 	return buffers;
 }
 
+// Registers the instances and creates the TLAS buffers, nothing is built yet. The
+// generator keeps the instances so buildTopLevelAS can rebuild into the same buffers
+// every frame. Each instance starts at its own hit records.
 AccelerationStructureBuffers
-createTopLevelAS(ComPtr<ID3D12Device5> &device, ComPtr<ID3D12GraphicsCommandList4> &commandList,
-	nv_helpers_dx12::TopLevelASGenerator &topLevelASGenerator,
-	const std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> &instances) {
+allocateTopLevelAS(ComPtr<ID3D12Device5> &device, nv_helpers_dx12::TopLevelASGenerator &topLevelASGenerator,
+	const std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> &instances,
+	const HitGroupTableLayout &hitGroups) {
 	// Gather all the instances
 	for (int i = 0; i < instances.size(); i++) {
-		topLevelASGenerator.AddInstance(instances[i].first.Get(), instances[i].second, static_cast<UINT>(i), static_cast<UINT>(0));
+		topLevelASGenerator.AddInstance(instances[i].first.Get(), instances[i].second, static_cast<UINT>(i),
+			hitGroups.instanceContributions[i]);
 	}
 
 	UINT64 scratchSize, resultSize, instanceDescsSize;
@@ -84,92 +130,208 @@ createTopLevelAS(ComPtr<ID3D12Device5> &device, ComPtr<ID3D12GraphicsCommandList
 	buffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(device.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE, 
 		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
 
-	// Now build the TLAS 
-	topLevelASGenerator.Generate(commandList.Get(), buffers.pScratch.Get(), buffers.pResult.Get(), buffers.pInstanceDesc.Get());
-
 	return buffers;
 }
 
-// Create BLAS and TLAS
+// Records the TLAS build, works on direct and compute command lists. The instance descs are
+// written through a mapped upload buffer, so the GPU must be done with the previous build
+// into the same buffers.
+void
+buildTopLevelAS(ComPtr<ID3D12GraphicsCommandList4> &commandList, nv_helpers_dx12::TopLevelASGenerator &topLevelASGenerator,
+	AccelerationStructureBuffers &buffers) {
+	topLevelASGenerator.Generate(commandList.Get(), buffers.pScratch.Get(), buffers.pResult.Get(), buffers.pInstanceDesc.Get());
+}
+
+// Create a BLAS per mesh and one TLAS per slot. The TLAS is rebuilt every frame, with a slot per
+// frame in flight the build for the next frame never touches the one being ray traced.
 void
 createAccelerationStructures(ComPtr<ID3D12Device5>& device, ComPtr<ID3D12GraphicsCommandList4>& commandList,
-	ComPtr<ID3D12Resource>& vertexBuffer, nv_helpers_dx12::TopLevelASGenerator& topLevelASGenerator,
-	AccelerationStructureBuffers& bottomLevelBuffers, AccelerationStructureBuffers& topLevelBuffers) {
+	std::vector<RaytracingMesh>& meshes, const std::vector<RaytracingInstance>& sceneInstances,
+	const HitGroupTableLayout& hitGroups, uint32_t numSlots, nv_helpers_dx12::TopLevelASGenerator* topLevelASGenerators,
+	AccelerationStructureBuffers* topLevelBuffers) {
 
-	std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vertexBuffers = { {vertexBuffer.Get(), 3} };
+	for (RaytracingMesh& mesh : meshes) {
+		mesh.bottomLevelBuffers = createBottomLevelAS(device, commandList, mesh.geometries);
+	}
 
-	bottomLevelBuffers = createBottomLevelAS(device, commandList, vertexBuffers);
+	std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> instances;
 
-	std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> instances = { { bottomLevelBuffers.pResult, DirectX::XMMatrixIdentity() } };
+	for (const RaytracingInstance& instance : sceneInstances) {
+		instances.push_back({ meshes[instance.mesh].bottomLevelBuffers.pResult, instance.transform });
+	}
 
-	topLevelBuffers = createTopLevelAS(device, commandList, topLevelASGenerator, instances);
+	for (uint32_t slot = 0; slot < numSlots; slot++) {
+		topLevelBuffers[slot] = allocateTopLevelAS(device, topLevelASGenerators[slot], instances, hitGroups);
+		buildTopLevelAS(commandList, topLevelASGenerators[slot], topLevelBuffers[slot]);
+	}
 }
 
-ComPtr<ID3D12RootSignature> createRayGenSignature(ComPtr<ID3D12Device5>& device) {
-	nv_helpers_dx12::RootSignatureGenerator rootSignatureGenerator;
+// Root parameter type of a root descriptor or table range for a reflected binding
+D3D12_ROOT_PARAMETER_TYPE
+rootDescriptorType(const ShaderBinding& binding) {
+	switch (binding.type) {
+	case ShaderBindingType::ConstantBuffer:
+		return D3D12_ROOT_PARAMETER_TYPE_CBV;
+	case ShaderBindingType::RWTexture:
+	case ShaderBindingType::RWBuffer:
+		return D3D12_ROOT_PARAMETER_TYPE_UAV;
+	default:
+		return D3D12_ROOT_PARAMETER_TYPE_SRV;
+	}
+}
 
-	rootSignatureGenerator.AddHeapRangesParameter(
-		{ {0 /*u0*/, 
-		   1 /*1 descriptor */, 
-		   0 /*use the implicit register space 0*/, 
-		   D3D12_DESCRIPTOR_RANGE_TYPE_UAV /* UAV representing the output buffer*/, 
-		   0 /*heap slot where the UAV is defined*/}, 
-		  {0 /*t0*/, 
-		   1, 
-		   0, 
-		   D3D12_DESCRIPTOR_RANGE_TYPE_SRV /*Top-level acceleration structure*/, 
-		   1} }
-	);
-
-	return rootSignatureGenerator.Generate(device.Get(), true);
+D3D12_DESCRIPTOR_RANGE_TYPE
+descriptorRangeType(const ShaderBinding& binding) {
+	switch (binding.type) {
+	case ShaderBindingType::ConstantBuffer:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	case ShaderBindingType::RWTexture:
+	case ShaderBindingType::RWBuffer:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+	case ShaderBindingType::Sampler:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+	default:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	}
 }
 
-ComPtr<ID3D12RootSignature> createHitSignature(ComPtr<ID3D12Device5>& device) {
+// The local root signature of a layout planned from reflection, its parameters in the order
+// of the root arguments
+nv_helpers_dx12::RootSignatureGenerator
+localRootSignatureDesc(const LocalRootLayout& layout) {
 	nv_helpers_dx12::RootSignatureGenerator rootSignatureGenerator;
 
-	rootSignatureGenerator.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV);
+	for (const LocalRootParameter& parameter : layout.parameters) {
+		const ShaderBinding& binding = parameter.binding;
+
+		switch (parameter.kind) {
+		case nv_helpers_dx12::RootParameterKind::Constants:
+			rootSignatureGenerator.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS,
+				binding.bindPoint, binding.space, parameter.num32BitValues);
+			break;
+		case nv_helpers_dx12::RootParameterKind::Descriptor:
+			rootSignatureGenerator.AddRootParameter(rootDescriptorType(binding), binding.bindPoint, binding.space);
+			break;
+		default: {
+			std::vector<D3D12_DESCRIPTOR_RANGE> ranges;
+
+			for (const ShaderBinding& range : parameter.ranges) {
+				// a count of 0 is an unbounded array
+				ranges.push_back({ descriptorRangeType(range), range.bindCount == 0 ? UINT_MAX : range.bindCount,
+					range.bindPoint, range.space, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND });
+			}
+
+			rootSignatureGenerator.AddHeapRangesParameter(ranges);
+			break;
+		}
+		}
+	}
 
-	return rootSignatureGenerator.Generate(device.Get(), true);
+	return rootSignatureGenerator;
 }
 
-ComPtr<ID3D12RootSignature> createMissSignature(ComPtr<ID3D12Device5>& device) {
-	nv_helpers_dx12::RootSignatureGenerator rootSignatureGenerator;
+// Layouts of the local root arguments of each kind of record, planned from what the compiled
+// shaders bind. Records carry nothing a shader doesn't read, a variant compiling a resource out
+// gets smaller records.
+struct RaytracingLayouts {
+	LocalRootLayout rayGen;
+	LocalRootLayout miss;
+	LocalRootLayout hitGroup;
+};
+
+// The exports of the ray tracing pipeline, interned once so neither the pipeline nor the SBT
+// deal with names after startup
+struct RaytracingSymbols {
+	nv_helpers_dx12::ShaderSymbol rayGen;
+	nv_helpers_dx12::ShaderSymbol miss;
+	nv_helpers_dx12::ShaderSymbol closestHit;
+	nv_helpers_dx12::ShaderSymbol anyHit;
+	nv_helpers_dx12::ShaderSymbol hitGroup;
+};
 
-	return rootSignatureGenerator.Generate(device.Get(), true);
+RaytracingSymbols
+internRaytracingSymbols(nv_helpers_dx12::ShaderSymbolTable& symbols) {
+	RaytracingSymbols result;
+
+	result.rayGen = symbols.Intern(L"RayGen");
+	result.miss = symbols.Intern(L"Miss");
+	result.closestHit = symbols.Intern(L"ClosestHit");
+	result.anyHit = symbols.Intern(L"AnyHit");
+	result.hitGroup = symbols.Intern(L"HitGroup");
+
+	return result;
 }
 
+// The record layouts of the libraries' exports, from the bindings of their ShaderCompileJobs. The
+// closest hit and any hit shaders share the records of their hit group, which holds what either
+// of them reads.
+RaytracingLayouts
+planRaytracingLayouts(const nv_helpers_dx12::ShaderSymbolTable& symbolTable, const RaytracingSymbols& symbols,
+	const std::vector<ExportBindings>& rayGenLibrary, const std::vector<ExportBindings>& hitLibrary,
+	const std::vector<ExportBindings>& missLibrary, bool alphaTest) {
+	RaytracingLayouts layouts;
+
+	layouts.rayGen = planLocalRootLayout(findExportBindings(rayGenLibrary, symbolTable.Name(symbols.rayGen)));
+	layouts.miss = planLocalRootLayout(findExportBindings(missLibrary, symbolTable.Name(symbols.miss)));
+
+	std::vector<ShaderBinding> hitBindings = findExportBindings(hitLibrary, symbolTable.Name(symbols.closestHit));
+	if (alphaTest) {
+		hitBindings = mergeShaderBindings(hitBindings, findExportBindings(hitLibrary, symbolTable.Name(symbols.anyHit)));
+	}
+	layouts.hitGroup = planLocalRootLayout(hitBindings);
+
+	return layouts;
+}
+
+// Also fills identifiers with the shader identifiers of the new pipeline, the SBT is
+// generated from those. The local root signatures are made from layouts, see
+// planRaytracingLayouts, the SBT has to be laid out after the same ones.
 ComPtr<ID3D12StateObject>
 createRaytracingPipelineState(ComPtr<ID3D12Device5>& device, 
+	RootSignatureCache& rootSignatures,
+	nv_helpers_dx12::ShaderSymbolTable& symbolTable,
+	const RaytracingSymbols& symbols,
+	nv_helpers_dx12::ShaderIdentifierCache& identifiers,
 	ComPtr<IDxcBlob> &rayGenLibrary,
 	ComPtr<IDxcBlob> &hitLibrary,
 	ComPtr<IDxcBlob> &missLibrary,
 	ComPtr<ID3D12RootSignature> &rayGenSignature,
 	ComPtr<ID3D12RootSignature> &hitSignature,
 	ComPtr<ID3D12RootSignature> &missSignature,
-	ComPtr<ID3D12StateObjectProperties> &raytracingStateObjectProperties
+	ComPtr<ID3D12StateObjectProperties> &raytracingStateObjectProperties,
+	const RaytracingLayouts& layouts,
+	bool alphaTest
 	) {
-	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get());
-
-	// Compile shaders
-	rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(L"shaders/RayGen.hlsl");
-	hitLibrary = nv_helpers_dx12::CompileShaderLibrary(L"shaders/Hit.hlsl");
-	missLibrary = nv_helpers_dx12::CompileShaderLibrary(L"shaders/Miss.hlsl");
+	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(device.Get(), symbolTable);
+
+	// the libraries are compiled up front, together with the raster shaders
+	pipeline.AddLibrary(rayGenLibrary.Get(), { symbols.rayGen });
+	pipeline.AddLibrary(missLibrary.Get(), { symbols.miss });
+	// only the alpha tested Hit variant has an any-hit shader
+	if (alphaTest) {
+		pipeline.AddLibrary(hitLibrary.Get(), { symbols.closestHit, symbols.anyHit });
+	}
+	else {
+		pipeline.AddLibrary(hitLibrary.Get(), { symbols.closestHit });
+	}
 
-	pipeline.AddLibrary(rayGenLibrary.Get(), { L"RayGen" });
-	pipeline.AddLibrary(missLibrary.Get(), { L"Miss" });
-	pipeline.AddLibrary(hitLibrary.Get(), { L"ClosestHit" });
+	// Create root signatures from what the shaders bind, they come from the cache so a pipeline
+	// rebuilt after a shader reload gets the same objects back as long as the bindings didn't change
+	nv_helpers_dx12::RootSignatureGenerator rayGenSignatureGenerator = localRootSignatureDesc(layouts.rayGen);
+	nv_helpers_dx12::RootSignatureGenerator hitSignatureGenerator = localRootSignatureDesc(layouts.hitGroup);
+	nv_helpers_dx12::RootSignatureGenerator missSignatureGenerator = localRootSignatureDesc(layouts.miss);
 
-	// Create root signatures 
-	rayGenSignature = createRayGenSignature(device);
-	hitSignature = createHitSignature(device);
-	missSignature = createMissSignature(device);
+	rayGenSignature = rootSignatures.get(rayGenSignatureGenerator, true);
+	hitSignature = rootSignatures.get(hitSignatureGenerator, true);
+	missSignature = rootSignatures.get(missSignatureGenerator, true);
 	
 	// Associate the shader code with the root signatures 
-	pipeline.AddHitGroup(L"HitGroup", L"ClosestHit");
+	pipeline.AddHitGroup(symbols.hitGroup, symbols.closestHit,
+		alphaTest ? symbols.anyHit : nv_helpers_dx12::kNoShaderSymbol);
 
-	pipeline.AddRootSignatureAssociation(rayGenSignature.Get(), { L"RayGen" });
-	pipeline.AddRootSignatureAssociation(missSignature.Get(), { L"Miss" });
-	pipeline.AddRootSignatureAssociation(hitSignature.Get(), { L"HitGroup" });
+	pipeline.AddRootSignatureAssociation(rayGenSignature.Get(), { symbols.rayGen });
+	pipeline.AddRootSignatureAssociation(missSignature.Get(), { symbols.miss });
+	pipeline.AddRootSignatureAssociation(hitSignature.Get(), { symbols.hitGroup });
 
 	pipeline.SetMaxPayloadSize(4 * sizeof(float)); // RGB + distance
 
@@ -177,15 +339,30 @@ createRaytracingPipelineState(ComPtr<ID3D12Device5>& device,
 
 	pipeline.SetMaxRecursionDepth(1);
 
+	// only RayGen traces rays, so the stack never holds more than one hit or miss shader on top
+	// of it while the runtime default assumes they recurse
+	pipeline.SetShaderStage(symbols.rayGen, nv_helpers_dx12::ShaderStage::RayGeneration, true);
+	pipeline.SetShaderStage(symbols.miss, nv_helpers_dx12::ShaderStage::Miss);
+
 	ComPtr<ID3D12StateObject> raytracingPipelineState = pipeline.Generate();
 
 	throwIfFailed(raytracingPipelineState->QueryInterface(IID_PPV_ARGS(&raytracingStateObjectProperties)));
 
+	pipeline.SetPipelineStackSize(raytracingStateObjectProperties.Get());
+
+	identifiers.Fill(raytracingStateObjectProperties.Get(), symbolTable);
+
 	return raytracingPipelineState;
 }
 
-ComPtr<ID3D12Resource>
-createRaytracingOutputBuffer(ComPtr<ID3D12Device5>& device, uint32_t width, uint32_t height) {
+// passes of a ray traced frame, the transient resources are given lifetimes in these
+enum RaytracingPass : uint32_t {
+	kRaytracingPassDispatch = 0, // DispatchRays writes the output buffer
+	kRaytracingPassCopy = 1 // output buffer gets copied into the back buffer
+};
+
+D3D12_RESOURCE_DESC
+raytracingOutputBufferDesc(uint32_t width, uint32_t height) {
 	D3D12_RESOURCE_DESC desc = {};
 
 	desc.DepthOrArraySize = 1;
@@ -198,71 +375,203 @@ createRaytracingOutputBuffer(ComPtr<ID3D12Device5>& device, uint32_t width, uint
 	desc.MipLevels = 1;
 	desc.SampleDesc.Count = 1;
 
-	ComPtr<ID3D12Resource> outputBuffer;
+	return desc;
+}
 
-	throwIfFailed(device->CreateCommittedResource(&nv_helpers_dx12::kDefaultHeapProps,
-		D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_SOURCE, 
-		nullptr, IID_PPV_ARGS(&outputBuffer)));
+// Registers the output buffer with the transient pool, it only has to live from the
+// dispatch to the copy so it can share memory with other per-frame targets
+uint32_t
+addRaytracingOutputBuffer(TransientResourcePool& transientResources, uint32_t width, uint32_t height) {
+	return transientResources.addResource("RaytracingOutput", raytracingOutputBufferDesc(width, height),
+		D3D12_RESOURCE_STATE_COPY_SOURCE, kRaytracingPassDispatch, kRaytracingPassCopy);
+}
+
+// (Re)writes the output buffer UAV of one slot's descriptor table, the GPU must not be using
+// that slot anymore
+void
+writeRaytracingOutputDescriptor(ComPtr<ID3D12Device5>& device, ComPtr<ID3D12DescriptorHeap>& descriptorHeap,
+	uint32_t slot, ComPtr<ID3D12Resource> outputBuffer) {
+	D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	uavHandle.ptr += 2 * slot * device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	return outputBuffer;
+	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+
+	device->CreateUnorderedAccessView(outputBuffer.Get(), nullptr, &uavDesc, uavHandle);
 }
 
+// The ray generation descriptor table is [output UAV, TLAS SRV], repeated once per TLAS
+// slot so every frame can point the ray generation shader at its own TLAS
 ComPtr<ID3D12DescriptorHeap>
 createShaderResourceHeap(ComPtr<ID3D12Device5>& device, ComPtr<ID3D12Resource> outputBuffer, 
-	AccelerationStructureBuffers &topLevelASBuffers) {
+	uint32_t numSlots, AccelerationStructureBuffers* topLevelASBuffers) {
 	// Create the SRV/UAV/CBV descriptor heap 
-	// We need 2 entries, one for the output buffer UAV, one SRV for the TLAS
+	// We need 2 entries per slot, one for the output buffer UAV, one SRV for the TLAS
 
 	ComPtr<ID3D12DescriptorHeap> descriptorHeap = nv_helpers_dx12::CreateDescriptorHeap(device.Get(),
-		2, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+		2 * numSlots, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
 
 	// Get a handle to the heap memory on CPU side so we can write to it 
 	D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	UINT increment = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	// Create the UAV. Based on root signature created earlier it is the first entry in the heap 
-	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+	for (uint32_t slot = 0; slot < numSlots; slot++) {
+		// Create the UAV. Based on root signature created earlier it is the first entry in the table 
+		writeRaytracingOutputDescriptor(device, descriptorHeap, slot, outputBuffer);
 
-	device->CreateUnorderedAccessView(outputBuffer.Get(), nullptr, &uavDesc, srvHandle);
+		// Now add the TLAS SRV after the output buffer next in the descriptor heap 
+		srvHandle.ptr += increment;
 
-	// Now add the TLAS SRV after the output buffer next in the descriptor heap 
-	srvHandle.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.RaytracingAccelerationStructure.Location = topLevelASBuffers[slot].pResult->GetGPUVirtualAddress();
 
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.RaytracingAccelerationStructure.Location = topLevelASBuffers.pResult->GetGPUVirtualAddress();
+		device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
 
-	device->CreateShaderResourceView(nullptr, &srvDesc, srvHandle);
+		srvHandle.ptr += increment;
+	}
 
 	return descriptorHeap;
 }
 
+// DWORDs, indirections and root argument bytes of each local root signature, next to what
+// the records planned with it hold
+std::string
+formatRaytracingSignatureCosts(const RaytracingLayouts& layouts) {
+	return formatRootSignatureCost("RayGen", localRootSignatureDesc(layouts.rayGen).ComputeCost(), layouts.rayGen.argumentsSize) +
+		formatRootSignatureCost("Miss", localRootSignatureDesc(layouts.miss).ComputeCost(), layouts.miss.argumentsSize) +
+		formatRootSignatureCost("HitGroup", localRootSignatureDesc(layouts.hitGroup).ComputeCost(), layouts.hitGroup.argumentsSize);
+}
+
+std::logic_error
+unexpectedBinding(const char* record, const ShaderBinding& binding) {
+	return std::logic_error(std::string(record) + " shader binds " + formatShaderBinding(binding) +
+		", which has no root argument");
+}
+
+// Root arguments of the ray generation record of one slot: the output UAV is at the start of the
+// slot's descriptor table, the TLAS is bound directly
+void
+writeRayGenArguments(const RaytracingLayouts& layouts, uint8_t* arguments,
+	D3D12_GPU_DESCRIPTOR_HANDLE table, D3D12_GPU_VIRTUAL_ADDRESS topLevelAS) {
+	writeLocalRootArguments(layouts.rayGen, arguments, [&](const LocalRootParameter& parameter, uint8_t* destination) {
+		const ShaderBinding& binding = parameter.binding;
+
+		if (parameter.kind == nv_helpers_dx12::RootParameterKind::DescriptorTable &&
+			binding.type == ShaderBindingType::RWTexture && binding.bindPoint == 0) {
+			memcpy(destination, &table, sizeof(table));
+		}
+		else if (parameter.kind == nv_helpers_dx12::RootParameterKind::Descriptor &&
+			binding.type == ShaderBindingType::AccelerationStructure && binding.bindPoint == 0) {
+			memcpy(destination, &topLevelAS, sizeof(topLevelAS));
+		}
+		else {
+			throw unexpectedBinding("RayGen", binding);
+		}
+	});
+}
+
+// Root arguments of the hit record of one geometry, t0 its vertices and t1 its indices
+void
+writeHitArguments(const RaytracingLayouts& layouts, uint8_t* arguments, const RaytracingGeometry& geometry) {
+	writeLocalRootArguments(layouts.hitGroup, arguments, [&](const LocalRootParameter& parameter, uint8_t* destination) {
+		const ShaderBinding& binding = parameter.binding;
+		D3D12_GPU_VIRTUAL_ADDRESS address = 0;
+
+		if (parameter.kind == nv_helpers_dx12::RootParameterKind::Descriptor &&
+			binding.type == ShaderBindingType::Buffer && binding.bindPoint == 0) {
+			address = geometry.vertexBuffer->GetGPUVirtualAddress();
+		}
+		else if (parameter.kind == nv_helpers_dx12::RootParameterKind::Descriptor &&
+			binding.type == ShaderBindingType::Buffer && binding.bindPoint == 1) {
+			address = geometry.indexBuffer->GetGPUVirtualAddress();
+		}
+		else {
+			throw unexpectedBinding("Hit", binding);
+		}
+
+		memcpy(destination, &address, sizeof(address));
+	});
+}
+
+// One ray generation record per TLAS slot, each with its own descriptor table. The dispatch
+// picks the record of its slot, ray generation records are aligned so every one of them is a
+// valid start.
+//
+// The buffer holds one copy of the SBT per slot, copySize apart, and stays mapped at sbtData.
+// A frame only reads the copy of its slot, so records changed with the generator's Set*()
+// calls can be patched into a copy with Update() once the frame that used it last is done,
+// while the other copies are still in flight.
+//
+// The hit groups hold a record per ray type per geometry of every instance, laid out as in
+// hitGroups. The table is sized once and filled by the job system in record ranges.
+//
+// Every record holds the root arguments of its layout and nothing else, so the sections are as
+// narrow as what the shaders read allows.
 ComPtr<ID3D12Resource>
-createShaderBindingTable(ComPtr<ID3D12Device5>& device, 
+createShaderBindingTable(ComPtr<ID3D12Device5>& device, JobSystem& jobs,
 	nv_helpers_dx12::ShaderBindingTableGenerator &sbtGenerator, ComPtr<ID3D12DescriptorHeap> &srvUavHeap,
-	ComPtr<ID3D12Resource> &vertexBuffer,
-	ComPtr<ID3D12StateObjectProperties> &raytracingStateObjectProperties) {
+	uint32_t numSlots, AccelerationStructureBuffers* topLevelASBuffers,
+	const std::vector<RaytracingMesh>& meshes, const std::vector<RaytracingInstance>& instances,
+	const HitGroupTableLayout& hitGroups, const RaytracingLayouts& layouts,
+	const RaytracingSymbols& symbols, const nv_helpers_dx12::ShaderIdentifierCache& identifiers,
+	uint8_t*& sbtData, uint32_t& copySize) {
 	
 	sbtGenerator.Reset();
 
 	D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle = srvUavHeap->GetGPUDescriptorHandleForHeapStart();
-	UINT64* heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
+	UINT increment = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	sbtGenerator.AddRayGenerationProgram(L"RayGen", { heapPointer });
-	sbtGenerator.AddMissProgram(L"Miss", {});
-	sbtGenerator.AddMissProgram(L"Miss", {}); // hack because miss section size is only 32 but it needs to be padded to 64 
-	sbtGenerator.AddHitGroup(L"HitGroup", { (void*) (vertexBuffer->GetGPUVirtualAddress())});
+	std::vector<uint8_t> arguments(layouts.rayGen.argumentsSize);
 
-	// Create the SBT on the upload heap
-	uint32_t sbtSize = sbtGenerator.ComputeSBTSize();
+	for (uint32_t slot = 0; slot < numSlots; slot++) {
+		D3D12_GPU_DESCRIPTOR_HANDLE table = { srvUavHeapHandle.ptr + 2 * slot * increment };
+		writeRayGenArguments(layouts, arguments.data(), table, topLevelASBuffers[slot].pResult->GetGPUVirtualAddress());
+		sbtGenerator.AddRayGenerationProgram(symbols.rayGen, arguments.data(), layouts.rayGen.argumentsSize);
+	}
+
+	// Miss reads nothing but its payload today, a binding it gains has no value to be given
+	if (!layouts.miss.parameters.empty()) {
+		throw unexpectedBinding("Miss", layouts.miss.parameters.front().binding);
+	}
 
-	ComPtr<ID3D12Resource> sbtStorage = nv_helpers_dx12::CreateBuffer(device.Get(), sbtSize,
+	sbtGenerator.AddMissProgram(symbols.miss, nullptr, 0);
+
+	uint32_t firstHitGroup = sbtGenerator.ReserveHitGroups(hitGroups.numRecords, layouts.hitGroup.argumentsSize);
+
+	// every record is a binary search and two copies, small chunks would cost more to hand out
+	const size_t kHitRecordGrainSize = 4096;
+
+	jobs.parallelFor(hitGroups.numRecords, kHitRecordGrainSize, [&](size_t begin, size_t end) {
+		std::vector<uint8_t> hitArguments(layouts.hitGroup.argumentsSize);
+
+		for (size_t record = begin; record < end; record++) {
+			HitGroupRecord hit = locateHitGroupRecord(hitGroups, static_cast<uint32_t>(record));
+			const RaytracingGeometry& geometry = meshes[instances[hit.instance].mesh].geometries[hit.geometry];
+
+			writeHitArguments(layouts, hitArguments.data(), geometry);
+			sbtGenerator.FillHitGroup(firstHitGroup + static_cast<uint32_t>(record), symbols.hitGroup,
+				hitArguments.data(), layouts.hitGroup.argumentsSize);
+		}
+	});
+
+	// Create the SBT on the upload heap, each section starts aligned and so does every copy
+	copySize = sbtGenerator.ComputeSBTSize();
+
+	ComPtr<ID3D12Resource> sbtStorage = nv_helpers_dx12::CreateBuffer(device.Get(), copySize * numSlots,
 		D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ,
 		nv_helpers_dx12::kUploadHeapProps);
 
-	sbtGenerator.Generate(sbtStorage.Get(), raytracingStateObjectProperties.Get());
+	// the CPU never reads it back
+	D3D12_RANGE readRange = { 0, 0 };
+	throwIfFailed(sbtStorage->Map(0, &readRange, reinterpret_cast<void**>(&sbtData)));
+
+	// nothing reads the new buffer yet, all copies get written right away
+	for (uint32_t slot = 0; slot < numSlots; slot++) {
+		sbtGenerator.Update(sbtData + slot * copySize, identifiers, slot);
+	}
 
 	return sbtStorage;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "recorder.h"
+
+#include <algorithm>
+
+#include "helpers.h"
+
+void CommandAllocatorPool::init(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type) {
+	m_device = device;
+	m_type = type;
+}
+
+ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::acquire(uint64_t completedFence) {
+	if (!m_retired.empty() && m_retired.front().first <= completedFence) {
+		ComPtr<ID3D12CommandAllocator> allocator = m_retired.front().second;
+		m_retired.pop_front();
+
+		throwIfFailed(allocator->Reset());
+
+		return allocator;
+	}
+
+	// nothing the GPU is done with yet, grow the pool
+	ComPtr<ID3D12CommandAllocator> allocator;
+	throwIfFailed(m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&allocator)));
+	m_allocated++;
+
+	return allocator;
+}
+
+void CommandAllocatorPool::release(ComPtr<ID3D12CommandAllocator> allocator, uint64_t fenceValue) {
+	m_retired.push_back({ fenceValue, allocator });
+}
+
+void CommandRecorder::init(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type, JobSystem& jobs) {
+	m_device = device;
+	m_type = type;
+	m_jobs = &jobs;
+}
+
+void CommandRecorder::shutdown() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_freeContexts.clear();
+	m_contexts.clear();
+}
+
+std::vector<ID3D12CommandList*>
+CommandRecorder::record(const std::vector<RecordJob>& jobs, uint64_t completedFence) {
+	std::vector<ID3D12CommandList*> results(jobs.size(), nullptr);
+
+	// jobs are picked in order, but which thread gets which one doesn't matter since
+	// the results are stored by job index
+	m_jobs->parallelFor(jobs.size(), 1, [&](size_t begin, size_t end) {
+		Context* context = acquireContext();
+
+		try {
+			for (size_t job = begin; job < end; job++) {
+				ID3D12GraphicsCommandList4* commandList = nextCommandList(*context, completedFence);
+
+				jobs[job](commandList);
+
+				throwIfFailed(commandList->Close());
+
+				results[job] = commandList;
+			}
+		}
+		catch (...) {
+			releaseContext(context);
+			throw;
+		}
+
+		releaseContext(context);
+	});
+
+	return results;
+}
+
+void CommandRecorder::submitted(uint64_t fenceValue) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& context : m_contexts) {
+		if (context->frameAllocator) {
+			context->allocators.release(context->frameAllocator, fenceValue);
+			context->frameAllocator.Reset();
+		}
+
+		context->usedCommandLists = 0;
+	}
+}
+
+CommandRecorder::Context* CommandRecorder::acquireContext() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_freeContexts.empty()) {
+		Context* context = m_freeContexts.back();
+		m_freeContexts.pop_back();
+
+		return context;
+	}
+
+	// more jobs recording at once than ever before, only happens in the first frames
+	m_contexts.push_back(std::make_unique<Context>());
+	m_contexts.back()->allocators.init(m_device, m_type);
+
+	return m_contexts.back().get();
+}
+
+void CommandRecorder::releaseContext(Context* context) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_freeContexts.push_back(context);
+}
+
+ID3D12GraphicsCommandList4* CommandRecorder::nextCommandList(Context& context, uint64_t completedFence) {
+	// one allocator per context and frame is enough, a context records its lists one after the other
+	if (!context.frameAllocator) {
+		context.frameAllocator = context.allocators.acquire(completedFence);
+	}
+
+	if (context.usedCommandLists < context.commandLists.size()) {
+		ID3D12GraphicsCommandList4* commandList = context.commandLists[context.usedCommandLists++].Get();
+		throwIfFailed(commandList->Reset(context.frameAllocator.Get(), nullptr));
+
+		return commandList;
+	}
+
+	ComPtr<ID3D12GraphicsCommandList4> commandList;
+	throwIfFailed(m_device->CreateCommandList(0, m_type, context.frameAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+
+	context.commandLists.push_back(commandList);
+	context.usedCommandLists++;
+
+	return commandList.Get();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "jobs.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Command allocators owned by one recording context. An allocator handed out for a frame
+// goes back into the pool with the fence value of the submission that used it, and is
+// only reset and reused once that fence has completed.
+class CommandAllocatorPool {
+public:
+	void init(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type);
+
+	ComPtr<ID3D12CommandAllocator> acquire(uint64_t completedFence);
+	void release(ComPtr<ID3D12CommandAllocator> allocator, uint64_t fenceValue);
+
+	size_t size() const { return m_allocated; }
+
+private:
+	ComPtr<ID3D12Device5> m_device;
+	D3D12_COMMAND_LIST_TYPE m_type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+	std::deque<std::pair<uint64_t, ComPtr<ID3D12CommandAllocator>>> m_retired; // in fence order
+	size_t m_allocated = 0;
+};
+
+typedef std::function<void(ID3D12GraphicsCommandList4*)> RecordJob;
+
+// Records a frame's jobs (AS builds, draws, dispatches, ...) in parallel on the job system.
+// Every job gets a command list of its own, and record() returns the lists in job order,
+// whichever thread recorded them, so the submission order is the same every frame.
+class CommandRecorder {
+public:
+	void init(ComPtr<ID3D12Device5> device, D3D12_COMMAND_LIST_TYPE type, JobSystem& jobs);
+	void shutdown();
+
+	// Blocks until all jobs are recorded and closed. completedFence is the last completed
+	// value of the fence the submission will signal, used to recycle allocators.
+	std::vector<ID3D12CommandList*> record(const std::vector<RecordJob>& jobs, uint64_t completedFence);
+
+	// Hands the allocators used by the last record() back, they are free again once fenceValue completes
+	void submitted(uint64_t fenceValue);
+
+	// recording contexts created so far, at most one per thread that took part in a record()
+	uint32_t numContexts() const { return static_cast<uint32_t>(m_contexts.size()); }
+
+private:
+	// What one thread records with. A job borrows a context for as long as it records, any
+	// thread of the job system may run it, so contexts aren't tied to threads.
+	struct Context {
+		CommandAllocatorPool allocators;
+		ComPtr<ID3D12CommandAllocator> frameAllocator; // the one in use for the current frame
+		std::vector<ComPtr<ID3D12GraphicsCommandList4>> commandLists;
+		size_t usedCommandLists = 0;
+	};
+
+	Context* acquireContext();
+	void releaseContext(Context* context);
+	ID3D12GraphicsCommandList4* nextCommandList(Context& context, uint64_t completedFence);
+
+	ComPtr<ID3D12Device5> m_device;
+	D3D12_COMMAND_LIST_TYPE m_type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+	JobSystem* m_jobs = nullptr;
+
+	std::mutex m_mutex; // guards the two below
+	std::vector<std::unique_ptr<Context>> m_contexts;
+	std::vector<Context*> m_freeContexts;
+};
@@ -0,0 +1,101 @@
+#include "residency.h"
+
+#include <algorithm>
+
+ResidencyHandle ResidencySet::add(uint64_t sizeInBytes, ResidencyKind kind, bool evictable) {
+	ResidencyHandle handle;
+
+	if (!m_freeHandles.empty()) {
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else {
+		handle = static_cast<ResidencyHandle>(m_objects.size());
+		m_objects.emplace_back();
+	}
+
+	Object& object = m_objects[handle];
+	object.sizeInBytes = sizeInBytes;
+	object.lastUsedFence = 0;
+	object.kind = kind;
+	object.evictable = evictable;
+	object.resident = true; // freshly created objects are resident
+	object.alive = true;
+
+	m_residentSize += sizeInBytes;
+
+	return handle;
+}
+
+void ResidencySet::remove(ResidencyHandle handle) {
+	Object& object = m_objects[handle];
+
+	if (object.resident) {
+		m_residentSize -= object.sizeInBytes;
+	}
+
+	object = {};
+	m_freeHandles.push_back(handle);
+}
+
+void ResidencySet::markUsed(ResidencyHandle handle, uint64_t fenceValue) {
+	Object& object = m_objects[handle];
+	object.lastUsedFence = std::max(object.lastUsedFence, fenceValue);
+}
+
+std::vector<ResidencyHandle>
+ResidencySet::makeResident(const std::vector<ResidencyHandle>& used, uint64_t fenceValue) {
+	std::vector<ResidencyHandle> pageIn;
+
+	for (ResidencyHandle handle : used) {
+		Object& object = m_objects[handle];
+
+		if (!object.resident) {
+			object.resident = true;
+			m_residentSize += object.sizeInBytes;
+			pageIn.push_back(handle);
+		}
+
+		markUsed(handle, fenceValue);
+	}
+
+	return pageIn;
+}
+
+std::vector<ResidencyHandle>
+ResidencySet::evictToBudget(uint64_t completedFence, uint64_t incomingBytes) {
+	std::vector<ResidencyHandle> victims;
+
+	if (m_residentSize + incomingBytes <= m_budget) {
+		return victims;
+	}
+
+	std::vector<ResidencyHandle> candidates;
+	for (ResidencyHandle handle = 0; handle < m_objects.size(); handle++) {
+		const Object& object = m_objects[handle];
+
+		if (object.alive && object.resident && object.evictable && object.lastUsedFence <= completedFence) {
+			candidates.push_back(handle);
+		}
+	}
+
+	// least recently used first, bigger objects first among equally old ones so we evict fewer
+	std::sort(candidates.begin(), candidates.end(), [&](ResidencyHandle a, ResidencyHandle b) {
+		if (m_objects[a].lastUsedFence != m_objects[b].lastUsedFence) {
+			return m_objects[a].lastUsedFence < m_objects[b].lastUsedFence;
+		}
+		return m_objects[a].sizeInBytes > m_objects[b].sizeInBytes;
+	});
+
+	for (ResidencyHandle handle : candidates) {
+		if (m_residentSize + incomingBytes <= m_budget) {
+			break;
+		}
+
+		m_objects[handle].resident = false;
+		m_residentSize -= m_objects[handle].sizeInBytes;
+		victims.push_back(handle);
+	}
+
+	return victims;
+}
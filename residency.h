@@ -0,0 +1,59 @@
+#pragma once
+
+// Bookkeeping for GPU memory residency: which objects are resident, how big they are
+// and the fence value of the last submission that used them. Pure CPU so the eviction
+// policy can be driven with an injected budget, residencymanager.h does the D3D12 calls.
+
+#include <cstdint>
+#include <vector>
+
+enum class ResidencyKind : uint8_t {
+	BottomLevelAS,
+	TopLevelAS,
+	Texture,
+	Buffer,
+	Heap
+};
+
+typedef uint32_t ResidencyHandle;
+
+const ResidencyHandle kInvalidResidencyHandle = ~0u;
+
+class ResidencySet {
+public:
+	ResidencyHandle add(uint64_t sizeInBytes, ResidencyKind kind, bool evictable);
+	void remove(ResidencyHandle handle);
+
+	void markUsed(ResidencyHandle handle, uint64_t fenceValue);
+
+	// Marks everything in `used` as used by the submission signalling fenceValue and
+	// returns the handles that were evicted and have to be paged back in first.
+	std::vector<ResidencyHandle> makeResident(const std::vector<ResidencyHandle>& used, uint64_t fenceValue);
+
+	// Picks least recently used objects to evict until the resident size plus
+	// `incomingBytes` fits the budget. Only objects the GPU is done with
+	// (lastUsedFence <= completedFence) are candidates, so this can come up short.
+	std::vector<ResidencyHandle> evictToBudget(uint64_t completedFence, uint64_t incomingBytes = 0);
+
+	void setBudget(uint64_t budgetInBytes) { m_budget = budgetInBytes; }
+	uint64_t budget() const { return m_budget; }
+
+	uint64_t residentSize() const { return m_residentSize; }
+	bool isResident(ResidencyHandle handle) const { return m_objects[handle].resident; }
+	uint64_t lastUsedFence(ResidencyHandle handle) const { return m_objects[handle].lastUsedFence; }
+
+private:
+	struct Object {
+		uint64_t sizeInBytes = 0;
+		uint64_t lastUsedFence = 0;
+		ResidencyKind kind = ResidencyKind::Buffer;
+		bool evictable = false;
+		bool resident = false;
+		bool alive = false;
+	};
+
+	std::vector<Object> m_objects;
+	std::vector<ResidencyHandle> m_freeHandles;
+	uint64_t m_residentSize = 0;
+	uint64_t m_budget = ~0ull;
+};
@@ -0,0 +1,120 @@
+#include "residencymanager.h"
+
+#include "helpers.h"
+
+void ResidencyManager::init(ComPtr<ID3D12Device5> device, ComPtr<IDXGIAdapter3> adapter) {
+	m_device = device;
+	m_adapter = adapter;
+
+	refreshBudget();
+}
+
+void ResidencyManager::setBudgetOverride(uint64_t budgetInBytes) {
+	m_budgetOverride = budgetInBytes;
+
+	refreshBudget();
+}
+
+ResidencyHandle ResidencyManager::track(ComPtr<ID3D12Pageable> object, uint64_t sizeInBytes, ResidencyKind kind) {
+	bool evictable = kind == ResidencyKind::BottomLevelAS || kind == ResidencyKind::Texture;
+
+	ResidencyHandle handle = m_set.add(sizeInBytes, kind, evictable);
+
+	if (handle >= m_objects.size()) {
+		m_objects.resize(handle + 1);
+	}
+	m_objects[handle] = object;
+
+	return handle;
+}
+
+ResidencyHandle ResidencyManager::track(ComPtr<ID3D12Resource> resource, ResidencyKind kind) {
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+
+	return track(ComPtr<ID3D12Pageable>(resource.Get()), info.SizeInBytes, kind);
+}
+
+void ResidencyManager::untrack(ResidencyHandle handle) {
+	m_set.remove(handle);
+	m_objects[handle].Reset();
+}
+
+void ResidencyManager::makeResident(const std::vector<ResidencyHandle>& used, uint64_t fenceValue, uint64_t completedFence) {
+	std::vector<ResidencyHandle> pageIn = m_set.makeResident(used, fenceValue);
+
+	if (pageIn.empty()) {
+		return;
+	}
+
+	// make room first, the objects we are about to use are now marked with fenceValue
+	// so they can't be picked as victims
+	evict(m_set.evictToBudget(completedFence));
+
+	std::vector<ID3D12Pageable*> pageables;
+	for (ResidencyHandle handle : pageIn) {
+		pageables.push_back(m_objects[handle].Get());
+	}
+
+	throwIfFailed(m_device->MakeResident(static_cast<UINT>(pageables.size()), pageables.data()));
+}
+
+void ResidencyManager::trim(uint64_t completedFence) {
+	refreshBudget();
+
+	evict(m_set.evictToBudget(completedFence));
+}
+
+ComPtr<ID3D12Resource> ResidencyManager::createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties,
+	const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, uint64_t completedFence) {
+	D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+
+	refreshBudget();
+	evict(m_set.evictToBudget(completedFence, info.SizeInBytes));
+
+	ComPtr<ID3D12Resource> resource;
+	HRESULT hr = m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+		initialState, nullptr, IID_PPV_ARGS(&resource));
+
+	if (hr == E_OUTOFMEMORY) {
+		// the budget was too optimistic, evict everything the GPU is done with and try once more
+		evict(m_set.evictToBudget(completedFence, m_set.residentSize() + info.SizeInBytes));
+
+		hr = m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+			initialState, nullptr, IID_PPV_ARGS(&resource));
+	}
+
+	throwIfFailed(hr);
+
+	return resource;
+}
+
+void ResidencyManager::refreshBudget() {
+	if (m_budgetOverride != 0) {
+		m_set.setBudget(m_budgetOverride);
+		return;
+	}
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
+	if (m_adapter && SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo))) {
+		// the adapter budget covers the whole process, take off what we are not tracking
+		// (swap chain, descriptor heaps, ...) so it can be compared against our resident size
+		uint64_t untracked = memoryInfo.CurrentUsage > m_set.residentSize() ?
+			memoryInfo.CurrentUsage - m_set.residentSize() : 0;
+
+		m_set.setBudget(memoryInfo.Budget > untracked ? memoryInfo.Budget - untracked : 0);
+	}
+}
+
+void ResidencyManager::evict(const std::vector<ResidencyHandle>& victims) {
+	if (victims.empty()) {
+		return;
+	}
+
+	std::vector<ID3D12Pageable*> pageables;
+	for (ResidencyHandle handle : victims) {
+		pageables.push_back(m_objects[handle].Get());
+	}
+
+	throwIfFailed(m_device->Evict(static_cast<UINT>(pageables.size()), pageables.data()));
+}
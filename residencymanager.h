@@ -0,0 +1,56 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include <vector>
+
+#include "residency.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Keeps the committed video memory under the adapter's budget by evicting the least
+// recently used BLASes and textures, and paging them back in when a frame needs them.
+class ResidencyManager {
+public:
+	void init(ComPtr<ID3D12Device5> device, ComPtr<IDXGIAdapter3> adapter);
+
+	// Overrides the budget reported by the adapter, 0 goes back to the adapter's value.
+	void setBudgetOverride(uint64_t budgetInBytes);
+
+	// BLASes and textures are evictable, everything else stays resident
+	ResidencyHandle track(ComPtr<ID3D12Pageable> object, uint64_t sizeInBytes, ResidencyKind kind);
+	ResidencyHandle track(ComPtr<ID3D12Resource> resource, ResidencyKind kind);
+	void untrack(ResidencyHandle handle);
+
+	// Call before ExecuteCommandLists with everything the submission references and the
+	// fence value it will signal. Evicted objects are made resident again.
+	void makeResident(const std::vector<ResidencyHandle>& used, uint64_t fenceValue, uint64_t completedFence);
+
+	// Evict until the budget is respected again
+	void trim(uint64_t completedFence);
+
+	// CreateCommittedResource that evicts and retries instead of failing when video memory runs out
+	ComPtr<ID3D12Resource> createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties,
+		const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, uint64_t completedFence);
+
+	uint64_t budget() const { return m_set.budget(); }
+	uint64_t residentSize() const { return m_set.residentSize(); }
+
+private:
+	void refreshBudget();
+	void evict(const std::vector<ResidencyHandle>& victims);
+
+	ComPtr<ID3D12Device5> m_device;
+	ComPtr<IDXGIAdapter3> m_adapter;
+	uint64_t m_budgetOverride = 0;
+
+	ResidencySet m_set;
+	std::vector<ComPtr<ID3D12Pageable>> m_objects; // indexed by handle
+};
@@ -0,0 +1,45 @@
+#include "resize.h"
+
+#include <algorithm>
+
+ResizePolicy::ResizePolicy(uint32_t granularity, double shrinkRatio, uint32_t shrinkDelay) :
+	m_granularity(std::max(1u, granularity)),
+	m_shrinkRatio(shrinkRatio),
+	m_shrinkDelay(shrinkDelay) {
+}
+
+bool ResizePolicy::update(Extent2D requested) {
+	requested.width = std::max(1u, requested.width);
+	requested.height = std::max(1u, requested.height);
+
+	// has to grow right away, the frame wouldn't fit otherwise
+	if (requested.width > m_capacity.width || requested.height > m_capacity.height) {
+		m_capacity = roundUp(requested);
+		m_smallUpdates = 0;
+
+		return true;
+	}
+
+	if (requested.area() < m_shrinkRatio * m_capacity.area()) {
+		if (++m_smallUpdates >= m_shrinkDelay) {
+			m_capacity = roundUp(requested);
+			m_smallUpdates = 0;
+
+			return true;
+		}
+	}
+	else {
+		m_smallUpdates = 0;
+	}
+
+	return false;
+}
+
+Extent2D ResizePolicy::roundUp(Extent2D extent) const {
+	Extent2D rounded;
+
+	rounded.width = (extent.width + m_granularity - 1) / m_granularity * m_granularity;
+	rounded.height = (extent.height + m_granularity - 1) / m_granularity * m_granularity;
+
+	return rounded;
+}
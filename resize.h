@@ -0,0 +1,84 @@
+#pragma once
+
+// Sizing of window-sized resources. No D3D12 in here: ResizePolicy decides when an
+// allocation has to change, RecyclingPool keeps replaced allocations around for reuse.
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+
+struct Extent2D {
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	bool operator==(const Extent2D& other) const { return width == other.width && height == other.height; }
+	bool operator!=(const Extent2D& other) const { return !(*this == other); }
+
+	uint64_t area() const { return static_cast<uint64_t>(width) * height; }
+};
+
+// Allocated size of a resource that follows the window. The capacity is rounded up to
+// granularity so a growing window reallocates once per step instead of once per pixel,
+// and it only shrinks once the requested area stayed below shrinkRatio of the capacity
+// for shrinkDelay updates in a row.
+class ResizePolicy {
+public:
+	explicit ResizePolicy(uint32_t granularity = 256, double shrinkRatio = 0.5, uint32_t shrinkDelay = 120);
+
+	// call once per frame with the size that is rendered, returns true if the capacity changed
+	bool update(Extent2D requested);
+
+	Extent2D capacity() const { return m_capacity; }
+
+private:
+	Extent2D roundUp(Extent2D extent) const;
+
+	uint32_t m_granularity;
+	double m_shrinkRatio;
+	uint32_t m_shrinkDelay;
+	Extent2D m_capacity;
+	uint32_t m_smallUpdates = 0; // consecutive updates asking for much less than the capacity
+};
+
+// Allocations that were replaced after a resize, keyed by their capacity. A window going
+// back and forth between two sizes (e.g. maximize and restore) gets its old allocation
+// back instead of a new one. Holds at most maxEntries, recycle() hands back the oldest
+// entry once that is exceeded so the caller can release it.
+template <typename T>
+class RecyclingPool {
+public:
+	explicit RecyclingPool(size_t maxEntries = 2) : m_maxEntries(maxEntries) {}
+
+	std::optional<T> recycle(Extent2D capacity, T allocation) {
+		m_entries.push_back({ capacity, std::move(allocation) });
+
+		if (m_entries.size() <= m_maxEntries) {
+			return std::nullopt;
+		}
+
+		std::optional<T> evicted = std::move(m_entries.front().second);
+		m_entries.pop_front();
+
+		return evicted;
+	}
+
+	std::optional<T> reuse(Extent2D capacity) {
+		for (auto entry = m_entries.begin(); entry != m_entries.end(); entry++) {
+			if (entry->first == capacity) {
+				std::optional<T> allocation = std::move(entry->second);
+				m_entries.erase(entry);
+
+				return allocation;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	size_t size() const { return m_entries.size(); }
+
+private:
+	size_t m_maxEntries;
+	std::deque<std::pair<Extent2D, T>> m_entries;
+};
@@ -0,0 +1,108 @@
+#include "rootsignatures.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "helpers.h"
+
+namespace {
+	// a stored entry is the canonical description followed by the blob, the description is
+	// compared on load so a key collision is a miss rather than the wrong root signature
+	std::vector<uint8_t> rootSignatureCachePayload(const std::vector<uint8_t>& desc, ID3DBlob* blob) {
+		uint32_t descSize = static_cast<uint32_t>(desc.size());
+		const uint8_t* blobData = static_cast<const uint8_t*>(blob->GetBufferPointer());
+
+		std::vector<uint8_t> payload(reinterpret_cast<const uint8_t*>(&descSize),
+			reinterpret_cast<const uint8_t*>(&descSize) + sizeof(descSize));
+		payload.insert(payload.end(), desc.begin(), desc.end());
+		payload.insert(payload.end(), blobData, blobData + blob->GetBufferSize());
+
+		return payload;
+	}
+
+	bool matchesDesc(const ShaderCacheEntry& entry, const std::vector<uint8_t>& desc) {
+		uint32_t descSize;
+
+		if (entry.size < sizeof(descSize)) {
+			return false;
+		}
+
+		memcpy(&descSize, entry.data, sizeof(descSize));
+
+		return descSize == desc.size() && entry.size > sizeof(descSize) + descSize &&
+			memcmp(static_cast<const uint8_t*>(entry.data) + sizeof(descSize), desc.data(), desc.size()) == 0;
+	}
+}
+
+std::string formatRootSignatureCost(const std::string& name, const nv_helpers_dx12::RootSignatureCost& cost,
+	uint32_t recordArgumentsSize) {
+	char buffer[500];
+	snprintf(buffer, sizeof(buffer), "root signature %s: %u of %u DWORDs, %u tables, %u root descriptors, "
+		"%u root constants, %u bytes of local root arguments in %u byte records%s\n",
+		name.c_str(), cost.dwords, nv_helpers_dx12::kMaxRootSignatureDwords, cost.numTables, cost.numDescriptors,
+		cost.numConstants, cost.localArgumentsSize, cost.recordStride,
+		cost.localArgumentsSize != recordArgumentsSize ? ", the records don't match" : "");
+
+	return buffer;
+}
+
+void RootSignatureCache::init(ComPtr<ID3D12Device5> device, const std::filesystem::path& directory) {
+	m_device = device;
+
+	if (!directory.empty()) {
+		m_blobs = std::make_unique<ShaderCache>(directory, ".rootsig");
+	}
+}
+
+ComPtr<ID3D12RootSignature> RootSignatureCache::get(nv_helpers_dx12::RootSignatureGenerator& generator, bool isLocal) {
+	std::vector<uint8_t> desc = generator.CanonicalDesc(isLocal);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_signatures.find(desc);
+
+	if (found != m_signatures.end()) {
+		m_stats.shared++;
+		return found->second;
+	}
+
+	uint64_t key = hashBytes(desc.data(), desc.size());
+	ComPtr<ID3D12RootSignature> signature;
+	ShaderCacheEntry entry;
+
+	if (m_blobs && m_blobs->load(key, entry) && matchesDesc(entry, desc)) {
+		size_t blobOffset = sizeof(uint32_t) + desc.size();
+
+		// a blob the runtime doesn't take anymore gets serialized again below
+		if (SUCCEEDED(m_device->CreateRootSignature(0, static_cast<const uint8_t*>(entry.data) + blobOffset,
+			entry.size - blobOffset, IID_PPV_ARGS(&signature)))) {
+			m_stats.loaded++;
+		}
+	}
+
+	if (!signature) {
+		ComPtr<ID3DBlob> blob = generator.Serialize(isLocal);
+
+		throwIfFailed(m_device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(),
+			IID_PPV_ARGS(&signature)));
+		m_stats.serialized++;
+
+		if (m_blobs) {
+			std::vector<uint8_t> payload = rootSignatureCachePayload(desc, blob.Get());
+			m_blobs->store(key, payload.data(), payload.size());
+		}
+	}
+
+	m_signatures.emplace(std::move(desc), signature);
+
+	return signature;
+}
+
+RootSignatureCacheStats RootSignatureCache::stats() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+size_t RootSignatureCache::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_signatures.size();
+}
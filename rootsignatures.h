@@ -0,0 +1,60 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dxr/RootSignatureGenerator.h"
+#include "shadercache.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One line per signature: DWORDs against the 64 DWORD budget, tables, root descriptors and root
+// constants, and the root arguments as a local root signature. recordArgumentsSize is what the
+// records declare for it, a mismatch gets flagged.
+std::string formatRootSignatureCost(const std::string& name, const nv_helpers_dx12::RootSignatureCost& cost,
+	uint32_t recordArgumentsSize);
+
+struct RootSignatureCacheStats {
+	uint32_t shared; // asked for a description which already had a root signature
+	uint32_t loaded; // created from a serialized blob on disk
+	uint32_t serialized;
+};
+
+// Root signatures by description. Descriptions are compared by their canonical bytes (see
+// RootSignatureGenerator::CanonicalDesc), every request for the same description gets the same
+// root signature object. The serialized blobs are stored by the hash of those bytes, so a warm
+// start creates its root signatures without serializing anything.
+//
+// Safe to use from several threads at once.
+class RootSignatureCache {
+public:
+	// blobs are kept as <key>.rootsig in directory, empty keeps nothing on disk
+	void init(ComPtr<ID3D12Device5> device, const std::filesystem::path& directory);
+
+	ComPtr<ID3D12RootSignature> get(nv_helpers_dx12::RootSignatureGenerator& generator, bool isLocal);
+
+	RootSignatureCacheStats stats() const;
+
+	// distinct root signatures created so far
+	size_t size() const;
+
+private:
+	ComPtr<ID3D12Device5> m_device;
+	std::unique_ptr<ShaderCache> m_blobs;
+
+	mutable std::mutex m_mutex;
+	std::map<std::vector<uint8_t>, ComPtr<ID3D12RootSignature>> m_signatures;
+	RootSignatureCacheStats m_stats = {}; // guarded by m_mutex
+};
@@ -0,0 +1,76 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(uint32_t framesInFlight) {
+	setFramesInFlight(framesInFlight);
+}
+
+void FrameScheduler::setFramesInFlight(uint32_t framesInFlight) {
+	m_framesInFlight = std::clamp(framesInFlight, 1u, kMaxFramesInFlight);
+}
+
+uint64_t FrameScheduler::beginFrame(GpuTimeline& gpu) {
+	// the fence of frame n - framesInFlight, frames are kept in a ring as big as the maximum
+	// latency so lowering framesInFlight at runtime still finds the right value
+	if (m_frameIndex >= m_framesInFlight) {
+		uint64_t waitFrame = m_frameIndex - m_framesInFlight;
+		uint64_t fenceValue = m_frameFenceValues[waitFrame % kMaxFramesInFlight];
+
+		if (gpu.completedValue() < fenceValue) {
+			gpu.waitForValue(fenceValue);
+		}
+	}
+
+	return m_frameIndex;
+}
+
+void FrameScheduler::endFrame(uint64_t fenceValue) {
+	m_frameFenceValues[m_frameIndex % kMaxFramesInFlight] = fenceValue;
+	m_frameIndex++;
+}
+
+uint32_t FrameScheduler::framesPending(GpuTimeline& gpu) const {
+	uint64_t completed = gpu.completedValue();
+	uint32_t pending = 0;
+
+	for (uint64_t i = 0; i < std::min<uint64_t>(m_frameIndex, kMaxFramesInFlight); i++) {
+		if (m_frameFenceValues[(m_frameIndex - 1 - i) % kMaxFramesInFlight] > completed) {
+			pending++;
+		}
+	}
+
+	return pending;
+}
+
+uint64_t SimulatedGpuTimeline::submit(double cpuTime, double gpuDuration) {
+	m_cpuTime = std::max(m_cpuTime, cpuTime);
+
+	// the GPU starts once it is idle and the submission has arrived
+	m_gpuTime = std::max(m_gpuTime, m_cpuTime) + gpuDuration;
+	m_completionTimes.push_back(m_gpuTime);
+
+	return m_completionTimes.size();
+}
+
+uint64_t SimulatedGpuTimeline::completedValue() {
+	uint64_t completed = 0;
+
+	while (completed < m_completionTimes.size() && m_completionTimes[completed] <= m_cpuTime) {
+		completed++;
+	}
+
+	return completed;
+}
+
+void SimulatedGpuTimeline::waitForValue(uint64_t value) {
+	if (value == 0 || value > m_completionTimes.size()) {
+		return;
+	}
+
+	double completionTime = m_completionTimes[value - 1];
+	if (completionTime > m_cpuTime) {
+		m_totalWaitTime += completionTime - m_cpuTime;
+		m_cpuTime = completionTime;
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Frame pacing between the simulation thread, the render thread and the GPU.
+// No D3D12 in here, the GPU is seen through GpuTimeline so the scheduler can run
+// against SimulatedGpuTimeline on the CPU.
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+const uint32_t kMaxFramesInFlight = 3;
+
+// Hands the most recent snapshot from one producer thread to one consumer thread
+// without locks (triple buffering). The producer never waits for the consumer and
+// the consumer always gets the newest complete snapshot, older ones are dropped.
+template <typename T>
+class SnapshotHandoff {
+public:
+	// producer: fill back() and then publish() it
+	T& back() { return m_buffers[m_back]; }
+
+	void publish() {
+		uint32_t previous = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+		m_back = previous & kIndexMask;
+	}
+
+	// consumer: returns false if nothing new was published since the last call,
+	// front() keeps the previous snapshot in that case
+	bool acquire() {
+		if ((m_middle.load(std::memory_order_acquire) & kFresh) == 0) {
+			return false;
+		}
+
+		uint32_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = previous & kIndexMask;
+
+		return true;
+	}
+
+	const T& front() const { return m_buffers[m_front]; }
+
+private:
+	static const uint32_t kFresh = 4;
+	static const uint32_t kIndexMask = 3;
+
+	T m_buffers[3] = {};
+	std::atomic<uint32_t> m_middle = 1;
+	uint32_t m_back = 0; // only touched by the producer
+	uint32_t m_front = 2; // only touched by the consumer
+};
+
+// The scheduler's view of the GPU: fence values that complete in submission order.
+class GpuTimeline {
+public:
+	virtual ~GpuTimeline() = default;
+
+	virtual uint64_t completedValue() = 0;
+	virtual void waitForValue(uint64_t value) = 0;
+};
+
+// Decides how far the CPU may run ahead of the GPU. With N frames in flight, recording
+// frame n has to wait until frame n - N has finished on the GPU.
+class FrameScheduler {
+public:
+	explicit FrameScheduler(uint32_t framesInFlight = kMaxFramesInFlight);
+
+	// clamped to [1, kMaxFramesInFlight], takes effect from the next beginFrame()
+	void setFramesInFlight(uint32_t framesInFlight);
+	uint32_t framesInFlight() const { return m_framesInFlight; }
+
+	// blocks until the frame about to be recorded is allowed to start, returns its index
+	uint64_t beginFrame(GpuTimeline& gpu);
+
+	// fence value signalled by the submission of the frame returned by beginFrame()
+	void endFrame(uint64_t fenceValue);
+
+	// number of submitted frames the GPU hasn't finished yet
+	uint32_t framesPending(GpuTimeline& gpu) const;
+
+private:
+	uint32_t m_framesInFlight;
+	uint64_t m_frameIndex = 0;
+	uint64_t m_frameFenceValues[kMaxFramesInFlight] = {};
+};
+
+// GPU stand-in with its own clock: submissions run back to back, each taking the given
+// time, and waiting moves the CPU clock forward to the completion time.
+class SimulatedGpuTimeline : public GpuTimeline {
+public:
+	// returns the fence value signalled when this submission completes
+	uint64_t submit(double cpuTime, double gpuDuration);
+
+	uint64_t completedValue() override;
+	void waitForValue(uint64_t value) override;
+
+	// current CPU time, advance it to model CPU work between submissions
+	double cpuTime() const { return m_cpuTime; }
+	void advanceCpu(double seconds) { m_cpuTime += seconds; }
+
+	double totalWaitTime() const { return m_totalWaitTime; }
+
+private:
+	std::vector<double> m_completionTimes; // index = fence value - 1
+	double m_cpuTime = 0.0;
+	double m_gpuTime = 0.0;
+	double m_totalWaitTime = 0.0;
+};
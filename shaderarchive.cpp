@@ -0,0 +1,205 @@
+#include "shaderarchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	const char kShaderArchiveMagic[4] = { 'S', 'H', 'P', 'K' };
+	const uint32_t kShaderArchiveFormat = 2;
+	const uint64_t kBlobAlignment = 16;
+
+	struct ShaderArchiveHeader {
+		char magic[4];
+		uint32_t format;
+		uint32_t numEntries;
+		uint32_t nameTableSize;
+	};
+
+	struct ShaderArchiveEntry {
+		uint32_t nameOffset;
+		uint32_t nameSize;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t hash;
+		uint64_t sourceHash;
+	};
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	const ShaderArchiveEntry* entries(const MappedFile& file) {
+		return reinterpret_cast<const ShaderArchiveEntry*>(file.data() + sizeof(ShaderArchiveHeader));
+	}
+
+	const ShaderArchiveHeader& header(const MappedFile& file) {
+		return *reinterpret_cast<const ShaderArchiveHeader*>(file.data());
+	}
+
+	std::string entryName(const MappedFile& file, const ShaderArchiveEntry& entry) {
+		const char* names = reinterpret_cast<const char*>(entries(file) + header(file).numEntries);
+
+		return std::string(names + entry.nameOffset, entry.nameSize);
+	}
+}
+
+void ShaderArchiveWriter::add(const std::string& name, const void* data, size_t size, uint64_t sourceHash) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	auto found = std::find_if(m_blobs.begin(), m_blobs.end(), [&](const Blob& blob) { return blob.name == name; });
+
+	if (found != m_blobs.end()) {
+		found->data.assign(bytes, bytes + size);
+		found->sourceHash = sourceHash;
+		return;
+	}
+
+	m_blobs.push_back({ name, std::vector<uint8_t>(bytes, bytes + size), sourceHash });
+}
+
+bool ShaderArchiveWriter::write(const std::filesystem::path& path) const {
+	std::vector<const Blob*> sorted;
+	for (const Blob& blob : m_blobs) {
+		sorted.push_back(&blob);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const Blob* a, const Blob* b) { return a->name < b->name; });
+
+	ShaderArchiveHeader header;
+	memcpy(header.magic, kShaderArchiveMagic, sizeof(kShaderArchiveMagic));
+	header.format = kShaderArchiveFormat;
+	header.numEntries = static_cast<uint32_t>(sorted.size());
+
+	std::string names;
+	std::vector<ShaderArchiveEntry> entries(sorted.size());
+
+	for (size_t i = 0; i < sorted.size(); i++) {
+		entries[i].nameOffset = static_cast<uint32_t>(names.size());
+		entries[i].nameSize = static_cast<uint32_t>(sorted[i]->name.size());
+		names += sorted[i]->name;
+	}
+	header.nameTableSize = static_cast<uint32_t>(names.size());
+
+	uint64_t offset = sizeof(header) + entries.size() * sizeof(ShaderArchiveEntry) + names.size();
+
+	for (size_t i = 0; i < sorted.size(); i++) {
+		offset = alignUp(offset, kBlobAlignment);
+
+		entries[i].offset = offset;
+		entries[i].size = sorted[i]->data.size();
+		entries[i].hash = hashBytes(sorted[i]->data.data(), sorted[i]->data.size());
+		entries[i].sourceHash = sorted[i]->sourceHash;
+
+		offset += entries[i].size;
+	}
+
+	// written next to the target and renamed, a running app keeps its mapping of the old one
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderArchiveEntry));
+		file.write(names.data(), names.size());
+
+		for (size_t i = 0; i < sorted.size(); i++) {
+			static const char kPadding[kBlobAlignment] = {};
+			uint64_t position = static_cast<uint64_t>(file.tellp());
+
+			file.write(kPadding, entries[i].offset - position);
+			file.write(reinterpret_cast<const char*>(sorted[i]->data.data()), sorted[i]->data.size());
+		}
+
+		if (!file.good()) {
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+
+	return !error;
+}
+
+bool ShaderArchive::open(const std::filesystem::path& path) {
+	m_file = nullptr;
+
+	std::shared_ptr<MappedFile> file = MappedFile::open(path);
+
+	if (!file || file->size() < sizeof(ShaderArchiveHeader)) {
+		return false;
+	}
+
+	const ShaderArchiveHeader& archiveHeader = header(*file);
+
+	if (memcmp(archiveHeader.magic, kShaderArchiveMagic, sizeof(kShaderArchiveMagic)) != 0 ||
+		archiveHeader.format != kShaderArchiveFormat) {
+		return false;
+	}
+
+	uint64_t tablesEnd = sizeof(ShaderArchiveHeader) +
+		uint64_t(archiveHeader.numEntries) * sizeof(ShaderArchiveEntry) + archiveHeader.nameTableSize;
+
+	if (tablesEnd > file->size()) {
+		return false;
+	}
+
+	const ShaderArchiveEntry* archiveEntries = entries(*file);
+
+	for (uint32_t i = 0; i < archiveHeader.numEntries; i++) {
+		const ShaderArchiveEntry& entry = archiveEntries[i];
+
+		if (uint64_t(entry.nameOffset) + entry.nameSize > archiveHeader.nameTableSize ||
+			entry.offset < tablesEnd || entry.offset > file->size() || entry.size > file->size() - entry.offset ||
+			entry.hash != hashBytes(file->data() + entry.offset, static_cast<size_t>(entry.size))) {
+			return false;
+		}
+
+		// find() relies on the order
+		if (i > 0 && !(entryName(*file, archiveEntries[i - 1]) < entryName(*file, entry))) {
+			return false;
+		}
+	}
+
+	m_file = file;
+
+	return true;
+}
+
+bool ShaderArchive::find(const std::string& name, ShaderArchiveBlob& blob) const {
+	if (!m_file) {
+		return false;
+	}
+
+	const ShaderArchiveEntry* begin = entries(*m_file);
+	const ShaderArchiveEntry* end = begin + header(*m_file).numEntries;
+
+	const ShaderArchiveEntry* found = std::lower_bound(begin, end, name,
+		[&](const ShaderArchiveEntry& entry, const std::string& value) { return entryName(*m_file, entry) < value; });
+
+	if (found == end || entryName(*m_file, *found) != name) {
+		return false;
+	}
+
+	blob.file = m_file;
+	blob.data = m_file->data() + found->offset;
+	blob.size = static_cast<size_t>(found->size);
+	blob.sourceHash = found->sourceHash;
+
+	return true;
+}
+
+size_t ShaderArchive::size() const {
+	return m_file ? header(*m_file).numEntries : 0;
+}
+
+std::vector<std::string> ShaderArchive::names() const {
+	std::vector<std::string> result;
+
+	for (size_t i = 0; i < size(); i++) {
+		result.push_back(entryName(*m_file, entries(*m_file)[i]));
+	}
+
+	return result;
+}
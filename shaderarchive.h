@@ -0,0 +1,59 @@
+#pragma once
+
+// Packed archive of compiled shaders, written at build time by the shaderpack tool and
+// memory mapped by the app so startup compiles nothing. No D3D12 or DXC in here.
+//
+// Layout: header, entry table sorted by name, name table, then the blobs 16-byte aligned.
+// Every offset is from the start of the file. Each entry also keeps the shaderSourceHash of
+// the sources it was compiled from, so an archive older than the shaders next to it is noticed.
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shadercache.h"
+
+class ShaderArchiveWriter {
+public:
+	// a second blob under the same name replaces the first
+	void add(const std::string& name, const void* data, size_t size, uint64_t sourceHash = 0);
+
+	bool write(const std::filesystem::path& path) const;
+
+	size_t size() const { return m_blobs.size(); }
+
+private:
+	struct Blob {
+		std::string name;
+		std::vector<uint8_t> data;
+		uint64_t sourceHash;
+	};
+
+	std::vector<Blob> m_blobs;
+};
+
+// A blob in a mapped archive, valid as long as someone holds the mapping
+struct ShaderArchiveBlob {
+	std::shared_ptr<MappedFile> file;
+	const void* data = nullptr;
+	size_t size = 0;
+	uint64_t sourceHash = 0; // of the sources at build time
+};
+
+class ShaderArchive {
+public:
+	// false if the file is missing or fails validation (format, bounds, blob hashes)
+	bool open(const std::filesystem::path& path);
+	bool isOpen() const { return m_file != nullptr; }
+
+	// binary search over the entry table
+	bool find(const std::string& name, ShaderArchiveBlob& blob) const;
+
+	size_t size() const;
+	std::vector<std::string> names() const;
+
+private:
+	std::shared_ptr<MappedFile> m_file;
+};
@@ -0,0 +1,343 @@
+#include "shadercache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const char kShaderCacheMagic[4] = { 'S', 'H', 'C', 'E' };
+	const uint32_t kShaderCacheFormat = 2; // bump when the file layout or key derivation changes
+
+	struct ShaderCacheFileHeader {
+		char magic[4];
+		uint32_t format;
+		uint64_t key;
+		uint64_t payloadSize;
+		uint64_t payloadHash;
+	};
+
+	// length prefixed so ("ab", "c") and ("a", "bc") hash differently
+	uint64_t hashString(const std::string& value, uint64_t seed) {
+		uint64_t size = value.size();
+		seed = hashBytes(&size, sizeof(size), seed);
+
+		return hashBytes(value.data(), value.size(), seed);
+	}
+
+	bool readFile(const std::filesystem::path& path, std::string& contents) {
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file.good()) {
+			return false;
+		}
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+
+		return true;
+	}
+
+	void gatherRecursive(const std::filesystem::path& file, const std::vector<std::filesystem::path>& includeDirectories,
+		std::vector<ShaderSourceFile>& sources) {
+		ShaderSourceFile source;
+		source.path = std::filesystem::weakly_canonical(file);
+
+		for (const ShaderSourceFile& seen : sources) {
+			if (seen.path == source.path) {
+				return;
+			}
+		}
+
+		source.found = readFile(source.path, source.contents);
+		sources.push_back(source);
+
+		if (!source.found) {
+			return;
+		}
+
+		for (const std::string& include : scanIncludes(source.contents)) {
+			std::filesystem::path resolved = source.path.parent_path() / include;
+
+			for (size_t i = 0; i < includeDirectories.size() && !std::filesystem::exists(resolved); i++) {
+				if (std::filesystem::exists(includeDirectories[i] / include)) {
+					resolved = includeDirectories[i] / include;
+				}
+			}
+
+			gatherRecursive(resolved, includeDirectories, sources);
+		}
+	}
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+std::vector<std::string> scanIncludes(const std::string& source) {
+	std::vector<std::string> includes;
+	std::istringstream lines(source);
+	std::string line;
+
+	while (std::getline(lines, line)) {
+		size_t position = line.find_first_not_of(" \t");
+
+		if (position == std::string::npos || line[position] != '#') {
+			continue;
+		}
+
+		position = line.find_first_not_of(" \t", position + 1);
+
+		if (position == std::string::npos || line.compare(position, 7, "include") != 0) {
+			continue;
+		}
+
+		size_t open = line.find_first_of("\"<", position + 7);
+
+		if (open == std::string::npos) {
+			continue;
+		}
+
+		size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+
+		if (close != std::string::npos) {
+			includes.push_back(line.substr(open + 1, close - open - 1));
+		}
+	}
+
+	return includes;
+}
+
+std::vector<ShaderSourceFile> gatherShaderSources(const std::filesystem::path& file,
+	const std::vector<std::filesystem::path>& includeDirectories) {
+	std::vector<ShaderSourceFile> sources;
+
+	gatherRecursive(file, includeDirectories, sources);
+
+	return sources;
+}
+
+uint64_t shaderCacheKey(const std::vector<ShaderSourceFile>& sources, const ShaderCompileOptions& options) {
+	uint64_t key = hashBytes(&kShaderCacheFormat, sizeof(kShaderCacheFormat));
+
+	key = hashString(options.profile, key);
+	key = hashString(options.compilerVersion, key);
+
+	uint64_t numArguments = options.arguments.size();
+	key = hashBytes(&numArguments, sizeof(numArguments), key);
+
+	for (const std::string& argument : options.arguments) {
+		key = hashString(argument, key);
+	}
+
+	uint64_t numDefines = options.defines.size();
+	key = hashBytes(&numDefines, sizeof(numDefines), key);
+
+	for (const std::string& define : options.defines) {
+		key = hashString(define, key);
+	}
+
+	return shaderSourceHash(sources, key);
+}
+
+uint64_t shaderSourceHash(const std::vector<ShaderSourceFile>& sources, uint64_t seed) {
+	uint64_t hash = seed;
+
+	// by content, the main file's name doesn't matter but an include's does since it decides
+	// which file the compiler picks up
+	for (size_t i = 0; i < sources.size(); i++) {
+		hash = hashString(i == 0 ? std::string() : sources[i].path.filename().string(), hash);
+		hash = hashString(sources[i].found ? "found" : "missing", hash);
+		hash = hashString(sources[i].contents, hash);
+	}
+
+	return hash;
+}
+
+std::string formatShaderCacheKey(uint64_t key) {
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+
+	return text;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (m_data) {
+		::UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		::CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		::CloseHandle(m_file);
+	}
+#else
+	if (m_data) {
+		::munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+#endif
+}
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+	std::unique_ptr<MappedFile> mapped(new MappedFile());
+
+#ifdef _WIN32
+	HANDLE file = ::CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	mapped->m_file = file;
+
+	LARGE_INTEGER size = {};
+	if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		return nullptr;
+	}
+	mapped->m_size = static_cast<size_t>(size.QuadPart);
+
+	mapped->m_mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapped->m_mapping) {
+		return nullptr;
+	}
+
+	mapped->m_data = static_cast<const uint8_t*>(::MapViewOfFile(mapped->m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mapped->m_data) {
+		return nullptr;
+	}
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+
+	if (file < 0) {
+		return nullptr;
+	}
+
+	struct stat status = {};
+	if (::fstat(file, &status) != 0 || status.st_size == 0) {
+		::close(file);
+		return nullptr;
+	}
+
+	// the mapping keeps the file alive, the descriptor isn't needed anymore
+	void* data = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+
+	mapped->m_data = static_cast<const uint8_t*>(data);
+	mapped->m_size = static_cast<size_t>(status.st_size);
+#endif
+
+	return mapped;
+}
+
+ShaderCache::ShaderCache(std::filesystem::path directory, std::string extension)
+	: m_directory(std::move(directory)), m_extension(std::move(extension)) {
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+}
+
+bool ShaderCache::load(uint64_t key, ShaderCacheEntry& entry) {
+	std::shared_ptr<MappedFile> file = MappedFile::open(entryPath(key));
+
+	if (!file) {
+		m_misses++;
+		return false;
+	}
+
+	ShaderCacheFileHeader header;
+	bool valid = file->size() >= sizeof(header);
+
+	if (valid) {
+		memcpy(&header, file->data(), sizeof(header));
+
+		valid = memcmp(header.magic, kShaderCacheMagic, sizeof(kShaderCacheMagic)) == 0 &&
+			header.format == kShaderCacheFormat &&
+			header.key == key &&
+			header.payloadSize == file->size() - sizeof(header) &&
+			header.payloadHash == hashBytes(file->data() + sizeof(header), header.payloadSize);
+	}
+
+	if (!valid) {
+		// treated as a miss, the next store() replaces it
+		m_rejected++;
+		m_misses++;
+		return false;
+	}
+
+	entry.file = file;
+	entry.data = file->data() + sizeof(header);
+	entry.size = static_cast<size_t>(header.payloadSize);
+
+	m_hits++;
+
+	return true;
+}
+
+void ShaderCache::store(uint64_t key, const void* data, size_t size) {
+	ShaderCacheFileHeader header;
+	memcpy(header.magic, kShaderCacheMagic, sizeof(kShaderCacheMagic));
+	header.format = kShaderCacheFormat;
+	header.key = key;
+	header.payloadSize = size;
+	header.payloadHash = hashBytes(data, size);
+
+	// unique per thread so concurrent stores of the same key don't write into each other
+	std::filesystem::path target = entryPath(key);
+	std::filesystem::path temporary = target;
+	temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(data), size);
+
+		if (!file.good()) {
+			return;
+		}
+	}
+
+	// a failed store only costs a compile next time
+	std::error_code error;
+	std::filesystem::rename(temporary, target, error);
+
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return;
+	}
+
+	m_stores++;
+}
+
+ShaderCacheStats ShaderCache::stats() const {
+	return { m_hits, m_misses, m_stores, m_rejected };
+}
+
+std::filesystem::path ShaderCache::entryPath(uint64_t key) const {
+	return m_directory / (formatShaderCacheKey(key) + m_extension);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Content-addressed on-disk cache for compiled shaders. No D3D12 or DXC in here, so the
+// keys and the file format can be checked on any platform.
+//
+// A key hashes everything that goes into a compile: the source, every file it includes
+// (recursively, by content), the target profile, the arguments and the compiler version.
+// Touching Common.hlsl therefore invalidates exactly the libraries including it. Entries
+// are <key>.dxil files (or another extension for other blobs), written to a temporary name and renamed so readers never see a
+// partial file, and read back through a memory mapping.
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 64-bit FNV-1a, seed chains calls
+const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = kHashSeed);
+
+// names in #include "..." and #include <...> lines, in order
+std::vector<std::string> scanIncludes(const std::string& source);
+
+struct ShaderSourceFile {
+	std::filesystem::path path;
+	std::string contents;
+	bool found = false; // a missing include is part of the key too, creating it changes the key
+};
+
+// The file followed by everything it includes, depth first and each file once. Includes are
+// looked up next to the including file, then in includeDirectories.
+std::vector<ShaderSourceFile> gatherShaderSources(const std::filesystem::path& file,
+	const std::vector<std::filesystem::path>& includeDirectories = {});
+
+struct ShaderCompileOptions {
+	std::string profile; // e.g. lib_6_3
+	std::vector<std::string> arguments; // compiler arguments, order matters
+	std::vector<std::string> defines; // NAME=VALUE
+	std::string compilerVersion;
+};
+
+uint64_t shaderCacheKey(const std::vector<ShaderSourceFile>& sources, const ShaderCompileOptions& options);
+
+// the part of the key the sources make up, the archive stores it to notice edited sources
+uint64_t shaderSourceHash(const std::vector<ShaderSourceFile>& sources, uint64_t seed = kHashSeed);
+
+std::string formatShaderCacheKey(uint64_t key);
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+	~MappedFile();
+
+	static std::unique_ptr<MappedFile> open(const std::filesystem::path& path);
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	MappedFile() = default;
+
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	void* m_file = nullptr; // Windows file and mapping handles
+	void* m_mapping = nullptr;
+};
+
+// A cached blob, valid as long as someone holds the mapping
+struct ShaderCacheEntry {
+	std::shared_ptr<MappedFile> file;
+	const void* data = nullptr;
+	size_t size = 0;
+};
+
+struct ShaderCacheStats {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t stores;
+	uint32_t rejected; // files that were there but truncated, corrupt or of another key
+};
+
+// Safe to use from several threads at once
+class ShaderCache {
+public:
+	// caches of different blobs can share a directory with different extensions
+	explicit ShaderCache(std::filesystem::path directory, std::string extension = ".dxil");
+
+	const std::filesystem::path& directory() const { return m_directory; }
+
+	// false if nothing valid is stored for the key
+	bool load(uint64_t key, ShaderCacheEntry& entry);
+	void store(uint64_t key, const void* data, size_t size);
+
+	ShaderCacheStats stats() const;
+
+private:
+	std::filesystem::path entryPath(uint64_t key) const;
+
+	std::filesystem::path m_directory;
+	std::string m_extension;
+	std::atomic<uint32_t> m_hits = 0;
+	std::atomic<uint32_t> m_misses = 0;
+	std::atomic<uint32_t> m_stores = 0;
+	std::atomic<uint32_t> m_rejected = 0;
+};
@@ -0,0 +1,74 @@
+// Build time shader compiler: compiles every shader variant the app can use and packs them
+// into one archive the app maps at startup.
+//
+// usage: shaderpack <output archive>, run from the directory holding shaders/
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#include "jobs.h"
+#include "shaderarchive.h"
+#include "shaders.h"
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		fprintf(stderr, "usage: shaderpack <output archive>\n");
+		return 1;
+	}
+
+	JobSystem jobs;
+	ShaderCompiler compiler;
+	compiler.init({});
+
+	// every variant of every shader, whatever features the app gets started with
+	std::vector<ShaderCompileJob> shaders;
+
+	for (const ShaderCompileJob& shader : applicationShaders()) {
+		for (uint32_t features = 0; features <= shader.features; features++) {
+			if ((features & shader.features) == features) {
+				shaders.push_back(shaderVariant(shader, features));
+			}
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	try {
+		compiler.compileAll(jobs, shaders);
+	}
+	catch (const std::exception& error) {
+		fprintf(stderr, "%s\n", error.what());
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ShaderArchiveWriter writer;
+
+	for (const ShaderCompileJob& shader : shaders) {
+		uint64_t sourceHash = shaderSourceHash(gatherShaderSources(shader.fileName));
+
+		if (shader.library) {
+			writer.add(shaderArchiveName(shader), shader.library->GetBufferPointer(), shader.library->GetBufferSize(),
+				sourceHash);
+
+			// reflected here so the app doesn't have to for the libraries it loads from the archive
+			std::vector<uint8_t> bindings = serializeLibraryBindings(shader.bindings);
+			writer.add(shaderBindingsArchiveName(shader), bindings.data(), bindings.size(), sourceHash);
+		}
+		else {
+			writer.add(shaderArchiveName(shader), shader.bytecode->GetBufferPointer(), shader.bytecode->GetBufferSize(),
+				sourceHash);
+		}
+	}
+
+	if (!writer.write(argv[1])) {
+		fprintf(stderr, "shaderpack: can't write %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("%s", formatShaderCompileReport(shaders, seconds).c_str());
+
+	return 0;
+}
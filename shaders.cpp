@@ -0,0 +1,507 @@
+#include "shaders.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#include <d3d12shader.h>
+#include <winver.h>
+
+#include "helpers.h"
+
+namespace {
+	// IDxcBlob or ID3DBlob over part of a mapped file (cache entry or archive), keeps the file
+	// mapped for as long as D3D12 or anyone else holds a reference
+	template <typename Interface>
+	class MappedBlob : public Interface {
+	public:
+		MappedBlob(std::shared_ptr<MappedFile> file, const void* data, size_t size)
+			: m_file(std::move(file)), m_data(data), m_size(size) {}
+
+		// the new blob starts out with the one reference handed to the caller
+		static ComPtr<Interface> create(std::shared_ptr<MappedFile> file, const void* data, size_t size) {
+			ComPtr<Interface> blob;
+			blob.Attach(new MappedBlob(std::move(file), data, size));
+
+			return blob;
+		}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+			if (!object) {
+				return E_POINTER;
+			}
+
+			if (riid == __uuidof(IUnknown) || riid == __uuidof(Interface)) {
+				*object = static_cast<Interface*>(this);
+				AddRef();
+				return S_OK;
+			}
+
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override {
+			return ++m_references;
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override {
+			ULONG references = --m_references;
+
+			if (references == 0) {
+				delete this;
+			}
+
+			return references;
+		}
+
+		LPVOID STDMETHODCALLTYPE GetBufferPointer() override {
+			return const_cast<void*>(m_data);
+		}
+
+		SIZE_T STDMETHODCALLTYPE GetBufferSize() override {
+			return m_size;
+		}
+
+	private:
+		std::shared_ptr<MappedFile> m_file;
+		const void* m_data;
+		size_t m_size;
+		std::atomic<ULONG> m_references = 1;
+	};
+
+	std::wstring widen(const std::string& text) {
+		return std::wstring(text.begin(), text.end());
+	}
+
+	// NAME=VALUE, a define without a value is 1 like on the command line
+	std::pair<std::string, std::string> splitDefine(const std::string& define) {
+		size_t equals = define.find('=');
+
+		if (equals == std::string::npos) {
+			return { define, "1" };
+		}
+
+		return { define.substr(0, equals), define.substr(equals + 1) };
+	}
+
+	// File version and size of the dxcompiler.dll the loader would pick, read from disk so a cache
+	// hit never loads it. Empty if it can't be found, the compile that follows reports that.
+	std::string dxcompilerVersion() {
+		wchar_t path[MAX_PATH];
+
+		if (SearchPathW(nullptr, L"dxcompiler.dll", nullptr, MAX_PATH, path, nullptr) == 0) {
+			return "";
+		}
+
+		std::string version;
+		DWORD handle = 0;
+		DWORD infoSize = GetFileVersionInfoSizeW(path, &handle);
+		std::vector<uint8_t> info(infoSize);
+		VS_FIXEDFILEINFO* fileInfo = nullptr;
+		UINT fileInfoSize = 0;
+
+		if (infoSize > 0 && GetFileVersionInfoW(path, 0, infoSize, info.data()) &&
+			VerQueryValueW(info.data(), L"\\", reinterpret_cast<void**>(&fileInfo), &fileInfoSize) && fileInfo) {
+			version = std::to_string(HIWORD(fileInfo->dwFileVersionMS)) + "." + std::to_string(LOWORD(fileInfo->dwFileVersionMS)) +
+				"." + std::to_string(HIWORD(fileInfo->dwFileVersionLS)) + "." + std::to_string(LOWORD(fileInfo->dwFileVersionLS));
+		}
+
+		// builds of the compiler don't always bump the version, the size tells most of them apart
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(path, error);
+
+		return version + "/" + std::to_string(error ? 0 : size);
+	}
+
+	// the log goes with the exception, a hot reload only logs it where startup shows it
+	void throwCompileErrors(const void* text, size_t size) {
+		std::string message = "Shader Compiler Error:\n";
+		message.append(static_cast<const char*>(text), size);
+
+		throw std::runtime_error(message);
+	}
+}
+
+void ShaderCompiler::init(const std::filesystem::path& cacheDirectory) {
+	if (!cacheDirectory.empty()) {
+		m_cache = std::make_unique<ShaderCache>(cacheDirectory);
+		m_bindingsCache = std::make_unique<ShaderCache>(cacheDirectory, ".bindings");
+	}
+}
+
+const std::string& ShaderCompiler::compilerVersion() {
+	// a new dxcompiler.dll may generate different code for the same source, it's told apart by
+	// the file so that checking the cache doesn't create a compiler
+	std::call_once(m_compilerVersionOnce, [this]() {
+		m_compilerVersion = dxcompilerVersion();
+	});
+
+	return m_compilerVersion;
+}
+
+ComPtr<IDxcBlob> ShaderCompiler::compileLibrary(const std::filesystem::path& fileName,
+	std::vector<ExportBindings>& bindings, const std::string& profile, const std::vector<std::string>& arguments,
+	const std::vector<std::string>& defines) {
+	std::vector<ShaderSourceFile> sources = gatherShaderSources(fileName);
+
+	if (!sources[0].found) {
+		throw std::logic_error("Cannot find shader file");
+	}
+
+	ShaderCompileOptions options = { profile, arguments, defines, compilerVersion() };
+
+	uint64_t key = 0;
+
+	if (m_cache) {
+		key = shaderCacheKey(sources, options);
+		ShaderCacheEntry entry;
+		ShaderCacheEntry bindingsEntry;
+
+		// without its bindings the library is no use, compiling gets both
+		if (m_cache->load(key, entry) && m_bindingsCache->load(key, bindingsEntry) &&
+			parseLibraryBindings(static_cast<const uint8_t*>(bindingsEntry.data), bindingsEntry.size, bindings)) {
+			return MappedBlob<IDxcBlob>::create(entry.file, entry.data, entry.size);
+		}
+	}
+
+	std::unique_ptr<Instance> instance = acquireInstance();
+	ComPtr<IDxcBlob> blob;
+
+	try {
+		blob = compile(*instance, fileName, sources[0].contents, options);
+	}
+	catch (...) {
+		releaseInstance(std::move(instance));
+		throw;
+	}
+
+	releaseInstance(std::move(instance));
+
+	bindings = reflectLibrary(blob.Get());
+
+	if (m_cache) {
+		std::vector<uint8_t> serializedBindings = serializeLibraryBindings(bindings);
+
+		m_cache->store(key, blob->GetBufferPointer(), blob->GetBufferSize());
+		m_bindingsCache->store(key, serializedBindings.data(), serializedBindings.size());
+	}
+
+	return blob;
+}
+
+ComPtr<ID3DBlob> ShaderCompiler::compileRaster(const std::filesystem::path& fileName, const std::string& entryPoint,
+	const std::string& profile, const std::vector<std::string>& defines) {
+	#if defined(_DEBUG)
+		// Enable better shader debugging with the graphics debugging tools.
+		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+	#else
+		UINT compileFlags = 0;
+	#endif
+
+	std::vector<std::pair<std::string, std::string>> splitDefines;
+	for (const std::string& define : defines) {
+		splitDefines.push_back(splitDefine(define));
+	}
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const auto& define : splitDefines) {
+		macros.push_back({ define.first.c_str(), define.second.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	// FXC keeps no state between calls, it's fine to call from several threads
+	ComPtr<ID3DBlob> bytecode;
+	ComPtr<ID3DBlob> errors;
+	HRESULT result = D3DCompileFromFile(fileName.c_str(), macros.data(), nullptr, entryPoint.c_str(), profile.c_str(),
+		compileFlags, 0, &bytecode, &errors);
+
+	// warnings land in the error blob too, only a failed compile is reported
+	if (FAILED(result) && errors) {
+		throwCompileErrors(errors->GetBufferPointer(), errors->GetBufferSize());
+	}
+	throwIfFailed(result);
+
+	return bytecode;
+}
+
+void ShaderCompiler::compileAll(JobSystem& jobs, std::vector<ShaderCompileJob>& shaders, uint32_t maxThreads) {
+	// one shader per chunk, a slow one shouldn't hold up the ones queued behind it
+	jobs.parallelFor(shaders.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			compile(shaders[i]);
+		}
+	}, maxThreads);
+}
+
+void ShaderCompiler::compile(ShaderCompileJob& shader) {
+	auto start = std::chrono::steady_clock::now();
+
+	if (shader.entryPoint.empty()) {
+		shader.library = compileLibrary(shader.fileName, shader.bindings, shader.profile, shader.arguments,
+			shader.defines);
+	}
+	else {
+		shader.bytecode = compileRaster(shader.fileName, shader.entryPoint, shader.profile, shader.defines);
+	}
+
+	shader.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t ShaderCompiler::numInstances() const {
+	std::lock_guard<std::mutex> lock(m_instanceMutex);
+
+	return m_numInstances;
+}
+
+std::unique_ptr<ShaderCompiler::Instance> ShaderCompiler::acquireInstance() {
+	{
+		std::lock_guard<std::mutex> lock(m_instanceMutex);
+
+		if (!m_freeInstances.empty()) {
+			std::unique_ptr<Instance> instance = std::move(m_freeInstances.back());
+			m_freeInstances.pop_back();
+
+			return instance;
+		}
+
+		m_numInstances++;
+	}
+
+	// created outside the lock, loading the compiler takes a moment
+	auto instance = std::make_unique<Instance>();
+	throwIfFailed(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instance->compiler)));
+	throwIfFailed(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&instance->library)));
+	throwIfFailed(instance->library->CreateIncludeHandler(&instance->includeHandler));
+
+	return instance;
+}
+
+void ShaderCompiler::releaseInstance(std::unique_ptr<Instance> instance) {
+	std::lock_guard<std::mutex> lock(m_instanceMutex);
+
+	m_freeInstances.push_back(std::move(instance));
+}
+
+ComPtr<IDxcBlob> ShaderCompiler::compile(Instance& instance, const std::filesystem::path& fileName,
+	const std::string& source, const ShaderCompileOptions& options) {
+	ComPtr<IDxcBlobEncoding> textBlob;
+	throwIfFailed(instance.library->CreateBlobWithEncodingFromPinned(source.c_str(),
+		static_cast<UINT32>(source.size()), 0, &textBlob));
+
+	std::vector<std::wstring> arguments;
+	for (const std::string& argument : options.arguments) {
+		arguments.push_back(widen(argument));
+	}
+
+	std::vector<LPCWSTR> argumentPointers;
+	for (const std::wstring& argument : arguments) {
+		argumentPointers.push_back(argument.c_str());
+	}
+
+	std::vector<std::pair<std::wstring, std::wstring>> defines;
+	for (const std::string& define : options.defines) {
+		auto split = splitDefine(define);
+		defines.push_back({ widen(split.first), widen(split.second) });
+	}
+
+	std::vector<DxcDefine> definePointers;
+	for (const auto& define : defines) {
+		definePointers.push_back({ define.first.c_str(), define.second.c_str() });
+	}
+
+	ComPtr<IDxcOperationResult> result;
+	throwIfFailed(instance.compiler->Compile(textBlob.Get(), fileName.wstring().c_str(), L"", widen(options.profile).c_str(),
+		argumentPointers.data(), static_cast<UINT32>(argumentPointers.size()),
+		definePointers.data(), static_cast<UINT32>(definePointers.size()),
+		instance.includeHandler.Get(), &result));
+
+	HRESULT status;
+	throwIfFailed(result->GetStatus(&status));
+
+	if (FAILED(status)) {
+		ComPtr<IDxcBlobEncoding> errors;
+		throwIfFailed(result->GetErrorBuffer(&errors));
+
+		throwCompileErrors(errors->GetBufferPointer(), errors->GetBufferSize());
+	}
+
+	ComPtr<IDxcBlob> blob;
+	throwIfFailed(result->GetResult(&blob));
+
+	return blob;
+}
+
+const std::vector<std::string>& shaderFeatureNames() {
+	static const std::vector<std::string> kNames = { "VERTEX_COLOR", "ALPHA_TEST" };
+
+	return kNames;
+}
+
+std::vector<ShaderCompileJob> applicationShaders() {
+	std::vector<ShaderCompileJob> shaders(kNumShaders);
+
+	// RayGen traces as opaque unless alpha testing, so the any-hit shader isn't even looked at
+	shaders[kShaderRayGen] = { "shaders/RayGen.hlsl", "", "lib_6_3", {}, kFeatureAlphaTest };
+	shaders[kShaderHit] = { "shaders/Hit.hlsl", "", "lib_6_3", {}, kFeatureVertexColor | kFeatureAlphaTest };
+	shaders[kShaderMiss] = { "shaders/Miss.hlsl", "", "lib_6_3" };
+	shaders[kShaderVertex] = { "shaders/Vertex.hlsl", "VSMain", "vs_5_0" };
+	shaders[kShaderPixel] = { "shaders/Pixel.hlsl", "PSMain", "ps_5_0", {}, kFeatureVertexColor };
+
+	return shaders;
+}
+
+ShaderCompileJob shaderVariant(const ShaderCompileJob& shader, uint32_t enabledFeatures) {
+	ShaderCompileJob variant = { shader.fileName, shader.entryPoint, shader.profile, shader.arguments, shader.features };
+	variant.defines = permutationDefines(shaderFeatureNames(), shader.features, enabledFeatures);
+
+	return variant;
+}
+
+std::string shaderArchiveName(const ShaderCompileJob& shader) {
+	std::string name = shader.fileName.filename().string() + ":" + shader.entryPoint + ":" + shader.profile;
+
+	for (const std::string& argument : shader.arguments) {
+		name += " " + argument;
+	}
+
+	for (const std::string& define : shader.defines) {
+		name += " -D" + define;
+	}
+
+	return name;
+}
+
+std::string shaderBindingsArchiveName(const ShaderCompileJob& shader) {
+	return shaderArchiveName(shader) + "#bindings";
+}
+
+bool loadShaderFromArchive(const ShaderArchive& archive, ShaderCompileJob& shader) {
+	ShaderArchiveBlob blob;
+
+	if (!archive.find(shaderArchiveName(shader), blob)) {
+		return false;
+	}
+
+	// edited since the archive was built, compiling it is the only way to get what's on disk
+	std::vector<ShaderSourceFile> sources = gatherShaderSources(shader.fileName);
+
+	if (sources[0].found && shaderSourceHash(sources) != blob.sourceHash) {
+		return false;
+	}
+
+	if (shader.entryPoint.empty()) {
+		// an archive without the bindings would need DXC's reflection, compiling does that anyway
+		ShaderArchiveBlob bindings;
+		if (!archive.find(shaderBindingsArchiveName(shader), bindings) ||
+			!parseLibraryBindings(static_cast<const uint8_t*>(bindings.data), bindings.size, shader.bindings)) {
+			return false;
+		}
+
+		shader.library = MappedBlob<IDxcBlob>::create(blob.file, blob.data, blob.size);
+	}
+	else {
+		shader.bytecode = MappedBlob<ID3DBlob>::create(blob.file, blob.data, blob.size);
+	}
+	shader.seconds = 0.0;
+
+	return true;
+}
+
+namespace {
+	// DXC_PART_DXIL, not in every SDK's dxcapi.h
+	const UINT32 kDxilPart = 'D' | ('X' << 8) | ('I' << 16) | ('L' << 24);
+
+	ShaderBinding shaderBinding(ID3D12FunctionReflection* function, const D3D12_SHADER_INPUT_BIND_DESC& bind) {
+		ShaderBinding binding = { ShaderBindingType::Texture, bind.BindPoint, bind.BindCount, bind.Space, 0 };
+
+		switch (bind.Type) {
+		case D3D_SIT_CBUFFER: {
+			D3D12_SHADER_BUFFER_DESC bufferDesc;
+			throwIfFailed(function->GetConstantBufferByName(bind.Name)->GetDesc(&bufferDesc));
+			binding.type = ShaderBindingType::ConstantBuffer;
+			binding.size = bufferDesc.Size;
+			break;
+		}
+		case D3D_SIT_STRUCTURED:
+		case D3D_SIT_BYTEADDRESS:
+			binding.type = ShaderBindingType::Buffer;
+			break;
+		case D3D_SIT_UAV_RWTYPED:
+			binding.type = ShaderBindingType::RWTexture;
+			break;
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_APPEND_STRUCTURED:
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+			binding.type = ShaderBindingType::RWBuffer;
+			break;
+		case D3D_SIT_RTACCELERATIONSTRUCTURE:
+			binding.type = ShaderBindingType::AccelerationStructure;
+			break;
+		case D3D_SIT_SAMPLER:
+			binding.type = ShaderBindingType::Sampler;
+			break;
+		default: // textures, typed and texture buffers
+			break;
+		}
+
+		return binding;
+	}
+}
+
+std::vector<ExportBindings> reflectLibrary(IDxcBlob* library) {
+	ComPtr<IDxcContainerReflection> container;
+	throwIfFailed(DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(&container)));
+	throwIfFailed(container->Load(library));
+
+	UINT32 partIndex;
+	throwIfFailed(container->FindFirstPartKind(kDxilPart, &partIndex));
+
+	ComPtr<ID3D12LibraryReflection> reflection;
+	throwIfFailed(container->GetPartReflection(partIndex, IID_PPV_ARGS(&reflection)));
+
+	D3D12_LIBRARY_DESC libraryDesc;
+	throwIfFailed(reflection->GetDesc(&libraryDesc));
+
+	std::vector<ExportBindings> exports;
+
+	for (UINT i = 0; i < libraryDesc.FunctionCount; i++) {
+		ID3D12FunctionReflection* function = reflection->GetFunctionByIndex(static_cast<INT>(i));
+
+		D3D12_FUNCTION_DESC functionDesc;
+		throwIfFailed(function->GetDesc(&functionDesc));
+
+		ExportBindings exported;
+		exported.name = undecorateExportName(functionDesc.Name);
+
+		for (UINT resource = 0; resource < functionDesc.BoundResources; resource++) {
+			D3D12_SHADER_INPUT_BIND_DESC bind;
+			throwIfFailed(function->GetResourceBindingDesc(resource, &bind));
+			exported.bindings.push_back(shaderBinding(function, bind));
+		}
+
+		exports.push_back(std::move(exported));
+	}
+
+	return exports;
+}
+
+std::string formatShaderCompileReport(const std::vector<ShaderCompileJob>& shaders, double seconds) {
+	double slowest = 0.0;
+	double sum = 0.0;
+
+	for (const ShaderCompileJob& shader : shaders) {
+		slowest = std::max(slowest, shader.seconds);
+		sum += shader.seconds;
+	}
+
+	char line[256];
+	snprintf(line, sizeof(line), "shaders: %zu compiled in %.1fms, slowest %.1fms, serial sum %.1fms\n",
+		shaders.size(), seconds * 1000.0, slowest * 1000.0, sum * 1000.0);
+
+	return line;
+}
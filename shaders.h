@@ -0,0 +1,148 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3dcompiler.h>
+#include <dxcapi.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bindings.h"
+#include "jobs.h"
+#include "permutations.h"
+#include "shaderarchive.h"
+#include "shadercache.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One shader of a batch. An empty entry point makes it a DXIL library compiled with DXC,
+// otherwise it's a raster shader compiled with FXC.
+struct ShaderCompileJob {
+	std::filesystem::path fileName;
+	std::string entryPoint;
+	std::string profile;
+	std::vector<std::string> arguments; // DXC only
+	uint32_t features = 0; // ShaderFeature bits the shader is specialized on
+	std::vector<std::string> defines; // NAME=VALUE, the variant, see shaderVariant()
+
+	// results
+	ComPtr<IDxcBlob> library;
+	ComPtr<ID3DBlob> bytecode;
+	std::vector<ExportBindings> bindings; // libraries only, read from the archive or reflected after compiling
+	double seconds = 0.0; // ~0 when the library came from the cache
+};
+
+// DXC front end for the ray tracing libraries plus FXC for the raster shaders. Library compiles
+// go through the on-disk cache: a hit hands the mapped file to D3D12 as the blob and never
+// calls the compiler. The bindings reflected from a library are cached next to it under the
+// same key, so a hit doesn't load DXC for the reflection either.
+//
+// Thread safe. IDxcCompiler instances must not be shared between threads, so every compile
+// borrows one from a pool that grows to the number of compiles running at once.
+class ShaderCompiler {
+public:
+	// cacheDirectory empty compiles every time. DXC is loaded by the first compile, not here.
+	void init(const std::filesystem::path& cacheDirectory);
+
+	// the library and what its exports bind, reflected only after an actual compile
+	ComPtr<IDxcBlob> compileLibrary(const std::filesystem::path& fileName, std::vector<ExportBindings>& bindings,
+		const std::string& profile = "lib_6_3", const std::vector<std::string>& arguments = {},
+		const std::vector<std::string>& defines = {});
+
+	ComPtr<ID3DBlob> compileRaster(const std::filesystem::path& fileName, const std::string& entryPoint,
+		const std::string& profile, const std::vector<std::string>& defines = {});
+
+	// compiles one job in place
+	void compile(ShaderCompileJob& shader);
+
+	// Compiles the whole batch concurrently on the job system, at most maxThreads at a time
+	// (0 for every thread), so it takes about as long as its slowest shader. Rethrows the
+	// first compile error once all of them are done, a std::runtime_error with the log.
+	void compileAll(JobSystem& jobs, std::vector<ShaderCompileJob>& shaders, uint32_t maxThreads = 0);
+
+	// null without a cache
+	const ShaderCache* cache() const { return m_cache.get(); }
+
+	uint32_t numInstances() const;
+
+private:
+	struct Instance {
+		ComPtr<IDxcCompiler> compiler;
+		ComPtr<IDxcLibrary> library;
+		ComPtr<IDxcIncludeHandler> includeHandler;
+	};
+
+	const std::string& compilerVersion();
+
+	std::unique_ptr<Instance> acquireInstance();
+	void releaseInstance(std::unique_ptr<Instance> instance);
+
+	ComPtr<IDxcBlob> compile(Instance& instance, const std::filesystem::path& fileName, const std::string& source,
+		const ShaderCompileOptions& options);
+
+	std::once_flag m_compilerVersionOnce;
+	std::string m_compilerVersion;
+	std::unique_ptr<ShaderCache> m_cache;
+	std::unique_ptr<ShaderCache> m_bindingsCache; // serializeLibraryBindings() of each cached library
+
+	mutable std::mutex m_instanceMutex;
+	std::vector<std::unique_ptr<Instance>> m_freeInstances;
+	uint32_t m_numInstances = 0;
+};
+
+// everything the app compiles at startup, indexed by these
+enum ShaderIndex : uint32_t {
+	kShaderRayGen,
+	kShaderHit,
+	kShaderMiss,
+	kShaderVertex,
+	kShaderPixel,
+	kNumShaders
+};
+
+// permutation features of the whole pipeline, the defines are named in shaderFeatureNames()
+enum ShaderFeature : uint32_t {
+	kFeatureVertexColor = 1 << 0, // shade with interpolated vertex colors, flat otherwise
+	kFeatureAlphaTest = 1 << 1 // any-hit shader discarding hits on transparent vertices
+};
+
+const uint32_t kDefaultShaderFeatures = kFeatureVertexColor;
+
+const std::vector<std::string>& shaderFeatureNames();
+
+// base shaders without defines, each declaring the features it is specialized on
+std::vector<ShaderCompileJob> applicationShaders();
+
+// The shader specialized for the enabled features, only the ones it declares count. Two
+// feature sets giving the same variantKey() give the same variant.
+ShaderCompileJob shaderVariant(const ShaderCompileJob& shader, uint32_t enabledFeatures);
+inline uint32_t variantKey(const ShaderCompileJob& shader, uint32_t enabledFeatures) {
+	return shader.features & enabledFeatures;
+}
+
+// what a compile is stored as in the archive: file, entry point, profile, arguments and defines.
+// A library's bindings are stored next to it, under shaderBindingsArchiveName().
+std::string shaderArchiveName(const ShaderCompileJob& shader);
+std::string shaderBindingsArchiveName(const ShaderCompileJob& shader);
+
+// Fills in the shader's blob, and a library's bindings, straight from the mapped archive. False
+// if it isn't in there or was built from other sources than the ones on disk now. Without
+// sources on disk the archive counts.
+bool loadShaderFromArchive(const ShaderArchive& archive, ShaderCompileJob& shader);
+
+// What the exports of a ray tracing library bind, read from the reflection data DXC keeps in the
+// library. Only resources an export uses after compilation are in there, so a variant that
+// compiles a resource out doesn't list it. Runs when shaderpack builds the archive and for
+// libraries compiled at runtime, the archive and the shader cache hold the result for the others.
+std::vector<ExportBindings> reflectLibrary(IDxcBlob* library);
+
+// one line with the batch's wall time against its slowest shader and the serial sum
+std::string formatShaderCompileReport(const std::vector<ShaderCompileJob>& shaders, double seconds);
@@ -1,17 +1,49 @@
 #include "Common.hlsl"
 
+// permutation features, the app always defines both, the defaults are for compiling by hand
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 1
+#endif
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 0
+#endif
+
+#if VERTEX_COLOR || ALPHA_TEST
+// vertices and indices of the geometry hit, every geometry has its own hit record
 StructuredBuffer<Vertex> Vertex : register(t0);
+StructuredBuffer<uint> Indices : register(t1);
 
-[shader("closesthit")] 
-void ClosestHit(inout HitInfo payload, Attributes attrib) 
+float4 interpolateColor(Attributes attrib)
 {
   float3 barycentrics = float3(1.f - attrib.bary.x - attrib.bary.y, attrib.bary.x, attrib.bary.y);
 
-  uint vertId = 3 * PrimitiveIndex();
+  uint firstIndex = 3 * PrimitiveIndex();
 
-  float3 hitColor = Vertex[vertId + 0].color * barycentrics.x +
-      Vertex[vertId + 1].color * barycentrics.y +
-      Vertex[vertId + 2].color * barycentrics.z;
+  return Vertex[Indices[firstIndex + 0]].color * barycentrics.x +
+      Vertex[Indices[firstIndex + 1]].color * barycentrics.y +
+      Vertex[Indices[firstIndex + 2]].color * barycentrics.z;
+}
+#endif
+
+[shader("closesthit")] 
+void ClosestHit(inout HitInfo payload, Attributes attrib) 
+{
+#if VERTEX_COLOR
+  float3 hitColor = interpolateColor(attrib).rgb;
+#else
+  float3 hitColor = float3(0.8f, 0.8f, 0.8f);
+#endif
 
   payload.colorAndDistance = float4(hitColor, RayTCurrent());
 }
+
+#if ALPHA_TEST
+[shader("anyhit")]
+void AnyHit(inout HitInfo payload, Attributes attrib)
+{
+  if (interpolateColor(attrib).a < 0.5f)
+  {
+    IgnoreHit();
+  }
+}
+#endif
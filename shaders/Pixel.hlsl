@@ -1,3 +1,7 @@
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 1
+#endif
+
 struct PSInput
 {
     float4 position : SV_POSITION;
@@ -6,5 +10,9 @@ struct PSInput
 
 float4 PSMain(PSInput input) : SV_TARGET
 {
+#if VERTEX_COLOR
     return input.color;
+#else
+    return float4(0.8f, 0.8f, 0.8f, 1.0f);
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "Common.hlsl"
 
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 0
+#endif
+
 // Raytracing output texture, accessed as a UAV
 RWTexture2D< float4 > gOutput : register(u0);
 
@@ -27,12 +31,19 @@ void RayGen() {
   ray.TMin = 0;
   ray.TMax = 100000;
 
+  // without alpha testing every hit is final, forcing opaque skips any-hit shaders altogether
+#if ALPHA_TEST
+  const uint rayFlags = RAY_FLAG_FORCE_NON_OPAQUE;
+#else
+  const uint rayFlags = RAY_FLAG_FORCE_OPAQUE;
+#endif
+
   TraceRay(
 	  SceneBVH,
-	  RAY_FLAG_NONE,
+	  rayFlags,
 	  0xFF,
-	  0,
-	  0,
+	  0, // ray type
+	  1, // number of ray types, every geometry has that many hit records
 	  0,
 	  ray,
 	  payload);
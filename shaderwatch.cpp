@@ -0,0 +1,255 @@
+#include "shaderwatch.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// the same spelling for paths from the compiler's include scan and from the watcher
+	std::filesystem::path normalize(const std::filesystem::path& path) {
+		std::error_code error;
+		std::filesystem::path normalized = std::filesystem::weakly_canonical(path, error);
+
+		return error ? path.lexically_normal() : normalized;
+	}
+}
+
+void ShaderDependencyGraph::setFiles(uint32_t root, const std::vector<std::filesystem::path>& files) {
+	remove(root);
+
+	std::vector<std::filesystem::path>& rootFiles = m_files[root];
+
+	for (const std::filesystem::path& file : files) {
+		rootFiles.push_back(normalize(file));
+		m_dependents[rootFiles.back()].insert(root);
+	}
+}
+
+void ShaderDependencyGraph::remove(uint32_t root) {
+	auto found = m_files.find(root);
+
+	if (found == m_files.end()) {
+		return;
+	}
+
+	for (const std::filesystem::path& file : found->second) {
+		auto dependents = m_dependents.find(file);
+		dependents->second.erase(root);
+
+		if (dependents->second.empty()) {
+			m_dependents.erase(dependents);
+		}
+	}
+
+	m_files.erase(found);
+}
+
+std::vector<uint32_t> ShaderDependencyGraph::affectedRoots(const std::vector<std::filesystem::path>& changedFiles) const {
+	std::set<uint32_t> roots;
+
+	for (const std::filesystem::path& changed : changedFiles) {
+		std::filesystem::path path = normalize(changed);
+
+		for (const auto& [file, dependents] : m_dependents) {
+			if (file == path || file.parent_path() == path) {
+				roots.insert(dependents.begin(), dependents.end());
+			}
+		}
+	}
+
+	return std::vector<uint32_t>(roots.begin(), roots.end());
+}
+
+const std::vector<std::filesystem::path>& ShaderDependencyGraph::files(uint32_t root) const {
+	static const std::vector<std::filesystem::path> kNone;
+	auto found = m_files.find(root);
+
+	return found == m_files.end() ? kNone : found->second;
+}
+
+#ifdef _WIN32
+
+struct DirectoryWatcher::Platform {
+	HANDLE directory = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	alignas(DWORD) uint8_t buffer[16 * 1024];
+
+	bool read() {
+		return ::ReadDirectoryChangesW(directory, buffer, sizeof(buffer), FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr) != FALSE;
+	}
+};
+
+DirectoryWatcher::DirectoryWatcher() : m_platform(std::make_unique<Platform>()) {}
+
+DirectoryWatcher::~DirectoryWatcher() {
+	if (m_platform->directory != INVALID_HANDLE_VALUE) {
+		// the pending read writes into the buffer, it has to be gone before the buffer is
+		::CancelIoEx(m_platform->directory, &m_platform->overlapped);
+		DWORD bytes;
+		::GetOverlappedResult(m_platform->directory, &m_platform->overlapped, &bytes, TRUE);
+		::CloseHandle(m_platform->directory);
+	}
+	if (m_platform->overlapped.hEvent) {
+		::CloseHandle(m_platform->overlapped.hEvent);
+	}
+}
+
+bool DirectoryWatcher::open(const std::filesystem::path& directory) {
+	m_directory = directory;
+	m_platform->directory = ::CreateFileW(directory.wstring().c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+	if (m_platform->directory == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	m_platform->overlapped.hEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+	return m_platform->read();
+}
+
+bool DirectoryWatcher::isOpen() const {
+	return m_platform->directory != INVALID_HANDLE_VALUE;
+}
+
+std::vector<std::filesystem::path> DirectoryWatcher::poll() {
+	std::vector<std::filesystem::path> changes;
+
+	if (!isOpen()) {
+		return changes;
+	}
+
+	DWORD bytes = 0;
+	if (!::GetOverlappedResult(m_platform->directory, &m_platform->overlapped, &bytes, FALSE)) {
+		// ERROR_IO_INCOMPLETE, nothing happened yet
+		return changes;
+	}
+
+	if (bytes == 0) {
+		// the buffer overflowed, the individual changes are lost
+		changes.push_back(m_directory);
+	}
+
+	for (size_t offset = 0; bytes > 0;) {
+		auto* info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(m_platform->buffer + offset);
+		std::filesystem::path file = m_directory / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+
+		if (std::find(changes.begin(), changes.end(), file) == changes.end()) {
+			changes.push_back(file);
+		}
+
+		if (info->NextEntryOffset == 0) {
+			break;
+		}
+		offset += info->NextEntryOffset;
+	}
+
+	::ResetEvent(m_platform->overlapped.hEvent);
+	m_platform->read();
+
+	return changes;
+}
+
+#else
+
+struct DirectoryWatcher::Platform {
+	int inotify = -1;
+};
+
+DirectoryWatcher::DirectoryWatcher() : m_platform(std::make_unique<Platform>()) {}
+
+DirectoryWatcher::~DirectoryWatcher() {
+	if (m_platform->inotify >= 0) {
+		::close(m_platform->inotify);
+	}
+}
+
+bool DirectoryWatcher::open(const std::filesystem::path& directory) {
+	m_directory = directory;
+	m_platform->inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_platform->inotify < 0) {
+		return false;
+	}
+
+	// close-write rather than modify, so a file is reported once it has been saved completely
+	uint32_t events = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+	if (::inotify_add_watch(m_platform->inotify, directory.c_str(), events) < 0) {
+		::close(m_platform->inotify);
+		m_platform->inotify = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool DirectoryWatcher::isOpen() const {
+	return m_platform->inotify >= 0;
+}
+
+std::vector<std::filesystem::path> DirectoryWatcher::poll() {
+	std::vector<std::filesystem::path> changes;
+
+	if (!isOpen()) {
+		return changes;
+	}
+
+	alignas(inotify_event) char buffer[16 * 1024];
+
+	// non-blocking, read() fails with EAGAIN once the queue is empty
+	for (ssize_t bytes = ::read(m_platform->inotify, buffer, sizeof(buffer)); bytes > 0;
+		bytes = ::read(m_platform->inotify, buffer, sizeof(buffer))) {
+		for (ssize_t offset = 0; offset < bytes;) {
+			auto* event = reinterpret_cast<inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			// an overflowed queue lost the individual changes, that reports the directory itself
+			std::filesystem::path file = m_directory;
+
+			if (!(event->mask & IN_Q_OVERFLOW)) {
+				if (event->len == 0) {
+					continue;
+				}
+				file /= event->name;
+			}
+
+			if (std::find(changes.begin(), changes.end(), file) == changes.end()) {
+				changes.push_back(file);
+			}
+		}
+	}
+
+	return changes;
+}
+
+#endif
+
+void ChangeDebouncer::add(const std::vector<std::filesystem::path>& changes, Clock::time_point now) {
+	if (changes.empty()) {
+		return;
+	}
+
+	m_changes.insert(changes.begin(), changes.end());
+	m_lastChange = now;
+}
+
+std::vector<std::filesystem::path> ChangeDebouncer::take(Clock::time_point now) {
+	if (m_changes.empty() || now - m_lastChange < m_quietPeriod) {
+		return {};
+	}
+
+	std::vector<std::filesystem::path> changes(m_changes.begin(), m_changes.end());
+	m_changes.clear();
+
+	return changes;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Shader hot reload support, no D3D12 in here: a watcher reporting changed files in the
+// shader directory (inotify on Linux, ReadDirectoryChangesW on Windows), a debouncer that
+// waits for an editor to finish saving, and the include graph that maps changed files to
+// the compiles reading them. Editing Common.hlsl rebuilds RayGen, Hit and Miss, editing
+// Pixel.hlsl only the raster pipeline.
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+// Which compiles (roots, any integer id) read which files
+class ShaderDependencyGraph {
+public:
+	// replaces what was known about root, files are the root's own file and its includes
+	void setFiles(uint32_t root, const std::vector<std::filesystem::path>& files);
+	void remove(uint32_t root);
+
+	// Roots reading any of the changed files, sorted. A changed directory stands for
+	// everything in it, watchers report that when they lost track of individual files.
+	std::vector<uint32_t> affectedRoots(const std::vector<std::filesystem::path>& changedFiles) const;
+
+	const std::vector<std::filesystem::path>& files(uint32_t root) const;
+
+private:
+	std::map<uint32_t, std::vector<std::filesystem::path>> m_files;
+	std::map<std::filesystem::path, std::set<uint32_t>> m_dependents;
+};
+
+// Non-recursive watch on one directory
+class DirectoryWatcher {
+public:
+	DirectoryWatcher();
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	bool open(const std::filesystem::path& directory);
+	bool isOpen() const;
+
+	// Files written, created, renamed or removed since the last call, each once. Never blocks.
+	std::vector<std::filesystem::path> poll();
+
+private:
+	struct Platform;
+
+	std::filesystem::path m_directory;
+	std::unique_ptr<Platform> m_platform;
+};
+
+// Collects changes until none came in for the quiet period, editors often save in steps
+// (truncate, write, rename) and a compile in between would see half a file
+class ChangeDebouncer {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit ChangeDebouncer(Clock::duration quietPeriod = std::chrono::milliseconds(100)) : m_quietPeriod(quietPeriod) {}
+
+	void add(const std::vector<std::filesystem::path>& changes, Clock::time_point now);
+
+	// everything collected once it has been quiet long enough, nothing before that
+	std::vector<std::filesystem::path> take(Clock::time_point now);
+
+private:
+	Clock::duration m_quietPeriod;
+	Clock::time_point m_lastChange;
+	std::set<std::filesystem::path> m_changes;
+};
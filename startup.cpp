@@ -0,0 +1,276 @@
+#include "startup.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+	double secondsBetween(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+		return std::chrono::duration<double>(end - begin).count();
+	}
+}
+
+StartupStep StartupStep::promise_type::get_return_object() {
+	state = std::make_shared<State>();
+	state->handle = Handle::from_promise(*this);
+
+	return StartupStep(state);
+}
+
+void StartupStep::FinalAwaiter::await_suspend(Handle handle) noexcept {
+	// the frame holds the state, take it out before the frame goes
+	std::shared_ptr<State> state = std::move(handle.promise().state);
+	handle.destroy();
+
+	state->graph->finish(std::move(state));
+}
+
+bool StartupStep::Awaiter::await_suspend(Handle awaiting) {
+	std::shared_ptr<State>& step = awaiting.promise().state;
+	step->dependencies.push_back(state->index);
+
+	std::lock_guard<std::mutex> lock(state->mutex);
+
+	if (state->finished) {
+		return false;
+	}
+
+	// from here on another thread can resume the step, nothing of it is touched after this
+	step->graph->suspend(step);
+	state->waiting.push_back(step);
+
+	return true;
+}
+
+void StartupStep::Awaiter::await_resume() const {
+	std::lock_guard<std::mutex> lock(state->mutex);
+
+	if (state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
+bool StartupStep::finished() const {
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+
+	return m_state->finished;
+}
+
+StartupGraph::StartupGraph(JobSystem& jobs) : m_jobs(jobs), m_start(std::chrono::steady_clock::now()) {
+}
+
+StartupGraph::~StartupGraph() {
+	// steps refer to the graph until they return, whatever they threw was reported by wait()
+	try {
+		wait();
+	}
+	catch (const std::exception&) {
+	}
+}
+
+StartupStep StartupGraph::add(const std::string& name, StartupStep step) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		step.m_state->graph = this;
+		step.m_state->index = static_cast<uint32_t>(m_steps.size());
+		step.m_state->name = name;
+		m_steps.push_back(step.m_state);
+	}
+
+	schedule(step.m_state);
+
+	return step;
+}
+
+void StartupGraph::MainThreadAwaiter::await_suspend(StartupStep::Handle awaiting) {
+	auto step = awaiting.promise().state;
+
+	graph->suspend(step);
+	step->mainThread = true;
+
+	std::lock_guard<std::mutex> lock(graph->m_mutex);
+	graph->m_mainThread.push_back(std::move(step));
+	graph->m_wake.notify_all();
+}
+
+void StartupGraph::wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (m_finished < m_steps.size() || !m_mainThread.empty()) {
+		if (!m_mainThread.empty()) {
+			StepState step = std::move(m_mainThread.front());
+			m_mainThread.pop_front();
+
+			lock.unlock();
+			resume(step);
+			lock.lock();
+			continue;
+		}
+
+		// without workers nothing else runs the steps, the queued resumptions run here
+		m_scheduled.erase(std::remove_if(m_scheduled.begin(), m_scheduled.end(),
+			[](const Task& task) { return task.finished(); }), m_scheduled.end());
+
+		if (m_jobs.numWorkers() == 0 && !m_scheduled.empty()) {
+			Task task = m_scheduled.front();
+
+			lock.unlock();
+			m_jobs.wait(task);
+			lock.lock();
+			continue;
+		}
+
+		m_wake.wait(lock);
+	}
+
+	// the step that failed first is the cause, the ones awaiting it rethrew its error
+	const StartupStep::State* failed = nullptr;
+
+	for (const StepState& step : m_steps) {
+		if (step->error && (!failed || step->end < failed->end)) {
+			failed = step.get();
+		}
+	}
+
+	if (failed) {
+		std::rethrow_exception(failed->error);
+	}
+}
+
+std::vector<StartupStepTiming> StartupGraph::timings() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<StartupStepTiming> timings;
+
+	for (const StepState& step : m_steps) {
+		timings.push_back({ step->name, std::max(step->start, 0.0), step->end, step->busy, step->mainThread,
+			step->error != nullptr, step->dependencies });
+	}
+
+	return timings;
+}
+
+void StartupGraph::schedule(StepState step) {
+	Task task = m_jobs.run([this, step]() { resume(step); });
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_scheduled.push_back(task);
+	m_wake.notify_all();
+}
+
+void StartupGraph::resume(const StepState& step) {
+	step->resumedAt = std::chrono::steady_clock::now();
+
+	if (step->start < 0.0) {
+		step->start = secondsBetween(m_start, step->resumedAt);
+	}
+
+	step->handle.resume();
+}
+
+// called by the step itself right before it suspends
+void StartupGraph::suspend(StepState& step) {
+	step->busy += secondsBetween(step->resumedAt, std::chrono::steady_clock::now());
+}
+
+void StartupGraph::finish(StepState step) {
+	std::vector<StepState> waiting;
+
+	{
+		std::lock_guard<std::mutex> lock(step->mutex);
+
+		auto now = std::chrono::steady_clock::now();
+		step->busy += secondsBetween(step->resumedAt, now);
+		step->end = secondsBetween(m_start, now);
+		step->handle = nullptr;
+		step->finished = true;
+		waiting.swap(step->waiting);
+	}
+
+	for (StepState& next : waiting) {
+		schedule(std::move(next));
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_finished++;
+	m_wake.notify_all();
+}
+
+std::vector<uint32_t> startupCriticalPath(const std::vector<StartupStepTiming>& steps) {
+	std::vector<uint32_t> path;
+
+	if (steps.empty()) {
+		return path;
+	}
+
+	uint32_t step = 0;
+
+	for (uint32_t i = 1; i < steps.size(); i++) {
+		if (steps[i].end > steps[step].end) {
+			step = i;
+		}
+	}
+
+	while (true) {
+		path.push_back(step);
+
+		const std::vector<uint32_t>& dependencies = steps[step].dependencies;
+
+		if (dependencies.empty()) {
+			break;
+		}
+
+		step = *std::max_element(dependencies.begin(), dependencies.end(),
+			[&](uint32_t a, uint32_t b) { return steps[a].end < steps[b].end; });
+	}
+
+	std::reverse(path.begin(), path.end());
+
+	return path;
+}
+
+std::string formatStartupTimeline(const std::vector<StartupStepTiming>& steps) {
+	double wall = 0.0;
+	double work = 0.0;
+
+	for (const StartupStepTiming& step : steps) {
+		wall = std::max(wall, step.end);
+		work += step.busy;
+	}
+
+	std::string criticalPath;
+
+	for (uint32_t step : startupCriticalPath(steps)) {
+		criticalPath += (criticalPath.empty() ? "" : " > ") + steps[step].name;
+	}
+
+	char line[256];
+	snprintf(line, sizeof(line), "startup: %zu steps in %.1fms, %.1fms of work (%.2fx), critical path %s\n",
+		steps.size(), wall * 1000.0, work * 1000.0, wall > 0.0 ? work / wall : 1.0, criticalPath.c_str());
+
+	std::string text = line;
+	text += "  step              start      end     busy\n";
+
+	std::vector<const StartupStepTiming*> byStart;
+
+	for (const StartupStepTiming& step : steps) {
+		byStart.push_back(&step);
+	}
+
+	std::stable_sort(byStart.begin(), byStart.end(),
+		[](const StartupStepTiming* a, const StartupStepTiming* b) { return a->start < b->start; });
+
+	for (const StartupStepTiming* step : byStart) {
+		std::string after;
+
+		for (uint32_t dependency : step->dependencies) {
+			after += (after.empty() ? "  after " : ", ") + steps[dependency].name;
+		}
+
+		snprintf(line, sizeof(line), "  %-14s %8.1f %8.1f %8.1f%s%s%s\n", step->name.c_str(),
+			step->start * 1000.0, step->end * 1000.0, step->busy * 1000.0,
+			step->mainThread ? "  main thread" : "", step->failed ? "  failed" : "", after.c_str());
+		text += line;
+	}
+
+	return text;
+}
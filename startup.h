@@ -0,0 +1,171 @@
+#pragma once
+
+// Startup as a dependency graph of C++20 coroutines run by the job system, no D3D12 in here.
+//
+// Every step is a coroutine returning StartupStep. It co_awaits the steps it needs, which
+// suspends it without holding a thread, and it's resumed on the job system once they're done,
+// so steps with no path between them run at the same time. A step that has to run on the thread
+// owning the window co_awaits mainThread() and continues inside that thread's wait().
+// Every step records when it ran and what it waited for, for formatStartupTimeline.
+//
+// StartupStep load(StartupGraph& startup, StartupStep device) {
+//     co_await device; // rethrows if the device step threw
+//     ...
+// }
+//
+// StartupStep device = startup.add("device", createDevice(startup));
+// startup.add("load", load(startup, device));
+// startup.wait();
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jobs.h"
+
+class StartupGraph;
+
+class StartupStep {
+	struct State;
+
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	// destroys the frame once the step returned, what it shares with others is in State
+	struct FinalAwaiter {
+		bool await_ready() noexcept { return false; }
+		void await_suspend(Handle handle) noexcept;
+		void await_resume() noexcept {}
+	};
+
+	struct promise_type {
+		std::shared_ptr<State> state;
+
+		StartupStep get_return_object();
+		std::suspend_always initial_suspend() noexcept { return {}; } // started by StartupGraph::add
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { state->error = std::current_exception(); }
+	};
+
+	// Suspends the awaiting step until this one returned, rethrows what it threw
+	struct Awaiter {
+		std::shared_ptr<State> state;
+
+		bool await_ready() const { return false; }
+		bool await_suspend(Handle awaiting);
+		void await_resume() const;
+	};
+
+	StartupStep() = default;
+
+	bool valid() const { return m_state != nullptr; }
+	bool finished() const;
+
+	Awaiter operator co_await() const { return Awaiter{ m_state }; }
+
+private:
+	friend class StartupGraph;
+
+	struct State {
+		std::mutex mutex; // guards finished, error and waiting
+		Handle handle; // until the step returned
+		StartupGraph* graph = nullptr;
+		uint32_t index = 0;
+		std::string name;
+		bool finished = false;
+		std::exception_ptr error;
+		std::vector<std::shared_ptr<State>> waiting; // steps suspended on this one
+
+		// only touched by whoever runs the step at the time
+		std::chrono::steady_clock::time_point resumedAt;
+		double start = -1.0;
+		double end = 0.0;
+		double busy = 0.0;
+		bool mainThread = false;
+		std::vector<uint32_t> dependencies;
+	};
+
+	explicit StartupStep(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+	std::shared_ptr<State> m_state;
+};
+
+struct StartupStepTiming {
+	std::string name;
+	double start; // seconds from the graph's creation to when the step first ran
+	double end; // ... to when it returned
+	double busy; // seconds it ran, without the time it was suspended
+	bool mainThread; // continued on the main thread
+	bool failed;
+	std::vector<uint32_t> dependencies; // indices of the steps it awaited, in the order of add()
+};
+
+class StartupGraph {
+public:
+	explicit StartupGraph(JobSystem& jobs);
+	~StartupGraph();
+
+	StartupGraph(const StartupGraph&) = delete;
+	StartupGraph& operator=(const StartupGraph&) = delete;
+
+	// Names the step and starts it on the job system, every step has to be added
+	StartupStep add(const std::string& name, StartupStep step);
+
+	// co_await startup.mainThread() continues the step on the thread in wait()
+	struct MainThreadAwaiter {
+		StartupGraph* graph;
+
+		bool await_ready() const { return false; }
+		void await_suspend(StartupStep::Handle awaiting);
+		void await_resume() const {}
+	};
+
+	MainThreadAwaiter mainThread() { return MainThreadAwaiter{ this }; }
+
+	// Runs the steps asking for the main thread until every step returned, then rethrows the
+	// error of the first step that failed. A pool without workers runs all steps in here.
+	void wait();
+
+	// in the order of add(), complete once wait() returned
+	std::vector<StartupStepTiming> timings() const;
+
+private:
+	friend class StartupStep;
+
+	typedef std::shared_ptr<StartupStep::State> StepState;
+
+	void schedule(StepState step);
+	void resume(const StepState& step);
+	void suspend(StepState& step);
+	void finish(StepState step);
+
+	JobSystem& m_jobs;
+	std::chrono::steady_clock::time_point m_start;
+
+	mutable std::mutex m_mutex; // guards everything below
+	std::condition_variable m_wake; // a step returned or wants the main thread
+	std::vector<StepState> m_steps;
+	std::deque<StepState> m_mainThread;
+	std::vector<Task> m_scheduled; // resumptions queued on the job system, for a pool without workers
+	size_t m_finished = 0;
+};
+
+// The steps that decided how long startup took: from the one that returned last, back through
+// the dependency each was waiting for last
+std::vector<uint32_t> startupCriticalPath(const std::vector<StartupStepTiming>& steps);
+
+// When every step ran and on what it waited, with the critical path and how much of the work
+// overlapped, e.g.
+// startup: 7 steps in 184.2ms, 297.5ms of work (1.62x), critical path shaders > raster pso
+//   step              start      end     busy
+//   window              0.0      6.1      6.1  main thread
+std::string formatStartupTimeline(const std::vector<StartupStepTiming>& steps);
@@ -0,0 +1,145 @@
+#include "check.h"
+
+#include "aliasing.h"
+
+namespace {
+	const uint64_t kAlignment = 64 * 1024;
+
+	TransientResourceDesc resource(const char* name, uint64_t sizeInBytes, uint32_t firstPass, uint32_t lastPass) {
+		TransientResourceDesc desc;
+		desc.name = name;
+		desc.sizeInBytes = sizeInBytes;
+		desc.firstPass = firstPass;
+		desc.lastPass = lastPass;
+		return desc;
+	}
+
+	bool memoryOverlaps(const TransientHeapLayout& layout, const std::vector<TransientResourceDesc>& resources,
+		size_t a, size_t b) {
+		return layout.offsets[a] < layout.offsets[b] + resources[b].sizeInBytes &&
+			layout.offsets[b] < layout.offsets[a] + resources[a].sizeInBytes;
+	}
+}
+
+TEST(disjointLifetimesShareMemory) {
+	std::vector<TransientResourceDesc> resources = {
+		resource("a", kAlignment, 0, 1),
+		resource("b", kAlignment, 2, 3),
+	};
+
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	CHECK(layout.offsets[0] == 0);
+	CHECK(layout.offsets[1] == 0);
+	CHECK(layout.heapSize == kAlignment);
+	CHECK(layout.committedSize == 2 * kAlignment);
+}
+
+TEST(overlappingLifetimesDontShareMemory) {
+	std::vector<TransientResourceDesc> resources = {
+		resource("a", kAlignment, 0, 2),
+		resource("b", kAlignment, 2, 3), // the interval is inclusive, both live in pass 2
+	};
+
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	CHECK(!memoryOverlaps(layout, resources, 0, 1));
+	CHECK(layout.heapSize == 2 * kAlignment);
+	CHECK(layout.barriers.empty());
+}
+
+TEST(offsetsKeepTheAlignment) {
+	std::vector<TransientResourceDesc> resources = {
+		resource("a", 100, 0, 1),
+		resource("b", 5000, 0, 1),
+		resource("c", 100, 0, 1),
+	};
+	resources[1].alignment = 4096;
+	resources[2].alignment = 4096;
+
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		CHECK(layout.offsets[i] % resources[i].alignment == 0);
+
+		for (size_t j = i + 1; j < resources.size(); j++) {
+			CHECK(!memoryOverlaps(layout, resources, i, j));
+		}
+	}
+
+	// b goes first as the largest, c fits in the next 4K, a needs the next 64K boundary
+	CHECK(layout.offsets[1] == 0);
+	CHECK(layout.offsets[2] == 8192);
+	CHECK(layout.offsets[0] == kAlignment);
+	CHECK(layout.committedSize == kAlignment + 8192 + 4096);
+}
+
+TEST(aliasingBarrierNamesThePreviousResource) {
+	std::vector<TransientResourceDesc> resources = {
+		resource("b", kAlignment, 2, 3),
+		resource("a", kAlignment, 0, 1),
+		resource("c", kAlignment, 0, 0), // different memory than a, shares it with b too
+	};
+
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	// a and c overlap in pass 0, b takes the memory of one of them
+	CHECK(layout.offsets[1] != layout.offsets[2]);
+	CHECK(layout.barriers.size() == 1);
+
+	if (layout.barriers.size() == 1) {
+		uint32_t previous = layout.offsets[0] == layout.offsets[1] ? 1 : 2;
+
+		CHECK(layout.barriers[0].pass == 2);
+		CHECK(layout.barriers[0].before == previous);
+		CHECK(layout.barriers[0].after == 0);
+	}
+}
+
+TEST(aliasingBarrierOverSeveralResourcesIsNull) {
+	std::vector<TransientResourceDesc> resources = {
+		resource("a", kAlignment, 0, 1),
+		resource("b", kAlignment, 0, 1),
+		resource("c", 2 * kAlignment, 2, 3), // covers both a and b
+		resource("d", kAlignment, 4, 4),
+	};
+
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	CHECK(layout.heapSize == 2 * kAlignment);
+	CHECK(layout.barriers.size() == 2);
+
+	if (layout.barriers.size() == 2) {
+		CHECK(layout.barriers[0].pass == 2);
+		CHECK(layout.barriers[0].before == kNoTransientResource);
+		CHECK(layout.barriers[0].after == 2);
+
+		// d follows c and also sits where a or b was, still more than one predecessor
+		CHECK(layout.barriers[1].pass == 4);
+		CHECK(layout.barriers[1].before == kNoTransientResource);
+		CHECK(layout.barriers[1].after == 3);
+	}
+}
+
+TEST(syntheticFrameNeverAliasesLiveResources) {
+	std::vector<TransientResourceDesc> resources = buildSyntheticTransientFrame(1920, 1080);
+	TransientHeapLayout layout = packTransientResources(resources);
+
+	CHECK(layout.heapSize < layout.committedSize);
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		CHECK(layout.offsets[i] % resources[i].alignment == 0);
+		CHECK(layout.offsets[i] + resources[i].sizeInBytes <= layout.heapSize);
+
+		for (size_t j = i + 1; j < resources.size(); j++) {
+			bool livesOverlap = resources[i].firstPass <= resources[j].lastPass &&
+				resources[j].firstPass <= resources[i].lastPass;
+
+			CHECK(!livesOverlap || !memoryOverlaps(layout, resources, i, j));
+		}
+	}
+
+	for (size_t i = 1; i < layout.barriers.size(); i++) {
+		CHECK(layout.barriers[i - 1].pass <= layout.barriers[i].pass);
+	}
+}
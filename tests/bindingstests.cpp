@@ -0,0 +1,77 @@
+#include "check.h"
+
+#include <stdexcept>
+
+#include "bindings.h"
+
+namespace {
+	std::vector<ExportBindings> hitLibraryBindings() {
+		return {
+			{ "ClosestHit", {
+				{ ShaderBindingType::Buffer, 0, 1, 0, 0 },
+				{ ShaderBindingType::ConstantBuffer, 0, 1, 0, 16 },
+				{ ShaderBindingType::Texture, 2, 4, 1, 0 },
+			} },
+			{ "AnyHit", {} },
+		};
+	}
+}
+
+TEST(libraryBindingsRoundTrip) {
+	std::vector<ExportBindings> exports = hitLibraryBindings();
+	std::vector<uint8_t> bytes = serializeLibraryBindings(exports);
+
+	std::vector<ExportBindings> parsed;
+	CHECK(parseLibraryBindings(bytes.data(), bytes.size(), parsed));
+	CHECK(parsed.size() == 2);
+	CHECK(findExportBindings(parsed, L"ClosestHit") == exports[0].bindings);
+	CHECK(findExportBindings(parsed, L"AnyHit").empty());
+
+	bool threw = false;
+	try {
+		findExportBindings(parsed, L"Miss");
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST(libraryBindingsRejectTruncatedBytes) {
+	std::vector<uint8_t> bytes = serializeLibraryBindings(hitLibraryBindings());
+	std::vector<ExportBindings> parsed;
+
+	for (size_t size = 0; size < bytes.size(); size++) {
+		CHECK(!parseLibraryBindings(bytes.data(), size, parsed));
+		CHECK(parsed.empty());
+	}
+
+	// trailing bytes mean the sizes are off
+	bytes.push_back(0);
+	CHECK(!parseLibraryBindings(bytes.data(), bytes.size(), parsed));
+
+	// a count far beyond the bytes is rejected before anything gets allocated
+	bytes = serializeLibraryBindings(hitLibraryBindings());
+	bytes[0] = 0xff;
+	bytes[3] = 0xff;
+	CHECK(!parseLibraryBindings(bytes.data(), bytes.size(), parsed));
+}
+
+TEST(localRootConstantsAreLimitedByTheRecordStride) {
+	// more than the 64 DWORDs of a global signature in root descriptors
+	std::vector<ShaderBinding> bindings;
+	for (uint32_t i = 0; i < 40; i++) {
+		bindings.push_back({ ShaderBindingType::Buffer, i, 1, 0, 0 });
+	}
+	bindings.push_back({ ShaderBindingType::ConstantBuffer, 0, 1, 0, 256 });
+	bindings.push_back({ ShaderBindingType::ConstantBuffer, 1, 1, 0, 4000 });
+
+	LocalRootLayout layout = planLocalRootLayout(bindings, 4096);
+
+	CHECK(layout.parameters.size() == 42);
+	CHECK(layout.parameters[40].binding.bindPoint == 1 && layout.parameters[40].kind == nv_helpers_dx12::RootParameterKind::Descriptor);
+	CHECK(layout.parameters[41].binding.bindPoint == 0 && layout.parameters[41].kind == nv_helpers_dx12::RootParameterKind::Constants);
+	CHECK(layout.parameters[41].num32BitValues == 64);
+	CHECK(layout.argumentsSize == 41 * 8 + 256);
+	CHECK(localRootLayoutCost(layout).WithinBudget(true));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Minimal harness for the CPU tests: nothing in tests/ needs a GPU or a window. The few that
+// include D3D12 headers only use its types and stand in for the objects, CMake builds those on
+// Windows only. A TEST registers itself, CHECK reports a failure and carries on.
+//
+// TEST(packsDisjointLifetimes) {
+//     CHECK(layout.offsets[0] == layout.offsets[1]);
+// }
+
+#include <cstdio>
+#include <vector>
+
+struct TestCase {
+	const char* name;
+	void (*run)();
+};
+
+std::vector<TestCase>& testCases();
+int registerTest(const char* name, void (*run)());
+void reportFailure(const char* file, int line, const char* expression);
+
+#define TEST(name) \
+	static void name(); \
+	static const int name##Registered = registerTest(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			reportFailure(__FILE__, __LINE__, #expression); \
+		} \
+	} while (false)
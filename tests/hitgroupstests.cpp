@@ -0,0 +1,68 @@
+#include "check.h"
+
+#include <stdexcept>
+
+#include "hitgroups.h"
+
+namespace {
+	bool sameRecord(const HitGroupRecord& a, const HitGroupRecord& b) {
+		return a.instance == b.instance && a.geometry == b.geometry && a.rayType == b.rayType;
+	}
+}
+
+TEST(hitGroupRecordsFollowTheInstances) {
+	HitGroupTableLayout layout = layoutHitGroupTable({ 2, 0, 3, 1 }, 2);
+
+	CHECK(layout.instanceContributions == std::vector<uint32_t>({ 0, 4, 4, 10 }));
+	CHECK(layout.numRecords == 12);
+	CHECK(hitGroupRecordIndex(layout, 2, 1, 1) == 7);
+	CHECK(hitGroupRecordIndex(layout, 3, 0, 0) == 10);
+}
+
+TEST(locateHitGroupRecordInvertsTheIndex) {
+	// instances without geometry at the start, in the middle, in a row and at the end
+	const std::vector<uint32_t> geometriesPerInstance = { 0, 3, 1, 0, 0, 5, 1, 0, 2, 0 };
+
+	for (uint32_t numRayTypes = 1; numRayTypes <= 3; numRayTypes++) {
+		HitGroupTableLayout layout = layoutHitGroupTable(geometriesPerInstance, numRayTypes);
+		uint32_t expectedRecord = 0;
+
+		for (uint32_t instance = 0; instance < geometriesPerInstance.size(); instance++) {
+			for (uint32_t geometry = 0; geometry < geometriesPerInstance[instance]; geometry++) {
+				for (uint32_t rayType = 0; rayType < numRayTypes; rayType++) {
+					uint32_t record = hitGroupRecordIndex(layout, instance, geometry, rayType);
+
+					// records are handed out in instance, geometry, ray type order without gaps
+					CHECK(record == expectedRecord++);
+					CHECK(sameRecord(locateHitGroupRecord(layout, record), { instance, geometry, rayType }));
+				}
+			}
+		}
+
+		CHECK(layout.numRecords == expectedRecord);
+	}
+}
+
+TEST(hitGroupTableIsLimitedByTheInstanceField) {
+	// exactly the 2^24 records InstanceContributionToHitGroupIndex can address
+	HitGroupTableLayout layout = layoutHitGroupTable({ kMaxHitGroupRecords / 4, kMaxHitGroupRecords / 4 }, 2);
+	CHECK(layout.numRecords == kMaxHitGroupRecords);
+
+	const std::vector<std::vector<uint32_t>> tooLarge = {
+		{ kMaxHitGroupRecords / 4, kMaxHitGroupRecords / 4, 1 },
+		{ kMaxHitGroupRecords, 1 },
+		// more than 32 bits worth of records, the count must not wrap around
+		{ UINT32_MAX, UINT32_MAX },
+	};
+
+	for (const std::vector<uint32_t>& geometriesPerInstance : tooLarge) {
+		bool threw = false;
+		try {
+			layoutHitGroupTable(geometriesPerInstance, 2);
+		}
+		catch (const std::length_error&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+}
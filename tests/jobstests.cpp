@@ -0,0 +1,106 @@
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "jobs.h"
+
+TEST(tasksRunAfterTheirDependencies) {
+	JobSystem jobs(3);
+	std::atomic<int> order = 0;
+	int first = -1;
+	int second = -1;
+
+	Task a = jobs.run([&] { first = order++; });
+	Task b = jobs.run([&] { second = order++; }, { a });
+	jobs.wait(b);
+
+	CHECK(first == 0);
+	CHECK(second == 1);
+}
+
+TEST(waitRethrowsAndSkipsDependents) {
+	JobSystem jobs(2);
+	bool ran = false;
+
+	Task failing = jobs.run([] { throw std::runtime_error("failed"); });
+	Task dependent = jobs.run([&] { ran = true; }, { failing });
+
+	bool threw = false;
+	try {
+		jobs.wait(dependent);
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+
+	CHECK(threw);
+	CHECK(!ran);
+}
+
+TEST(parallelForCoversEveryIndexOnce) {
+	for (uint32_t workers : { 0u, 1u, 4u }) {
+		JobSystem jobs(workers);
+		std::vector<std::atomic<int>> hits(1000);
+
+		jobs.parallelFor(hits.size(), 7, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				hits[i]++;
+			}
+		});
+
+		bool once = true;
+		for (const auto& hit : hits) {
+			once = once && hit == 1;
+		}
+		CHECK(once);
+	}
+}
+
+// the render thread waiting on its own work must not pick up someone else's long task
+TEST(outsideThreadOnlyRunsWhatItWaitsFor) {
+	JobSystem jobs(1);
+	std::atomic<bool> release = false;
+	std::atomic<bool> blockerRunning = false;
+	std::thread::id ownThread;
+
+	// keeps the only worker busy so everything else stays queued
+	Task blocker = jobs.run([&] {
+		blockerRunning = true;
+		while (!release) {
+			std::this_thread::yield();
+		}
+	});
+
+	while (!blockerRunning) {
+		std::this_thread::yield();
+	}
+
+	Task unrelated = jobs.run([] {});
+	Task own = jobs.run([&] { ownThread = std::this_thread::get_id(); });
+
+	jobs.wait(own);
+
+	CHECK(ownThread == std::this_thread::get_id());
+	CHECK(!unrelated.finished());
+
+	release = true;
+	jobs.wait({ blocker, unrelated });
+}
+
+TEST(outsideThreadWaitsForDependenciesOnTheWorkers) {
+	JobSystem jobs(2);
+	std::thread::id dependencyThread;
+
+	Task dependency = jobs.run([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		dependencyThread = std::this_thread::get_id();
+	});
+	Task dependent = jobs.run([] {}, { dependency });
+
+	jobs.wait(dependent);
+
+	CHECK(dependencyThread != std::this_thread::get_id());
+}
@@ -0,0 +1,47 @@
+#include "check.h"
+
+#include <cstring>
+
+namespace {
+	int gFailures = 0;
+}
+
+std::vector<TestCase>& testCases() {
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+int registerTest(const char* name, void (*run)()) {
+	testCases().push_back({ name, run });
+	return 0;
+}
+
+void reportFailure(const char* file, int line, const char* expression) {
+	printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+	gFailures++;
+}
+
+// cputests [name], runs every test or the ones whose name contains the argument
+int main(int argc, char** argv) {
+	int failedTests = 0;
+	int ranTests = 0;
+
+	for (const TestCase& test : testCases()) {
+		if (argc > 1 && !strstr(test.name, argv[1])) {
+			continue;
+		}
+
+		int failures = gFailures;
+		test.run();
+		ranTests++;
+
+		if (gFailures != failures) {
+			printf("FAILED %s\n", test.name);
+			failedTests++;
+		}
+	}
+
+	printf("%d of %d tests passed\n", ranTests - failedTests, ranTests);
+
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include "check.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include "permutations.h"
+
+namespace {
+	const std::vector<std::string> kFeatureNames = { "VERTEX_COLOR", "ALPHA_TEST", "SHADOWS" };
+
+	bool throwsLogicError(const std::function<void()>& run) {
+		try {
+			run();
+		}
+		catch (const std::logic_error&) {
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST(variantCacheCompilesEachVariantOnce) {
+	VariantCache<std::shared_ptr<int>> cache;
+	std::atomic<int> compiles = 0;
+	std::atomic<bool> go = false;
+	std::vector<std::shared_ptr<int>> results(8);
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < results.size(); i++) {
+		threads.emplace_back([&, i]() {
+			while (!go) {
+				std::this_thread::yield();
+			}
+
+			results[i] = cache.get(1, 3, [&]() {
+				compiles++;
+				// long enough for the other threads to find the compile running
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				return std::make_shared<int>(42);
+			});
+		});
+	}
+
+	go = true;
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	CHECK(compiles == 1);
+	CHECK(cache.misses() == 1 && cache.hits() == 7);
+	for (const auto& result : results) {
+		CHECK(result && result == results[0]);
+	}
+
+	// other variants and other shaders are compiled on their own
+	CHECK(*cache.get(1, 1, []() { return std::make_shared<int>(1); }) == 1);
+	CHECK(*cache.get(2, 3, []() { return std::make_shared<int>(2); }) == 2);
+	CHECK(cache.size() == 3 && cache.contains(1, 3));
+
+	cache.invalidate(1);
+	CHECK(cache.size() == 1 && !cache.contains(1, 3) && cache.contains(2, 3));
+}
+
+TEST(variantCacheRetriesFailedCompiles) {
+	VariantCache<int> cache;
+
+	CHECK(throwsLogicError([&]() { cache.get(0, 0, []() -> int { throw std::logic_error("syntax error"); }); }));
+	CHECK(!cache.contains(0, 0) && cache.size() == 0);
+
+	CHECK(cache.get(0, 0, []() { return 5; }) == 5);
+	CHECK(cache.get(0, 0, []() { return 6; }) == 5);
+}
+
+TEST(featureMasksGiveDistinctDefines) {
+	const uint32_t declared = 0b111;
+	std::set<std::vector<std::string>> seen;
+
+	for (uint32_t enabled = 0; enabled < 8; enabled++) {
+		seen.insert(permutationDefines(kFeatureNames, declared, enabled));
+	}
+	CHECK(seen.size() == 8);
+
+	CHECK(permutationDefines(kFeatureNames, declared, 0b101) ==
+		std::vector<std::string>({ "VERTEX_COLOR=1", "ALPHA_TEST=0", "SHADOWS=1" }));
+
+	// a feature the shader doesn't declare makes no variant of its own
+	CHECK(permutationDefines(kFeatureNames, 0b010, 0b011) == permutationDefines(kFeatureNames, 0b010, 0b010));
+	CHECK(permutationDefines(kFeatureNames, 0b010, 0b001) == std::vector<std::string>({ "ALPHA_TEST=0" }));
+	CHECK(permutationDefines(kFeatureNames, 0, 0b111).empty());
+
+	// declaring a feature without a name is a bug in the shader list
+	CHECK(throwsLogicError([]() { permutationDefines(kFeatureNames, 0b1000, 0); }));
+}
+
+TEST(shaderFeaturesParseAndFormat) {
+	CHECK(parseShaderFeatures(kFeatureNames, "") == 0);
+	CHECK(parseShaderFeatures(kFeatureNames, "none") == 0);
+	CHECK(parseShaderFeatures(kFeatureNames, "ALPHA_TEST") == 0b010);
+	CHECK(parseShaderFeatures(kFeatureNames, "SHADOWS,VERTEX_COLOR") == 0b101);
+
+	for (uint32_t features = 0; features < 8; features++) {
+		CHECK(parseShaderFeatures(kFeatureNames, formatShaderFeatures(kFeatureNames, features)) == features);
+	}
+	CHECK(formatShaderFeatures(kFeatureNames, 0) == "none");
+
+	// unknown names are rejected rather than ignored, a typo on the command line would go unnoticed
+	CHECK(throwsLogicError([]() { parseShaderFeatures(kFeatureNames, "VERTEX_COLOUR"); }));
+	CHECK(throwsLogicError([]() { parseShaderFeatures(kFeatureNames, "ALPHA_TEST,vertex_color"); }));
+}
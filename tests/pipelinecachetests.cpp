@@ -0,0 +1,369 @@
+#include "check.h"
+
+#include <cstring>
+#include <string>
+
+#include "pipelinecache.h"
+
+namespace {
+	// the fields of D3D12_GRAPHICS_PIPELINE_STATE_DESC, enums as plain integers
+	struct TestBytecode {
+		const void* pShaderBytecode;
+		size_t BytecodeLength;
+	};
+
+	struct TestStreamOutputEntry {
+		uint32_t Stream;
+		const char* SemanticName;
+		uint32_t SemanticIndex;
+		uint8_t StartComponent;
+		uint8_t ComponentCount;
+		uint8_t OutputSlot;
+	};
+
+	struct TestRenderTargetBlend {
+		int BlendEnable;
+		int LogicOpEnable;
+		int SrcBlend;
+		int DestBlend;
+		int BlendOp;
+		int SrcBlendAlpha;
+		int DestBlendAlpha;
+		int BlendOpAlpha;
+		int LogicOp;
+		uint8_t RenderTargetWriteMask;
+	};
+
+	struct TestStencilFace {
+		int StencilFailOp;
+		int StencilDepthFailOp;
+		int StencilPassOp;
+		int StencilFunc;
+	};
+
+	struct TestInputElement {
+		const char* SemanticName;
+		uint32_t SemanticIndex;
+		int Format;
+		uint32_t InputSlot;
+		uint32_t AlignedByteOffset;
+		int InputSlotClass;
+		uint32_t InstanceDataStepRate;
+	};
+
+	struct TestPipelineDesc {
+		void* pRootSignature;
+		TestBytecode VS, PS, DS, HS, GS;
+		struct {
+			const TestStreamOutputEntry* pSODeclaration;
+			uint32_t NumEntries;
+			const uint32_t* pBufferStrides;
+			uint32_t NumStrides;
+			uint32_t RasterizedStream;
+		} StreamOutput;
+		struct {
+			int AlphaToCoverageEnable;
+			int IndependentBlendEnable;
+			TestRenderTargetBlend RenderTarget[8];
+		} BlendState;
+		uint32_t SampleMask;
+		struct {
+			int FillMode;
+			int CullMode;
+			int FrontCounterClockwise;
+			int DepthBias;
+			float DepthBiasClamp;
+			float SlopeScaledDepthBias;
+			int DepthClipEnable;
+			int MultisampleEnable;
+			int AntialiasedLineEnable;
+			uint32_t ForcedSampleCount;
+			int ConservativeRaster;
+		} RasterizerState;
+		struct {
+			int DepthEnable;
+			int DepthWriteMask;
+			int DepthFunc;
+			int StencilEnable;
+			uint8_t StencilReadMask;
+			uint8_t StencilWriteMask;
+			TestStencilFace FrontFace;
+			TestStencilFace BackFace;
+		} DepthStencilState;
+		struct {
+			const TestInputElement* pInputElementDescs;
+			uint32_t NumElements;
+		} InputLayout;
+		int IBStripCutValue;
+		int PrimitiveTopologyType;
+		uint32_t NumRenderTargets;
+		int RTVFormats[8];
+		int DSVFormat;
+		struct {
+			uint32_t Count;
+			uint32_t Quality;
+		} SampleDesc;
+		uint32_t NodeMask;
+		TestBytecode CachedPSO;
+		int Flags;
+	};
+
+	const char kVertexShader[] = "vertex shader";
+	const char kPixelShader[] = "pixel shader";
+	const char kRootSignature[] = "root signature";
+
+	const TestInputElement kInputElements[] = {
+		{ "POSITION", 0, 6, 0, 0, 0, 0 },
+		{ "COLOR", 0, 2, 0, 12, 0, 0 },
+	};
+	const TestStreamOutputEntry kStreamOutputEntries[] = {
+		{ 0, "POSITION", 0, 0, 4, 0 },
+	};
+	const uint32_t kStreamOutputStrides[] = { 16 };
+
+	// what the app's raster pipeline looks like, and stream output to have something in there
+	TestPipelineDesc rasterPipelineDesc() {
+		TestPipelineDesc desc = {};
+		desc.VS = { kVertexShader, sizeof(kVertexShader) };
+		desc.PS = { kPixelShader, sizeof(kPixelShader) };
+		desc.StreamOutput = { kStreamOutputEntries, 1, kStreamOutputStrides, 1, 0 };
+		for (auto& target : desc.BlendState.RenderTarget) {
+			target.SrcBlend = 2;
+			target.DestBlend = 1;
+			target.BlendOp = 1;
+			target.SrcBlendAlpha = 2;
+			target.DestBlendAlpha = 1;
+			target.BlendOpAlpha = 1;
+			target.LogicOp = 4;
+			target.RenderTargetWriteMask = 0xf;
+		}
+		desc.SampleMask = UINT32_MAX;
+		desc.RasterizerState.FillMode = 3;
+		desc.RasterizerState.CullMode = 3;
+		desc.RasterizerState.DepthClipEnable = 1;
+		desc.DepthStencilState.DepthWriteMask = 1;
+		desc.DepthStencilState.DepthFunc = 2;
+		desc.DepthStencilState.StencilReadMask = 0xff;
+		desc.DepthStencilState.StencilWriteMask = 0xff;
+		desc.InputLayout = { kInputElements, 2 };
+		desc.PrimitiveTopologyType = 3;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = 28;
+		desc.SampleDesc = { 1, 0 };
+		return desc;
+	}
+
+	std::vector<uint8_t> descBytes(const TestPipelineDesc& desc) {
+		return graphicsPipelineDesc(desc, kRootSignature, sizeof(kRootSignature));
+	}
+
+	PipelineCacheContents testContents() {
+		std::vector<uint8_t> desc = descBytes(rasterPipelineDesc());
+
+		PipelineCacheContents contents;
+		contents.identity = { 0x10de, 0x2204, 0x1f00020000abcdull };
+		contents.library = { 1, 2, 3, 4, 5 };
+		contents.entries.push_back({ pipelineCacheKey(desc), desc, {} });
+		contents.entries.push_back({ 7, { 9, 9 }, { 8, 8, 8 } });
+		return contents;
+	}
+
+	bool sameContents(const PipelineCacheContents& a, const PipelineCacheContents& b) {
+		if (!(a.identity == b.identity) || a.library != b.library || a.entries.size() != b.entries.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.entries.size(); i++) {
+			if (a.entries[i].key != b.entries[i].key || a.entries[i].desc != b.entries[i].desc ||
+				a.entries[i].blob != b.entries[i].blob) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(pipelineCacheRoundTrip) {
+	PipelineCacheContents contents = testContents();
+	std::vector<uint8_t> bytes = serializePipelineCache(contents);
+
+	PipelineCacheContents parsed;
+	CHECK(parsePipelineCache(bytes.data(), bytes.size(), parsed));
+	CHECK(sameContents(parsed, contents));
+
+	// nothing but the header
+	bytes = serializePipelineCache(PipelineCacheContents());
+	CHECK(parsePipelineCache(bytes.data(), bytes.size(), parsed));
+	CHECK(parsed.library.empty() && parsed.entries.empty());
+}
+
+TEST(pipelineCacheRejectsTruncatedBytes) {
+	std::vector<uint8_t> bytes = serializePipelineCache(testContents());
+	PipelineCacheContents parsed;
+
+	for (size_t size = 0; size < bytes.size(); size++) {
+		CHECK(!parsePipelineCache(bytes.data(), size, parsed));
+		CHECK(parsed.entries.empty());
+	}
+
+	bytes.push_back(0);
+	CHECK(!parsePipelineCache(bytes.data(), bytes.size(), parsed));
+}
+
+TEST(pipelineCacheRejectsCorruptBytes) {
+	std::vector<uint8_t> bytes = serializePipelineCache(testContents());
+	PipelineCacheContents parsed;
+
+	// the identity is left to the caller to compare, every other byte is checked
+	const size_t identityFirst = 8;
+	const size_t identityEnd = 24;
+
+	for (size_t i = 0; i < bytes.size(); i++) {
+		std::vector<uint8_t> corrupt = bytes;
+		corrupt[i] ^= 0x40;
+
+		bool parses = parsePipelineCache(corrupt.data(), corrupt.size(), parsed);
+		CHECK(parses == (i >= identityFirst && i < identityEnd));
+	}
+
+	// the payload hash is the last field of the header
+	std::vector<uint8_t> badHash = bytes;
+	badHash[47] ^= 1;
+	CHECK(!parsePipelineCache(badHash.data(), badHash.size(), parsed));
+	CHECK(parsed.entries.empty());
+
+	// a file of another format is ignored, whatever follows the header
+	std::vector<uint8_t> otherFormat = bytes;
+	otherFormat[4] = 2;
+	CHECK(!parsePipelineCache(otherFormat.data(), otherFormat.size(), parsed));
+}
+
+TEST(pipelineDescBytesFollowContentNotPointers) {
+	TestPipelineDesc desc = rasterPipelineDesc();
+	std::vector<uint8_t> bytes = descBytes(desc);
+
+	// the same contents somewhere else, another root signature object and a cached blob
+	std::string vertexShader = kVertexShader;
+	TestInputElement inputElements[2];
+	memcpy(inputElements, kInputElements, sizeof(inputElements));
+	std::string semanticName = kInputElements[1].SemanticName;
+	inputElements[1].SemanticName = semanticName.c_str();
+
+	TestPipelineDesc moved = desc;
+	moved.VS = { vertexShader.c_str(), vertexShader.size() + 1 };
+	moved.InputLayout = { inputElements, 2 };
+	moved.pRootSignature = &moved;
+	moved.CachedPSO = { "blob", 4 };
+	CHECK(descBytes(moved) == bytes);
+
+	// the root signature counts by its bytes
+	const char otherRootSignature[] = "root signaturE";
+	CHECK(graphicsPipelineDesc(desc, otherRootSignature, sizeof(otherRootSignature)) != bytes);
+}
+
+TEST(pipelineDescBytesChangeWithEveryField) {
+	const TestPipelineDesc desc = rasterPipelineDesc();
+	const std::vector<uint8_t> bytes = descBytes(desc);
+
+	// same lengths as the vertex and pixel shader, only the bytecode differs
+	static const char kOtherVertexShader[] = "vertex shadeR";
+	static const char kOtherShader[] = "pixel shadeR";
+	static const TestInputElement kOtherInputElements[] = {
+		{ "POSITION", 0, 6, 0, 0, 0, 0 },
+		{ "COLOR", 1, 2, 0, 12, 0, 0 },
+	};
+	static const TestStreamOutputEntry kOtherStreamOutputEntries[] = {
+		{ 0, "POSITION", 0, 0, 3, 0 },
+	};
+	static const uint32_t kOtherStreamOutputStrides[] = { 12 };
+
+	using Change = void (*)(TestPipelineDesc&);
+	const Change changes[] = {
+		[](TestPipelineDesc& d) { d.VS.pShaderBytecode = kOtherVertexShader; },
+		[](TestPipelineDesc& d) { d.PS = { kOtherShader, sizeof(kOtherShader) }; },
+		[](TestPipelineDesc& d) { d.PS.BytecodeLength--; },
+		[](TestPipelineDesc& d) { d.DS = d.PS; },
+		[](TestPipelineDesc& d) { d.HS = d.PS; },
+		[](TestPipelineDesc& d) { d.GS = d.PS; },
+		[](TestPipelineDesc& d) { d.StreamOutput.pSODeclaration = kOtherStreamOutputEntries; },
+		[](TestPipelineDesc& d) { d.StreamOutput.NumEntries = 0; },
+		[](TestPipelineDesc& d) { d.StreamOutput.pBufferStrides = kOtherStreamOutputStrides; },
+		[](TestPipelineDesc& d) { d.StreamOutput.NumStrides = 0; },
+		[](TestPipelineDesc& d) { d.StreamOutput.RasterizedStream = 1; },
+		[](TestPipelineDesc& d) { d.BlendState.AlphaToCoverageEnable = 1; },
+		[](TestPipelineDesc& d) { d.BlendState.IndependentBlendEnable = 1; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[0].BlendEnable = 1; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[1].LogicOpEnable = 1; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[2].SrcBlend = 5; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[3].DestBlend = 6; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[4].BlendOp = 2; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[5].SrcBlendAlpha = 5; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[6].DestBlendAlpha = 6; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[7].BlendOpAlpha = 2; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[0].LogicOp = 0; },
+		[](TestPipelineDesc& d) { d.BlendState.RenderTarget[7].RenderTargetWriteMask = 0x7; },
+		[](TestPipelineDesc& d) { d.SampleMask = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.FillMode = 2; },
+		[](TestPipelineDesc& d) { d.RasterizerState.CullMode = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.FrontCounterClockwise = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.DepthBias = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.DepthBiasClamp = 0.5f; },
+		[](TestPipelineDesc& d) { d.RasterizerState.SlopeScaledDepthBias = 0.5f; },
+		[](TestPipelineDesc& d) { d.RasterizerState.DepthClipEnable = 0; },
+		[](TestPipelineDesc& d) { d.RasterizerState.MultisampleEnable = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.AntialiasedLineEnable = 1; },
+		[](TestPipelineDesc& d) { d.RasterizerState.ForcedSampleCount = 4; },
+		[](TestPipelineDesc& d) { d.RasterizerState.ConservativeRaster = 1; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.DepthEnable = 1; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.DepthWriteMask = 0; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.DepthFunc = 4; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.StencilEnable = 1; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.StencilReadMask = 0x0f; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.StencilWriteMask = 0x0f; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.FrontFace.StencilFailOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.FrontFace.StencilDepthFailOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.FrontFace.StencilPassOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.FrontFace.StencilFunc = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.BackFace.StencilFailOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.BackFace.StencilDepthFailOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.BackFace.StencilPassOp = 2; },
+		[](TestPipelineDesc& d) { d.DepthStencilState.BackFace.StencilFunc = 2; },
+		[](TestPipelineDesc& d) { d.InputLayout.pInputElementDescs = kOtherInputElements; },
+		[](TestPipelineDesc& d) { d.InputLayout.NumElements = 1; },
+		[](TestPipelineDesc& d) { d.IBStripCutValue = 1; },
+		[](TestPipelineDesc& d) { d.PrimitiveTopologyType = 2; },
+		[](TestPipelineDesc& d) { d.NumRenderTargets = 2; },
+		[](TestPipelineDesc& d) { d.RTVFormats[7] = 28; },
+		[](TestPipelineDesc& d) { d.DSVFormat = 40; },
+		[](TestPipelineDesc& d) { d.SampleDesc.Count = 4; },
+		[](TestPipelineDesc& d) { d.SampleDesc.Quality = 1; },
+		[](TestPipelineDesc& d) { d.NodeMask = 1; },
+		[](TestPipelineDesc& d) { d.Flags = 1; },
+	};
+
+	std::vector<std::vector<uint8_t>> seen = { bytes };
+	for (Change change : changes) {
+		TestPipelineDesc changed = desc;
+		change(changed);
+
+		std::vector<uint8_t> changedBytes = descBytes(changed);
+		for (const auto& other : seen) {
+			CHECK(changedBytes != other);
+		}
+		seen.push_back(changedBytes);
+	}
+}
+
+TEST(pipelineCacheEntryNeedsTheSameDesc) {
+	PipelineCacheContents contents = testContents();
+	const PipelineCacheEntry& entry = contents.entries[0];
+
+	CHECK(findPipelineCacheEntry(contents, entry.key, entry.desc) == &entry);
+	CHECK(!findPipelineCacheEntry(contents, entry.key + 1, entry.desc));
+
+	// a key collision: same key, another description
+	TestPipelineDesc desc = rasterPipelineDesc();
+	desc.SampleMask = 1;
+	CHECK(!findPipelineCacheEntry(contents, entry.key, descBytes(desc)));
+
+	CHECK(pipelineLibraryName(0xabc) == L"0000000000000abc");
+}
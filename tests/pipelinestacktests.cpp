@@ -0,0 +1,84 @@
+#include "check.h"
+
+#include <algorithm>
+
+#include "dxr/PipelineStackSize.h"
+
+using namespace nv_helpers_dx12;
+
+namespace {
+	// what the runtime uses without SetPipelineStackSize, every closest hit and miss shader
+	// tracing down to the maximum recursion depth and callables two deep
+	uint64_t runtimeDefaultStackSize(uint64_t rayGen, uint64_t closestHit, uint64_t miss, uint64_t intersection,
+		uint64_t anyHit, uint64_t callable, uint32_t maxRecursionDepth) {
+		uint64_t hitOrMiss = std::max(closestHit, miss);
+
+		return rayGen + std::max(hitOrMiss, intersection + anyHit) + (maxRecursionDepth - 1) * hitOrMiss + 2 * callable;
+	}
+}
+
+TEST(stackSizeOfTheHeaderExample) {
+	uint64_t stackSize = ComputePipelineStackSize({ { ShaderStage::RayGeneration, 256, true },
+		{ ShaderStage::ClosestHit, 64, false },
+		{ ShaderStage::Miss, 16, false } }, 1);
+
+	CHECK(stackSize == 320);
+}
+
+TEST(stackSizeOfRecursiveShadersMatchesTheRuntimeDefault) {
+	for (uint32_t depth = 1; depth <= 4; depth++) {
+		std::vector<ShaderStackUsage> shaders = { { ShaderStage::RayGeneration, 256, true },
+			{ ShaderStage::ClosestHit, 64, true },
+			{ ShaderStage::Miss, 32, true },
+			{ ShaderStage::Intersection, 16, false },
+			{ ShaderStage::AnyHit, 8, false },
+			{ ShaderStage::Callable, 48, false } };
+
+		CHECK(ComputePipelineStackSize(shaders, depth, 2) == runtimeDefaultStackSize(256, 64, 32, 16, 8, 48, depth));
+	}
+}
+
+TEST(stackSizeOnlyStacksShadersThatTrace) {
+	std::vector<ShaderStackUsage> shaders = { { ShaderStage::RayGeneration, 256, true },
+		{ ShaderStage::ClosestHit, 64, false },
+		{ ShaderStage::Miss, 32, true } };
+
+	// only the miss shader traces, so each level adds a miss shader below the closest hit at the bottom
+	CHECK(ComputePipelineStackSize(shaders, 1) == 256 + 64);
+	CHECK(ComputePipelineStackSize(shaders, 2) == 256 + 32 + 64);
+	CHECK(ComputePipelineStackSize(shaders, 3) == 256 + 32 + 32 + 64);
+
+	// with neither tracing the depth doesn't matter
+	shaders[2].tracesRays = false;
+	CHECK(ComputePipelineStackSize(shaders, 3) == 256 + 64);
+
+	// a ray generation shader that doesn't trace needs nothing on top
+	shaders[0].tracesRays = false;
+	CHECK(ComputePipelineStackSize(shaders, 3) == 256);
+}
+
+TEST(stackSizeCountsTraversalWhenLargerThanClosestHit) {
+	std::vector<ShaderStackUsage> shaders = { { ShaderStage::RayGeneration, 100, true },
+		{ ShaderStage::ClosestHit, 40, false },
+		{ ShaderStage::Intersection, 30, false },
+		{ ShaderStage::AnyHit, 20, false },
+		{ ShaderStage::AnyHit, 10, false } };
+
+	// the largest intersection and the largest any hit shader, whatever their hit groups
+	CHECK(ComputePipelineStackSize(shaders, 1) == 100 + 30 + 20);
+
+	shaders[1].stackSize = 60;
+	CHECK(ComputePipelineStackSize(shaders, 1) == 100 + 60);
+}
+
+TEST(stackSizeCountsCallablesPerLevel) {
+	std::vector<ShaderStackUsage> shaders = { { ShaderStage::RayGeneration, 256, true },
+		{ ShaderStage::ClosestHit, 64, false },
+		{ ShaderStage::Miss, 16, false },
+		{ ShaderStage::Callable, 24, false },
+		{ ShaderStage::Callable, 32, false } };
+
+	CHECK(ComputePipelineStackSize(shaders, 1) == 320);
+	CHECK(ComputePipelineStackSize(shaders, 1, 1) == 320 + 32);
+	CHECK(ComputePipelineStackSize(shaders, 1, 3) == 320 + 3 * 32);
+}
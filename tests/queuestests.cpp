@@ -0,0 +1,179 @@
+#include "check.h"
+
+#include <cmath>
+#include <memory>
+
+#include "queues.h"
+
+namespace {
+	// frames planned the way the renderer submits them, the frame's build and then its trace
+	struct PlannedFrames {
+		std::vector<QueueSubmission> submissions;
+		std::vector<double> durations;
+
+		PlannedFrames(uint32_t numFrames, uint32_t numSlots, double buildTime, double traceTime) {
+			AsyncBuildScheduler scheduler(numSlots);
+
+			for (uint64_t frame = 0; frame < numFrames; frame++) {
+				submissions.push_back(scheduler.planBuild(frame, frame + 1));
+				durations.push_back(buildTime);
+				submissions.push_back(scheduler.planTrace(frame, frame + 1));
+				durations.push_back(traceTime);
+			}
+		}
+
+		const QueueSubmission& build(uint64_t frame) const { return submissions[2 * frame]; }
+		const QueueSubmission& trace(uint64_t frame) const { return submissions[2 * frame + 1]; }
+	};
+
+	bool near(double a, double b) {
+		return std::abs(a - b) < 1e-9;
+	}
+}
+
+TEST(asyncBuildsOverlapTheTraceBefore) {
+	const uint32_t numFrames = 100;
+
+	for (double buildTime : { 1.0, 2.0, 3.0 }) {
+		const double traceTime = 2.0;
+		AsyncBuildSimulation simulation = simulateAsyncBuilds(numFrames, 2, buildTime, traceTime);
+
+		// the slower queue sets the pace, the other one only adds its first or last submission
+		CHECK(near(simulation.serialTime, numFrames * (buildTime + traceTime)));
+		CHECK(near(simulation.asyncTime, numFrames * std::max(buildTime, traceTime) + std::min(buildTime, traceTime)));
+		CHECK(near(simulation.overlapTime, (numFrames - 1) * std::min(buildTime, traceTime)));
+	}
+
+	// with a single slot each build waits for the trace before it, nothing overlaps
+	AsyncBuildSimulation simulation = simulateAsyncBuilds(numFrames, 1, 1.0, 2.0);
+	CHECK(near(simulation.asyncTime, simulation.serialTime));
+	CHECK(simulation.overlapTime == 0.0);
+}
+
+TEST(tracesWaitForTheirOwnBuild) {
+	PlannedFrames frames(8, 3, 1.0, 2.0);
+
+	for (uint64_t frame = 0; frame < 8; frame++) {
+		const QueueSubmission& trace = frames.trace(frame);
+
+		CHECK(trace.queue == QueueType::Direct);
+		CHECK(trace.waits.size() == 1);
+		CHECK(trace.waits[0].queue == QueueType::Compute);
+		CHECK(trace.waits[0].value == frames.build(frame).signalValue);
+	}
+}
+
+TEST(buildsNeverOverwriteASlotBeingTraced) {
+	for (uint32_t numSlots = 1; numSlots <= 3; numSlots++) {
+		PlannedFrames frames(12, numSlots, 3.0, 2.0);
+		std::vector<QueueInterval> intervals = simulateQueueTimeline(frames.submissions, frames.durations);
+
+		for (uint64_t frame = 0; frame < 12; frame++) {
+			const QueueSubmission& build = frames.build(frame);
+			CHECK(build.queue == QueueType::Compute);
+
+			// the first use of each slot has nothing to wait for
+			if (frame < numSlots) {
+				CHECK(build.waits.empty());
+				continue;
+			}
+
+			// otherwise the slot's previous trace, and the build starts after it finished
+			CHECK(build.waits.size() == 1);
+			CHECK(build.waits[0].queue == QueueType::Direct);
+			CHECK(build.waits[0].value == frames.trace(frame - numSlots).signalValue);
+			CHECK(intervals[2 * frame].start >= intervals[2 * (frame - numSlots) + 1].end);
+		}
+
+		// and no build into a slot runs while any trace reading an older build of it does
+		for (uint64_t traced = 0; traced < 12; traced++) {
+			for (uint64_t built = traced + 1; built < 12; built++) {
+				if (built % numSlots != traced % numSlots) {
+					continue;
+				}
+
+				const QueueInterval& trace = intervals[2 * traced + 1];
+				const QueueInterval& build = intervals[2 * built];
+				CHECK(build.start >= trace.end || build.end <= trace.start);
+			}
+		}
+	}
+}
+
+TEST(completionsWaitForEveryQueue) {
+	CompletionQueue completions;
+	std::vector<int> ran;
+
+	completions.enqueue({ { QueueType::Direct, 2 }, { QueueType::Compute, 5 } }, [&]() { ran.push_back(0); });
+	completions.enqueue({ { QueueType::Compute, 3 } }, [&]() { ran.push_back(1); });
+	completions.enqueue({}, [&]() { ran.push_back(2); });
+
+	uint64_t completed[kNumQueueTypes] = { 1, 4 };
+	CHECK(completions.run(completed) == 2);
+	CHECK(ran == std::vector<int>({ 1, 2 }));
+
+	// the direct queue is far enough now, the compute queue not yet
+	completed[0] = 2;
+	CHECK(completions.run(completed) == 0);
+	CHECK(completions.pending() == 1);
+
+	completed[1] = 5;
+	CHECK(completions.run(completed) == 1);
+	CHECK(ran == std::vector<int>({ 1, 2, 0 }));
+	CHECK(completions.pending() == 0);
+}
+
+TEST(completionsRunInEnqueueOrder) {
+	CompletionQueue completions;
+	std::vector<int> ran;
+
+	for (int i = 0; i < 6; i++) {
+		// alternately waiting on 1 and 2, the ones for 1 ahead of the others once both are due
+		completions.enqueue({ { QueueType::Direct, 1u + i % 2 } }, [&ran, i]() { ran.push_back(i); });
+	}
+
+	uint64_t completed[kNumQueueTypes] = { 1, 0 };
+	completions.run(completed);
+	CHECK(ran == std::vector<int>({ 0, 2, 4 }));
+
+	completed[0] = 2;
+	completions.run(completed);
+	CHECK(ran == std::vector<int>({ 0, 2, 4, 1, 3, 5 }));
+}
+
+TEST(completionsEnqueuedByACallbackRunNextTime) {
+	CompletionQueue completions;
+	int ran = 0;
+
+	completions.enqueue({ { QueueType::Direct, 1 } }, [&]() {
+		ran++;
+		completions.enqueue({ { QueueType::Direct, 1 } }, [&]() { ran++; });
+	});
+
+	uint64_t completed[kNumQueueTypes] = { 1, 0 };
+	CHECK(completions.run(completed) == 1);
+	CHECK(ran == 1 && completions.pending() == 1);
+
+	CHECK(completions.run(completed) == 1);
+	CHECK(ran == 2 && completions.pending() == 0);
+}
+
+TEST(deferredReleasesLiveUntilTheirFence) {
+	CompletionQueue completions;
+	std::weak_ptr<int> released;
+
+	{
+		// as QueueTimeline::deferRelease does, the callback holds the last reference
+		auto object = std::make_shared<int>(42);
+		released = object;
+		completions.enqueue({ { QueueType::Direct, 3 }, { QueueType::Compute, 1 } }, [object]() {});
+	}
+
+	uint64_t completed[kNumQueueTypes] = { 2, 1 };
+	completions.run(completed);
+	CHECK(!released.expired());
+
+	completed[0] = 3;
+	completions.run(completed);
+	CHECK(released.expired());
+}
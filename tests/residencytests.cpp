@@ -0,0 +1,124 @@
+#include "check.h"
+
+#include "residency.h"
+
+namespace {
+	const uint64_t kMiB = 1024 * 1024;
+
+	// four evictable 100 MiB textures, last used by submissions 3, 1, 4 and 2
+	struct TestSet {
+		ResidencySet set;
+		ResidencyHandle textures[4];
+
+		TestSet() {
+			const uint64_t fences[] = { 3, 1, 4, 2 };
+			for (int i = 0; i < 4; i++) {
+				textures[i] = set.add(100 * kMiB, ResidencyKind::Texture, true);
+				set.markUsed(textures[i], fences[i]);
+			}
+		}
+	};
+}
+
+TEST(evictsLeastRecentlyUsedFirst) {
+	TestSet test;
+	test.set.setBudget(250 * kMiB);
+
+	std::vector<ResidencyHandle> victims = test.set.evictToBudget(4);
+
+	CHECK(victims == std::vector<ResidencyHandle>({ test.textures[1], test.textures[3] }));
+	CHECK(test.set.residentSize() == 200 * kMiB);
+	CHECK(!test.set.isResident(test.textures[1]) && !test.set.isResident(test.textures[3]));
+	CHECK(test.set.isResident(test.textures[0]) && test.set.isResident(test.textures[2]));
+
+	// within the budget nothing more goes
+	CHECK(test.set.evictToBudget(4).empty());
+
+	// room for an incoming allocation is made the same way
+	CHECK(test.set.evictToBudget(4, 100 * kMiB) == std::vector<ResidencyHandle>({ test.textures[0] }));
+}
+
+TEST(evictsBiggerObjectsFirstAmongEquallyOld) {
+	ResidencySet set;
+	ResidencyHandle small = set.add(10 * kMiB, ResidencyKind::Texture, true);
+	ResidencyHandle big = set.add(90 * kMiB, ResidencyKind::BottomLevelAS, true);
+	set.markUsed(small, 1);
+	set.markUsed(big, 1);
+
+	set.setBudget(50 * kMiB);
+	CHECK(set.evictToBudget(1) == std::vector<ResidencyHandle>({ big }));
+	CHECK(set.isResident(small));
+}
+
+TEST(inFlightObjectsAreNeverEvicted) {
+	TestSet test;
+	test.set.setBudget(150 * kMiB);
+
+	// submissions 3 and 4 are still running, only what 1 and 2 used can go and that isn't enough
+	std::vector<ResidencyHandle> victims = test.set.evictToBudget(2);
+
+	CHECK(victims == std::vector<ResidencyHandle>({ test.textures[1], test.textures[3] }));
+	CHECK(test.set.residentSize() == 200 * kMiB);
+	CHECK(test.set.isResident(test.textures[0]) && test.set.isResident(test.textures[2]));
+
+	// once 3 completes its texture is fair game
+	CHECK(test.set.evictToBudget(3) == std::vector<ResidencyHandle>({ test.textures[0] }));
+	CHECK(test.set.residentSize() == 100 * kMiB);
+}
+
+TEST(nonEvictableObjectsStayResident) {
+	ResidencySet set;
+	ResidencyHandle tlas = set.add(100 * kMiB, ResidencyKind::TopLevelAS, false);
+	ResidencyHandle texture = set.add(100 * kMiB, ResidencyKind::Texture, true);
+
+	set.setBudget(50 * kMiB);
+	CHECK(set.evictToBudget(10) == std::vector<ResidencyHandle>({ texture }));
+	CHECK(set.isResident(tlas));
+	CHECK(set.residentSize() == 100 * kMiB);
+}
+
+TEST(makeResidentPagesBackIn) {
+	TestSet test;
+	test.set.setBudget(250 * kMiB);
+	test.set.evictToBudget(4);
+
+	// submission 5 uses one evicted and one resident texture
+	std::vector<ResidencyHandle> pageIn = test.set.makeResident({ test.textures[1], test.textures[0] }, 5);
+
+	CHECK(pageIn == std::vector<ResidencyHandle>({ test.textures[1] }));
+	CHECK(test.set.isResident(test.textures[1]));
+	CHECK(test.set.lastUsedFence(test.textures[0]) == 5 && test.set.lastUsedFence(test.textures[1]) == 5);
+	CHECK(test.set.residentSize() == 300 * kMiB);
+
+	// making room, as the residency manager does next, evicts the others and never what 5 uses
+	CHECK(test.set.evictToBudget(4) == std::vector<ResidencyHandle>({ test.textures[2] }));
+	CHECK(test.set.residentSize() == 200 * kMiB);
+
+	// already resident, nothing to page in
+	CHECK(test.set.makeResident({ test.textures[0], test.textures[1] }, 6).empty());
+}
+
+TEST(overBudgetWithEverythingInFlight) {
+	TestSet test;
+	test.set.makeResident({ test.textures[0], test.textures[1], test.textures[2], test.textures[3] }, 5);
+	test.set.setBudget(50 * kMiB);
+
+	// the GPU still needs all of it, so the set stays over the budget rather than evicting in-flight memory
+	CHECK(test.set.evictToBudget(4).empty());
+	CHECK(test.set.evictToBudget(4, 100 * kMiB).empty());
+	CHECK(test.set.residentSize() == 400 * kMiB);
+	CHECK(test.set.residentSize() > test.set.budget());
+}
+
+TEST(removedObjectsLeaveTheSet) {
+	TestSet test;
+	test.set.remove(test.textures[1]);
+	CHECK(test.set.residentSize() == 300 * kMiB);
+
+	// its handle is reused and the removed object is never a victim
+	ResidencyHandle buffer = test.set.add(10 * kMiB, ResidencyKind::Buffer, false);
+	CHECK(buffer == test.textures[1]);
+
+	test.set.setBudget(250 * kMiB);
+	CHECK(test.set.evictToBudget(4) == std::vector<ResidencyHandle>({ test.textures[3] }));
+}
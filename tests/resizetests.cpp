@@ -0,0 +1,103 @@
+#include "check.h"
+
+#include <memory>
+
+#include "resize.h"
+
+TEST(resizeKeepsTheAllocationWithinAStep) {
+	ResizePolicy policy;
+
+	CHECK(policy.update({ 1280, 720 }));
+	CHECK(policy.capacity() == Extent2D({ 1280, 768 }));
+
+	// dragging the border a pixel at a time reallocates once for the whole 256 px step
+	uint32_t reallocations = 0;
+	for (uint32_t width = 1281; width <= 1536; width++) {
+		reallocations += policy.update({ width, 730 });
+	}
+	CHECK(reallocations == 1);
+	CHECK(policy.capacity() == Extent2D({ 1536, 768 }));
+
+	// and not at all back the other way
+	for (uint32_t width = 1536; width > 1200; width -= 7) {
+		CHECK(!policy.update({ width, 700 }));
+	}
+	CHECK(policy.capacity() == Extent2D({ 1536, 768 }));
+
+	// a step further grows right away
+	CHECK(policy.update({ 1537, 700 }));
+	CHECK(policy.capacity() == Extent2D({ 1792, 768 }));
+}
+
+TEST(resizeGrowsOncePerStep) {
+	ResizePolicy policy;
+	policy.update({ 256, 256 });
+
+	uint32_t reallocations = 0;
+	for (uint32_t width = 256; width <= 1024; width++) {
+		reallocations += policy.update({ width, 256 });
+	}
+
+	CHECK(reallocations == 3);
+	CHECK(policy.capacity() == Extent2D({ 1024, 256 }));
+}
+
+TEST(resizeShrinksOnlyAfterStayingSmall) {
+	ResizePolicy policy;
+	policy.update({ 2560, 1440 });
+	CHECK(policy.capacity() == Extent2D({ 2560, 1536 }));
+
+	// below half the area for 119 updates, then one at the full size resets the count
+	for (uint32_t i = 0; i < 119; i++) {
+		CHECK(!policy.update({ 1280, 720 }));
+	}
+	CHECK(!policy.update({ 2560, 1440 }));
+	for (uint32_t i = 0; i < 119; i++) {
+		CHECK(!policy.update({ 1280, 720 }));
+	}
+
+	// the 120th in a row shrinks
+	CHECK(policy.update({ 1280, 720 }));
+	CHECK(policy.capacity() == Extent2D({ 1280, 768 }));
+
+	// more than half the area never shrinks
+	ResizePolicy large;
+	large.update({ 2560, 1440 });
+	for (uint32_t i = 0; i < 1000; i++) {
+		CHECK(!large.update({ 2000, 1200 }));
+	}
+}
+
+TEST(recyclingPoolReusesMatchingAllocations) {
+	RecyclingPool<std::shared_ptr<int>> pool;
+	auto maximized = std::make_shared<int>(1);
+	auto restored = std::make_shared<int>(2);
+
+	CHECK(!pool.recycle({ 2560, 1536 }, maximized));
+	CHECK(!pool.recycle({ 1280, 768 }, restored));
+
+	CHECK(!pool.reuse({ 1536, 768 }));
+	CHECK(pool.reuse({ 2560, 1536 }) == maximized);
+	CHECK(pool.size() == 1);
+
+	// each allocation is handed out once
+	CHECK(!pool.reuse({ 2560, 1536 }));
+	CHECK(pool.reuse({ 1280, 768 }) == restored);
+	CHECK(pool.size() == 0);
+}
+
+TEST(recyclingPoolKeepsTwoEntries) {
+	RecyclingPool<int> pool;
+
+	CHECK(!pool.recycle({ 256, 256 }, 1));
+	CHECK(!pool.recycle({ 512, 256 }, 2));
+
+	// the oldest goes back to the caller to release
+	CHECK(pool.recycle({ 768, 256 }, 3) == 1);
+	CHECK(pool.recycle({ 1024, 256 }, 4) == 2);
+	CHECK(pool.size() == 2);
+
+	CHECK(!pool.reuse({ 256, 256 }));
+	CHECK(pool.reuse({ 768, 256 }) == 3);
+	CHECK(pool.reuse({ 1024, 256 }) == 4);
+}
@@ -0,0 +1,108 @@
+#include "check.h"
+
+#include "dxr/RootSignatureCost.h"
+
+using namespace nv_helpers_dx12;
+
+TEST(rootSignatureCostOfTheHeaderExample) {
+	RootSignatureCost cost = ComputeRootSignatureCost({ { RootParameterKind::DescriptorTable, 0 },
+		{ RootParameterKind::Constants, 4 } });
+
+	CHECK(cost.dwords == 5);
+	CHECK(cost.localArgumentsSize == 24);
+	CHECK(cost.recordStride == 64);
+	CHECK(cost.numTables == 1 && cost.numDescriptors == 0 && cost.numConstants == 4);
+}
+
+TEST(rootParametersCostTheirDwords) {
+	CHECK(RootParameterDwords({ RootParameterKind::DescriptorTable, 0 }) == 1);
+	CHECK(RootParameterDwords({ RootParameterKind::Descriptor, 0 }) == 2);
+	CHECK(RootParameterDwords({ RootParameterKind::Constants, 7 }) == 7);
+
+	RootSignatureCost cost = ComputeRootSignatureCost({ { RootParameterKind::Descriptor, 0 },
+		{ RootParameterKind::DescriptorTable, 0 }, { RootParameterKind::Constants, 3 },
+		{ RootParameterKind::Descriptor, 0 } });
+
+	CHECK(cost.dwords == 2 + 1 + 3 + 2);
+	CHECK(cost.numTables == 1 && cost.numDescriptors == 2 && cost.numConstants == 3);
+
+	// nothing bound still takes a record with the identifier
+	RootSignatureCost empty = ComputeRootSignatureCost({});
+	CHECK(empty.dwords == 0 && empty.localArgumentsSize == 0 && empty.recordStride == kShaderRecordAlignment);
+}
+
+TEST(localDescriptorsFollowConstantsAligned) {
+	// an odd number of constants leaves 4 bytes of padding before the next 8-byte argument
+	for (uint32_t numConstants = 1; numConstants <= 4; numConstants++) {
+		for (RootParameterKind kind : { RootParameterKind::Descriptor, RootParameterKind::DescriptorTable }) {
+			RootSignatureCost cost = ComputeRootSignatureCost({ { RootParameterKind::Constants, numConstants },
+				{ kind, 0 } });
+
+			uint32_t padding = numConstants % 2 == 1 ? 4 : 0;
+			CHECK(cost.localArgumentsSize == 4 * numConstants + padding + 8);
+		}
+	}
+
+	// constants after a descriptor need no padding, and none is added at the end
+	CHECK(ComputeRootSignatureCost({ { RootParameterKind::Descriptor, 0 },
+		{ RootParameterKind::Constants, 1 } }).localArgumentsSize == 12);
+	CHECK(ComputeRootSignatureCost({ { RootParameterKind::Constants, 1 },
+		{ RootParameterKind::Constants, 1 }, { RootParameterKind::DescriptorTable, 0 } }).localArgumentsSize == 16);
+}
+
+TEST(recordStrideRoundsTheRecordUp) {
+	// the identifier plus the arguments, to the next multiple of 32 bytes
+	for (uint32_t numConstants = 0; numConstants <= 24; numConstants++) {
+		RootSignatureCost cost = ComputeRootSignatureCost({ { RootParameterKind::Constants, numConstants } });
+		uint32_t recordSize = kShaderIdentifierSize + 4 * numConstants;
+
+		CHECK(cost.recordStride % kShaderRecordAlignment == 0);
+		CHECK(cost.recordStride >= recordSize && cost.recordStride - recordSize < kShaderRecordAlignment);
+	}
+
+	// a local signature is limited by the 4096-byte stride, not by 64 DWORDs
+	const uint32_t fitting = (kMaxShaderRecordStride - kShaderIdentifierSize) / 4;
+	RootSignatureCost largest = ComputeRootSignatureCost({ { RootParameterKind::Constants, fitting } });
+	CHECK(largest.recordStride == kMaxShaderRecordStride);
+	CHECK(largest.WithinBudget(true) && !largest.WithinBudget(false));
+
+	RootSignatureCost tooLarge = ComputeRootSignatureCost({ { RootParameterKind::Constants, fitting + 1 } });
+	CHECK(!tooLarge.WithinBudget(true));
+}
+
+TEST(globalSignatureBudgetIs64Dwords) {
+	RootSignatureCost full = ComputeRootSignatureCost({ { RootParameterKind::Constants, 62 },
+		{ RootParameterKind::Descriptor, 0 } });
+	CHECK(full.dwords == 64 && full.WithinBudget(false));
+
+	RootSignatureCost over = ComputeRootSignatureCost({ { RootParameterKind::Constants, 62 },
+		{ RootParameterKind::Descriptor, 0 }, { RootParameterKind::DescriptorTable, 0 } });
+	CHECK(over.dwords == 65 && !over.WithinBudget(false));
+}
+
+TEST(constantsArePromotedUpTo64Dwords) {
+	// within the limit, as long as the signature stays within 64 DWORDs
+	CHECK(PromoteToRootConstants(16, kDefaultConstantPromotionLimit, 60));
+	CHECK(!PromoteToRootConstants(16, kDefaultConstantPromotionLimit, 61));
+	CHECK(!PromoteToRootConstants(17, kDefaultConstantPromotionLimit, 0));
+
+	// partial DWORDs count whole
+	CHECK(PromoteToRootConstants(13, kDefaultConstantPromotionLimit, 60));
+	CHECK(!PromoteToRootConstants(13, kDefaultConstantPromotionLimit, 61));
+
+	// a raised limit still stops at the signature's budget
+	CHECK(PromoteToRootConstants(256, 256, 0));
+	CHECK(!PromoteToRootConstants(256, 256, 1));
+	CHECK(!PromoteToRootConstants(260, 1024, 0));
+}
+
+TEST(localConstantsArePromotedUpToTheRecordStride) {
+	const uint32_t argumentsSizeUsed = kMaxShaderRecordStride - kShaderIdentifierSize - 64;
+
+	CHECK(PromoteToLocalRootConstants(64, 1024, argumentsSizeUsed));
+	CHECK(!PromoteToLocalRootConstants(65, 1024, argumentsSizeUsed));
+	CHECK(!PromoteToLocalRootConstants(64, 32, 0));
+
+	// far beyond 64 DWORDs when the record has room
+	CHECK(PromoteToLocalRootConstants(1024, 1024, 0));
+}
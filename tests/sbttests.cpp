@@ -0,0 +1,208 @@
+#include "check.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "dxr/ShaderBindingTableGenerator.h"
+#include "hitgroups.h"
+#include "jobs.h"
+
+using namespace nv_helpers_dx12;
+
+namespace {
+	// stands in for a pipeline, the identifier of an export is its name repeated
+	struct FakePipeline : ID3D12StateObjectProperties {
+		std::vector<std::wstring> names;
+		std::vector<std::vector<uint8_t>> identifiers;
+		ULONG refs = 1;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override {
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+		ULONG STDMETHODCALLTYPE AddRef() override { return ++refs; }
+		ULONG STDMETHODCALLTYPE Release() override { return --refs; }
+
+		void* STDMETHODCALLTYPE GetShaderIdentifier(LPCWSTR exportName) override {
+			for (size_t i = 0; i < names.size(); i++) {
+				if (names[i] == exportName) {
+					return identifiers[i].data();
+				}
+			}
+			names.push_back(exportName);
+			identifiers.emplace_back(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+			for (size_t i = 0; i < D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES; i++) {
+				identifiers.back()[i] = static_cast<uint8_t>(exportName[i % names.back().size()]);
+			}
+			return identifiers.back().data();
+		}
+		UINT64 STDMETHODCALLTYPE GetShaderStackSize(LPCWSTR) override { return 0; }
+		UINT64 STDMETHODCALLTYPE GetPipelineStackSize() override { return 0; }
+		void STDMETHODCALLTYPE SetPipelineStackSize(UINT64) override {}
+	};
+
+	// a table with a ray generation program, two miss programs and four hit groups
+	struct TestTable {
+		FakePipeline pipeline;
+		ShaderBindingTableGenerator sbt;
+		ShaderIdentifierCache identifiers;
+		ShaderSymbol rayGen, miss, shadowMiss, hitGroup, shadowHitGroup;
+
+		TestTable() {
+			rayGen = sbt.Symbols().Intern(L"RayGen");
+			miss = sbt.Symbols().Intern(L"Miss");
+			shadowMiss = sbt.Symbols().Intern(L"ShadowMiss");
+			hitGroup = sbt.Symbols().Intern(L"HitGroup");
+			shadowHitGroup = sbt.Symbols().Intern(L"ShadowHitGroup");
+
+			sbt.AddRayGenerationProgram(rayGen, { reinterpret_cast<void*>(0x1000) });
+			sbt.AddMissProgram(miss, {});
+			sbt.AddMissProgram(shadowMiss, {});
+			for (uint32_t i = 0; i < 4; i++) {
+				sbt.AddHitGroup(hitGroup, { reinterpret_cast<void*>(0x2000 + i), reinterpret_cast<void*>(0x3000 + i) });
+			}
+			sbt.ComputeSBTSize();
+
+			identifiers.Fill(&pipeline, sbt.Symbols());
+		}
+
+		std::vector<uint8_t> generate() {
+			std::vector<uint8_t> data(sbt.GetLayout().size, 0xcd);
+			sbt.Generate(data.data(), identifiers);
+			return data;
+		}
+	};
+}
+
+TEST(sbtUpdateMatchesFullGenerate) {
+	TestTable table;
+	std::vector<uint8_t> copies[2] = {
+		std::vector<uint8_t>(table.sbt.GetLayout().size, 0xcd),
+		std::vector<uint8_t>(table.sbt.GetLayout().size, 0xcd),
+	};
+
+	for (uint32_t copy = 0; copy < 2; copy++) {
+		table.sbt.Update(copies[copy].data(), table.identifiers, copy);
+		CHECK(copies[copy] == table.generate());
+	}
+
+	table.sbt.SetHitGroup(2, table.shadowHitGroup, { reinterpret_cast<void*>(0x4000) });
+	table.sbt.SetMissProgram(0, table.shadowMiss, {});
+
+	std::vector<uint8_t> expected = table.generate();
+	CHECK(copies[0] != expected);
+
+	for (uint32_t copy = 0; copy < 2; copy++) {
+		table.sbt.Update(copies[copy].data(), table.identifiers, copy);
+		CHECK(copies[copy] == expected);
+	}
+}
+
+TEST(sbtUpdateWritesOnlyChangedRecords) {
+	TestTable table;
+	const ShaderTableLayout& layout = table.sbt.GetLayout();
+	std::vector<uint8_t> copies[2] = {
+		std::vector<uint8_t>(layout.size),
+		std::vector<uint8_t>(layout.size),
+	};
+
+	uint32_t allRecords = layout.rayGen.Size() + layout.miss.Size() + layout.hitGroup.Size();
+	CHECK(table.sbt.Update(copies[0].data(), table.identifiers, 0) == allRecords);
+	CHECK(table.sbt.Update(copies[0].data(), table.identifiers, 0) == 0);
+
+	table.sbt.SetHitGroup(1, table.shadowHitGroup, {});
+	table.sbt.SetHitGroup(3, table.shadowHitGroup, {});
+	table.sbt.SetMissProgram(1, table.miss, {});
+
+	// each changed record once per copy, a stride of its own section
+	uint32_t changedBytes = 2 * layout.hitGroup.stride + layout.miss.stride;
+	CHECK(table.sbt.Update(copies[0].data(), table.identifiers, 0) == changedBytes);
+	CHECK(table.sbt.Update(copies[0].data(), table.identifiers, 0) == 0);
+
+	// the other copy was never written, it gets everything
+	CHECK(table.sbt.Update(copies[1].data(), table.identifiers, 1) == allRecords);
+
+	// records outside the changed ones are left alone
+	std::vector<uint8_t> before = copies[0];
+	table.sbt.SetHitGroup(0, table.hitGroup, {});
+	table.sbt.Update(copies[0].data(), table.identifiers, 0);
+	uint32_t changedFirst = layout.hitGroup.offset;
+	uint32_t changedLast = changedFirst + layout.hitGroup.stride;
+	CHECK(memcmp(copies[0].data(), before.data(), changedFirst) == 0);
+	CHECK(memcmp(copies[0].data() + changedLast, before.data() + changedLast, layout.size - changedLast) == 0);
+	CHECK(memcmp(copies[0].data() + changedFirst, before.data() + changedFirst, layout.hitGroup.stride) != 0);
+
+	// identifiers of another pipeline rewrite everything
+	FakePipeline otherPipeline;
+	ShaderIdentifierCache other;
+	other.Fill(&otherPipeline, table.sbt.Symbols());
+	CHECK(table.sbt.Update(copies[0].data(), other, 0) == allRecords);
+}
+
+// the scene side of createShaderBindingTable: a record per geometry and ray type, filled by
+// record ranges on the job system
+TEST(sbtFillsAHundredThousandHitGroupsInParallel) {
+	std::vector<uint32_t> geometriesPerInstance(25000);
+	for (uint32_t instance = 0; instance < geometriesPerInstance.size(); instance++) {
+		geometriesPerInstance[instance] = instance % 5;
+	}
+
+	HitGroupTableLayout hitGroups = layoutHitGroupTable(geometriesPerInstance, 2);
+	CHECK(hitGroups.numRecords == 100000);
+
+	// what a record binds, here just where it is
+	auto recordArguments = [&](uint32_t record) {
+		HitGroupRecord hit = locateHitGroupRecord(hitGroups, record);
+		return std::vector<uint32_t>({ hit.instance, hit.geometry, hit.rayType, record });
+	};
+	const uint32_t argumentsSize = 4 * sizeof(uint32_t);
+
+	FakePipeline pipeline;
+	ShaderBindingTableGenerator serial;
+	ShaderBindingTableGenerator parallel;
+	JobSystem jobs(3);
+
+	for (ShaderBindingTableGenerator* sbt : { &serial, &parallel }) {
+		sbt->AddRayGenerationProgram(sbt->Symbols().Intern(L"RayGen"), {});
+		sbt->AddMissProgram(sbt->Symbols().Intern(L"Miss"), {});
+	}
+
+	for (uint32_t record = 0; record < hitGroups.numRecords; record++) {
+		std::vector<uint32_t> arguments = recordArguments(record);
+		serial.AddHitGroup(serial.Symbols().Intern(L"HitGroup"), reinterpret_cast<const uint8_t*>(arguments.data()),
+			argumentsSize);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	ShaderSymbol hitGroup = parallel.Symbols().Intern(L"HitGroup");
+	uint32_t firstHitGroup = parallel.ReserveHitGroups(hitGroups.numRecords, argumentsSize);
+
+	jobs.parallelFor(hitGroups.numRecords, 4096, [&](size_t begin, size_t end) {
+		for (size_t record = begin; record < end; record++) {
+			std::vector<uint32_t> arguments = recordArguments(static_cast<uint32_t>(record));
+			parallel.FillHitGroup(firstHitGroup + static_cast<uint32_t>(record), hitGroup,
+				reinterpret_cast<const uint8_t*>(arguments.data()), argumentsSize);
+		}
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// milliseconds in a release build, the bound leaves room for debug and sanitizer builds
+	CHECK(seconds < 1.0);
+
+	std::vector<uint8_t> tables[2];
+	ShaderBindingTableGenerator* generators[2] = { &serial, &parallel };
+
+	for (int i = 0; i < 2; i++) {
+		ShaderIdentifierCache identifiers;
+		identifiers.Fill(&pipeline, generators[i]->Symbols());
+
+		tables[i].resize(generators[i]->ComputeSBTSize());
+		generators[i]->Generate(tables[i].data(), identifiers);
+	}
+
+	CHECK(serial.GetLayout().hitGroup.count == hitGroups.numRecords);
+	CHECK(tables[0] == tables[1]);
+}
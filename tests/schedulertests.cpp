@@ -0,0 +1,70 @@
+#include "check.h"
+
+#include <algorithm>
+
+#include "scheduler.h"
+
+namespace {
+	// runs frames taking cpuDuration to record and gpuDuration to execute, returns the most
+	// frames that were pending on the GPU while the CPU recorded the next one
+	uint32_t runFrames(FrameScheduler& scheduler, SimulatedGpuTimeline& gpu, uint32_t numFrames,
+		double cpuDuration, double gpuDuration) {
+		uint32_t mostPending = 0;
+
+		for (uint32_t frame = 0; frame < numFrames; frame++) {
+			scheduler.beginFrame(gpu);
+			gpu.advanceCpu(cpuDuration);
+
+			// the frame about to be submitted plus the ones still on the GPU
+			mostPending = std::max(mostPending, scheduler.framesPending(gpu) + 1);
+
+			scheduler.endFrame(gpu.submit(gpu.cpuTime(), gpuDuration));
+		}
+
+		return mostPending;
+	}
+}
+
+TEST(gpuBoundCpuStaysFramesInFlightAhead) {
+	for (uint32_t framesInFlight = 1; framesInFlight <= kMaxFramesInFlight; framesInFlight++) {
+		FrameScheduler scheduler(framesInFlight);
+		SimulatedGpuTimeline gpu;
+
+		uint32_t mostPending = runFrames(scheduler, gpu, 100, 0.001, 0.005);
+
+		CHECK(mostPending == framesInFlight);
+		CHECK(gpu.totalWaitTime() > 0.0);
+	}
+}
+
+// with one frame in flight the CPU always waits for the frame before, from two on it never has to
+TEST(cpuBoundNeverWaits) {
+	for (uint32_t framesInFlight = 2; framesInFlight <= kMaxFramesInFlight; framesInFlight++) {
+		FrameScheduler scheduler(framesInFlight);
+		SimulatedGpuTimeline gpu;
+
+		uint32_t mostPending = runFrames(scheduler, gpu, 100, 0.005, 0.001);
+
+		CHECK(mostPending == 1);
+		CHECK(gpu.totalWaitTime() == 0.0);
+	}
+}
+
+TEST(framesInFlightChangesAtRuntime) {
+	FrameScheduler scheduler(3);
+	SimulatedGpuTimeline gpu;
+
+	CHECK(runFrames(scheduler, gpu, 20, 0.001, 0.005) == 3);
+
+	scheduler.setFramesInFlight(1);
+	runFrames(scheduler, gpu, 1, 0.001, 0.005); // drains what was queued at 3
+	CHECK(runFrames(scheduler, gpu, 20, 0.001, 0.005) == 1);
+
+	scheduler.setFramesInFlight(2);
+	CHECK(runFrames(scheduler, gpu, 20, 0.001, 0.005) == 2);
+}
+
+TEST(framesInFlightIsClamped) {
+	CHECK(FrameScheduler(0).framesInFlight() == 1);
+	CHECK(FrameScheduler(kMaxFramesInFlight + 5).framesInFlight() == kMaxFramesInFlight);
+}
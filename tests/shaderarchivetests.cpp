@@ -0,0 +1,71 @@
+#include "check.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "shaderarchive.h"
+
+namespace {
+	std::filesystem::path testDirectory() {
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "cputests-shaderarchive";
+		std::filesystem::create_directories(directory);
+		return directory;
+	}
+
+	void writeText(const std::filesystem::path& path, const std::string& text) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+}
+
+TEST(archiveRoundTripsBlobsAndSourceHashes) {
+	std::filesystem::path path = testDirectory() / "shaders.pak";
+
+	ShaderArchiveWriter writer;
+	writer.add("b", "second", 6, 2);
+	writer.add("a", "first", 5, 1);
+	writer.add("b", "replaced", 8, 3);
+	CHECK(writer.size() == 2);
+	CHECK(writer.write(path));
+
+	ShaderArchive archive;
+	CHECK(archive.open(path));
+	CHECK(archive.size() == 2);
+
+	ShaderArchiveBlob blob;
+	CHECK(archive.find("b", blob));
+	CHECK(blob.size == 8 && memcmp(blob.data, "replaced", 8) == 0);
+	CHECK(blob.sourceHash == 3);
+	CHECK(archive.find("a", blob));
+	CHECK(blob.sourceHash == 1);
+	CHECK(!archive.find("c", blob));
+}
+
+TEST(archiveRejectsCorruptBlobs) {
+	std::filesystem::path path = testDirectory() / "corrupt.pak";
+
+	ShaderArchiveWriter writer;
+	writer.add("a", "first", 5);
+	CHECK(writer.write(path));
+
+	std::vector<char> bytes(std::filesystem::file_size(path));
+	std::ifstream(path, std::ios::binary).read(bytes.data(), bytes.size());
+	bytes.back() ^= 1;
+	std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+
+	ShaderArchive archive;
+	CHECK(!archive.open(path));
+}
+
+// what loadShaderFromArchive compares, an edit anywhere in the include tree changes it
+TEST(sourceHashFollowsIncludes) {
+	std::filesystem::path directory = testDirectory();
+	writeText(directory / "Common.hlsl", "float4 tint;\n");
+	writeText(directory / "Main.hlsl", "#include \"Common.hlsl\"\nfloat4 main() { return tint; }\n");
+
+	uint64_t before = shaderSourceHash(gatherShaderSources(directory / "Main.hlsl"));
+	CHECK(before == shaderSourceHash(gatherShaderSources(directory / "Main.hlsl")));
+
+	writeText(directory / "Common.hlsl", "float4 tint = 1;\n");
+	CHECK(shaderSourceHash(gatherShaderSources(directory / "Main.hlsl")) != before);
+}
@@ -0,0 +1,177 @@
+#include "check.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "shadercache.h"
+
+namespace {
+	// an empty cache in a directory of its own
+	std::filesystem::path testDirectory(const char* name) {
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "cputests-shadercache" / name;
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		return directory;
+	}
+
+	void writeText(const std::filesystem::path& path, const std::string& text) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+
+	std::vector<char> readBytes(const std::filesystem::path& path) {
+		std::vector<char> bytes(std::filesystem::file_size(path));
+		std::ifstream(path, std::ios::binary).read(bytes.data(), bytes.size());
+		return bytes;
+	}
+
+	void writeBytes(const std::filesystem::path& path, const std::vector<char>& bytes) {
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+	}
+
+	bool sameStats(const ShaderCacheStats& stats, uint32_t hits, uint32_t misses, uint32_t stores, uint32_t rejected) {
+		return stats.hits == hits && stats.misses == misses && stats.stores == stores && stats.rejected == rejected;
+	}
+
+	const char kBlob[] = "DXBC library";
+
+	std::vector<ShaderSourceFile> rayGenSources() {
+		return { { "RayGen.hlsl", "#include \"Common.hlsl\"\n[shader(\"raygeneration\")] void RayGen() {}\n", true },
+			{ "Common.hlsl", "struct HitInfo { float4 colorAndDistance; };\n", true } };
+	}
+
+	ShaderCompileOptions libraryOptions() {
+		ShaderCompileOptions options;
+		options.profile = "lib_6_3";
+		options.arguments = { "-Zi", "-Qembed_debug", "-O3" };
+		options.defines = { "VERTEX_COLOR=1", "ALPHA_TEST=0" };
+		options.compilerVersion = "1.7.2308";
+		return options;
+	}
+}
+
+TEST(shaderCacheRoundTrip) {
+	ShaderCache cache(testDirectory("roundtrip"));
+	ShaderCacheEntry entry;
+
+	CHECK(!cache.load(1, entry));
+	cache.store(1, kBlob, sizeof(kBlob));
+
+	CHECK(cache.load(1, entry));
+	CHECK(entry.size == sizeof(kBlob) && memcmp(entry.data, kBlob, sizeof(kBlob)) == 0);
+	CHECK(!cache.load(2, entry));
+	CHECK(sameStats(cache.stats(), 1, 2, 1, 0));
+
+	// another extension is another cache in the same directory
+	ShaderCache other(cache.directory(), ".bin");
+	CHECK(!other.load(1, entry));
+	CHECK(sameStats(other.stats(), 0, 1, 0, 0));
+}
+
+TEST(shaderCacheRejectsDamagedFiles) {
+	ShaderCache cache(testDirectory("damaged"));
+	ShaderCacheEntry entry;
+
+	cache.store(1, kBlob, sizeof(kBlob));
+	std::filesystem::path path = cache.directory() / (formatShaderCacheKey(1) + ".dxil");
+	std::vector<char> bytes = readBytes(path);
+
+	// truncated in the header and in the payload
+	for (size_t size : { size_t(0), size_t(10), bytes.size() - 1 }) {
+		writeBytes(path, std::vector<char>(bytes.begin(), bytes.begin() + size));
+		CHECK(!cache.load(1, entry));
+	}
+
+	// a flipped payload byte
+	std::vector<char> corrupt = bytes;
+	corrupt.back() ^= 1;
+	writeBytes(path, corrupt);
+	CHECK(!cache.load(1, entry));
+
+	// a valid file under another key's name
+	writeBytes(cache.directory() / (formatShaderCacheKey(2) + ".dxil"), bytes);
+	CHECK(!cache.load(2, entry));
+
+	// the empty file doesn't map, so it counts as missing rather than rejected
+	CHECK(sameStats(cache.stats(), 0, 5, 1, 4));
+
+	// the next store replaces the damaged file
+	cache.store(1, kBlob, sizeof(kBlob));
+	CHECK(cache.load(1, entry));
+}
+
+TEST(shaderCacheKeyCoversTheCompile) {
+	const std::vector<ShaderSourceFile> sources = rayGenSources();
+	const ShaderCompileOptions options = libraryOptions();
+	const uint64_t key = shaderCacheKey(sources, options);
+
+	CHECK(shaderCacheKey(rayGenSources(), libraryOptions()) == key);
+
+	std::vector<uint64_t> keys = { key };
+	auto changed = [&](const ShaderCompileOptions& changedOptions, const std::vector<ShaderSourceFile>& changedSources) {
+		uint64_t changedKey = shaderCacheKey(changedSources, changedOptions);
+		for (uint64_t other : keys) {
+			if (other == changedKey) {
+				return false;
+			}
+		}
+		keys.push_back(changedKey);
+		return true;
+	};
+
+	ShaderCompileOptions profile = options;
+	profile.profile = "lib_6_5";
+	CHECK(changed(profile, sources));
+
+	ShaderCompileOptions version = options;
+	version.compilerVersion = "1.8.2407";
+	CHECK(changed(version, sources));
+
+	for (size_t i = 0; i < options.arguments.size(); i++) {
+		ShaderCompileOptions argument = options;
+		argument.arguments[i] += " ";
+		CHECK(changed(argument, sources));
+
+		ShaderCompileOptions dropped = options;
+		dropped.arguments.erase(dropped.arguments.begin() + i);
+		CHECK(changed(dropped, sources));
+	}
+
+	ShaderCompileOptions order = options;
+	std::swap(order.arguments[0], order.arguments[2]);
+	CHECK(changed(order, sources));
+
+	for (size_t i = 0; i < options.defines.size(); i++) {
+		ShaderCompileOptions define = options;
+		define.defines[i].back() = '2';
+		CHECK(changed(define, sources));
+	}
+
+	// arguments and defines don't run into each other
+	ShaderCompileOptions moved = options;
+	moved.defines.insert(moved.defines.begin(), moved.arguments.back());
+	moved.arguments.pop_back();
+	CHECK(changed(moved, sources));
+
+	std::vector<ShaderSourceFile> include = sources;
+	include[1].contents += "float4 tint;\n";
+	CHECK(changed(options, include));
+}
+
+TEST(shaderCacheKeyChangesWhenAMissingIncludeAppears) {
+	std::filesystem::path directory = testDirectory("includes");
+	writeText(directory / "Main.hlsl", "#include \"Missing.hlsl\"\nfloat4 main() { return 0; }\n");
+
+	std::vector<ShaderSourceFile> before = gatherShaderSources(directory / "Main.hlsl");
+	CHECK(before.size() == 2 && !before[1].found);
+
+	uint64_t key = shaderCacheKey(before, libraryOptions());
+	CHECK(shaderCacheKey(gatherShaderSources(directory / "Main.hlsl"), libraryOptions()) == key);
+
+	// even an empty file is different from none
+	writeText(directory / "Missing.hlsl", "");
+
+	std::vector<ShaderSourceFile> after = gatherShaderSources(directory / "Main.hlsl");
+	CHECK(after.size() == 2 && after[1].found);
+	CHECK(shaderCacheKey(after, libraryOptions()) != key);
+}
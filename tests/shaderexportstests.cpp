@@ -0,0 +1,108 @@
+#include "check.h"
+
+#include <functional>
+#include <stdexcept>
+
+#include "dxr/ShaderExports.h"
+
+using namespace nv_helpers_dx12;
+
+namespace {
+	// symbols of the app's pipeline and of the additions growing it
+	enum TestSymbol : ShaderSymbol {
+		kRayGen,
+		kMiss,
+		kClosestHit,
+		kHitGroup,
+		kShadowHitGroup,
+		kNewClosestHit,
+		kNewHitGroup,
+		kNumSymbols
+	};
+
+	// the pipeline of the generator's example: a ray generation, a miss and a hit group
+	ShaderExports generatedPipeline() {
+		ShaderExports exports;
+		exports.libraries = { { kRayGen }, { kMiss }, { kClosestHit } };
+		exports.hitGroups = { { kHitGroup, kClosestHit, kNoShaderSymbol, kNoShaderSymbol } };
+		exports.associations = { { kRayGen }, { kMiss }, { kHitGroup } };
+		return exports;
+	}
+
+	// what is in the pipeline above, the additions start after it
+	const size_t kFirstLibrary = 3;
+	const size_t kFirstHitGroup = 1;
+	const size_t kFirstAssociation = 3;
+
+	bool throwsLogicError(const std::function<void()>& run) {
+		try {
+			run();
+		}
+		catch (const std::logic_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	bool checkAdditionsThrows(const ShaderExports& exports) {
+		return throwsLogicError([&]() {
+			CheckShaderExports(exports, kNumSymbols, kFirstLibrary, kFirstHitGroup, kFirstAssociation);
+		});
+	}
+}
+
+TEST(pipelineExportsHitGroupsInsteadOfTheirShaders) {
+	ShaderExports exports = generatedPipeline();
+
+	CHECK(!throwsLogicError([&]() { CheckShaderExports(exports, kNumSymbols, 0, 0, 0); }));
+	CHECK(ListShaderExports(exports, kNumSymbols, 0, 0) == std::vector<ShaderSymbol>({ kRayGen, kMiss, kHitGroup }));
+
+	// a hit group on an unknown shader, and a shader exported twice
+	ShaderExports unknown = generatedPipeline();
+	unknown.hitGroups.push_back({ kShadowHitGroup, kNewClosestHit, kNoShaderSymbol, kNoShaderSymbol });
+	CHECK(throwsLogicError([&]() { CheckShaderExports(unknown, kNumSymbols, 0, 0, 0); }));
+
+	ShaderExports twice = generatedPipeline();
+	twice.libraries.push_back({ kMiss });
+	CHECK(throwsLogicError([&]() { CheckShaderExports(twice, kNumSymbols, 0, 0, 0); }));
+}
+
+TEST(additionsReuseThePipelinesShaders) {
+	// a material hit group on the closest hit shader already in the pipeline, nothing compiled
+	ShaderExports exports = generatedPipeline();
+	exports.hitGroups.push_back({ kShadowHitGroup, kClosestHit, kNoShaderSymbol, kNoShaderSymbol });
+	exports.associations.push_back({ kShadowHitGroup });
+
+	CHECK(!checkAdditionsThrows(exports));
+	CHECK(ListShaderExports(exports, kNumSymbols, kFirstLibrary, kFirstHitGroup) ==
+		std::vector<ShaderSymbol>({ kShadowHitGroup }));
+
+	// and one with a shader of its own, whose library comes with it
+	exports.libraries.push_back({ kNewClosestHit });
+	exports.hitGroups.push_back({ kNewHitGroup, kNewClosestHit, kNoShaderSymbol, kNoShaderSymbol });
+	exports.associations.push_back({ kNewHitGroup });
+
+	CHECK(!checkAdditionsThrows(exports));
+	CHECK(ListShaderExports(exports, kNumSymbols, kFirstLibrary, kFirstHitGroup) ==
+		std::vector<ShaderSymbol>({ kShadowHitGroup, kNewHitGroup }));
+}
+
+TEST(additionsOnlyAssociateNewExports) {
+	// the pipeline's exports already have their root signature
+	for (ShaderSymbol old : { kRayGen, kClosestHit, kHitGroup }) {
+		ShaderExports exports = generatedPipeline();
+		exports.hitGroups.push_back({ kShadowHitGroup, kClosestHit, kNoShaderSymbol, kNoShaderSymbol });
+		exports.associations.push_back({ kShadowHitGroup, old });
+
+		CHECK(checkAdditionsThrows(exports));
+	}
+
+	// nor can a shader be defined again, or a hit group use one nobody defines
+	ShaderExports twice = generatedPipeline();
+	twice.libraries.push_back({ kClosestHit });
+	CHECK(checkAdditionsThrows(twice));
+
+	ShaderExports unknown = generatedPipeline();
+	unknown.hitGroups.push_back({ kNewHitGroup, kClosestHit, kNewClosestHit, kNoShaderSymbol });
+	CHECK(checkAdditionsThrows(unknown));
+}
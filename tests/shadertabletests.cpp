@@ -0,0 +1,98 @@
+#include "check.h"
+
+#include "dxr/DirtyRecordTracker.h"
+#include "dxr/ShaderRecordLayout.h"
+
+using namespace nv_helpers_dx12;
+
+namespace {
+	bool rangesAre(const std::vector<DirtyRecordTracker::Range>& ranges,
+		const std::vector<std::pair<uint32_t, uint32_t>>& expected) {
+		if (ranges.size() != expected.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < ranges.size(); i++) {
+			if (ranges[i].first != expected[i].first || ranges[i].count != expected[i].second) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// one ray generation record, which is a table of its own, two miss and three hit group records
+	constexpr ShaderTableLayout kLayout = ComputeShaderTableLayout(kShaderIdentifierSize + 8, 1,
+		kShaderIdentifierSize, 2, kShaderIdentifierSize + 12, 3);
+
+	static_assert(kLayout.rayGen.offset == 0 && kLayout.rayGen.stride == 64);
+	static_assert(kLayout.miss.offset == 64 && kLayout.miss.stride == 32);
+	static_assert(kLayout.hitGroup.offset == 128 && kLayout.hitGroup.stride == 64);
+	static_assert(kLayout.size == 320);
+}
+
+TEST(dirtyRangesAreSortedAndCoalesced) {
+	DirtyRecordTracker tracker;
+	tracker.Resize(16);
+	tracker.TakeRanges(0);
+	CHECK(!tracker.IsDirty(0));
+
+	for (uint32_t record : { 9u, 3u, 4u, 8u, 3u, 15u, 5u, 20u }) {
+		tracker.MarkDirty(record);
+	}
+
+	CHECK(tracker.IsDirty(0));
+	CHECK(rangesAre(tracker.TakeRanges(0), { { 3, 3 }, { 8, 2 }, { 15, 1 } }));
+	CHECK(!tracker.IsDirty(0));
+	CHECK(tracker.TakeRanges(0).empty());
+}
+
+TEST(firstSeenCopyIsAllDirty) {
+	DirtyRecordTracker tracker;
+	tracker.Resize(8);
+	tracker.TakeRanges(0);
+	tracker.MarkDirty(2);
+
+	// copy 2 was never taken, it has nothing of the table yet
+	CHECK(tracker.IsDirty(2));
+	CHECK(rangesAre(tracker.TakeRanges(2), { { 0, 8 } }));
+	CHECK(rangesAre(tracker.TakeRanges(0), { { 2, 1 } }));
+
+	// copy 1 came into existence with copy 2 and is still untouched
+	CHECK(rangesAre(tracker.TakeRanges(1), { { 0, 8 } }));
+}
+
+TEST(resizeMarksEveryCopyDirty) {
+	DirtyRecordTracker tracker;
+	tracker.Resize(4);
+	tracker.TakeRanges(0);
+	tracker.TakeRanges(1);
+
+	tracker.Resize(6);
+	CHECK(tracker.NumRecords() == 6);
+	CHECK(rangesAre(tracker.TakeRanges(0), { { 0, 6 } }));
+	CHECK(rangesAre(tracker.TakeRanges(1), { { 0, 6 } }));
+}
+
+TEST(shaderTableSectionsAreAligned) {
+	for (uint32_t recordSize = kShaderIdentifierSize; recordSize <= 256; recordSize += 4) {
+		for (uint32_t count = 0; count < 4; count++) {
+			ShaderTableLayout layout = ComputeShaderTableLayout(recordSize, 1, recordSize + 8, count,
+				recordSize + 4, count + 1);
+			const ShaderTableSection* sections[] = { &layout.rayGen, &layout.miss, &layout.hitGroup };
+
+			// DispatchRays takes each ray generation record as a table of its own
+			CHECK(layout.rayGen.stride % kShaderTableAlignment == 0);
+
+			uint32_t end = 0;
+			for (const ShaderTableSection* section : sections) {
+				CHECK(section->offset % kShaderTableAlignment == 0);
+				CHECK(section->offset >= end && section->offset - end < kShaderTableAlignment);
+				CHECK(section->stride % kShaderRecordAlignment == 0);
+				end = section->offset + section->Size();
+			}
+
+			CHECK(layout.miss.stride >= recordSize + 8 && layout.miss.stride - (recordSize + 8) < kShaderRecordAlignment);
+			CHECK(layout.hitGroup.stride >= recordSize + 4 && layout.hitGroup.stride - (recordSize + 4) < kShaderRecordAlignment);
+			CHECK(layout.size % kShaderTableAlignment == 0 && layout.size >= end && layout.size - end < kShaderTableAlignment);
+		}
+	}
+}
@@ -0,0 +1,134 @@
+#include "check.h"
+
+#include <fstream>
+#include <thread>
+
+#include "shadercache.h"
+#include "shaderwatch.h"
+
+namespace {
+	// the app's shaders, as ShaderIndex numbers them
+	enum TestShader : uint32_t {
+		kRayGen,
+		kHit,
+		kMiss,
+		kVertex,
+		kPixel
+	};
+
+	const std::filesystem::path kShaderDirectory = CPUTESTS_SHADER_DIRECTORY;
+
+	// built the way the app does, from each shader's include scan
+	ShaderDependencyGraph applicationGraph() {
+		const char* files[] = { "RayGen.hlsl", "Hit.hlsl", "Miss.hlsl", "Vertex.hlsl", "Pixel.hlsl" };
+		ShaderDependencyGraph graph;
+
+		for (uint32_t shader = kRayGen; shader <= kPixel; shader++) {
+			std::vector<std::filesystem::path> sources;
+			for (const ShaderSourceFile& source : gatherShaderSources(kShaderDirectory / files[shader])) {
+				sources.push_back(source.path);
+			}
+			graph.setFiles(shader, sources);
+		}
+
+		return graph;
+	}
+
+	std::filesystem::path testDirectory() {
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "cputests-shaderwatch";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		return directory;
+	}
+
+	void writeText(const std::filesystem::path& path, const std::string& text) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+}
+
+TEST(commonEditRebuildsTheRayTracingLibraries) {
+	ShaderDependencyGraph graph = applicationGraph();
+
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Common.hlsl" }) == std::vector<uint32_t>({ kRayGen, kHit, kMiss }));
+
+	// a path spelled differently still names the file
+	CHECK(graph.affectedRoots({ kShaderDirectory / "." / "Common.hlsl" }).size() == 3);
+}
+
+TEST(shaderEditsRebuildOnlyThemselves) {
+	ShaderDependencyGraph graph = applicationGraph();
+
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Vertex.hlsl" }) == std::vector<uint32_t>({ kVertex }));
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Pixel.hlsl" }) == std::vector<uint32_t>({ kPixel }));
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Hit.hlsl" }) == std::vector<uint32_t>({ kHit }));
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Vertex.hlsl", kShaderDirectory / "Miss.hlsl" }) ==
+		std::vector<uint32_t>({ kMiss, kVertex }));
+
+	// nothing reads it
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Unused.hlsl" }).empty());
+
+	// a lost track of changes rebuilds everything in the directory
+	CHECK(graph.affectedRoots({ kShaderDirectory }).size() == 5);
+
+	graph.remove(kHit);
+	CHECK(graph.affectedRoots({ kShaderDirectory / "Common.hlsl" }) == std::vector<uint32_t>({ kRayGen, kMiss }));
+}
+
+TEST(debouncerWaitsForAQuietPeriod) {
+	using namespace std::chrono;
+	const ChangeDebouncer::Clock::time_point start;
+	ChangeDebouncer debouncer(milliseconds(100));
+
+	CHECK(debouncer.take(start).empty());
+
+	// an editor saving in steps, each change restarts the quiet period
+	debouncer.add({ "Common.hlsl" }, start);
+	debouncer.add({ "Common.hlsl.tmp" }, start + milliseconds(30));
+	debouncer.add({ "Common.hlsl", "Hit.hlsl" }, start + milliseconds(60));
+	debouncer.add({}, start + milliseconds(120));
+
+	CHECK(debouncer.take(start + milliseconds(150)).empty());
+
+	// everything at once, each file once
+	std::vector<std::filesystem::path> changes = debouncer.take(start + milliseconds(160));
+	CHECK(changes == std::vector<std::filesystem::path>({ "Common.hlsl", "Common.hlsl.tmp", "Hit.hlsl" }));
+	CHECK(debouncer.take(start + seconds(10)).empty());
+}
+
+#ifndef _WIN32
+TEST(inotifyReportsChangedFiles) {
+	std::filesystem::path directory = testDirectory();
+	writeText(directory / "Common.hlsl", "float4 tint;\n");
+
+	DirectoryWatcher watcher;
+	CHECK(watcher.open(directory));
+	CHECK(watcher.poll().empty());
+
+	// written twice, reported once
+	writeText(directory / "Common.hlsl", "float4 tint = 1;\n");
+	writeText(directory / "Common.hlsl", "float4 tint = 2;\n");
+	writeText(directory / "Hit.hlsl", "#include \"Common.hlsl\"\n");
+
+	std::vector<std::filesystem::path> changes;
+	for (int attempt = 0; attempt < 100 && changes.size() < 2; attempt++) {
+		std::vector<std::filesystem::path> polled = watcher.poll();
+		changes.insert(changes.end(), polled.begin(), polled.end());
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	CHECK(changes == std::vector<std::filesystem::path>({ directory / "Common.hlsl", directory / "Hit.hlsl" }));
+
+	std::filesystem::remove(directory / "Hit.hlsl");
+	std::vector<std::filesystem::path> removed;
+	for (int attempt = 0; attempt < 100 && removed.empty(); attempt++) {
+		removed = watcher.poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(removed == std::vector<std::filesystem::path>({ directory / "Hit.hlsl" }));
+
+	DirectoryWatcher missing;
+	CHECK(!missing.open(directory / "missing"));
+	CHECK(!missing.isOpen() && missing.poll().empty());
+}
+#endif
@@ -0,0 +1,214 @@
+#include "check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "startup.h"
+
+namespace {
+	// records the order steps ran in, from whichever thread runs them
+	struct StepLog {
+		std::mutex mutex;
+		std::vector<std::string> order;
+		std::vector<std::thread::id> threads;
+
+		void ran(const std::string& name) {
+			std::lock_guard<std::mutex> lock(mutex);
+			order.push_back(name);
+			threads.push_back(std::this_thread::get_id());
+		}
+
+		size_t position(const std::string& name) const {
+			return std::find(order.begin(), order.end(), name) - order.begin();
+		}
+	};
+
+	StartupStep logged(std::vector<StartupStep> dependencies, StepLog& log, std::string name) {
+		for (const StartupStep& dependency : dependencies) {
+			co_await dependency;
+		}
+		log.ran(name);
+	}
+
+	// arrives, then waits for the other side of the diamond, which only comes if both run at once
+	StartupStep meet(StartupStep root, std::atomic<int>& arrived, bool& met) {
+		co_await root;
+		arrived++;
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (arrived < 2 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		met = arrived == 2;
+	}
+
+	StartupStep fail(const char* message) {
+		throw std::runtime_error(message);
+		co_return;
+	}
+
+	// awaits the failing step and notes that it rethrew there
+	StartupStep awaitFailing(StartupStep failing, bool& rethrown) {
+		try {
+			co_await failing;
+		}
+		catch (const std::runtime_error&) {
+			rethrown = true;
+			throw;
+		}
+	}
+
+	StartupStep onMainThread(StartupGraph& startup, std::thread::id& before, std::thread::id& after) {
+		before = std::this_thread::get_id();
+		co_await startup.mainThread();
+		after = std::this_thread::get_id();
+	}
+
+	std::string waitError(StartupGraph& startup) {
+		try {
+			startup.wait();
+		}
+		catch (const std::runtime_error& error) {
+			return error.what();
+		}
+		return "";
+	}
+
+	StartupStepTiming timing(const char* name, double start, double end, std::vector<uint32_t> dependencies) {
+		return { name, start, end, end - start, false, false, dependencies };
+	}
+}
+
+TEST(diamondStepsRunConcurrently) {
+	JobSystem jobs(3);
+	StartupGraph startup(jobs);
+	StepLog log;
+	std::atomic<int> arrived = 0;
+	bool leftMet = false;
+	bool rightMet = false;
+
+	StartupStep root = startup.add("root", logged({}, log, "root"));
+	StartupStep left = startup.add("left", meet(root, arrived, leftMet));
+	StartupStep right = startup.add("right", meet(root, arrived, rightMet));
+	StartupStep bottom = startup.add("bottom", logged({ left, right }, log, "bottom"));
+	startup.wait();
+
+	CHECK(leftMet && rightMet);
+	CHECK(log.order == std::vector<std::string>({ "root", "bottom" }));
+	CHECK(root.finished() && left.finished() && right.finished() && bottom.finished());
+
+	std::vector<StartupStepTiming> timings = startup.timings();
+	CHECK(timings[1].dependencies == std::vector<uint32_t>({ 0 }));
+	CHECK(timings[3].dependencies == std::vector<uint32_t>({ 1, 2 }));
+	CHECK(timings[3].start >= timings[1].end || timings[3].start >= timings[2].end);
+	for (const StartupStepTiming& step : timings) {
+		CHECK(!step.failed && !step.mainThread && step.end >= step.start);
+	}
+}
+
+TEST(failingStepRethrowsInDependentsAndWait) {
+	JobSystem jobs(2);
+	StartupGraph startup(jobs);
+	StepLog log;
+	bool rethrown = false;
+
+	StartupStep device = startup.add("device", fail("no device"));
+	startup.add("load", awaitFailing(device, rethrown));
+	StartupStep shaders = startup.add("shaders", logged({ device }, log, "shaders"));
+	startup.add("window", logged({}, log, "window"));
+	startup.add("present", logged({ shaders }, log, "present"));
+
+	// the first failure is reported, not what the steps after it rethrew
+	CHECK(waitError(startup) == "no device");
+	CHECK(rethrown);
+
+	// the steps awaiting it failed without running on, the others ran
+	CHECK(log.order == std::vector<std::string>({ "window" }));
+
+	std::vector<StartupStepTiming> timings = startup.timings();
+	for (uint32_t step : { 0, 1, 2, 4 }) {
+		CHECK(timings[step].failed);
+	}
+	CHECK(!timings[3].failed);
+}
+
+TEST(mainThreadStepsContinueInWait) {
+	JobSystem jobs(2);
+	StartupGraph startup(jobs);
+	StepLog log;
+	std::thread::id before;
+	std::thread::id after;
+
+	StartupStep window = startup.add("window", onMainThread(startup, before, after));
+	startup.add("swapchain", logged({ window }, log, "swapchain"));
+	startup.wait();
+
+	// started on a worker, returned on the thread that called wait
+	CHECK(before != std::this_thread::get_id());
+	CHECK(after == std::this_thread::get_id());
+	CHECK(log.order == std::vector<std::string>({ "swapchain" }));
+
+	std::vector<StartupStepTiming> timings = startup.timings();
+	CHECK(timings[0].mainThread && !timings[1].mainThread);
+}
+
+TEST(poolWithoutWorkersRunsStartupInWait) {
+	JobSystem jobs(0);
+	StartupGraph startup(jobs);
+	StepLog log;
+	std::thread::id before;
+	std::thread::id after;
+
+	StartupStep device = startup.add("device", logged({}, log, "device"));
+	StartupStep shaders = startup.add("shaders", logged({}, log, "shaders"));
+	StartupStep window = startup.add("window", onMainThread(startup, before, after));
+	StartupStep pipelines = startup.add("pipelines", logged({ shaders, device }, log, "pipelines"));
+	startup.add("scene", logged({ pipelines, window }, log, "scene"));
+
+	// nothing runs before wait
+	CHECK(log.order.empty() && !device.finished());
+
+	startup.wait();
+
+	CHECK(log.order.size() == 4);
+	CHECK(log.position("pipelines") > log.position("device") && log.position("pipelines") > log.position("shaders"));
+	CHECK(log.position("scene") > log.position("pipelines"));
+	for (std::thread::id thread : log.threads) {
+		CHECK(thread == std::this_thread::get_id());
+	}
+	CHECK(before == std::this_thread::get_id() && after == std::this_thread::get_id());
+
+	// failures are reported the same
+	StartupGraph failing(jobs);
+	bool rethrown = false;
+	StartupStep missing = failing.add("device", fail("no adapter"));
+	failing.add("load", awaitFailing(missing, rethrown));
+	CHECK(waitError(failing) == "no adapter" && rethrown);
+}
+
+TEST(criticalPathFollowsTheLastDependency) {
+	// shaders compile longer than the device takes, so the raster pipeline waits on them
+	std::vector<StartupStepTiming> steps = {
+		timing("window", 0.000, 0.006, {}),
+		timing("device", 0.000, 0.020, {}),
+		timing("shaders", 0.000, 0.050, {}),
+		timing("raster pso", 0.050, 0.080, { 1, 2 }),
+		timing("rt pso", 0.050, 0.070, { 1, 2 }),
+		timing("scene", 0.020, 0.060, { 1 }),
+	};
+
+	CHECK(startupCriticalPath(steps) == std::vector<uint32_t>({ 2, 3 }));
+	CHECK(formatStartupTimeline(steps).find("critical path shaders > raster pso\n") != std::string::npos);
+
+	// once the device is slowest, the path goes through it and what it waited for
+	steps[1].dependencies = { 0 };
+	steps[1].end = 0.060;
+	steps[3].start = 0.060;
+	CHECK(startupCriticalPath(steps) == std::vector<uint32_t>({ 0, 1, 3 }));
+
+	// a single step is its own path, nothing has none
+	CHECK(startupCriticalPath({ timing("device", 0.0, 0.1, {}) }) == std::vector<uint32_t>({ 0 }));
+	CHECK(startupCriticalPath({}).empty());
+}
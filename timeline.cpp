@@ -0,0 +1,132 @@
+#include "timeline.h"
+
+#include "helpers.h"
+
+QueueTimeline::~QueueTimeline() {
+	if (m_event) {
+		::CloseHandle(m_event);
+	}
+}
+
+void QueueTimeline::init(ComPtr<ID3D12Device5> device) {
+	m_device = device;
+	m_event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	if (!m_event) {
+		throw std::exception();
+	}
+}
+
+void QueueTimeline::addQueue(QueueType type, ComPtr<ID3D12CommandQueue> queue) {
+	Queue& entry = m_queues[index(type)];
+
+	entry.queue = queue;
+	entry.lastSignaled = 0;
+	throwIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&entry.fence)));
+}
+
+uint64_t QueueTimeline::signal(QueueType type) {
+	Queue& entry = m_queues[index(type)];
+
+	throwIfFailed(entry.queue->Signal(entry.fence.Get(), entry.lastSignaled + 1));
+
+	return ++entry.lastSignaled;
+}
+
+uint64_t QueueTimeline::completedValue(QueueType type) const {
+	const Queue& entry = m_queues[index(type)];
+
+	return entry.fence ? entry.fence->GetCompletedValue() : 0;
+}
+
+void QueueTimeline::gpuWait(QueueType type, const std::vector<QueueWait>& waits) {
+	for (const QueueWait& wait : waits) {
+		// a queue's own work is already ordered
+		if (wait.queue != type) {
+			throwIfFailed(queue(type)->Wait(fence(wait.queue), wait.value));
+		}
+	}
+}
+
+void QueueTimeline::wait(const std::vector<QueueWait>& waits) {
+	std::vector<ID3D12Fence*> fences;
+	std::vector<UINT64> values;
+
+	for (const QueueWait& wait : waits) {
+		if (completedValue(wait.queue) < wait.value) {
+			fences.push_back(fence(wait.queue));
+			values.push_back(wait.value);
+		}
+	}
+
+	if (fences.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_waitMutex);
+
+	throwIfFailed(m_device->SetEventOnMultipleFenceCompletion(fences.data(), values.data(),
+		static_cast<UINT>(fences.size()), D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL, m_event));
+	::WaitForSingleObject(m_event, INFINITE);
+}
+
+void QueueTimeline::flush(QueueType type) {
+	wait(QueueWait{ type, signal(type) });
+}
+
+void QueueTimeline::flushAll() {
+	std::vector<QueueWait> waits;
+
+	for (uint32_t i = 0; i < kNumQueueTypes; i++) {
+		if (m_queues[i].queue) {
+			waits.push_back({ static_cast<QueueType>(i), signal(static_cast<QueueType>(i)) });
+		}
+	}
+
+	wait(waits);
+}
+
+void QueueTimeline::onCompletion(std::vector<QueueWait> waits, std::function<void()> callback) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+
+	m_callbacks.enqueue(std::move(waits), std::move(callback));
+}
+
+size_t QueueTimeline::poll() {
+	uint64_t completedValues[kNumQueueTypes] = {};
+
+	for (uint32_t i = 0; i < kNumQueueTypes; i++) {
+		completedValues[i] = completedValue(static_cast<QueueType>(i));
+	}
+
+	std::vector<std::function<void()>> due;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		due = m_callbacks.takeReady(completedValues);
+	}
+
+	// outside the lock, callbacks may call onCompletion()
+	for (auto& callback : due) {
+		callback();
+	}
+
+	return due.size();
+}
+
+size_t QueueTimeline::pendingCallbacks() const {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+
+	return m_callbacks.pending();
+}
+
+std::vector<QueueWait> QueueTimeline::lastSignaledValues() const {
+	std::vector<QueueWait> waits;
+
+	for (uint32_t i = 0; i < kNumQueueTypes; i++) {
+		if (m_queues[i].queue && m_queues[i].lastSignaled != 0) {
+			waits.push_back({ static_cast<QueueType>(i), m_queues[i].lastSignaled });
+		}
+	}
+
+	return waits;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "queues.h"
+
+using Microsoft::WRL::ComPtr;
+
+// One fence per queue plus everything that hangs off fence values: GPU and CPU waits,
+// completion callbacks and deferred releases. Objects the GPU may still use are handed to
+// deferRelease() instead of being kept alive by a global until the next flush().
+class QueueTimeline {
+public:
+	~QueueTimeline();
+
+	void init(ComPtr<ID3D12Device5> device);
+	void addQueue(QueueType type, ComPtr<ID3D12CommandQueue> queue);
+
+	ID3D12CommandQueue* queue(QueueType type) const { return m_queues[index(type)].queue.Get(); }
+	ID3D12Fence* fence(QueueType type) const { return m_queues[index(type)].fence.Get(); }
+
+	// signals the queue's next fence value and returns it
+	uint64_t signal(QueueType type);
+
+	// the value the next signal() on the queue will use
+	uint64_t nextValue(QueueType type) const { return m_queues[index(type)].lastSignaled + 1; }
+	uint64_t lastSignaled(QueueType type) const { return m_queues[index(type)].lastSignaled; }
+	uint64_t completedValue(QueueType type) const;
+
+	// GPU side, the queue waits for all values before running what is submitted next
+	void gpuWait(QueueType type, const std::vector<QueueWait>& waits);
+
+	// CPU side, blocks until all values are reached, with one event for the whole batch
+	void wait(const std::vector<QueueWait>& waits);
+	void wait(QueueWait value) { wait(std::vector<QueueWait>{ value }); }
+
+	// signals the queue and waits for it, flushAll() does so for every queue at once
+	void flush(QueueType type);
+	void flushAll();
+
+	// callback runs on the thread calling poll() once every wait is satisfied
+	void onCompletion(std::vector<QueueWait> waits, std::function<void()> callback);
+
+	// keeps the object (a ComPtr or anything holding references) alive until the waits are
+	// satisfied, releases it at the next poll() after that
+	template <typename T>
+	void deferRelease(T object, std::vector<QueueWait> waits) {
+		onCompletion(std::move(waits), [object = std::move(object)]() {});
+	}
+
+	// ... until the work submitted so far on every queue has finished
+	template <typename T>
+	void deferRelease(T object) {
+		deferRelease(std::move(object), lastSignaledValues());
+	}
+
+	// runs the callbacks that are due, returns how many
+	size_t poll();
+
+	size_t pendingCallbacks() const;
+
+private:
+	struct Queue {
+		ComPtr<ID3D12CommandQueue> queue;
+		ComPtr<ID3D12Fence> fence;
+		uint64_t lastSignaled = 0;
+	};
+
+	static uint32_t index(QueueType type) { return static_cast<uint32_t>(type); }
+
+	std::vector<QueueWait> lastSignaledValues() const;
+
+	ComPtr<ID3D12Device5> m_device;
+	Queue m_queues[kNumQueueTypes];
+
+	mutable std::mutex m_callbackMutex;
+	CompletionQueue m_callbacks;
+
+	std::mutex m_waitMutex; // the event is shared by all CPU waits
+	HANDLE m_event = nullptr;
+};
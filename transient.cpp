@@ -0,0 +1,121 @@
+#include "transient.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "d3dx12.h"
+#include "helpers.h"
+
+TransientResourcePool::TransientResourcePool(D3D12_HEAP_FLAGS heapFlags)
+	: m_heapFlags(heapFlags) {
+}
+
+uint32_t TransientResourcePool::addResource(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, uint32_t firstPass, uint32_t lastPass) {
+	TransientResourceDesc transientDesc;
+	transientDesc.name = name;
+	transientDesc.firstPass = firstPass;
+	transientDesc.lastPass = lastPass;
+
+	m_descs.push_back(transientDesc);
+	m_entries.push_back({ desc, initialState, nullptr });
+
+	return static_cast<uint32_t>(m_entries.size() - 1);
+}
+
+void TransientResourcePool::build(ComPtr<ID3D12Device5> device) {
+	release();
+
+	if (m_entries.empty()) {
+		return;
+	}
+
+	// the real size and alignment depend on the driver, only known once we ask the device
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &m_entries[i].desc);
+
+		m_descs[i].sizeInBytes = info.SizeInBytes;
+		m_descs[i].alignment = std::max<uint64_t>(info.Alignment, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	}
+
+	m_layout = packTransientResources(m_descs);
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = m_layout.heapSize;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = m_heapFlags;
+
+	throwIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heap)));
+
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		throwIfFailed(device->CreatePlacedResource(m_heap.Get(), m_layout.offsets[i], &m_entries[i].desc,
+			m_entries[i].initialState, nullptr, IID_PPV_ARGS(&m_entries[i].resource)));
+	}
+}
+
+ComPtr<ID3D12Resource> TransientResourcePool::get(uint32_t index) const {
+	return m_entries.at(index).resource;
+}
+
+void TransientResourcePool::setResourceDesc(uint32_t index, const D3D12_RESOURCE_DESC& desc) {
+	m_entries.at(index).desc = desc;
+}
+
+TransientResourcePool::Allocation TransientResourcePool::detach() {
+	Allocation allocation;
+
+	allocation.heap = m_heap;
+	allocation.layout = m_layout;
+
+	for (const auto& entry : m_entries) {
+		allocation.descs.push_back(entry.desc);
+		allocation.resources.push_back(entry.resource);
+	}
+
+	release();
+
+	return allocation;
+}
+
+void TransientResourcePool::attach(Allocation allocation) {
+	if (allocation.resources.size() != m_entries.size()) {
+		throw std::logic_error("TransientResourcePool::attach: allocation has a different number of resources");
+	}
+
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		m_entries[i].desc = allocation.descs[i];
+		m_entries[i].resource = allocation.resources[i];
+	}
+
+	m_heap = allocation.heap;
+	m_layout = allocation.layout;
+}
+
+void TransientResourcePool::aliasingBarriers(ComPtr<ID3D12GraphicsCommandList4> commandList, uint32_t pass) const {
+	std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+
+	for (const auto& aliasing : m_layout.barriers) {
+		if (aliasing.pass != pass) {
+			continue;
+		}
+
+		ID3D12Resource* before = aliasing.before == kNoTransientResource ?
+			nullptr : m_entries[aliasing.before].resource.Get();
+
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, m_entries[aliasing.after].resource.Get()));
+	}
+
+	if (!barriers.empty()) {
+		commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	}
+}
+
+void TransientResourcePool::release() {
+	for (auto& entry : m_entries) {
+		entry.resource.Reset();
+	}
+
+	m_heap.Reset();
+	m_layout = {};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <Windows.h>
+#include <wrl.h>
+
+#include <d3d12.h>
+
+#include <string>
+#include <vector>
+
+#include "aliasing.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Per-frame render targets that are placed into one shared heap instead of each
+// getting a committed resource of its own. Register the resources with the pass
+// interval they are used in, call build() once, and issue aliasingBarriers() at the
+// start of every pass.
+//
+// Resource heap tier 1 hardware can't mix buffers, RT/DS textures and other textures
+// in one heap, so a pool only holds one category, given by heapFlags.
+class TransientResourcePool {
+public:
+	// the heap and placed resources of one build(), detach() and attach() move them out of
+	// and back into the pool so they can be kept for later instead of being rebuilt
+	struct Allocation {
+		ComPtr<ID3D12Heap> heap;
+		std::vector<D3D12_RESOURCE_DESC> descs;
+		std::vector<ComPtr<ID3D12Resource>> resources;
+		TransientHeapLayout layout;
+	};
+
+	explicit TransientResourcePool(D3D12_HEAP_FLAGS heapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES);
+
+	uint32_t addResource(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, uint32_t firstPass, uint32_t lastPass);
+
+	// pack everything registered so far and create the heap and the placed resources
+	void build(ComPtr<ID3D12Device5> device);
+
+	ComPtr<ID3D12Resource> get(uint32_t index) const;
+
+	// takes effect at the next build(), e.g. to follow the window size
+	void setResourceDesc(uint32_t index, const D3D12_RESOURCE_DESC& desc);
+	const D3D12_RESOURCE_DESC& resourceDesc(uint32_t index) const { return m_entries.at(index).desc; }
+
+	// Takes the current heap and resources out, the pool is empty afterwards as after release().
+	// The GPU may still be using them, the caller keeps them alive until it is done.
+	Allocation detach();
+
+	// Puts back an allocation detached from this pool, the resource descs are restored with it.
+	// Resources are expected in the state they were created in.
+	void attach(Allocation allocation);
+
+	// record the aliasing barriers needed before the given pass
+	void aliasingBarriers(ComPtr<ID3D12GraphicsCommandList4> commandList, uint32_t pass) const;
+
+	const TransientHeapLayout& layout() const { return m_layout; }
+
+	// drop the heap and all placed resources, registrations are kept so build() can run again
+	void release();
+
+private:
+	struct Entry {
+		D3D12_RESOURCE_DESC desc;
+		D3D12_RESOURCE_STATES initialState;
+		ComPtr<ID3D12Resource> resource;
+	};
+
+	D3D12_HEAP_FLAGS m_heapFlags;
+	std::vector<TransientResourceDesc> m_descs;
+	std::vector<Entry> m_entries;
+	TransientHeapLayout m_layout;
+	ComPtr<ID3D12Heap> m_heap;
+};